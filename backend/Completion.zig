@@ -0,0 +1,344 @@
+// Completion.zig - Word and wiki-link completion from the vault's vocabulary
+//
+// Portable (std + posix mmap). Every note's words and `[[link]]` targets are
+// counted and compiled into an Fst file that is memory-mapped, the way the
+// spell check dictionary is. Words typed since then go into a small in-memory
+// delta that lookups consult alongside the map; once it grows, `compact`
+// folds it into a rebuilt file. Link targets are stored with their `[[`, so
+// completing inside a link is the same prefix lookup as completing a word.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const Fst = @import("Fst.zig");
+const SpellCheck = @import("SpellCheck.zig");
+
+pub const LINK_OPEN = "[[";
+/// Shorter words are not worth completing
+pub const MIN_WORD_LEN = 3;
+/// Delta entries after which `needsCompaction` says to rebuild
+pub const COMPACT_THRESHOLD = 1024;
+/// Most completions one lookup returns
+pub const MAX_RESULTS = 32;
+const MAX_NOTE_SIZE = 16 * 1024 * 1024;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/// The partial word (or `[[link`) before the cursor
+pub const Prefix = struct {
+    /// Offset of the prefix in the text; a chosen completion replaces
+    /// [start, cursor)
+    start: usize,
+    text: []const u8,
+};
+
+// ============================================================================
+// Tokens
+// ============================================================================
+
+/// Add one to the count of every word and link target in `text`. New keys
+/// are allocated from `allocator`.
+pub fn countTokens(allocator: Allocator, text: []const u8, counts: *std.StringHashMapUnmanaged(u32)) !void {
+    var pos: usize = 0;
+    while (SpellCheck.nextWord(text, &pos)) |span| {
+        if (span.end - span.start >= MIN_WORD_LEN) try bump(allocator, counts, text[span.start..span.end], 1);
+    }
+
+    var search: usize = 0;
+    while (std.mem.indexOfPos(u8, text, search, LINK_OPEN)) |open| {
+        const name_start = open + LINK_OPEN.len;
+        const close = std.mem.indexOfPos(u8, text, name_start, "]]") orelse break;
+        search = close + 2;
+        const inner = text[name_start..close];
+        // `[[Note|label]]` and `[[Note#Heading]]` complete to the note
+        const name_end = std.mem.indexOfAny(u8, inner, "|#") orelse inner.len;
+        const name = std.mem.trim(u8, inner[0..name_end], " ");
+        if (name.len == 0 or std.mem.indexOfScalar(u8, name, '\n') != null) continue;
+        if (LINK_OPEN.len + name.len > Fst.MAX_WORD_LEN) continue;
+
+        var buf: [Fst.MAX_WORD_LEN]u8 = undefined;
+        @memcpy(buf[0..LINK_OPEN.len], LINK_OPEN);
+        @memcpy(buf[LINK_OPEN.len..][0..name.len], name);
+        try bump(allocator, counts, buf[0 .. LINK_OPEN.len + name.len], 1);
+    }
+}
+
+fn bump(allocator: Allocator, counts: *std.StringHashMapUnmanaged(u32), key: []const u8, by: u32) !void {
+    const gop = try counts.getOrPut(allocator, key);
+    if (gop.found_existing) {
+        gop.value_ptr.* +|= by;
+    } else {
+        errdefer _ = counts.remove(key);
+        gop.key_ptr.* = try allocator.dupe(u8, key);
+        gop.value_ptr.* = by;
+    }
+}
+
+/// What is being typed at `cursor`: an unclosed `[[link` on the current line,
+/// else the run of word bytes before the cursor. Null if there is neither.
+pub fn prefixAt(text: []const u8, cursor: usize) ?Prefix {
+    const line_start = if (std.mem.lastIndexOfScalar(u8, text[0..cursor], '\n')) |nl| nl + 1 else 0;
+    const line = text[line_start..cursor];
+    if (std.mem.lastIndexOf(u8, line, LINK_OPEN)) |open| {
+        if (std.mem.indexOf(u8, line[open..], "]]") == null and line.len - open <= Fst.MAX_WORD_LEN) {
+            return .{ .start = line_start + open, .text = line[open..] };
+        }
+    }
+
+    var start = cursor;
+    while (start > line_start and isWordByte(text[start - 1])) start -= 1;
+    if (start == cursor or cursor - start > Fst.MAX_WORD_LEN) return null;
+    return .{ .start = start, .text = text[start..cursor] };
+}
+
+/// The word that ends right before `end`, if any
+pub fn wordBefore(text: []const u8, end: usize) ?[]const u8 {
+    var start = end;
+    while (start > 0 and isWordByte(text[start - 1])) start -= 1;
+    var pos = start;
+    const span = SpellCheck.nextWord(text[0..end], &pos) orelse return null;
+    if (span.start != start or span.end != end or end - start < MIN_WORD_LEN) return null;
+    return text[start..end];
+}
+
+fn isWordByte(c: u8) bool {
+    return std.ascii.isAlphanumeric(c) or c == '\'' or c == '_' or c >= 0x80;
+}
+
+// ============================================================================
+// Index
+// ============================================================================
+
+pub const Index = struct {
+    allocator: Allocator,
+    cache_path: []u8,
+    mapped: ?[]align(std.heap.page_size_min) const u8 = null,
+    fst: ?Fst.Transducer = null,
+    /// Weight added per word since the file was built; keys owned
+    delta: std.StringHashMapUnmanaged(u32) = .empty,
+
+    /// Count the vocabulary of every .md file under `vault_root`, compile it
+    /// to `cache_path` and map it.
+    pub fn build(allocator: Allocator, vault_root: []const u8, cache_path: []const u8) !Index {
+        var arena = std.heap.ArenaAllocator.init(allocator);
+        defer arena.deinit();
+        const scratch = arena.allocator();
+
+        var counts = std.StringHashMapUnmanaged(u32).empty;
+        var vault = try std.fs.cwd().openDir(vault_root, .{ .iterate = true });
+        defer vault.close();
+        var walker = try vault.walk(allocator);
+        defer walker.deinit();
+
+        var buffer = std.ArrayList(u8).empty;
+        defer buffer.deinit(allocator);
+        while (try walker.next()) |entry| {
+            if (entry.kind != .file or !std.mem.endsWith(u8, entry.basename, ".md")) continue;
+            // A note can be linked before anything links to it
+            const stem = entry.basename[0 .. entry.basename.len - ".md".len];
+            if (stem.len > 0 and LINK_OPEN.len + stem.len <= Fst.MAX_WORD_LEN) {
+                try bump(scratch, &counts, try std.mem.concat(scratch, u8, &.{ LINK_OPEN, stem }), 1);
+            }
+
+            const file = entry.dir.openFile(entry.basename, .{}) catch continue;
+            defer file.close();
+            const stat = file.stat() catch continue;
+            if (stat.size > MAX_NOTE_SIZE) continue;
+            try buffer.resize(allocator, @intCast(stat.size));
+            const n = file.readAll(buffer.items) catch continue;
+            try countTokens(scratch, buffer.items[0..n], &counts);
+        }
+
+        var entries = try std.ArrayList(Fst.Entry).initCapacity(scratch, counts.count());
+        var it = counts.iterator();
+        while (it.next()) |entry| entries.appendAssumeCapacity(.{ .word = entry.key_ptr.*, .weight = entry.value_ptr.* });
+        try writeFst(scratch, cache_path, entries.items);
+        return open(allocator, cache_path);
+    }
+
+    /// Map an index written earlier by `build` or `compact`.
+    pub fn open(allocator: Allocator, cache_path: []const u8) !Index {
+        var index = Index{ .allocator = allocator, .cache_path = try allocator.dupe(u8, cache_path) };
+        errdefer allocator.free(index.cache_path);
+        try index.remap();
+        return index;
+    }
+
+    pub fn deinit(self: *Index) void {
+        if (self.mapped) |mapped| std.posix.munmap(mapped);
+        var it = self.delta.keyIterator();
+        while (it.next()) |key| self.allocator.free(key.*);
+        self.delta.deinit(self.allocator);
+        self.allocator.free(self.cache_path);
+    }
+
+    /// Count a word (or `[[Note`) typed since the index was built
+    pub fn add(self: *Index, word: []const u8, weight: u32) !void {
+        if (word.len == 0 or word.len > Fst.MAX_WORD_LEN) return;
+        try bump(self.allocator, &self.delta, word, weight);
+    }
+
+    pub fn needsCompaction(self: *const Index) bool {
+        return self.delta.count() >= COMPACT_THRESHOLD;
+    }
+
+    /// Rebuild the file with the delta folded in, then map the new file.
+    pub fn compact(self: *Index) !void {
+        if (self.delta.count() == 0) return;
+        var arena = std.heap.ArenaAllocator.init(self.allocator);
+        defer arena.deinit();
+        const scratch = arena.allocator();
+
+        var entries = std.ArrayList(Fst.Entry).empty;
+        if (self.fst) |*fst| try fst.collect(scratch, &entries);
+        var it = self.delta.iterator();
+        while (it.next()) |entry| try entries.append(scratch, .{ .word = entry.key_ptr.*, .weight = entry.value_ptr.* });
+        try writeFst(scratch, self.cache_path, entries.items);
+        try self.remap();
+
+        var keys = self.delta.keyIterator();
+        while (keys.next()) |key| self.allocator.free(key.*);
+        self.delta.clearRetainingCapacity();
+    }
+
+    /// Up to `out.len` completions of `prefix`, heaviest first, not counting
+    /// `prefix` itself. Returns how many were written.
+    pub fn complete(self: *const Index, prefix: []const u8, out: []Fst.Completion) !usize {
+        if (out.len == 0) return 0;
+        // One extra slot, in case the prefix is itself a word
+        var found_buf: [MAX_RESULTS + 1]Fst.Completion = undefined;
+        const found_slots = found_buf[0..@min(out.len, MAX_RESULTS) + 1];
+
+        var found: usize = 0;
+        if (self.fst) |*fst| found = try fst.complete(self.allocator, prefix, found_slots);
+
+        // Words typed since the build: bump what was found, offer the rest
+        // at their mapped weight plus the delta. A word outside the map's top
+        // k with no delta cannot outrank what was found.
+        const from_map = found;
+        for (found_slots[0..from_map]) |*completion| {
+            if (self.delta.get(completion.slice())) |extra| completion.weight +|= extra;
+        }
+        var it = self.delta.iterator();
+        next: while (it.next()) |entry| {
+            const word = entry.key_ptr.*;
+            if (!std.mem.startsWith(u8, word, prefix)) continue;
+            for (found_slots[0..from_map]) |completion| {
+                if (std.mem.eql(u8, completion.slice(), word)) continue :next;
+            }
+            const mapped_weight = if (self.fst) |*fst| fst.weightOf(word) orelse 0 else 0;
+            var candidate = Fst.Completion{ .len = @intCast(word.len), .weight = mapped_weight +| entry.value_ptr.* };
+            @memcpy(candidate.buf[0..word.len], word);
+            found = offer(found_slots, found, candidate);
+        }
+        std.mem.sort(Fst.Completion, found_slots[0..found], {}, heavierFirst);
+
+        var count: usize = 0;
+        for (found_slots[0..found]) |completion| {
+            if (std.mem.eql(u8, completion.slice(), prefix)) continue;
+            if (count == out.len) break;
+            out[count] = completion;
+            count += 1;
+        }
+        return count;
+    }
+
+    fn remap(self: *Index) !void {
+        const file = try std.fs.cwd().openFile(self.cache_path, .{});
+        defer file.close();
+        const size = (try file.stat()).size;
+        if (size == 0) return error.InvalidFst;
+        const mapped = try std.posix.mmap(null, @intCast(size), std.posix.PROT.READ, .{ .TYPE = .PRIVATE }, file.handle, 0);
+        errdefer std.posix.munmap(mapped);
+        const fst = try Fst.Transducer.init(mapped);
+
+        if (self.mapped) |old| std.posix.munmap(old);
+        self.mapped = mapped;
+        self.fst = fst;
+    }
+};
+
+fn heavierFirst(_: void, a: Fst.Completion, b: Fst.Completion) bool {
+    return a.weight > b.weight;
+}
+
+/// Keep the heaviest `slots.len` completions; returns the new count
+fn offer(slots: []Fst.Completion, count: usize, candidate: Fst.Completion) usize {
+    if (count < slots.len) {
+        slots[count] = candidate;
+        return count + 1;
+    }
+    var lightest: usize = 0;
+    for (slots, 0..) |slot, i| {
+        if (slot.weight < slots[lightest].weight) lightest = i;
+    }
+    if (candidate.weight > slots[lightest].weight) slots[lightest] = candidate;
+    return count;
+}
+
+/// Written to a temp file and renamed into place, so a reader never maps a
+/// half-written index.
+fn writeFst(scratch: Allocator, path: []const u8, entries: []const Fst.Entry) !void {
+    const bytes = try Fst.build(scratch, entries);
+    const tmp_path = try std.fmt.allocPrint(scratch, "{s}.tmp", .{path});
+    {
+        const file = try std.fs.cwd().createFile(tmp_path, .{ .truncate = true });
+        defer file.close();
+        try file.writeAll(bytes);
+    }
+    try std.fs.cwd().rename(tmp_path, path);
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "prefix at the cursor" {
+    const text = "See [[Project Pl and wal";
+    const link = prefixAt(text, 16).?;
+    try std.testing.expectEqualStrings("[[Project Pl", link.text);
+    try std.testing.expectEqual(@as(usize, 4), link.start);
+
+    const closed = "[[Done]] wal";
+    try std.testing.expectEqualStrings("wal", prefixAt(closed, closed.len).?.text);
+    try std.testing.expect(prefixAt("end ", 4) == null);
+    try std.testing.expectEqualStrings("walking", wordBefore("walking ", 7).?);
+    try std.testing.expect(wordBefore("a2b ", 3) == null);
+}
+
+test "vault index with a delta and compaction" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{ .iterate = true });
+    defer tmp.cleanup();
+    try tmp.dir.writeFile(.{ .sub_path = "Walrus.md", .data = "walking walking wall\nsee [[Walrus]] and [[Wall Street|ws]]" });
+    try tmp.dir.writeFile(.{ .sub_path = "b.md", .data = "walking wallet" });
+
+    const root = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(root);
+    const cache = try std.fs.path.join(allocator, &.{ root, "vocab.fst" });
+    defer allocator.free(cache);
+
+    var index = try Index.build(allocator, root, cache);
+    defer index.deinit();
+
+    var out: [4]Fst.Completion = undefined;
+    var n = try index.complete("wal", &out);
+    try std.testing.expectEqual(@as(usize, 3), n);
+    try std.testing.expectEqualStrings("walking", out[0].slice());
+    try std.testing.expectEqual(@as(u32, 3), out[0].weight);
+
+    n = try index.complete("[[Wal", &out);
+    try std.testing.expectEqual(@as(usize, 2), n);
+    try std.testing.expectEqualStrings("[[Walrus", out[0].slice());
+
+    // Typed words rank at once and survive compaction
+    try index.add("wallaby", 5);
+    try index.add("wall", 3);
+    n = try index.complete("wal", &out);
+    try std.testing.expectEqualStrings("wallaby", out[0].slice());
+    try std.testing.expectEqual(@as(u32, 4), out[1].weight);
+    try index.compact();
+    try std.testing.expectEqual(@as(usize, 0), index.delta.count());
+    try std.testing.expectEqual(@as(?u32, 4), index.fst.?.weightOf("wall"));
+}
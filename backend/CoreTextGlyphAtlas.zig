@@ -1,6 +1,8 @@
 const std = @import("std");
 const builtin = @import("builtin");
 const Allocator = std.mem.Allocator;
+const SignedDistanceField = @import("SignedDistanceField.zig");
+const GlyphAtlasTypes = @import("GlyphAtlas.zig");
 
 comptime {
     if (builtin.os.tag != .macos) {
@@ -13,44 +15,16 @@ const c = @cImport({
     @cInclude("CoreFoundation/CoreFoundation.h");
     @cInclude("CoreGraphics/CoreGraphics.h");
 });
-/// Printable ASCII range: space (32) through tilde (126)
-const ASCII_START: u21 = 32;
-const ASCII_END: u21 = 126;
-pub const NUM_CHARS: usize = ASCII_END - ASCII_START + 1;
-pub const GLYPH_PAD: f32 = 2.0;
 
-// ============================================================================
-// Types
-// ============================================================================
+// Atlas types live in the portable GlyphAtlas.zig; this file only rasterizes
+const ASCII_START = GlyphAtlasTypes.ASCII_START;
+pub const NUM_CHARS = GlyphAtlasTypes.NUM_CHARS;
+pub const GLYPH_PAD = GlyphAtlasTypes.GLYPH_PAD;
+pub const SDF_SPREAD = GlyphAtlasTypes.SDF_SPREAD;
 
-pub const GlyphInfo = struct {
-    atlas_x: u32,
-    atlas_y: u32,
-    width: u32,
-    height: u32,
-    bearing_x: f32,
-    bearing_y: f32,
-    advance: f32,
-};
-
-pub const GlyphAtlas = struct {
-    pixels: []u8,
-    width: u32,
-    height: u32,
-    // TODO: probably make this a heap variable without this constraint in the future.
-    glyph_info: [NUM_CHARS]GlyphInfo,
-    line_height: f32,
-    ascent: f32,
-
-    pub fn deinit(self: *GlyphAtlas, allocator: Allocator) void {
-        allocator.free(self.pixels);
-    }
-
-    pub fn getGlyphInfo(self: *const GlyphAtlas, codepoint: u21) ?GlyphInfo {
-        if (codepoint < ASCII_START or codepoint > ASCII_END) return null;
-        return self.glyph_info[codepoint - ASCII_START];
-    }
-};
+pub const GlyphInfo = GlyphAtlasTypes.GlyphInfo;
+pub const AtlasMode = GlyphAtlasTypes.AtlasMode;
+pub const GlyphAtlas = GlyphAtlasTypes.GlyphAtlas;
 
 // ============================================================================
 // Public API — Atlas
@@ -59,7 +33,23 @@ pub const GlyphAtlas = struct {
 pub fn rasterize_atlas(allocator: Allocator, font_size: f64, ttf_data: []const u8) !GlyphAtlas {
     const font_ref = try createCTFont(ttf_data, font_size);
     defer c.CFRelease(font_ref);
-    return rasterize_atlas_with_font(allocator, font_ref);
+    return rasterize_atlas_with_font(allocator, font_ref, @intFromFloat(GLYPH_PAD));
+}
+
+/// Rasterize once at `reference_size` and convert each glyph's coverage into a
+/// signed distance field. Call `setDisplaySize` to zoom without re-rasterizing.
+pub fn rasterize_sdf_atlas(allocator: Allocator, reference_size: f64, ttf_data: []const u8) !GlyphAtlas {
+    const font_ref = try createCTFont(ttf_data, reference_size);
+    defer c.CFRelease(font_ref);
+
+    // Extra padding so the field has room to fall off outside the glyph outline
+    const pad: u32 = @intFromFloat(GLYPH_PAD + SDF_SPREAD);
+    var atlas = try rasterize_atlas_with_font(allocator, font_ref, pad);
+    errdefer atlas.deinit(allocator);
+
+    try SignedDistanceField.generate(allocator, atlas.pixels, atlas.width, atlas.height, SDF_SPREAD, atlas.pixels);
+    atlas.mode = .sdf;
+    return atlas;
 }
 
 // ============================================================================
@@ -87,7 +77,7 @@ fn createCTFont(ttf_data: []const u8, font_size: f64) !c.CTFontRef {
 // Internal — Atlas Rasterization
 // ============================================================================
 
-fn rasterize_atlas_with_font(allocator: Allocator, font_ref: c.CTFontRef) !GlyphAtlas {
+fn rasterize_atlas_with_font(allocator: Allocator, font_ref: c.CTFontRef, pad: u32) !GlyphAtlas {
     // 0. Get font metrics for line layout
     const ascent: f32 = @floatCast(c.CTFontGetAscent(font_ref));
     const descent: f32 = @floatCast(c.CTFontGetDescent(font_ref));
@@ -113,7 +103,6 @@ fn rasterize_atlas_with_font(allocator: Allocator, font_ref: c.CTFontRef) !Glyph
     _ = c.CTFontGetAdvancesForGlyphs(font_ref, c.kCTFontOrientationDefault, &glyph_ids, &advances, NUM_CHARS);
 
     // 3. Compute per-glyph pixel dimensions
-    const pad: u32 = 2;
     var glyph_widths: [NUM_CHARS]u32 = undefined;
     var glyph_heights: [NUM_CHARS]u32 = undefined;
     var has_pixels: [NUM_CHARS]bool = undefined;
@@ -241,5 +230,9 @@ fn rasterize_atlas_with_font(allocator: Allocator, font_ref: c.CTFontRef) !Glyph
         .glyph_info = glyph_info,
         .line_height = line_height,
         .ascent = ascent,
+        .pad = @floatFromInt(pad),
+        .reference_size = @floatCast(c.CTFontGetSize(font_ref)),
+        .reference_line_height = line_height,
+        .reference_ascent = ascent,
     };
 }
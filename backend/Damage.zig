@@ -0,0 +1,239 @@
+// Damage.zig - Damage region bookkeeping for partial redraw
+//
+// Portable (std only). Renderer turns edits, caret moves and selection changes
+// into byte ranges, maps them to horizontal line bands through the layout, and
+// collects them here. Metal then redraws only those bands with scissoring.
+
+const std = @import("std");
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/// Full-width horizontal band in pixel coordinates, [top, bottom).
+pub const Band = struct {
+    top: f32,
+    bottom: f32,
+
+    pub fn isEmpty(self: Band) bool {
+        return self.bottom <= self.top;
+    }
+
+    pub fn intersects(self: Band, other: Band) bool {
+        return self.top < other.bottom and other.top < self.bottom;
+    }
+};
+
+/// Half-open byte range [start, end).
+pub const ByteRange = struct {
+    start: usize,
+    end: usize,
+};
+
+/// Result of diffing two texts: bytes [start, old_end) of the old text were
+/// replaced by bytes [start, new_end) of the new text.
+pub const TextChange = struct {
+    start: usize,
+    old_end: usize,
+    new_end: usize,
+};
+
+/// More bands than this get merged; each band costs a scissored draw pass.
+pub const MAX_BANDS = 4;
+
+/// Small set of disjoint, sorted damage bands (or "everything").
+pub const DamageList = struct {
+    bands: [MAX_BANDS]Band = undefined,
+    len: usize = 0,
+    full: bool = false,
+
+    pub fn markFull(self: *DamageList) void {
+        self.full = true;
+        self.len = 0;
+    }
+
+    pub fn isEmpty(self: *const DamageList) bool {
+        return !self.full and self.len == 0;
+    }
+
+    pub fn slice(self: *const DamageList) []const Band {
+        return self.bands[0..self.len];
+    }
+
+    /// Add a band, merging with any band it overlaps or touches.
+    pub fn add(self: *DamageList, band: Band) void {
+        if (self.full or band.isEmpty()) return;
+
+        var merged = band;
+        var i: usize = 0;
+        while (i < self.len) {
+            const b = self.bands[i];
+            if (b.top <= merged.bottom and merged.top <= b.bottom) {
+                merged.top = @min(merged.top, b.top);
+                merged.bottom = @max(merged.bottom, b.bottom);
+                self.removeAt(i);
+                continue;
+            }
+            i += 1;
+        }
+
+        if (self.len == MAX_BANDS) {
+            // Fold into the band with the smallest gap
+            var best: usize = 0;
+            var best_gap = std.math.floatMax(f32);
+            for (self.bands[0..self.len], 0..) |b, j| {
+                const gap = if (b.bottom < merged.top) merged.top - b.bottom else b.top - merged.bottom;
+                if (gap < best_gap) {
+                    best_gap = gap;
+                    best = j;
+                }
+            }
+            const b = self.bands[best];
+            self.removeAt(best);
+            merged.top = @min(merged.top, b.top);
+            merged.bottom = @max(merged.bottom, b.bottom);
+            return self.add(merged);
+        }
+
+        // Insert sorted by top
+        var pos: usize = self.len;
+        while (pos > 0 and self.bands[pos - 1].top > merged.top) : (pos -= 1) {
+            self.bands[pos] = self.bands[pos - 1];
+        }
+        self.bands[pos] = merged;
+        self.len += 1;
+    }
+
+    /// Drop or trim bands to the visible [top, bottom) region.
+    pub fn clip(self: *DamageList, visible: Band) void {
+        var write: usize = 0;
+        for (self.bands[0..self.len]) |b| {
+            const clipped = Band{ .top = @max(b.top, visible.top), .bottom = @min(b.bottom, visible.bottom) };
+            if (clipped.isEmpty()) continue;
+            self.bands[write] = clipped;
+            write += 1;
+        }
+        self.len = write;
+    }
+
+    fn removeAt(self: *DamageList, index: usize) void {
+        for (index..self.len - 1) |j| {
+            self.bands[j] = self.bands[j + 1];
+        }
+        self.len -= 1;
+    }
+};
+
+// ============================================================================
+// Change Detection
+// ============================================================================
+
+/// Common-prefix/common-suffix diff. Returns null if the texts are equal.
+pub fn diffText(old: []const u8, new: []const u8) ?TextChange {
+    const min_len = @min(old.len, new.len);
+    const prefix = std.mem.indexOfDiff(u8, old[0..min_len], new[0..min_len]) orelse min_len;
+    if (prefix == min_len and old.len == new.len) return null;
+
+    var suffix: usize = 0;
+    const max_suffix = min_len - prefix;
+    while (suffix < max_suffix and old[old.len - 1 - suffix] == new[new.len - 1 - suffix]) {
+        suffix += 1;
+    }
+
+    return .{
+        .start = prefix,
+        .old_end = old.len - suffix,
+        .new_end = new.len - suffix,
+    };
+}
+
+/// Byte ranges whose selected state differs between two selections
+/// (symmetric difference). Writes at most two ranges into `out`.
+pub fn selectionChanges(old: ?ByteRange, new: ?ByteRange, out: *[2]ByteRange) usize {
+    const a = old orelse ByteRange{ .start = 0, .end = 0 };
+    const b = new orelse ByteRange{ .start = 0, .end = 0 };
+    if (a.start == b.start and a.end == b.end) return 0;
+
+    const a_empty = a.end <= a.start;
+    const b_empty = b.end <= b.start;
+    if (a_empty or b_empty or a.end <= b.start or b.end <= a.start) {
+        // Disjoint: both ranges changed completely
+        var n: usize = 0;
+        if (!a_empty) {
+            out[n] = a;
+            n += 1;
+        }
+        if (!b_empty) {
+            out[n] = b;
+            n += 1;
+        }
+        return n;
+    }
+
+    var n: usize = 0;
+    if (a.start != b.start) {
+        out[n] = .{ .start = @min(a.start, b.start), .end = @max(a.start, b.start) };
+        n += 1;
+    }
+    if (a.end != b.end) {
+        out[n] = .{ .start = @min(a.end, b.end), .end = @max(a.end, b.end) };
+        n += 1;
+    }
+    return n;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "diffText finds the replaced span" {
+    try std.testing.expectEqual(@as(?TextChange, null), diffText("hello", "hello"));
+
+    const insert = diffText("hello world", "hello, world").?;
+    try std.testing.expectEqual(TextChange{ .start = 5, .old_end = 5, .new_end = 6 }, insert);
+
+    const delete = diffText("abcdef", "abef").?;
+    try std.testing.expectEqual(TextChange{ .start = 2, .old_end = 4, .new_end = 2 }, delete);
+
+    const overtype = diffText("[ ] task", "[x] task").?;
+    try std.testing.expectEqual(TextChange{ .start = 1, .old_end = 2, .new_end = 2 }, overtype);
+
+    const append = diffText("aaa", "aaaa").?;
+    try std.testing.expectEqual(TextChange{ .start = 3, .old_end = 3, .new_end = 4 }, append);
+}
+
+test "selectionChanges is the symmetric difference" {
+    var out: [2]ByteRange = undefined;
+
+    try std.testing.expectEqual(@as(usize, 0), selectionChanges(.{ .start = 2, .end = 5 }, .{ .start = 2, .end = 5 }, &out));
+
+    // Extending a drag only damages the newly covered bytes
+    try std.testing.expectEqual(@as(usize, 1), selectionChanges(.{ .start = 2, .end = 5 }, .{ .start = 2, .end = 9 }, &out));
+    try std.testing.expectEqual(ByteRange{ .start = 5, .end = 9 }, out[0]);
+
+    try std.testing.expectEqual(@as(usize, 2), selectionChanges(.{ .start = 0, .end = 3 }, .{ .start = 10, .end = 12 }, &out));
+    try std.testing.expectEqual(@as(usize, 1), selectionChanges(null, .{ .start = 1, .end = 4 }, &out));
+    try std.testing.expectEqual(ByteRange{ .start = 1, .end = 4 }, out[0]);
+}
+
+test "DamageList merges and clips bands" {
+    var list = DamageList{};
+    list.add(.{ .top = 10, .bottom = 20 });
+    list.add(.{ .top = 40, .bottom = 50 });
+    list.add(.{ .top = 18, .bottom = 30 });
+    try std.testing.expectEqual(@as(usize, 2), list.len);
+    try std.testing.expectEqual(Band{ .top = 10, .bottom = 30 }, list.slice()[0]);
+
+    // Overflow folds the nearest bands together
+    list.add(.{ .top = 100, .bottom = 110 });
+    list.add(.{ .top = 200, .bottom = 210 });
+    list.add(.{ .top = 300, .bottom = 310 });
+    try std.testing.expectEqual(@as(usize, MAX_BANDS), list.len);
+
+    list.clip(.{ .top = 0, .bottom = 105 });
+    try std.testing.expectEqual(@as(usize, 3), list.len);
+    try std.testing.expectEqual(@as(f32, 105), list.slice()[2].bottom);
+
+    list.markFull();
+    try std.testing.expect(list.full and !list.isEmpty());
+}
@@ -0,0 +1,466 @@
+// Dawg.zig - Minimized word automaton (DAWG) in a flat, mmap-able format
+//
+// Portable (std only). `build` turns a word list into a minimal acyclic automaton
+// (incremental construction over sorted input, so shared prefixes and suffixes
+// are stored once) and serializes it together with a bloom filter. `Automaton`
+// reads that format in place, e.g. straight from an mmapped file, and answers
+// membership and bounded edit-distance queries.
+//
+// Layout (little endian):
+//   Header                 32 bytes
+//   edges: [edge_count]u64 label | FINAL | LAST | target << 32
+//   bloom: [bloom_words]u64
+//
+// A state is the run of edges starting at its first edge index and ending at
+// the edge with LAST set. Edge 0 is a sentinel; target 0 means "no children".
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+pub const MAGIC = "CRDAWG01".*;
+/// Longer words are neither stored nor checked.
+pub const MAX_WORD_LEN = 64;
+
+const EDGE_FINAL: u64 = 1 << 8;
+const EDGE_LAST: u64 = 1 << 9;
+const BLOOM_HASHES = 4;
+const BLOOM_BITS_PER_WORD = 10;
+
+const Header = extern struct {
+    magic: [8]u8,
+    edge_count: u32,
+    root: u32,
+    word_count: u32,
+    bloom_words: u32,
+    bloom_hashes: u32,
+    reserved: u32 = 0,
+};
+
+const HEADER_SIZE = @sizeOf(Header);
+
+comptime {
+    std.debug.assert(HEADER_SIZE == 32);
+}
+
+// ============================================================================
+// Bloom Filter
+// ============================================================================
+
+/// Double hashing: bit i is h1 + i * h2.
+fn bloomHashes(word: []const u8) [2]u64 {
+    const h = std.hash.Wyhash.hash(0x5eed, word);
+    return .{ h, (h >> 32) | 1 };
+}
+
+// ============================================================================
+// Construction
+// ============================================================================
+
+const BuildEdge = struct {
+    label: u8,
+    target: u32,
+};
+
+const BuildState = struct {
+    edges: std.ArrayList(BuildEdge) = .empty,
+    final: bool = false,
+};
+
+/// Edge from `parent` whose target is not yet minimized.
+const Unchecked = struct {
+    parent: u32,
+    child: u32,
+};
+
+const Builder = struct {
+    allocator: Allocator,
+    states: std.ArrayList(BuildState) = .empty,
+    /// Signature (final flag + edges) -> canonical state
+    register: std.StringHashMapUnmanaged(u32) = .empty,
+    unchecked: std.ArrayList(Unchecked) = .empty,
+    previous: []const u8 = "",
+
+    fn newState(self: *Builder) !u32 {
+        try self.states.append(self.allocator, .{});
+        return @intCast(self.states.items.len - 1);
+    }
+
+    fn signature(self: *Builder, id: u32) ![]u8 {
+        const state = self.states.items[id];
+        const sig = try self.allocator.alloc(u8, 1 + state.edges.items.len * 5);
+        sig[0] = @intFromBool(state.final);
+        for (state.edges.items, 0..) |edge, i| {
+            sig[1 + i * 5] = edge.label;
+            std.mem.writeInt(u32, sig[2 + i * 5 ..][0..4], edge.target, .little);
+        }
+        return sig;
+    }
+
+    /// Replace unchecked states deeper than `depth` by equivalent registered
+    /// ones, deepest first, so each state is compared with finished children.
+    fn minimize(self: *Builder, depth: usize) !void {
+        while (self.unchecked.items.len > depth) {
+            const u = self.unchecked.pop().?;
+            const sig = try self.signature(u.child);
+            const gop = try self.register.getOrPut(self.allocator, sig);
+            if (gop.found_existing) {
+                const edges = self.states.items[u.parent].edges.items;
+                edges[edges.len - 1].target = gop.value_ptr.*;
+            } else {
+                gop.value_ptr.* = u.child;
+            }
+        }
+    }
+
+    /// Words must arrive sorted and unique.
+    fn insert(self: *Builder, word: []const u8) !void {
+        const limit = @min(word.len, self.previous.len);
+        const prefix = std.mem.indexOfDiff(u8, word[0..limit], self.previous[0..limit]) orelse limit;
+        try self.minimize(prefix);
+
+        var node: u32 = if (self.unchecked.items.len == 0) 0 else self.unchecked.getLast().child;
+        for (word[prefix..]) |ch| {
+            const child = try self.newState();
+            try self.states.items[node].edges.append(self.allocator, .{ .label = ch, .target = child });
+            try self.unchecked.append(self.allocator, .{ .parent = node, .child = child });
+            node = child;
+        }
+        self.states.items[node].final = true;
+        self.previous = word;
+    }
+
+    /// Emit reachable states children-first so every edge points at a state
+    /// that is already placed. Returns the root's first edge index.
+    fn serialize(self: *Builder, edges: *std.ArrayList(u64)) !u32 {
+        const unplaced = std.math.maxInt(u32);
+        const placed = try self.allocator.alloc(u32, self.states.items.len);
+        @memset(placed, unplaced);
+
+        try edges.append(self.allocator, 0); // sentinel
+
+        const Frame = struct { state: u32, next: usize };
+        var stack = std.ArrayList(Frame).empty;
+        try stack.append(self.allocator, .{ .state = 0, .next = 0 });
+
+        while (stack.items.len > 0) {
+            const top = &stack.items[stack.items.len - 1];
+            const out = self.states.items[top.state].edges.items;
+            if (top.next < out.len) {
+                const child = out[top.next].target;
+                top.next += 1;
+                if (placed[child] != unplaced) continue;
+                if (self.states.items[child].edges.items.len == 0) {
+                    placed[child] = 0;
+                    continue;
+                }
+                try stack.append(self.allocator, .{ .state = child, .next = 0 });
+                continue;
+            }
+
+            const first: u32 = @intCast(edges.items.len);
+            for (out, 0..) |edge, i| {
+                var bits: u64 = edge.label;
+                if (self.states.items[edge.target].final) bits |= EDGE_FINAL;
+                if (i + 1 == out.len) bits |= EDGE_LAST;
+                bits |= @as(u64, placed[edge.target]) << 32;
+                try edges.append(self.allocator, bits);
+            }
+            placed[top.state] = if (out.len == 0) 0 else first;
+            _ = stack.pop();
+        }
+        return placed[0];
+    }
+};
+
+fn lessThanWord(_: void, a: []const u8, b: []const u8) bool {
+    return std.mem.lessThan(u8, a, b);
+}
+
+/// Build a serialized automaton from `words` (any order, duplicates allowed).
+/// Empty words and words longer than MAX_WORD_LEN are dropped. Caller owns
+/// the returned bytes.
+pub fn build(allocator: Allocator, words: []const []const u8) ![]u8 {
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const scratch = arena.allocator();
+
+    var sorted = std.ArrayList([]const u8).empty;
+    for (words) |word| {
+        if (word.len == 0 or word.len > MAX_WORD_LEN) continue;
+        try sorted.append(scratch, word);
+    }
+    std.mem.sort([]const u8, sorted.items, {}, lessThanWord);
+
+    var builder = Builder{ .allocator = scratch };
+    _ = try builder.newState(); // root
+
+    var word_count: u32 = 0;
+    var previous: ?[]const u8 = null;
+    for (sorted.items) |word| {
+        if (previous) |p| {
+            if (std.mem.eql(u8, p, word)) continue;
+        }
+        try builder.insert(word);
+        previous = word;
+        word_count += 1;
+    }
+    try builder.minimize(0);
+
+    var edges = std.ArrayList(u64).empty;
+    const root = try builder.serialize(&edges);
+
+    // ~1% false positives at 10 bits per word and 4 hashes
+    const bloom_bits = @max(64, @as(usize, word_count) * BLOOM_BITS_PER_WORD);
+    const bloom_words = (bloom_bits + 63) / 64;
+    const bloom = try scratch.alloc(u64, bloom_words);
+    @memset(bloom, 0);
+    for (sorted.items) |word| {
+        const h = bloomHashes(word);
+        for (0..BLOOM_HASHES) |i| {
+            const bit = (h[0] +% i *% h[1]) % (bloom_words * 64);
+            bloom[bit / 64] |= @as(u64, 1) << @intCast(bit % 64);
+        }
+    }
+
+    const header = Header{
+        .magic = MAGIC,
+        .edge_count = @intCast(edges.items.len),
+        .root = root,
+        .word_count = word_count,
+        .bloom_words = @intCast(bloom_words),
+        .bloom_hashes = BLOOM_HASHES,
+    };
+
+    const size = HEADER_SIZE + (edges.items.len + bloom_words) * 8;
+    const bytes = try allocator.alloc(u8, size);
+    @memcpy(bytes[0..HEADER_SIZE], std.mem.asBytes(&header));
+    var pos: usize = HEADER_SIZE;
+    for (edges.items) |edge| {
+        std.mem.writeInt(u64, bytes[pos..][0..8], edge, .little);
+        pos += 8;
+    }
+    for (bloom) |word| {
+        std.mem.writeInt(u64, bytes[pos..][0..8], word, .little);
+        pos += 8;
+    }
+    return bytes;
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+pub const Suggestion = struct {
+    buf: [MAX_WORD_LEN]u8 = undefined,
+    len: u8 = 0,
+    distance: u8 = 0,
+
+    pub fn slice(self: *const Suggestion) []const u8 {
+        return self.buf[0..self.len];
+    }
+};
+
+/// Read-only view of a serialized automaton; does not own `bytes`.
+pub const Automaton = struct {
+    bytes: []const u8,
+    edge_count: u32,
+    root: u32,
+    word_count: u32,
+    bloom_offset: usize,
+    bloom_words: u32,
+    bloom_hashes: u32,
+
+    pub fn init(bytes: []const u8) error{InvalidDictionary}!Automaton {
+        if (bytes.len < HEADER_SIZE) return error.InvalidDictionary;
+        var header: Header = undefined;
+        @memcpy(std.mem.asBytes(&header), bytes[0..HEADER_SIZE]);
+        if (!std.mem.eql(u8, &header.magic, &MAGIC)) return error.InvalidDictionary;
+
+        const edge_count = std.mem.littleToNative(u32, header.edge_count);
+        const bloom_words = std.mem.littleToNative(u32, header.bloom_words);
+        const expected = HEADER_SIZE + (@as(usize, edge_count) + bloom_words) * 8;
+        const root = std.mem.littleToNative(u32, header.root);
+        if (bytes.len < expected or edge_count == 0 or root >= edge_count) return error.InvalidDictionary;
+
+        return .{
+            .bytes = bytes,
+            .edge_count = edge_count,
+            .root = root,
+            .word_count = std.mem.littleToNative(u32, header.word_count),
+            .bloom_offset = HEADER_SIZE + @as(usize, edge_count) * 8,
+            .bloom_words = bloom_words,
+            .bloom_hashes = std.mem.littleToNative(u32, header.bloom_hashes),
+        };
+    }
+
+    inline fn edge(self: *const Automaton, index: u32) u64 {
+        return std.mem.readInt(u64, self.bytes[HEADER_SIZE + @as(usize, index) * 8 ..][0..8], .little);
+    }
+
+    inline fn target(bits: u64) u32 {
+        return @intCast(bits >> 32);
+    }
+
+    /// Edge of `state` labelled `label`. Edges are sorted by label.
+    fn step(self: *const Automaton, state: u32, label: u8) ?u64 {
+        if (state == 0) return null;
+        var i = state;
+        while (i < self.edge_count) : (i += 1) {
+            const bits = self.edge(i);
+            const l: u8 = @truncate(bits);
+            if (l == label) return bits;
+            if (l > label or bits & EDGE_LAST != 0) return null;
+        }
+        return null;
+    }
+
+    /// False means definitely absent; true means "walk the automaton".
+    pub fn mayContain(self: *const Automaton, word: []const u8) bool {
+        if (self.bloom_words == 0) return true;
+        const h = bloomHashes(word);
+        const total_bits = @as(u64, self.bloom_words) * 64;
+        for (0..self.bloom_hashes) |i| {
+            const bit = (h[0] +% i *% h[1]) % total_bits;
+            const word_bits = std.mem.readInt(u64, self.bytes[self.bloom_offset + (bit / 64) * 8 ..][0..8], .little);
+            if (word_bits & (@as(u64, 1) << @intCast(bit % 64)) == 0) return false;
+        }
+        return true;
+    }
+
+    pub fn contains(self: *const Automaton, word: []const u8) bool {
+        if (word.len == 0 or word.len > MAX_WORD_LEN) return false;
+        if (!self.mayContain(word)) return false;
+
+        var state = self.root;
+        var bits: u64 = 0;
+        for (word) |ch| {
+            bits = self.step(state, ch) orelse return false;
+            state = target(bits);
+        }
+        return bits & EDGE_FINAL != 0;
+    }
+
+    /// Words within `max_distance` edits (Levenshtein) of `word`, closest first
+    /// and alphabetical within a distance. The search walks the automaton with
+    /// one DP row per depth and prunes a branch once its whole row exceeds
+    /// `max_distance`. Returns the number of entries written to `out`.
+    pub fn suggest(self: *const Automaton, word: []const u8, max_distance: u8, out: []Suggestion) usize {
+        if (word.len == 0 or word.len > MAX_WORD_LEN or out.len == 0) return 0;
+
+        var search = Search{
+            .automaton = self,
+            .word = word,
+            .max_distance = max_distance,
+            .out = out,
+        };
+        for (0..word.len + 1) |j| search.rows[0][j] = @intCast(j);
+        search.walk(self.root, 0);
+        return search.count;
+    }
+};
+
+const Search = struct {
+    automaton: *const Automaton,
+    word: []const u8,
+    max_distance: u8,
+    out: []Suggestion,
+    count: usize = 0,
+    prefix: [MAX_WORD_LEN]u8 = undefined,
+    rows: [MAX_WORD_LEN + 1][MAX_WORD_LEN + 1]u8 = undefined,
+
+    fn walk(self: *Search, state: u32, depth: usize) void {
+        if (state == 0 or depth >= MAX_WORD_LEN) return;
+        const n = self.word.len;
+
+        var i = state;
+        while (i < self.automaton.edge_count) : (i += 1) {
+            const bits = self.automaton.edge(i);
+            const label: u8 = @truncate(bits);
+            const prev = &self.rows[depth];
+            const row = &self.rows[depth + 1];
+
+            row[0] = prev[0] + 1;
+            var row_min = row[0];
+            for (1..n + 1) |j| {
+                const cost: u8 = @intFromBool(self.word[j - 1] != label);
+                row[j] = @min(@min(prev[j] + 1, row[j - 1] + 1), prev[j - 1] + cost);
+                row_min = @min(row_min, row[j]);
+            }
+            self.prefix[depth] = label;
+
+            if (bits & EDGE_FINAL != 0 and row[n] <= self.max_distance and row[n] > 0) {
+                self.add(self.prefix[0 .. depth + 1], row[n]);
+            }
+            if (row_min <= self.max_distance) {
+                self.walk(Automaton.target(bits), depth + 1);
+            }
+            if (bits & EDGE_LAST != 0) break;
+        }
+    }
+
+    /// Keep the `out.len` best suggestions, sorted by distance.
+    fn add(self: *Search, word: []const u8, distance: u8) void {
+        var pos = self.count;
+        while (pos > 0 and self.out[pos - 1].distance > distance) : (pos -= 1) {}
+        if (pos >= self.out.len) return;
+
+        const last = @min(self.count, self.out.len - 1);
+        var k = last;
+        while (k > pos) : (k -= 1) self.out[k] = self.out[k - 1];
+
+        var s = Suggestion{ .len = @intCast(word.len), .distance = distance };
+        @memcpy(s.buf[0..word.len], word);
+        self.out[pos] = s;
+        if (self.count < self.out.len) self.count += 1;
+    }
+};
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "membership and minimization" {
+    const allocator = std.testing.allocator;
+    const words = [_][]const u8{ "walking", "talking", "walked", "talked", "walk", "talk", "walk", "tall" };
+    const bytes = try build(allocator, &words);
+    defer allocator.free(bytes);
+
+    const dawg = try Automaton.init(bytes);
+    try std.testing.expectEqual(@as(u32, 7), dawg.word_count);
+    for (words) |w| try std.testing.expect(dawg.contains(w));
+    for ([_][]const u8{ "wal", "walks", "talkin", "", "tal", "walkingg" }) |w| {
+        try std.testing.expect(!dawg.contains(w));
+    }
+
+    // "-ing"/"-ed" suffixes are shared by walk* and talk*: a trie would need
+    // far more edges than the minimal automaton
+    try std.testing.expect(dawg.edge_count < 16);
+
+    try std.testing.expectError(error.InvalidDictionary, Automaton.init(bytes[0..16]));
+}
+
+test "bounded edit distance suggestions" {
+    const allocator = std.testing.allocator;
+    const words = [_][]const u8{ "receive", "deceive", "relieve", "recede", "believe", "hello" };
+    const bytes = try build(allocator, &words);
+    defer allocator.free(bytes);
+    const dawg = try Automaton.init(bytes);
+
+    // relieve (1), then believe, recede, receive (2) in alphabetical order
+    var out: [4]Suggestion = undefined;
+    const n = dawg.suggest("recieve", 2, &out);
+    try std.testing.expectEqual(@as(usize, 4), n);
+    try std.testing.expectEqualStrings("relieve", out[0].slice());
+    try std.testing.expectEqual(@as(u8, 1), out[0].distance);
+    try std.testing.expectEqualStrings("receive", out[3].slice());
+    try std.testing.expectEqual(@as(u8, 2), out[3].distance);
+
+    // A full result list keeps the closest matches
+    var best: [1]Suggestion = undefined;
+    try std.testing.expectEqual(@as(usize, 1), dawg.suggest("recieve", 2, &best));
+    try std.testing.expectEqualStrings("relieve", best[0].slice());
+
+    try std.testing.expectEqual(@as(usize, 1), dawg.suggest("helo", 1, &out));
+    try std.testing.expectEqualStrings("hello", out[0].slice());
+    try std.testing.expectEqual(@as(usize, 0), dawg.suggest("xyzzy", 1, &out));
+}
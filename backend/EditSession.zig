@@ -1,9 +1,19 @@
 const std = @import("std");
 const Allocator = std.mem.Allocator;
-const unicode = std.unicode;
 
 const MdParser = @import("MdParser.zig");
-const Editor = @import("Editor.zig");
+const TextStorage = @import("TextStorage.zig");
+const SpellCheck = @import("SpellCheck.zig");
+const VaultRename = @import("VaultRename.zig");
+const Transclusion = @import("Transclusion.zig");
+const ImageProbe = @import("ImageProbe.zig");
+const Outline = @import("Outline.zig");
+const SequenceCrdt = @import("SequenceCrdt.zig");
+const Completion = @import("Completion.zig");
+const Fst = @import("Fst.zig");
+const Encoding = @import("Encoding.zig");
+const LineEnding = @import("LineEnding.zig");
+const Fingerprint = @import("Fingerprint.zig");
 const core_text_font = @import("CoreTextFont.zig");
 
 const EditorFont = core_text_font.EditorFont;
@@ -22,7 +32,10 @@ pub const Cursor = struct {
 
 pub const LineInfo = struct {
     line_start: usize,
+    /// Past the line break
     line_end: usize,
+    /// Before the line break ("\n" or "\r\n"); where the cursor stops
+    content_end: usize,
     y_start: f32,
     font_size: f32,
     block_id: usize,
@@ -38,6 +51,12 @@ pub const CursorMetrics = struct {
     line_height: f32,
 };
 
+/// Where the completed prefix starts and how many completions were found
+pub const CompletionMatch = struct {
+    start: usize,
+    count: usize,
+};
+
 pub const EditAction = union(enum) {
     insert: struct {
         offset: usize,
@@ -51,6 +70,15 @@ pub const EditAction = union(enum) {
         cursor_before: usize,
         cursor_after: usize,
     },
+    /// `old_text` at `offset` became `new_text` (several edits merged into
+    /// the one span they cover, so they undo together)
+    replace: struct {
+        offset: usize,
+        old_text: []const u8,
+        new_text: []const u8,
+        cursor_before: usize,
+        cursor_after: usize,
+    },
 };
 
 // ============================================================================
@@ -59,15 +87,42 @@ pub const EditAction = union(enum) {
 
 session_arena: *std.heap.ArenaAllocator,
 ast_arena: *std.heap.ArenaAllocator,
-editor: Editor,
+editor: TextStorage.Storage,
 file_path: []const u8,
 line_info: []LineInfo,
 font: EditorFont,
 font_cache: FontCache,
 root_block: ?*Block,
+/// `root_block` before embeds were resolved into it
+parsed_root: ?*Block,
+/// Headings and block starts of `parsed_root`, rebuilt with it
+outline: Outline,
+/// Fence pairs and resume points of `parsed_root`, for region reparses
+parse_index: MdParser.ParseIndex,
+/// Everything edited since the last parse, in one range
+pending_edit: ?MdParser.Edit,
+/// `pending_edit` is one same-length overwrite that replaced no line break
+pending_in_place: bool,
+/// Chunk hashes of the buffer, kept current by every edit
+fingerprint: Fingerprint,
+/// `fingerprint.whole()` of the text last read from or written to the file
+saved_fingerprint: u64,
+transclusions: ?*Transclusion,
+/// Cached notes `root_block` points into
+embedded: Transclusion.Used,
+image_probe: ?*ImageProbe.Service,
 cursor: Cursor,
 history: std.ArrayListUnmanaged(EditAction),
 history_index: usize,
+/// Bumped on every reparse; tags spell check results to the text they describe
+edit_generation: u64,
+spell_checker: ?*SpellCheck.Checker,
+/// Mergeable history of every edit, once sync is enabled for this note
+sync_history: ?*SequenceCrdt,
+/// How the file is encoded on disk; the buffer is always UTF-8
+encoding: Encoding.Kind,
+/// Break style of the file, used for new lines; existing breaks are kept
+line_ending: LineEnding.Style,
 
 // ============================================================================
 // Private Helpers
@@ -102,6 +157,7 @@ fn findBlockAtCursor(block: *Block, cursor_ptr: [*]const u8, id_counter: *usize)
             .Paragraph,
             .Heading,
             .CodeBlock,
+            .Frontmatter,
             .BlockQuote,
             .OrderedList,
             .OrderedListItem,
@@ -162,13 +218,17 @@ fn computeLineInfo(
             const font_size = fontSizeForBlockType(block_type, self.font.size);
             const line_height = self.font_cache.getLineHeight(self.font, font_size);
 
-            const line_text = text_ptr[line_start .. i + 1];
+            const has_cr = ch == '\n' and i > line_start and text_ptr[i - 1] == '\r';
+            const content_end = if (ch == '\n') i - @intFromBool(has_cr) else i + 1;
+            // The CR of a CRLF break would be drawn as a glyph
+            const line_text = if (has_cr) text_ptr[line_start..content_end] else text_ptr[line_start .. i + 1];
             const font_ref = self.font_cache.getFont(self.font, font_size);
             const ct_line = core_text_font.createCTLine(font_ref, line_text);
 
             info[idx] = .{
                 .line_start = line_start,
                 .line_end = i + 1,
+                .content_end = content_end,
                 .y_start = y,
                 .font_size = font_size,
                 .block_id = block_id,
@@ -183,14 +243,16 @@ fn computeLineInfo(
     return info;
 }
 
+/// Files are transcoded to UTF-8 on open, but a byte that does not start a
+/// valid sequence still counts as one UTF-16 unit rather than being trusted
 fn utf16IndexFromUtf8ByteOffset(text: []const u8, byte_offset: usize) usize {
     var i: usize = 0;
     var utf16_count: usize = 0;
     while (i < text.len and i < byte_offset) {
         const first = text[i];
-        const seq_len = unicode.utf8ByteSequenceLength(first) catch 1;
+        const seq_len = std.unicode.utf8ByteSequenceLength(first) catch 1;
         const end = @min(i + seq_len, text.len);
-        const codepoint = unicode.utf8Decode(text[i..end]) catch first;
+        const codepoint = std.unicode.utf8Decode(text[i..end]) catch first;
         utf16_count += if (codepoint > 0xFFFF) 2 else 1;
         i = end;
     }
@@ -207,11 +269,11 @@ fn lineIndexForCursor(line_info: []const LineInfo, cursor_byte: usize) usize {
 }
 
 fn updateActiveBlock(self: *Self) void {
-    if (self.editor.size == 0) return;
-    if (self.cursor.byte_offset > self.editor.size) {
-        self.cursor.byte_offset = self.editor.size;
+    if (self.editor.len() == 0) return;
+    if (self.cursor.byte_offset > self.editor.len()) {
+        self.cursor.byte_offset = self.editor.len();
     }
-    const cursor_ptr = self.editor.buffer.ptr + self.cursor.byte_offset;
+    const cursor_ptr = self.editor.contents().ptr + self.cursor.byte_offset;
     if (self.root_block) |root| {
         var id_counter: usize = 1;
         if (findBlockAtCursor(root, cursor_ptr, &id_counter)) |result| {
@@ -223,7 +285,7 @@ fn updateActiveBlock(self: *Self) void {
 }
 
 fn updateCursorMetrics(self: *Self) void {
-    const text = self.editor.buffer[0..self.editor.size];
+    const text = self.editor.contents();
     const line_info = self.line_info;
     if (line_info.len == 0) return;
     if (self.cursor.byte_offset > text.len) {
@@ -276,33 +338,203 @@ fn recordAction(self: *Self, action: EditAction) !void {
 }
 
 fn cloneTextRange(self: *Self, start: usize, end: usize) ![]const u8 {
-    return try self.session_arena.allocator().dupe(u8, self.editor.buffer[start..end]);
+    return try self.session_arena.allocator().dupe(u8, self.editor.contents()[start..end]);
+}
+
+/// Swap the `len` bytes at `offset` for `text`.
+fn replaceSpan(self: *Self, offset: usize, len: usize, text: []const u8) !void {
+    const start = @min(offset, self.editor.len());
+    const end = @min(start + len, self.editor.len());
+    if (end - start == text.len) return self.overwriteBytes(start, text);
+    if (end > start) {
+        try self.deleteBytes(start, end);
+    }
+    try self.insertBytes(start, text);
+}
+
+/// Every buffer edit goes through here and `deleteBytes`, so the sync
+/// history sees the same edits as the buffer.
+fn insertBytes(self: *Self, offset: usize, text: []const u8) !void {
+    try self.editor.insert(self.session_arena.allocator(), offset, text);
+    if (self.sync_history) |sequence| try sequence.localInsert(offset, text);
+    try self.fingerprint.splice(self.editor.contents(), offset, offset, offset + text.len);
+    self.pending_edit = MdParser.Edit.merge(self.pending_edit, .{ .start = offset, .old_end = offset, .new_end = offset + text.len });
+    self.pending_in_place = false;
+}
+
+fn deleteBytes(self: *Self, start: usize, end: usize) !void {
+    try self.editor.delete_range(start, end);
+    if (self.sync_history) |sequence| try sequence.localDelete(start, end - start);
+    try self.fingerprint.splice(self.editor.contents(), start, end, start);
+    self.pending_edit = MdParser.Edit.merge(self.pending_edit, .{ .start = start, .old_end = end, .new_end = start });
+    self.pending_in_place = false;
+}
+
+/// Same-length replace: the bytes are patched where they are and no offset
+/// after them changes
+fn overwriteBytes(self: *Self, offset: usize, text: []const u8) !void {
+    const end = offset + text.len;
+    const old = self.editor.contents()[offset..end];
+    const breaks_kept = std.mem.indexOfAny(u8, old, "\r\n") == null;
+    if (self.sync_history) |sequence| {
+        try sequence.localDelete(offset, text.len);
+        try sequence.localInsert(offset, text);
+    }
+    try self.editor.overwrite(self.session_arena.allocator(), offset, text);
+    try self.fingerprint.splice(self.editor.contents(), offset, end, end);
+    self.pending_in_place = self.pending_edit == null and breaks_kept;
+    self.pending_edit = MdParser.Edit.merge(self.pending_edit, .{ .start = offset, .old_end = end, .new_end = end });
+}
+
+/// Queue header probes for local images under `block` so their sizes are
+/// known by the time the view lays them out.
+fn prefetchImages(self: *Self, probe: *ImageProbe.Service, block: *Block) !void {
+    switch (block.blockType) {
+        .Image => |url| {
+            if (try self.localImagePath(url)) |path| {
+                defer std.heap.page_allocator.free(path);
+                _ = try probe.request(path);
+            }
+        },
+        else => for (block.children.items) |child| try self.prefetchImages(probe, child),
+    }
+}
+
+/// Absolute path of a `file://`, absolute or note-relative image URL; null
+/// for remote URLs. Percent escapes are decoded, as in any link target.
+/// Allocated with the page allocator.
+pub fn localImagePath(self: *Self, url: []const u8) !?[]u8 {
+    const allocator = std.heap.page_allocator;
+    const is_file = std.mem.startsWith(u8, url, "file://");
+    if (!is_file and std.mem.indexOf(u8, url, "://") != null) return null;
+    const dir = std.fs.path.dirname(self.file_path) orelse return null;
+    const escaped = try allocator.dupe(u8, if (is_file) url["file://".len..] else url);
+    defer allocator.free(escaped);
+    // An absolute path replaces `dir`
+    return try std.fs.path.resolve(allocator, &.{ dir, std.Uri.percentDecodeInPlace(escaped) });
+}
+
+/// Inline text runs under `block` overlapping [start, end). Code blocks,
+/// links and images are not prose, so they are skipped.
+fn collectTextRuns(
+    allocator: Allocator,
+    block: *Block,
+    base: [*]const u8,
+    start: usize,
+    end: usize,
+    out: *std.ArrayList(SpellCheck.BlockText),
+) !void {
+    switch (block.blockType) {
+        .CodeBlock, .Frontmatter, .Link, .Image, .Embed => return,
+        .RawStr, .Strong, .Emphasis, .StrongEmph => {
+            const content = block.content orelse return;
+            const offset = @intFromPtr(content.ptr) - @intFromPtr(base);
+            if (offset < end and offset + content.len > start) {
+                try out.append(allocator, .{ .offset = offset, .text = content });
+            }
+            return;
+        },
+        else => {},
+    }
+    for (block.children.items) |child| {
+        try collectTextRuns(allocator, child, base, start, end, out);
+    }
 }
 
 // ============================================================================
 // Public Methods
 // ============================================================================
 
-// TODO: this should be incremental
+/// What a same-length overwrite needs parsed again: nothing inside code, or
+/// the inline children of one paragraph or heading
+const InPlaceTarget = union(enum) {
+    code,
+    leaf: *Block,
+};
+
+/// Null if the overwrite may have changed the block structure
+fn inPlaceTarget(self: *Self, text: []const u8, edit: MdParser.Edit) ?InPlaceTarget {
+    const root = self.parsed_root orelse return null;
+    if (edit.start < self.parse_index.body_start) return null;
+    if (!MdParser.isInlineOnlyEdit(text, edit.start, edit.new_end)) return null;
+    if (self.parse_index.insideFence(edit.start)) return .code;
+    const leaf = MdParser.inlineBlockAt(text, root, edit.start, edit.new_end) orelse return null;
+    return .{ .leaf = leaf };
+}
+
+/// Arena bytes allowed per byte of text before a region reparse gives way to
+/// a full one, which drops the blocks earlier splices replaced
+const AST_ARENA_SLACK = 64;
+const AST_ARENA_MIN = 1 << 20;
+
+fn astArenaLimit(self: *Self) usize {
+    return AST_ARENA_SLACK * self.editor.len() + AST_ARENA_MIN;
+}
+
 pub fn reparse(self: *Self) !void {
     releaseLineInfo(self.line_info);
-    self.ast_arena.deinit();
-    self.ast_arena.* = std.heap.ArenaAllocator.init(std.heap.page_allocator);
+    const text = self.editor.contents();
+    const edit = self.pending_edit;
+    self.pending_edit = null;
+    const in_place = if (self.pending_in_place) self.inPlaceTarget(text, edit.?) else null;
+    self.pending_in_place = false;
+
+    // Only the lines an edit affects are parsed again, until the blocks kept
+    // from earlier parses are mostly garbage in the arena
+    const region = if (in_place == null and edit != null and self.parsed_root != null and self.ast_arena.queryCapacity() < self.astArenaLimit())
+        try MdParser.reparseBlocks(self.ast_arena.allocator(), text, &self.parse_index, edit.?)
+    else
+        null;
+
+    if (in_place) |target| {
+        // Nothing moved, so the tree, outline and index still point at the
+        // right bytes; only inline markup may have changed
+        switch (target) {
+            .code => {},
+            .leaf => |leaf| try MdParser.reparseInline(self.ast_arena.allocator(), text, leaf),
+        }
+        self.parse_index.text = text;
+    } else if (region) |r| {
+        const allocator = self.ast_arena.allocator();
+        const region_outline = try Outline.build(allocator, text, r.document);
+        try MdParser.parseInline(allocator, r.document);
+        self.outline = try self.outline.splice(allocator, region_outline, r, self.parse_index.text, text);
+        try MdParser.splice(allocator, self.parsed_root.?, &self.parse_index, r, text);
+    } else {
+        self.ast_arena.deinit();
+        self.ast_arena.* = std.heap.ArenaAllocator.init(std.heap.page_allocator);
+        const allocator = self.ast_arena.allocator();
+        const parsed = try MdParser.parseBlocksIndexed(allocator, text, &self.parse_index);
+        self.outline = try Outline.build(allocator, text, parsed);
+        try MdParser.parseInline(allocator, parsed);
+        self.parsed_root = parsed;
+    }
 
     const allocator = self.ast_arena.allocator();
-    const text = self.editor.buffer[0..self.editor.size];
-
-    const block = try MdParser.parseBlocks(allocator, text);
-    try MdParser.parseInline(allocator, block);
-
+    const block = self.parsed_root.?;
     self.root_block = block;
+    if (self.transclusions) |cache| {
+        // Notes embedding this one must not keep showing the old text
+        _ = cache.invalidate(self.file_path);
+        self.root_block = try cache.resolve(allocator, self.file_path, block, &self.embedded);
+    }
+    if (self.image_probe) |probe| {
+        // Images outside the blocks this parse produced were queued before;
+        // a request stats the file, too much to repeat on every keystroke
+        const changed: ?*Block = if (in_place) |target| switch (target) {
+            .code => null,
+            .leaf => |leaf| leaf,
+        } else if (region) |r| r.document else block;
+        if (changed) |fresh| try self.prefetchImages(probe, fresh);
+    }
+    self.edit_generation += 1;
     self.line_info = try computeLineInfo(allocator, text.ptr, text.len, self);
 
     self.updateActiveBlock();
     self.updateCursorMetrics();
 }
 
-pub fn create(filename: []const u8) !*Self {
+pub fn create(filename: []const u8, transclusions: ?*Transclusion, image_probe: ?*ImageProbe.Service) !*Self {
     const page_alloc = std.heap.page_allocator;
 
     const session_arena = try page_alloc.create(std.heap.ArenaAllocator);
@@ -324,9 +556,14 @@ pub fn create(filename: []const u8) !*Self {
 
     const file = try std.fs.openFileAbsolute(filename, .{});
     defer file.close();
-    const file_contents = try file.readToEndAlloc(allocator, std.math.maxInt(usize));
+    const file_contents = try file.readToEndAlloc(page_alloc, std.math.maxInt(usize));
+    defer page_alloc.free(file_contents);
+    const decoded = try Encoding.decode(page_alloc, file_contents);
+    defer decoded.deinit(page_alloc);
 
-    const editor = try Editor.create(allocator, file_contents);
+    const editor = try TextStorage.Storage.create(allocator, decoded.text);
+    var fingerprint = try Fingerprint.build(page_alloc, decoded.text);
+    errdefer fingerprint.deinit();
 
     const session = try allocator.create(Self);
     session.* = Self{
@@ -338,6 +575,16 @@ pub fn create(filename: []const u8) !*Self {
         .font = core_text_font.default_editor_font,
         .font_cache = FontCache.init(core_text_font.default_editor_font.size),
         .root_block = null,
+        .parsed_root = null,
+        .outline = .{},
+        .parse_index = .{},
+        .pending_edit = null,
+        .pending_in_place = false,
+        .fingerprint = fingerprint,
+        .saved_fingerprint = fingerprint.whole(),
+        .transclusions = transclusions,
+        .embedded = .{ .allocator = allocator },
+        .image_probe = image_probe,
         .cursor = .{
             .byte_offset = 0,
             .active_block_id = 0,
@@ -351,6 +598,11 @@ pub fn create(filename: []const u8) !*Self {
         },
         .history = .{},
         .history_index = 0,
+        .edit_generation = 0,
+        .spell_checker = null,
+        .sync_history = null,
+        .encoding = decoded.kind,
+        .line_ending = LineEnding.detect(decoded.text),
     };
 
     try session.reparse();
@@ -358,7 +610,15 @@ pub fn create(filename: []const u8) !*Self {
 }
 
 pub fn close(self: *Self) void {
+    if (self.spell_checker) |checker| checker.destroy();
+    if (self.sync_history) |sequence| {
+        sequence.deinit();
+        std.heap.page_allocator.destroy(sequence);
+    }
+    // Unsaved text may be cached for notes embedding this one
+    if (self.transclusions) |cache| _ = cache.invalidate(self.file_path);
     releaseLineInfo(self.line_info);
+    self.fingerprint.deinit();
     self.font_cache.deinit(); // Release external CoreText resources
 
     const page_alloc = std.heap.page_allocator;
@@ -379,7 +639,7 @@ pub fn insertText(self: *Self, text: []const u8) !void {
     const insert_offset = self.cursor.byte_offset;
     const cursor_before = self.cursor.byte_offset;
     const inserted_text = try self.session_arena.allocator().dupe(u8, text);
-    try self.editor.insert(self.session_arena.allocator(), insert_offset, text);
+    try self.insertBytes(insert_offset, text);
     self.cursor.byte_offset += text.len;
     try self.recordAction(.{
         .insert = .{
@@ -396,10 +656,10 @@ pub fn deleteBackward(self: *Self) !void {
     if (self.cursor.byte_offset == 0) return;
 
     const end = self.cursor.byte_offset;
-    const start = end - 1;
+    const start = LineEnding.stepBack(self.editor.contents(), end);
     const deleted_text = try self.cloneTextRange(start, end);
 
-    try self.editor.delete_range(start, end);
+    try self.deleteBytes(start, end);
     self.cursor.byte_offset = start;
     try self.recordAction(.{
         .delete = .{
@@ -413,13 +673,13 @@ pub fn deleteBackward(self: *Self) !void {
 }
 
 pub fn deleteForward(self: *Self) !void {
-    if (self.cursor.byte_offset >= self.editor.size) return;
+    if (self.cursor.byte_offset >= self.editor.len()) return;
 
     const start = self.cursor.byte_offset;
-    const end = start + 1;
+    const end = LineEnding.stepForward(self.editor.contents(), start);
     const deleted_text = try self.cloneTextRange(start, end);
 
-    try self.editor.delete_range(start, end);
+    try self.deleteBytes(start, end);
     try self.recordAction(.{
         .delete = .{
             .offset = start,
@@ -432,11 +692,11 @@ pub fn deleteForward(self: *Self) !void {
 }
 
 pub fn moveCursorLeft(self: *Self) void {
-    self.updateCursor(@max(0, self.cursor.byte_offset - 1));
+    self.updateCursor(LineEnding.stepBack(self.editor.contents(), self.cursor.byte_offset));
 }
 
 pub fn moveCursorRight(self: *Self) void {
-    self.updateCursor(@min(self.editor.size, self.cursor.byte_offset + 1));
+    self.updateCursor(LineEnding.stepForward(self.editor.contents(), self.cursor.byte_offset));
 }
 
 pub fn moveCursorUp(self: *Self) void {
@@ -447,7 +707,7 @@ pub fn moveCursorUp(self: *Self) void {
     const current_line = self.line_info[line_index];
     const col = self.cursor.byte_offset - current_line.line_start;
     const target_line = self.line_info[line_index - 1];
-    self.updateCursor(@min(target_line.line_start + col, target_line.line_end));
+    self.updateCursor(@min(target_line.line_start + col, target_line.content_end));
 }
 
 pub fn moveCursorDown(self: *Self) void {
@@ -458,16 +718,44 @@ pub fn moveCursorDown(self: *Self) void {
     const current_line = self.line_info[line_index];
     const col = self.cursor.byte_offset - current_line.line_start;
     const target_line = self.line_info[line_index + 1];
-    self.updateCursor(@min(target_line.line_start + col, target_line.line_end));
+    self.updateCursor(@min(target_line.line_start + col, target_line.content_end));
 }
 
 pub fn setCursorOffset(self: *Self, offset: usize) void {
-    self.updateCursor(@min(offset, self.editor.size));
+    const text = self.editor.contents();
+    self.updateCursor(LineEnding.snap(text, @min(offset, text.len)));
+}
+
+/// Break the line in the note's own line ending style
+pub fn insertNewline(self: *Self) !void {
+    try self.insertText(self.line_ending.newline());
+}
+
+/// Move to the next/previous heading or block start; false if there is none
+pub fn jumpCursor(self: *Self, jump: Outline.Jump) bool {
+    const target = self.outline.find(jump, self.cursor.byte_offset) orelse return false;
+    self.updateCursor(target);
+    return true;
+}
+
+/// Completions of the word (or `[[link`) being typed at the cursor, heaviest
+/// first. Choosing one replaces [start, cursor).
+pub fn completionsAtCursor(self: *Self, index: *const Completion.Index, out: []Fst.Completion) !CompletionMatch {
+    const text = self.editor.contents();
+    const prefix = Completion.prefixAt(text, self.cursor.byte_offset) orelse return .{ .start = self.cursor.byte_offset, .count = 0 };
+    return .{ .start = prefix.start, .count = try index.complete(prefix.text, out) };
+}
+
+/// The word just finished before the cursor, for `Completion.Index.add`
+pub fn wordBeforeCursor(self: *Self) ?[]const u8 {
+    const offset = self.cursor.byte_offset;
+    if (offset == 0) return null;
+    return Completion.wordBefore(self.editor.contents(), offset - 1);
 }
 
 pub fn deleteTextRange(self: *Self, start_offset: usize, end_offset: usize) !void {
-    const start = @min(start_offset, self.editor.size);
-    const end = @min(end_offset, self.editor.size);
+    const start = @min(start_offset, self.editor.len());
+    const end = @min(end_offset, self.editor.len());
 
     if (end <= start) {
         self.updateCursor(start);
@@ -476,7 +764,7 @@ pub fn deleteTextRange(self: *Self, start_offset: usize, end_offset: usize) !voi
 
     const cursor_before = self.cursor.byte_offset;
     const deleted_text = try self.cloneTextRange(start, end);
-    try self.editor.delete_range(start, end);
+    try self.deleteBytes(start, end);
     self.cursor.byte_offset = start;
     try self.recordAction(.{
         .delete = .{
@@ -489,6 +777,86 @@ pub fn deleteTextRange(self: *Self, start_offset: usize, end_offset: usize) !voi
     try self.reparse();
 }
 
+/// Replace text[start_offset..end_offset] with `text` as one undo step.
+/// Same-length replacements (ticking a task box, overtyping a typo) patch the
+/// buffer in place and, when they stay clear of the line's block marker,
+/// only parse the inline content of their paragraph or heading again.
+pub fn replaceRange(self: *Self, start_offset: usize, end_offset: usize, text: []const u8) !void {
+    const start = @min(start_offset, self.editor.len());
+    const end = @min(@max(start, end_offset), self.editor.len());
+    if (end == start and text.len == 0) return;
+    // The buffer stays UTF-8: whole characters in, whole characters out
+    if (!Encoding.isValidUtf8(text) or !self.isCharBoundary(start) or !self.isCharBoundary(end)) return error.InvalidUtf8;
+
+    const cursor_before = self.cursor.byte_offset;
+    const old_text = try self.cloneTextRange(start, end);
+    const new_text = try self.session_arena.allocator().dupe(u8, text);
+    try self.replaceSpan(start, old_text.len, new_text);
+    if (cursor_before >= end) {
+        self.cursor.byte_offset = cursor_before - old_text.len + new_text.len;
+    } else if (cursor_before > start) {
+        self.cursor.byte_offset = @min(cursor_before, start + new_text.len);
+    }
+    try self.recordAction(.{
+        .replace = .{
+            .offset = start,
+            .old_text = old_text,
+            .new_text = new_text,
+            .cursor_before = cursor_before,
+            .cursor_after = self.cursor.byte_offset,
+        },
+    });
+    try self.reparse();
+}
+
+/// Apply sorted, non-overlapping edits (e.g. links rewritten by a vault
+/// rename) as a single undoable replace of the span they cover.
+pub fn replaceRanges(self: *Self, edits: []const VaultRename.Edit) !void {
+    if (edits.len == 0) return;
+    const allocator = self.session_arena.allocator();
+
+    const start = edits[0].start;
+    const end = edits[edits.len - 1].end;
+    const old_text = try self.cloneTextRange(start, end);
+    const new_text = try VaultRename.applyEdits(allocator, old_text, start, edits);
+
+    const cursor_before = self.cursor.byte_offset;
+    try self.replaceSpan(start, old_text.len, new_text);
+    self.cursor.byte_offset = VaultRename.mapOffset(edits, cursor_before);
+    try self.recordAction(.{
+        .replace = .{
+            .offset = start,
+            .old_text = old_text,
+            .new_text = new_text,
+            .cursor_before = cursor_before,
+            .cursor_after = self.cursor.byte_offset,
+        },
+    });
+    try self.reparse();
+}
+
+/// The note was moved on disk; save to the new location from now on.
+pub fn setFilePath(self: *Self, file_path: []const u8) !void {
+    self.file_path = try self.session_arena.allocator().dupe(u8, file_path);
+}
+
+/// Resolve embeds again after notes they show changed. Reparses only when
+/// the AST arena is due to be emptied.
+pub fn resolveEmbeds(self: *Self) !void {
+    const cache = self.transclusions orelse return;
+    const parsed = self.parsed_root orelse return;
+    errdefer {
+        // Show the note without embeds rather than a retired tree
+        self.root_block = self.parsed_root;
+        self.embedded.paths.clearRetainingCapacity();
+    }
+    // Resolved copies pile up in the AST arena, which only a full parse
+    // empties; a session re-resolved while idle needs one now and then
+    if (self.ast_arena.queryCapacity() >= self.astArenaLimit()) return self.reparse();
+    self.root_block = try cache.resolve(self.ast_arena.allocator(), self.file_path, parsed, &self.embedded);
+    self.updateActiveBlock();
+}
+
 pub fn undo(self: *Self) !bool {
     if (self.history_index == 0) return false;
 
@@ -497,17 +865,21 @@ pub fn undo(self: *Self) !bool {
 
     switch (action) {
         .insert => |insert_action| {
-            const start = @min(insert_action.offset, self.editor.size);
-            const end = @min(start + insert_action.text.len, self.editor.size);
+            const start = @min(insert_action.offset, self.editor.len());
+            const end = @min(start + insert_action.text.len, self.editor.len());
             if (end > start) {
-                try self.editor.delete_range(start, end);
+                try self.deleteBytes(start, end);
             }
-            self.cursor.byte_offset = @min(insert_action.cursor_before, self.editor.size);
+            self.cursor.byte_offset = @min(insert_action.cursor_before, self.editor.len());
         },
         .delete => |delete_action| {
-            const insert_offset = @min(delete_action.offset, self.editor.size);
-            try self.editor.insert(self.session_arena.allocator(), insert_offset, delete_action.text);
-            self.cursor.byte_offset = @min(delete_action.cursor_before, self.editor.size);
+            const insert_offset = @min(delete_action.offset, self.editor.len());
+            try self.insertBytes(insert_offset, delete_action.text);
+            self.cursor.byte_offset = @min(delete_action.cursor_before, self.editor.len());
+        },
+        .replace => |replace_action| {
+            try self.replaceSpan(replace_action.offset, replace_action.new_text.len, replace_action.old_text);
+            self.cursor.byte_offset = @min(replace_action.cursor_before, self.editor.len());
         },
     }
 
@@ -523,17 +895,21 @@ pub fn redo(self: *Self) !bool {
 
     switch (action) {
         .insert => |insert_action| {
-            const insert_offset = @min(insert_action.offset, self.editor.size);
-            try self.editor.insert(self.session_arena.allocator(), insert_offset, insert_action.text);
-            self.cursor.byte_offset = @min(insert_action.cursor_after, self.editor.size);
+            const insert_offset = @min(insert_action.offset, self.editor.len());
+            try self.insertBytes(insert_offset, insert_action.text);
+            self.cursor.byte_offset = @min(insert_action.cursor_after, self.editor.len());
         },
         .delete => |delete_action| {
-            const start = @min(delete_action.offset, self.editor.size);
-            const end = @min(start + delete_action.text.len, self.editor.size);
+            const start = @min(delete_action.offset, self.editor.len());
+            const end = @min(start + delete_action.text.len, self.editor.len());
             if (end > start) {
-                try self.editor.delete_range(start, end);
+                try self.deleteBytes(start, end);
             }
-            self.cursor.byte_offset = @min(delete_action.cursor_after, self.editor.size);
+            self.cursor.byte_offset = @min(delete_action.cursor_after, self.editor.len());
+        },
+        .replace => |replace_action| {
+            try self.replaceSpan(replace_action.offset, replace_action.old_text.len, replace_action.new_text);
+            self.cursor.byte_offset = @min(replace_action.cursor_after, self.editor.len());
         },
     }
 
@@ -541,9 +917,179 @@ pub fn redo(self: *Self) !bool {
     return true;
 }
 
+/// Write the note back in the encoding it was opened with. A Latin-1 note
+/// that gained characters outside Latin-1 is saved as UTF-8 from then on.
 pub fn saveFile(self: *Self) !void {
+    const page_alloc = std.heap.page_allocator;
+    const text = self.editor.contents();
+
+    var encoded = std.ArrayList(u8).empty;
+    defer encoded.deinit(page_alloc);
+    if (self.encoding != .utf8) {
+        Encoding.encode(page_alloc, text, self.encoding, &encoded) catch |err| switch (err) {
+            error.Unencodable => self.encoding = .utf8,
+            else => return err,
+        };
+    }
+
     const file = try std.fs.createFileAbsolute(self.file_path, .{ .truncate = true });
     defer file.close();
 
-    try file.writeAll(self.editor.buffer[0..self.editor.size]);
+    try file.writeAll(if (self.encoding == .utf8) text else encoded.items);
+    self.saved_fingerprint = self.fingerprint.whole();
+}
+
+/// True if the buffer differs from what was last opened or saved
+pub fn hasUnsavedChanges(self: *const Self) bool {
+    return self.fingerprint.whole() != self.saved_fingerprint;
+}
+
+/// True if the file no longer holds what was last opened or saved, e.g.
+/// because a sync tool or another editor wrote it
+pub fn fileChangedOnDisk(self: *const Self) !bool {
+    const page_alloc = std.heap.page_allocator;
+    const file = try std.fs.openFileAbsolute(self.file_path, .{});
+    defer file.close();
+    const file_contents = try file.readToEndAlloc(page_alloc, std.math.maxInt(usize));
+    defer page_alloc.free(file_contents);
+    const decoded = try Encoding.decode(page_alloc, file_contents);
+    defer decoded.deinit(page_alloc);
+    return Fingerprint.hashBytes(decoded.text) != self.saved_fingerprint;
+}
+
+/// `text` was appended to this note's file by a quick capture
+/// (QuickAppend.zig): add it to the end of the buffer as one undoable insert,
+/// and move the saved fingerprint past it, so a buffer that matched the file
+/// still does and unsaved edits stay unsaved. The cursor does not move.
+pub fn appendCaptured(self: *Self, text: []const u8) !void {
+    const offset = self.editor.len();
+    const owned = try self.session_arena.allocator().dupe(u8, text);
+    try self.insertBytes(offset, owned);
+    try self.recordAction(.{
+        .insert = .{
+            .offset = offset,
+            .text = owned,
+            .cursor_before = self.cursor.byte_offset,
+            .cursor_after = self.cursor.byte_offset,
+        },
+    });
+    self.saved_fingerprint = Fingerprint.extend(self.saved_fingerprint, text);
+    try self.reparse();
+}
+
+/// Fingerprint of text[start..end]; equal ranges anywhere, in any note,
+/// fingerprint the same
+pub fn textFingerprint(self: *Self, start: usize, end: usize) u64 {
+    const text = self.editor.contents();
+    const clamped_end = @min(end, text.len);
+    return self.fingerprint.range(text, @min(start, clamped_end), clamped_end);
+}
+
+/// Start keeping a mergeable history of this note's edits (SequenceCrdt.zig)
+/// as `replica`. `saved` is this machine's log from an earlier session; if
+/// the note changed on disk since, the difference is recorded as one edit.
+pub fn enableSync(self: *Self, replica: u32, saved: ?[]const u8) !void {
+    if (self.sync_history != null) return;
+    const page_alloc = std.heap.page_allocator;
+    const text = self.editor.contents();
+
+    const sequence = try page_alloc.create(SequenceCrdt);
+    errdefer page_alloc.destroy(sequence);
+    if (saved) |bytes| {
+        const log = try SequenceCrdt.decode(page_alloc, bytes);
+        defer SequenceCrdt.freeLog(page_alloc, log);
+        sequence.* = try SequenceCrdt.load(page_alloc, replica, log);
+        errdefer sequence.deinit();
+
+        const logged = try sequence.text(page_alloc);
+        defer page_alloc.free(logged);
+        try recordDifference(sequence, logged, text);
+    } else {
+        sequence.* = try SequenceCrdt.init(page_alloc, replica, text);
+    }
+    self.sync_history = sequence;
+}
+
+/// This machine's log, to write where the other machines can read it
+pub fn syncLog(self: *Self, allocator: Allocator) ![]u8 {
+    const sequence = self.sync_history orelse return error.SyncDisabled;
+    return sequence.encode(allocator);
+}
+
+fn isCharBoundary(self: *const Self, offset: usize) bool {
+    return offset == self.editor.len() or self.editor.byteAt(offset) & 0xC0 != 0x80;
+}
+
+/// Make the sync history hold `new` instead of `old` with one delete and
+/// one insert covering where they differ
+fn recordDifference(sequence: *SequenceCrdt, old: []const u8, new: []const u8) !void {
+    const prefix = std.mem.indexOfDiff(u8, old, new) orelse return;
+    var suffix: usize = 0;
+    while (suffix < old.len - prefix and suffix < new.len - prefix and
+        old[old.len - 1 - suffix] == new[new.len - 1 - suffix]) suffix += 1;
+    try sequence.localDelete(prefix, old.len - prefix - suffix);
+    try sequence.localInsert(prefix, new[prefix .. new.len - suffix]);
+}
+
+/// Merge another machine's log into the buffer. The cursor stays with the
+/// text around it; undo history is dropped since its offsets no longer
+/// match. Returns false if the log had nothing new.
+pub fn mergeSyncLog(self: *Self, bytes: []const u8) !bool {
+    const sequence = self.sync_history orelse return error.SyncDisabled;
+    const page_alloc = std.heap.page_allocator;
+
+    const log = try SequenceCrdt.decode(page_alloc, bytes);
+    defer SequenceCrdt.freeLog(page_alloc, log);
+    const anchor = sequence.anchorAt(self.cursor.byte_offset);
+    if (try sequence.merge(log) == 0) return false;
+
+    var merged = try sequence.text(page_alloc);
+    defer page_alloc.free(merged);
+    if (!Encoding.isValidUtf8(merged)) {
+        // A corrupt log can cut a character in two. Keep the buffer UTF-8 and
+        // record the repair, so the sync history still matches the buffer.
+        const repaired = try Encoding.replaceInvalidUtf8(page_alloc, merged);
+        recordDifference(sequence, merged, repaired) catch |err| {
+            page_alloc.free(repaired);
+            return err;
+        };
+        page_alloc.free(merged);
+        merged = repaired;
+    }
+    // Straight to the editor: the merge is already in the sync history
+    const old_size = self.editor.len();
+    try self.editor.delete_range(0, self.editor.len());
+    try self.editor.insert(self.session_arena.allocator(), 0, merged);
+    try self.fingerprint.splice(self.editor.contents(), 0, old_size, merged.len);
+    self.pending_edit = MdParser.Edit.merge(self.pending_edit, .{ .start = 0, .old_end = old_size, .new_end = merged.len });
+    self.cursor.byte_offset = sequence.offsetAfter(anchor);
+
+    self.history.clearRetainingCapacity();
+    self.history_index = 0;
+    try self.reparse();
+    return true;
+}
+
+/// Check the prose of blocks overlapping [start, end) (typically the visible
+/// range) on the spell checker's worker thread. Blocks whose text has not
+/// changed since they were last checked are answered from its cache.
+pub fn requestSpellCheck(self: *Self, dictionary: *const SpellCheck.Dictionary, start: usize, end: usize) !void {
+    const allocator = std.heap.smp_allocator;
+    if (self.spell_checker == null) {
+        self.spell_checker = try SpellCheck.Checker.create(allocator, dictionary);
+    }
+
+    var runs = std.ArrayList(SpellCheck.BlockText).empty;
+    defer runs.deinit(allocator);
+    if (self.root_block) |root| {
+        try collectTextRuns(allocator, root, self.editor.contents().ptr, start, end, &runs);
+    }
+    try self.spell_checker.?.submit(self.edit_generation, runs.items);
+}
+
+/// Misspelled byte ranges for the current text. Returns false while the
+/// check for the current text is still running.
+pub fn misspellings(self: *Self, allocator: Allocator, out: *std.ArrayList(SpellCheck.Span)) !bool {
+    const checker = self.spell_checker orelse return false;
+    return checker.latest(self.edit_generation, allocator, out);
 }
@@ -1,12 +1,15 @@
 // super dumb editor cause i cba
+//
+// The default TextStorage (TextStorage.zig): one array, edits memmove the tail.
 const Self = @This();
 const std = @import("std");
 const Allocator = std.mem.Allocator;
+const TextStorage = @import("TextStorage.zig");
 
-// TODO: create a slice that is only upto size for consumers
 buffer: []u8,
 size: usize,
 capacity: usize,
+lines: TextStorage.LineIndex,
 
 const INITIAL_CAPACITY = 1024;
 
@@ -14,27 +17,36 @@ pub fn create(allocator: Allocator, text: []const u8) !Self {
     var capacity: usize = INITIAL_CAPACITY;
     while (capacity < text.len) : (capacity *= 2) {}
     const buffer = try allocator.alloc(u8, capacity);
+    errdefer allocator.free(buffer);
     @memcpy(buffer[0..text.len], text);
     return Self{
         .buffer = buffer,
         .size = text.len,
-        .capacity = INITIAL_CAPACITY,
+        .capacity = capacity,
+        .lines = try TextStorage.LineIndex.build(allocator, text),
     };
 }
 
+pub fn deinit(self: *Self, allocator: Allocator) void {
+    self.lines.deinit(allocator);
+    allocator.free(self.buffer);
+}
+
 fn maybe_resize(self: *Self, allocator: Allocator, new_size: usize) !void {
     if (new_size <= self.capacity) return;
-    self.capacity = @max(self.capacity * 2, new_size);
+    const capacity = @max(self.capacity * 2, new_size);
 
-    const new_buffer = try allocator.alloc(u8, self.capacity);
-    @memcpy(new_buffer[0..self.size], self.buffer);
+    const new_buffer = try allocator.alloc(u8, capacity);
+    @memcpy(new_buffer[0..self.size], self.buffer[0..self.size]);
 
     allocator.free(self.buffer);
     self.buffer = new_buffer;
+    self.capacity = capacity;
 }
 
 pub fn insert(self: *Self, allocator: Allocator, i: usize, text: []const u8) !void {
     try self.maybe_resize(allocator, text.len + self.size);
+    try self.lines.insert(allocator, i, text);
 
     @memmove(self.buffer[i + text.len .. self.size + text.len], self.buffer[i..self.size]);
     @memcpy(self.buffer[i .. i + text.len], text);
@@ -46,4 +58,44 @@ pub fn delete_range(self: *Self, start: usize, end: usize) !void {
     const move_size = self.size - end;
     @memmove(self.buffer[start .. start + move_size], self.buffer[end .. end + move_size]);
     self.size -= (end - start);
+    self.lines.delete(start, end);
+}
+
+/// Same-length replace of [i, i + text.len); nothing after it moves
+pub fn overwrite(self: *Self, allocator: Allocator, i: usize, text: []const u8) !void {
+    try self.lines.overwrite(allocator, i, self.buffer[i .. i + text.len], text);
+    @memcpy(self.buffer[i .. i + text.len], text);
+}
+
+pub fn len(self: *const Self) usize {
+    return self.size;
+}
+
+pub fn byteAt(self: *const Self, i: usize) u8 {
+    return self.buffer[i];
+}
+
+pub fn slices(self: *const Self, start: usize, end: usize) TextStorage.Slices {
+    return .{ .parts = .{ self.buffer[start..end], &.{} } };
+}
+
+/// Already contiguous; stable until the next edit
+pub fn contents(self: *Self) []const u8 {
+    return self.buffer[0..self.size];
+}
+
+pub fn lineCount(self: *const Self) usize {
+    return self.lines.count();
+}
+
+pub fn lineStart(self: *const Self, line: usize) usize {
+    return self.lines.start(line);
+}
+
+pub fn lineOf(self: *const Self, offset: usize) usize {
+    return self.lines.lineOf(offset);
+}
+
+pub fn memoryUsed(self: *const Self) usize {
+    return self.capacity + self.lines.memoryUsed();
 }
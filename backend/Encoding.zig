@@ -0,0 +1,405 @@
+// Encoding.zig - Detect a note's text encoding and transcode it to/from UTF-8
+//
+// Portable (std only). Notes are edited as UTF-8; files imported from other
+// tools may be UTF-16 (with a byte order mark) or Latin-1. Opening detects
+// the encoding and decodes to UTF-8 so everything past the editor buffer can
+// assume valid UTF-8; saving encodes back to what the file was.
+//
+// Decoding streams: `Decoder` takes the file in chunks of any size, carrying a
+// split UTF-16 code unit or surrogate pair across chunk boundaries. Runs of
+// ASCII, the common case even in UTF-16 notes, are converted a @Vector at a
+// time.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const Allocator = std.mem.Allocator;
+const unicode = std.unicode;
+
+/// Bytes examined per @Vector step
+const LANES = 16;
+/// Decode granularity of `decode`, small enough to stay in cache
+const CHUNK_SIZE = 64 * 1024;
+const REPLACEMENT: u21 = 0xFFFD;
+
+const UTF8_BOM = "\xEF\xBB\xBF";
+const UTF16LE_BOM = "\xFF\xFE";
+const UTF16BE_BOM = "\xFE\xFF";
+
+pub const Kind = enum(u8) {
+    utf8 = 0,
+    /// UTF-8 starting with a byte order mark, kept on save
+    utf8_bom = 1,
+    utf16le = 2,
+    utf16be = 3,
+    /// ISO-8859-1: anything that is not valid UTF-8 and has no BOM
+    latin1 = 4,
+
+    pub fn bom(self: Kind) []const u8 {
+        return switch (self) {
+            .utf8, .latin1 => "",
+            .utf8_bom => UTF8_BOM,
+            .utf16le => UTF16LE_BOM,
+            .utf16be => UTF16BE_BOM,
+        };
+    }
+};
+
+pub const Decoded = struct {
+    /// Valid UTF-8. For valid UTF-8 files this is a slice of the input,
+    /// otherwise it is allocated.
+    text: []const u8,
+    kind: Kind,
+    /// Whether `text` was allocated
+    owned: bool,
+
+    pub fn deinit(self: Decoded, allocator: Allocator) void {
+        if (self.owned) allocator.free(self.text);
+    }
+};
+
+// ============================================================================
+// Detection
+// ============================================================================
+
+/// A byte order mark decides; otherwise valid UTF-8 is UTF-8 and anything
+/// else is taken as Latin-1, where every byte is a character.
+pub fn detect(bytes: []const u8) Kind {
+    if (std.mem.startsWith(u8, bytes, UTF8_BOM)) return .utf8_bom;
+    if (std.mem.startsWith(u8, bytes, UTF16LE_BOM)) return .utf16le;
+    if (std.mem.startsWith(u8, bytes, UTF16BE_BOM)) return .utf16be;
+    return if (isValidUtf8(bytes)) .utf8 else .latin1;
+}
+
+pub fn isValidUtf8(bytes: []const u8) bool {
+    var i: usize = 0;
+    while (true) {
+        i += asciiPrefix(bytes[i..]);
+        if (i == bytes.len) return true;
+        const seq_len = unicode.utf8ByteSequenceLength(bytes[i]) catch return false;
+        if (i + seq_len > bytes.len) return false;
+        // Rejects overlong forms, surrogates and bad continuation bytes
+        _ = unicode.utf8Decode(bytes[i .. i + seq_len]) catch return false;
+        i += seq_len;
+    }
+}
+
+/// Length of the leading run of ASCII bytes
+fn asciiPrefix(bytes: []const u8) usize {
+    var i: usize = 0;
+    while (i + LANES <= bytes.len) : (i += LANES) {
+        const chunk: @Vector(LANES, u8) = bytes[i..][0..LANES].*;
+        if (@reduce(.Max, chunk) >= 0x80) break;
+    }
+    while (i < bytes.len and bytes[i] < 0x80) i += 1;
+    return i;
+}
+
+// ============================================================================
+// Decoding
+// ============================================================================
+
+/// Detect the encoding of a whole file and decode it. Unpaired UTF-16
+/// surrogates, and invalid bytes after a UTF-8 BOM, become U+FFFD.
+pub fn decode(allocator: Allocator, raw: []const u8) !Decoded {
+    const kind = detect(raw);
+    const body = raw[kind.bom().len..];
+    // Without a BOM, detect only says UTF-8 for valid UTF-8
+    if (kind == .utf8) return .{ .text = body, .kind = kind, .owned = false };
+    if (kind == .utf8_bom) {
+        if (isValidUtf8(body)) return .{ .text = body, .kind = kind, .owned = false };
+        return .{ .text = try replaceInvalidUtf8(allocator, body), .kind = kind, .owned = true };
+    }
+
+    var out = std.ArrayList(u8).empty;
+    errdefer out.deinit(allocator);
+    // Latin-1 grows at most 2x, UTF-16 at most 1.5x
+    try out.ensureTotalCapacity(allocator, body.len + body.len / 2);
+
+    var decoder = Decoder.init(kind);
+    var offset: usize = 0;
+    while (offset < body.len) : (offset += CHUNK_SIZE) {
+        try decoder.feed(allocator, body[offset..@min(offset + CHUNK_SIZE, body.len)], &out);
+    }
+    try decoder.finish(allocator, &out);
+    return .{ .text = try out.toOwnedSlice(allocator), .kind = kind, .owned = true };
+}
+
+/// Incremental decoder to UTF-8. The BOM, if any, must already be skipped.
+pub const Decoder = struct {
+    kind: Kind,
+    /// First byte of a UTF-16 code unit split across chunks
+    odd_byte: ?u8 = null,
+    /// High surrogate waiting for its low half
+    high_surrogate: ?u16 = null,
+
+    pub fn init(kind: Kind) Decoder {
+        return .{ .kind = kind };
+    }
+
+    pub fn feed(self: *Decoder, allocator: Allocator, chunk: []const u8, out: *std.ArrayList(u8)) !void {
+        switch (self.kind) {
+            .utf8, .utf8_bom => try out.appendSlice(allocator, chunk),
+            .latin1 => try decodeLatin1(allocator, chunk, out),
+            .utf16le, .utf16be => try self.feedUtf16(allocator, chunk, out),
+        }
+    }
+
+    /// Flush a dangling half code unit or surrogate as U+FFFD
+    pub fn finish(self: *Decoder, allocator: Allocator, out: *std.ArrayList(u8)) !void {
+        if (self.odd_byte != null or self.high_surrogate != null) try appendCodepoint(allocator, REPLACEMENT, out);
+        self.odd_byte = null;
+        self.high_surrogate = null;
+    }
+
+    fn feedUtf16(self: *Decoder, allocator: Allocator, chunk: []const u8, out: *std.ArrayList(u8)) !void {
+        var bytes = chunk;
+        if (self.odd_byte) |first| {
+            if (bytes.len == 0) return;
+            self.odd_byte = null;
+            try self.pushUnit(allocator, self.unit(.{ first, bytes[0] }), out);
+            bytes = bytes[1..];
+        }
+
+        var i: usize = 0;
+        while (i + 2 * LANES <= bytes.len) : (i += 2 * LANES) {
+            var units: @Vector(LANES, u16) = @bitCast(bytes[i..][0 .. 2 * LANES].*);
+            if (self.endian() != builtin.cpu.arch.endian()) units = @byteSwap(units);
+            if (self.high_surrogate == null and @reduce(.Max, units) < 0x80) {
+                const narrow: [LANES]u8 = @as(@Vector(LANES, u8), @truncate(units));
+                try out.appendSlice(allocator, &narrow);
+                continue;
+            }
+            const array: [LANES]u16 = units;
+            for (array) |u| try self.pushUnit(allocator, u, out);
+        }
+        while (i + 2 <= bytes.len) : (i += 2) {
+            try self.pushUnit(allocator, self.unit(bytes[i..][0..2].*), out);
+        }
+        if (i < bytes.len) self.odd_byte = bytes[i];
+    }
+
+    fn pushUnit(self: *Decoder, allocator: Allocator, u: u16, out: *std.ArrayList(u8)) !void {
+        if (self.high_surrogate) |high| {
+            self.high_surrogate = null;
+            if (u >= 0xDC00 and u <= 0xDFFF) {
+                const codepoint = 0x10000 + ((@as(u21, high) - 0xD800) << 10) + (u - 0xDC00);
+                return appendCodepoint(allocator, codepoint, out);
+            }
+            try appendCodepoint(allocator, REPLACEMENT, out);
+        }
+        switch (u) {
+            0xD800...0xDBFF => self.high_surrogate = u,
+            0xDC00...0xDFFF => try appendCodepoint(allocator, REPLACEMENT, out),
+            else => try appendCodepoint(allocator, u, out),
+        }
+    }
+
+    fn unit(self: *const Decoder, pair: [2]u8) u16 {
+        return std.mem.readInt(u16, &pair, self.endian());
+    }
+
+    fn endian(self: *const Decoder) std.builtin.Endian {
+        return if (self.kind == .utf16be) .big else .little;
+    }
+};
+
+fn decodeLatin1(allocator: Allocator, bytes: []const u8, out: *std.ArrayList(u8)) !void {
+    var i: usize = 0;
+    while (i < bytes.len) {
+        const ascii = asciiPrefix(bytes[i..]);
+        try out.appendSlice(allocator, bytes[i .. i + ascii]);
+        i += ascii;
+        // A run of high bytes, two UTF-8 bytes each
+        while (i < bytes.len and bytes[i] >= 0x80) : (i += 1) {
+            try out.appendSlice(allocator, &.{ 0xC0 | (bytes[i] >> 6), 0x80 | (bytes[i] & 0x3F) });
+        }
+    }
+}
+
+/// Copy of `bytes` with every byte that is not part of a valid UTF-8
+/// sequence replaced by U+FFFD
+pub fn replaceInvalidUtf8(allocator: Allocator, bytes: []const u8) ![]u8 {
+    var out = std.ArrayList(u8).empty;
+    errdefer out.deinit(allocator);
+    try out.ensureTotalCapacity(allocator, bytes.len);
+    var i: usize = 0;
+    while (i < bytes.len) {
+        const ascii = asciiPrefix(bytes[i..]);
+        try out.appendSlice(allocator, bytes[i .. i + ascii]);
+        i += ascii;
+        if (i == bytes.len) break;
+        const seq_len = unicode.utf8ByteSequenceLength(bytes[i]) catch 0;
+        if (seq_len > 0 and i + seq_len <= bytes.len) {
+            if (unicode.utf8Decode(bytes[i .. i + seq_len])) |_| {
+                try out.appendSlice(allocator, bytes[i .. i + seq_len]);
+                i += seq_len;
+                continue;
+            } else |_| {}
+        }
+        try appendCodepoint(allocator, REPLACEMENT, out);
+        i += 1;
+    }
+    return out.toOwnedSlice(allocator);
+}
+
+fn appendCodepoint(allocator: Allocator, codepoint: u21, out: *std.ArrayList(u8)) !void {
+    var buf: [4]u8 = undefined;
+    // Surrogates were replaced above, so every codepoint here encodes
+    const n = unicode.utf8Encode(codepoint, &buf) catch unreachable;
+    try out.appendSlice(allocator, buf[0..n]);
+}
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+/// Encode UTF-8 `text` as `kind`, BOM included, appending to `out`. Fails
+/// with Unencodable if `text` has characters that Latin-1 lacks, and with
+/// InvalidUtf8 if it is not UTF-8 after all.
+pub fn encode(allocator: Allocator, text: []const u8, kind: Kind, out: *std.ArrayList(u8)) !void {
+    try out.appendSlice(allocator, kind.bom());
+    switch (kind) {
+        .utf8, .utf8_bom => try out.appendSlice(allocator, text),
+        .latin1 => try encodeLatin1(allocator, text, out),
+        .utf16le, .utf16be => try encodeUtf16(allocator, text, if (kind == .utf16be) .big else .little, out),
+    }
+}
+
+fn encodeLatin1(allocator: Allocator, text: []const u8, out: *std.ArrayList(u8)) !void {
+    try out.ensureUnusedCapacity(allocator, text.len);
+    var i: usize = 0;
+    while (i < text.len) {
+        const ascii = asciiPrefix(text[i..]);
+        out.appendSliceAssumeCapacity(text[i .. i + ascii]);
+        i += ascii;
+        if (i == text.len) break;
+        // U+0080..U+00FF are the two-byte sequences led by C2 and C3
+        if (text[i] != 0xC2 and text[i] != 0xC3) return error.Unencodable;
+        if (i + 1 == text.len or text[i + 1] & 0xC0 != 0x80) return error.InvalidUtf8;
+        out.appendAssumeCapacity(((text[i] & 0x03) << 6) | (text[i + 1] & 0x3F));
+        i += 2;
+    }
+}
+
+fn encodeUtf16(allocator: Allocator, text: []const u8, endian: std.builtin.Endian, out: *std.ArrayList(u8)) !void {
+    try out.ensureUnusedCapacity(allocator, text.len * 2);
+    var i: usize = 0;
+    while (i < text.len) {
+        if (i + LANES <= text.len) {
+            const chunk: @Vector(LANES, u8) = text[i..][0..LANES].*;
+            if (@reduce(.Max, chunk) < 0x80) {
+                var units: @Vector(LANES, u16) = @intCast(chunk);
+                if (endian != builtin.cpu.arch.endian()) units = @byteSwap(units);
+                const wide: [2 * LANES]u8 = @bitCast(units);
+                try out.appendSlice(allocator, &wide);
+                i += LANES;
+                continue;
+            }
+        }
+        const seq_len = unicode.utf8ByteSequenceLength(text[i]) catch return error.InvalidUtf8;
+        if (i + seq_len > text.len) return error.InvalidUtf8;
+        const codepoint = unicode.utf8Decode(text[i .. i + seq_len]) catch return error.InvalidUtf8;
+        i += seq_len;
+        if (codepoint < 0x10000) {
+            try appendUnit(allocator, @intCast(codepoint), endian, out);
+        } else {
+            const offset = codepoint - 0x10000;
+            try appendUnit(allocator, @intCast(0xD800 + (offset >> 10)), endian, out);
+            try appendUnit(allocator, @intCast(0xDC00 + (offset & 0x3FF)), endian, out);
+        }
+    }
+}
+
+fn appendUnit(allocator: Allocator, u: u16, endian: std.builtin.Endian, out: *std.ArrayList(u8)) !void {
+    var pair: [2]u8 = undefined;
+    std.mem.writeInt(u16, &pair, u, endian);
+    try out.appendSlice(allocator, &pair);
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "detect by BOM, then UTF-8 validity" {
+    try std.testing.expectEqual(Kind.utf8, detect("plain ascii, then caf\xC3\xA9"));
+    try std.testing.expectEqual(Kind.utf8_bom, detect(UTF8_BOM ++ "x"));
+    try std.testing.expectEqual(Kind.utf16le, detect(UTF16LE_BOM ++ "x\x00"));
+    try std.testing.expectEqual(Kind.utf16be, detect(UTF16BE_BOM ++ "\x00x"));
+    try std.testing.expectEqual(Kind.latin1, detect("caf\xE9 au lait"));
+    // Overlong encoding of '/' and a lone surrogate are not UTF-8
+    try std.testing.expectEqual(Kind.latin1, detect("a\xC0\xAF"));
+    try std.testing.expectEqual(Kind.latin1, detect("\xED\xA0\x80"));
+}
+
+test "UTF-16 round trip across every chunk split" {
+    const allocator = std.testing.allocator;
+    // Long ASCII runs take the vector path; the emoji is a surrogate pair
+    const text = "# Title\n\nLong enough ascii line for a few vectors. caf\xC3\xA9 \xF0\x9F\x98\x80 \xE2\x82\xAC end\n";
+    inline for (.{ Kind.utf16le, Kind.utf16be }) |kind| {
+        var encoded = std.ArrayList(u8).empty;
+        defer encoded.deinit(allocator);
+        try encode(allocator, text, kind, &encoded);
+
+        const decoded = try decode(allocator, encoded.items);
+        defer decoded.deinit(allocator);
+        try std.testing.expectEqual(kind, decoded.kind);
+        try std.testing.expectEqualStrings(text, decoded.text);
+
+        const body = encoded.items[2..];
+        for (0..body.len) |split| {
+            var out = std.ArrayList(u8).empty;
+            defer out.deinit(allocator);
+            var decoder = Decoder.init(kind);
+            try decoder.feed(allocator, body[0..split], &out);
+            try decoder.feed(allocator, body[split..], &out);
+            try decoder.finish(allocator, &out);
+            try std.testing.expectEqualStrings(text, out.items);
+        }
+    }
+
+    // A high surrogate with nothing after it
+    var out = std.ArrayList(u8).empty;
+    defer out.deinit(allocator);
+    var decoder = Decoder.init(.utf16le);
+    try decoder.feed(allocator, "a\x00\x3D\xD8", &out);
+    try decoder.finish(allocator, &out);
+    try std.testing.expectEqualStrings("a\xEF\xBF\xBD", out.items);
+}
+
+test "Latin-1 round trip and unencodable text" {
+    const allocator = std.testing.allocator;
+    const raw = "Stra\xDFe, na\xEFve caf\xE9 -- and a long ascii tail to vectorize";
+    const decoded = try decode(allocator, raw);
+    defer decoded.deinit(allocator);
+    try std.testing.expectEqual(Kind.latin1, decoded.kind);
+    try std.testing.expect(isValidUtf8(decoded.text));
+    try std.testing.expect(std.mem.startsWith(u8, decoded.text, "Stra\xC3\x9Fe"));
+
+    var encoded = std.ArrayList(u8).empty;
+    defer encoded.deinit(allocator);
+    try encode(allocator, decoded.text, .latin1, &encoded);
+    try std.testing.expectEqualStrings(raw, encoded.items);
+    try std.testing.expectError(error.Unencodable, encode(allocator, "\xE2\x82\xAC", .latin1, &encoded));
+}
+
+test "broken UTF-8 fails to encode and can be repaired" {
+    const allocator = std.testing.allocator;
+    var encoded = std.ArrayList(u8).empty;
+    defer encoded.deinit(allocator);
+    for ([_][]const u8{ "a\xC3", "\xC3a", "\xFFb", "long ascii run, then a cut \xE2\x82" }) |broken| {
+        try std.testing.expectError(error.InvalidUtf8, encode(allocator, broken, .utf16le, &encoded));
+    }
+    // Latin-1 reads a second byte after C2/C3 only
+    try std.testing.expectError(error.InvalidUtf8, encode(allocator, "a\xC3", .latin1, &encoded));
+    try std.testing.expectError(error.InvalidUtf8, encode(allocator, "\xC3a", .latin1, &encoded));
+
+    const repaired = try replaceInvalidUtf8(allocator, "a\xC3b \xE2\x82");
+    defer allocator.free(repaired);
+    try std.testing.expectEqualStrings("a\u{FFFD}b \u{FFFD}\u{FFFD}", repaired);
+
+    // A BOM does not vouch for the bytes after it
+    const marked = try decode(allocator, UTF8_BOM ++ "caf\xE9 ok");
+    defer marked.deinit(allocator);
+    try std.testing.expectEqual(Kind.utf8_bom, marked.kind);
+    try std.testing.expectEqualStrings("caf\u{FFFD} ok", marked.text);
+}
@@ -9,6 +9,20 @@ const Allocator = std.mem.Allocator;
 const MdParser = @import("MdParser.zig");
 const core_text_font = @import("CoreTextFont.zig");
 const EditSession = @import("EditSession.zig");
+const SpellCheck = @import("SpellCheck.zig");
+const Dawg = @import("Dawg.zig");
+const Fst = @import("Fst.zig");
+const Completion = @import("Completion.zig");
+const Encoding = @import("Encoding.zig");
+const VaultRename = @import("VaultRename.zig");
+const HistoryStore = @import("HistoryStore.zig");
+const Transclusion = @import("Transclusion.zig");
+const ImageProbe = @import("ImageProbe.zig");
+const Outline = @import("Outline.zig");
+const SequenceCrdt = @import("SequenceCrdt.zig");
+const PropertyIndex = @import("PropertyIndex.zig");
+const VaultQuery = @import("VaultQuery.zig");
+const QuickAppend = @import("QuickAppend.zig");
 const Metal = @import("Metal.zig");
 
 const EditorFont = core_text_font.EditorFont;
@@ -66,6 +80,14 @@ pub const CCursorMetrics = extern struct {
     line_height: f32,
 };
 
+/// Bits of `CEditSession.changes`: which synced fields are new
+pub const SyncChange = struct {
+    pub const text: u32 = 1 << 0;
+    pub const tree: u32 = 1 << 1;
+    pub const cursor: u32 = 1 << 2;
+    pub const metrics: u32 = 1 << 3;
+};
+
 pub const CEditSession = extern struct {
     root_block: ?*CBlock,
     active_block_id: usize,
@@ -75,31 +97,63 @@ pub const CEditSession = extern struct {
     text_len: usize,
     session_ptr: ?*anyopaque,
     cursor_byte_offset: usize,
+    /// SyncChange bits set since the GUI last cleared them
+    changes: u32,
+    /// Parse and resolved tree `root_block` was converted from
+    synced_generation: u64,
+    synced_root: ?*const anyopaque,
 
     /// Sync state from the internal EditSession to this CEditSession
     pub fn sync(self: *CEditSession) void {
+        self.syncState();
+        // A note embedded somewhere changed (edited here or on disk):
+        // re-resolve the open sessions before freeing its old tree
+        if (transclusions.hasRetired()) refreshEmbeds();
+    }
+
+    fn syncState(self: *CEditSession) void {
         const session: *EditSession = @ptrCast(@alignCast(self.session_ptr orelse return));
 
-        // Convert Block -> CBlock if we have a root block
-        if (session.root_block) |root| {
-            var id_counter: usize = 1;
-            self.root_block = toCBlock(session.ast_arena.allocator(), root, &id_counter) catch null;
-        } else {
-            self.root_block = null;
+        // Cursor moves and drags sync on every event; the CBlock tree is
+        // only converted again (into the AST arena) when the parse changed
+        const root: ?*const anyopaque = session.root_block;
+        const reparsed = session.edit_generation != self.synced_generation;
+        if (reparsed or root != self.synced_root) {
+            if (session.root_block) |block| {
+                var id_counter: usize = 1;
+                self.root_block = toCBlock(session.ast_arena.allocator(), block, &id_counter) catch null;
+            } else {
+                self.root_block = null;
+            }
+            self.synced_generation = session.edit_generation;
+            self.synced_root = root;
+            self.changes |= SyncChange.tree;
+        }
+
+        const text_ptr: [*]const u8 = session.editor.contents().ptr;
+        if (reparsed or self.text_ptr != text_ptr or self.text_len != session.editor.len()) {
+            self.text_ptr = text_ptr;
+            self.text_len = session.editor.len();
+            self.changes |= SyncChange.text;
         }
 
-        self.active_block_id = session.cursor.active_block_id;
-        self.text_ptr = session.editor.buffer.ptr;
-        self.text_len = session.editor.size;
-        self.cursor_byte_offset = session.cursor.byte_offset;
+        if (self.cursor_byte_offset != session.cursor.byte_offset or self.active_block_id != session.cursor.active_block_id) {
+            self.cursor_byte_offset = session.cursor.byte_offset;
+            self.active_block_id = session.cursor.active_block_id;
+            self.changes |= SyncChange.cursor;
+        }
 
-        self.cursor_metrics = CCursorMetrics{
+        const metrics = CCursorMetrics{
             .line_index = session.cursor.metrics.line_index,
             .column_byte = session.cursor.metrics.column_byte,
             .caret_x = session.cursor.metrics.caret_x,
             .caret_y = session.cursor.metrics.caret_y,
             .line_height = session.cursor.metrics.line_height,
         };
+        if (!std.meta.eql(metrics, self.cursor_metrics)) {
+            self.cursor_metrics = metrics;
+            self.changes |= SyncChange.metrics;
+        }
     }
 };
 
@@ -163,7 +217,8 @@ fn openDocumentImpl(filename_slice: []const u8) !*CDocument {
     const file = try std.fs.openFileAbsolute(filename_slice, .{});
     defer file.close();
 
-    const file_contents = try file.readToEndAlloc(allocator, std.math.maxInt(usize));
+    const raw = try file.readToEndAlloc(allocator, std.math.maxInt(usize));
+    const file_contents = (try Encoding.decode(allocator, raw)).text;
 
     const block = try MdParser.parseBlocks(allocator, file_contents);
     try MdParser.parseInline(allocator, block);
@@ -205,8 +260,42 @@ export fn createFile(filename: [*:0]const u8) callconv(.c) c_int {
 // Edit Session Exports
 // ============================================================================
 
+/// Sessions currently open, so vault-wide operations (renames) can update
+/// their buffers. Only touched from the UI thread.
+var open_sessions: std.ArrayList(*CEditSession) = .empty;
+
+/// Parsed `![[embedded]]` notes shared by all sessions
+var transclusions = Transclusion.init(std.heap.page_allocator);
+
+/// Embedded notes that are open are read from their session's buffer.
+fn openNoteText(_: *anyopaque, path: []const u8) ?[]const u8 {
+    for (open_sessions.items) |c_session| {
+        const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse continue));
+        if (std.mem.eql(u8, session.file_path, path)) return session.editor.contents();
+    }
+    return null;
+}
+
+fn refreshEmbeds() void {
+    // Only sessions showing a retired tree are resolved (and converted)
+    // again. That can find more stale notes; repeat until none is left.
+    while (true) {
+        const retired = transclusions.retired.items.len;
+        for (open_sessions.items) |c_session| {
+            const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse continue));
+            if (!transclusions.referencesRetired(&session.embedded)) continue;
+            session.resolveEmbeds() catch {};
+            c_session.syncState();
+        }
+        if (transclusions.retired.items.len == retired) break;
+    }
+    transclusions.releaseRetired();
+}
+
 export fn createEditSession(filename: [*:0]const u8) callconv(.c) ?*CEditSession {
-    const session = EditSession.create(std.mem.span(filename)) catch return null;
+    transclusions.source = .{ .ctx = &open_sessions, .textFn = openNoteText };
+    if (image_probe == null) image_probe = ImageProbe.Service.create(std.heap.smp_allocator) catch null;
+    const session = EditSession.create(std.mem.span(filename), &transclusions, image_probe) catch return null;
 
     // Allocate CEditSession from the session's arena
     const c_session = session.session_arena.allocator().create(CEditSession) catch return null;
@@ -225,6 +314,15 @@ export fn createEditSession(filename: [*:0]const u8) callconv(.c) ?*CEditSession
         .text_len = 0,
         .session_ptr = session,
         .cursor_byte_offset = 0,
+        .changes = 0,
+        // Never a real generation, so the first sync converts the tree
+        .synced_generation = std.math.maxInt(u64),
+        .synced_root = null,
+    };
+
+    open_sessions.append(std.heap.page_allocator, c_session) catch {
+        session.close();
+        return null;
     };
 
     c_session.sync();
@@ -234,14 +332,29 @@ export fn createEditSession(filename: [*:0]const u8) callconv(.c) ?*CEditSession
 export fn closeEditSession(session_ptr: ?*CEditSession) callconv(.c) void {
     const c_session = session_ptr orelse return;
     const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return));
+    if (std.mem.indexOfScalar(*CEditSession, open_sessions.items, c_session)) |i| {
+        _ = open_sessions.swapRemove(i);
+    }
     session.close();
+    if (transclusions.hasRetired()) refreshEmbeds();
 }
 
 export fn handleTextInput(session_ptr: ?*CEditSession, text: [*:0]const u8) callconv(.c) void {
     const c_session = session_ptr orelse return;
     const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return));
 
-    session.insertText(std.mem.span(text)) catch return;
+    const typed = std.mem.span(text);
+    if (std.mem.eql(u8, typed, "\n")) {
+        session.insertNewline() catch return;
+    } else {
+        session.insertText(typed) catch return;
+    }
+    // A space or punctuation finishes a word; count it for completion
+    if (completion_index) |*index| {
+        if (typed.len == 1 and !std.ascii.isAlphanumeric(typed[0]) and typed[0] < 0x80) {
+            if (session.wordBeforeCursor()) |word| index.add(word, 1) catch {};
+        }
+    }
     c_session.sync();
 }
 
@@ -252,7 +365,18 @@ export fn handleKeyEvent(session_ptr: ?*CEditSession, key_code: u16, modifiers:
     const cmd_mask: u64 = 1 << 20;
     const shift_mask: u64 = 1 << 17;
     if ((modifiers & cmd_mask) != 0 and key_code == 1) {
-        session.saveFile() catch {};
+        session.saveFile() catch return;
+        if (history_store) |*store| {
+            const text = session.editor.contents();
+            _ = store.saveVersion(session.file_path, text, std.time.timestamp()) catch {};
+        }
+        if (property_index_loaded) {
+            const text = session.editor.contents();
+            property_index.update(session.file_path, text, std.time.timestamp()) catch {};
+        }
+        if (completion_index) |*index| {
+            if (index.needsCompaction()) index.compact() catch {};
+        }
         return;
     }
     if ((modifiers & cmd_mask) != 0 and (modifiers & shift_mask) != 0 and key_code == 6) {
@@ -271,8 +395,20 @@ export fn handleKeyEvent(session_ptr: ?*CEditSession, key_code: u16, modifiers:
         return;
     }
 
+    // Option-Up/Down move between blocks, with Command between headings
+    const option_mask: u64 = 1 << 19;
+    if ((modifiers & option_mask) != 0 and (key_code == 125 or key_code == 126)) {
+        const down = key_code == 125;
+        const jump: Outline.Jump = if ((modifiers & cmd_mask) != 0)
+            (if (down) .next_heading else .prev_heading)
+        else
+            (if (down) .next_block else .prev_block);
+        if (session.jumpCursor(jump)) c_session.sync();
+        return;
+    }
+
     switch (key_code) {
-        36 => session.insertText("\n") catch return,
+        36 => session.insertNewline() catch return,
         48 => session.insertText("    ") catch return,
         51 => session.deleteBackward() catch return,
         117 => session.deleteForward() catch return,
@@ -299,6 +435,452 @@ export fn deleteTextRange(session_ptr: ?*CEditSession, start_offset: usize, end_
     c_session.sync();
 }
 
+export fn replaceTextRange(session_ptr: ?*CEditSession, start_offset: usize, end_offset: usize, text_ptr: [*]const u8, text_len: usize) callconv(.c) void {
+    const c_session = session_ptr orelse return;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return));
+    session.replaceRange(start_offset, end_offset, text_ptr[0..text_len]) catch return;
+    c_session.sync();
+}
+
+export fn getFileEncoding(session_ptr: ?*CEditSession) callconv(.c) c_int {
+    const c_session = session_ptr orelse return -1;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return -1));
+    return @intFromEnum(session.encoding);
+}
+
+export fn hasUnsavedChanges(session_ptr: ?*CEditSession) callconv(.c) c_int {
+    const c_session = session_ptr orelse return -1;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return -1));
+    return @intFromBool(session.hasUnsavedChanges());
+}
+
+export fn fileChangedOnDisk(session_ptr: ?*CEditSession) callconv(.c) c_int {
+    const c_session = session_ptr orelse return -1;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return -1));
+    const changed = session.fileChangedOnDisk() catch return -1;
+    return @intFromBool(changed);
+}
+
+export fn getTextFingerprint(session_ptr: ?*CEditSession, start_offset: usize, end_offset: usize) callconv(.c) u64 {
+    const c_session = session_ptr orelse return 0;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return 0));
+    return session.textFingerprint(start_offset, end_offset);
+}
+
+// ============================================================================
+// Outline Exports
+// ============================================================================
+
+pub const COutlineEntry = extern struct {
+    offset: usize,
+    block_type: BlockTypeTag,
+    level: u32,
+    title_ptr: ?[*]const u8,
+    title_len: usize,
+};
+
+export fn getOutline(session_ptr: ?*CEditSession, out: ?[*]COutlineEntry, max_count: usize) callconv(.c) usize {
+    const c_session = session_ptr orelse return 0;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return 0));
+
+    const entries = session.outline.entries;
+    const dst = out orelse return entries.len;
+    const n = @min(entries.len, max_count);
+    for (entries[0..n], 0..) |entry, i| {
+        dst[i] = .{
+            .offset = entry.offset,
+            .block_type = entry.block_type,
+            .level = entry.level,
+            .title_ptr = entry.title.ptr,
+            .title_len = entry.title.len,
+        };
+    }
+    return n;
+}
+
+export fn jumpCursor(session_ptr: ?*CEditSession, jump: c_int) callconv(.c) c_int {
+    const c_session = session_ptr orelse return 0;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return 0));
+    const target = std.meta.intToEnum(Outline.Jump, jump) catch return 0;
+
+    if (!session.jumpCursor(target)) return 0;
+    c_session.sync();
+    return 1;
+}
+
+// ============================================================================
+// Vault Exports
+// ============================================================================
+
+fn renameNoteImpl(vault_root: []const u8, old_path: []const u8, new_path: []const u8) !void {
+    const allocator = std.heap.smp_allocator;
+    const old_relative = vaultRelative(vault_root, old_path) orelse return error.OutsideVault;
+    const new_relative = vaultRelative(vault_root, new_path) orelse return error.OutsideVault;
+
+    var vault = try std.fs.openDirAbsolute(vault_root, .{ .iterate = true });
+    defer vault.close();
+    _ = try VaultRename.renameNote(allocator, vault, old_relative, new_relative);
+
+    // Open notes get the same rewrite in memory, as one undo step
+    const rename = try VaultRename.Rename.init(allocator, old_relative, new_relative);
+    defer rename.deinit(allocator);
+    for (open_sessions.items) |c_session| {
+        const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse continue));
+        const note_path = vaultRelative(vault_root, session.file_path) orelse continue;
+
+        var arena = std.heap.ArenaAllocator.init(allocator);
+        defer arena.deinit();
+        const text = session.editor.contents();
+        const edits = try VaultRename.planEdits(arena.allocator(), text, note_path, rename);
+        try session.replaceRanges(edits);
+        if (std.mem.eql(u8, session.file_path, old_path)) try session.setFilePath(new_path);
+        c_session.sync();
+    }
+}
+
+fn vaultRelative(vault_root: []const u8, path: []const u8) ?[]const u8 {
+    if (!std.mem.startsWith(u8, path, vault_root)) return null;
+    const rest = path[vault_root.len..];
+    if (rest.len == 0 or (rest[0] != '/' and vault_root[vault_root.len - 1] != '/')) return null;
+    return std.mem.trimLeft(u8, rest, "/");
+}
+
+export fn renameNote(vault_root: [*:0]const u8, old_path: [*:0]const u8, new_path: [*:0]const u8) callconv(.c) c_int {
+    renameNoteImpl(std.mem.span(vault_root), std.mem.span(old_path), std.mem.span(new_path)) catch return -1;
+    return 0;
+}
+
+// ============================================================================
+// Image Exports
+// ============================================================================
+
+pub const CImageSize = extern struct {
+    width: u32,
+    height: u32,
+};
+
+/// Header probes for local images; sessions queue them when they parse
+var image_probe: ?*ImageProbe.Service = null;
+
+export fn getImageSize(path: [*:0]const u8, out: ?*CImageSize) callconv(.c) c_int {
+    return probedImageSize(std.mem.span(path), out);
+}
+
+export fn getNoteImageSize(session_ptr: ?*CEditSession, url: [*:0]const u8, out: ?*CImageSize) callconv(.c) c_int {
+    const c_session = session_ptr orelse return 0;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return 0));
+    // The same path the session queued when it parsed the image
+    const path = (session.localImagePath(std.mem.span(url)) catch return 0) orelse return 0;
+    defer std.heap.page_allocator.free(path);
+    return probedImageSize(path, out);
+}
+
+fn probedImageSize(path: []const u8, out: ?*CImageSize) c_int {
+    const probe = image_probe orelse return 0;
+    const dst = out orelse return 0;
+    const info = (probe.request(path) catch return 0) orelse return 0;
+    dst.* = .{ .width = info.width, .height = info.height };
+    return 1;
+}
+
+// ============================================================================
+// Property Exports
+// ============================================================================
+
+/// Metadata of every note in the vault, kept current on save once built
+var property_index = PropertyIndex.init(std.heap.page_allocator);
+var property_index_loaded = false;
+
+export fn indexVaultProperties(vault_root: [*:0]const u8) callconv(.c) isize {
+    const count = property_index.indexVault(std.mem.span(vault_root)) catch return -1;
+    property_index_loaded = true;
+    return @intCast(count);
+}
+
+export fn findNotesWithProperty(key: [*:0]const u8, value: [*:0]const u8, out: ?[*]u8, out_len: usize) callconv(.c) usize {
+    const dst = out orelse return 0;
+    const rows = property_index.findEquals(std.heap.page_allocator, std.mem.span(key), std.mem.span(value)) catch return 0;
+    defer std.heap.page_allocator.free(rows);
+    return writeNotePaths(rows, dst[0..out_len]);
+}
+
+export fn queryVault(query: [*:0]const u8, utc_offset: i32, out: ?[*]u8, out_len: usize) callconv(.c) isize {
+    const rows = VaultQuery.execute(std.heap.page_allocator, &property_index, std.mem.span(query), std.time.timestamp(), utc_offset) catch return -1;
+    defer std.heap.page_allocator.free(rows);
+    const dst = out orelse return 0;
+    return @intCast(writeNotePaths(rows, dst[0..out_len]));
+}
+
+/// Paths of `rows` separated by '\n', as many as fit; returns bytes written
+fn writeNotePaths(rows: []const u32, dst: []u8) usize {
+    var written: usize = 0;
+    for (rows) |row| {
+        const path = property_index.path(row);
+        const needed = path.len + @intFromBool(written > 0);
+        if (written + needed > dst.len) break;
+        if (written > 0) {
+            dst[written] = '\n';
+            written += 1;
+        }
+        @memcpy(dst[written .. written + path.len], path);
+        written += path.len;
+    }
+    return written;
+}
+
+// ============================================================================
+// Quick Capture Exports
+// ============================================================================
+
+export fn quickAppend(path: [*:0]const u8, text: [*:0]const u8) callconv(.c) c_int {
+    const allocator = std.heap.page_allocator;
+    const note_path = std.mem.span(path);
+    // An open session already knows the encoding, which the tail alone may not
+    var known: ?Encoding.Kind = null;
+    for (open_sessions.items) |c_session| {
+        const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse continue));
+        if (std.mem.eql(u8, session.file_path, note_path)) known = session.encoding;
+    }
+    const appended = QuickAppend.append(allocator, note_path, std.mem.span(text), known) catch return -1;
+    defer appended.deinit(allocator);
+
+    // The capture is on disk; what follows only brings caches up to date
+    for (open_sessions.items) |c_session| {
+        const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse continue));
+        if (!std.mem.eql(u8, session.file_path, note_path)) continue;
+        session.appendCaptured(appended.text) catch {};
+        c_session.sync();
+    }
+    if (property_index_loaded) {
+        const indexed = property_index.appendText(note_path, appended.last_line, appended.text, appended.mtime) catch false;
+        if (!indexed and appended.was_empty) property_index.update(note_path, appended.text, appended.mtime) catch {};
+    }
+    _ = transclusions.invalidate(note_path);
+    if (transclusions.hasRetired()) refreshEmbeds();
+    return 0;
+}
+
+// ============================================================================
+// History Exports
+// ============================================================================
+
+pub const CNoteVersion = extern struct {
+    id: u32,
+    timestamp: i64,
+    size: u64,
+};
+
+/// Version history recorded on every save once opened
+var history_store: ?HistoryStore = null;
+
+export fn openHistoryStore(store_path: [*:0]const u8) callconv(.c) c_int {
+    if (history_store != null) return 0;
+    history_store = HistoryStore.open(std.heap.page_allocator, std.mem.span(store_path)) catch return -1;
+    return 0;
+}
+
+export fn getNoteVersions(note_path: [*:0]const u8, out: ?[*]CNoteVersion, max_count: usize) callconv(.c) isize {
+    const store = &(history_store orelse return -1);
+    const versions = store.versionsOf(std.heap.page_allocator, std.mem.span(note_path)) catch return -1;
+    defer std.heap.page_allocator.free(versions);
+
+    const n = @min(versions.len, max_count);
+    if (out) |dst| {
+        for (versions[0..n], 0..) |version, i| {
+            dst[i] = .{ .id = version.id, .timestamp = version.timestamp, .size = version.size };
+        }
+    }
+    return @intCast(n);
+}
+
+export fn readNoteVersion(version_id: u32, out: ?[*]u8, out_len: usize) callconv(.c) isize {
+    const store = &(history_store orelse return -1);
+    const size = store.versionSize(version_id) orelse return -1;
+    if (out) |dst| {
+        if (out_len >= size) store.readVersionInto(version_id, dst[0..@intCast(size)]) catch return -1;
+    }
+    return @intCast(size);
+}
+
+// ============================================================================
+// Sync Exports
+// ============================================================================
+
+/// Logs are small (runs, not keystrokes), but bound what a bad file can cost
+const MAX_SYNC_LOG = 256 * 1024 * 1024;
+
+export fn enableSync(session_ptr: ?*CEditSession, replica: u32, log_path: [*:0]const u8) callconv(.c) c_int {
+    const c_session = session_ptr orelse return -1;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return -1));
+    if (replica == SequenceCrdt.BASE_REPLICA) return -1;
+
+    const allocator = std.heap.page_allocator;
+    const saved: ?[]u8 = std.fs.cwd().readFileAlloc(allocator, std.mem.span(log_path), MAX_SYNC_LOG) catch |err| switch (err) {
+        error.FileNotFound => null,
+        else => return -1,
+    };
+    defer if (saved) |bytes| allocator.free(bytes);
+    session.enableSync(replica, saved) catch return -1;
+    return 0;
+}
+
+export fn writeSyncLog(session_ptr: ?*CEditSession, log_path: [*:0]const u8) callconv(.c) c_int {
+    const c_session = session_ptr orelse return -1;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return -1));
+
+    const allocator = std.heap.page_allocator;
+    const bytes = session.syncLog(allocator) catch return -1;
+    defer allocator.free(bytes);
+
+    // Sync tools must never pick up a half-written log
+    const path = std.mem.span(log_path);
+    const tmp_path = std.fmt.allocPrint(allocator, "{s}.tmp", .{path}) catch return -1;
+    defer allocator.free(tmp_path);
+    {
+        const file = std.fs.cwd().createFile(tmp_path, .{ .truncate = true }) catch return -1;
+        defer file.close();
+        file.writeAll(bytes) catch return -1;
+    }
+    std.fs.cwd().rename(tmp_path, path) catch return -1;
+    return 0;
+}
+
+export fn mergeSyncLog(session_ptr: ?*CEditSession, log_path: [*:0]const u8) callconv(.c) c_int {
+    const c_session = session_ptr orelse return -1;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return -1));
+
+    const allocator = std.heap.page_allocator;
+    const bytes = std.fs.cwd().readFileAlloc(allocator, std.mem.span(log_path), MAX_SYNC_LOG) catch return -1;
+    defer allocator.free(bytes);
+    const changed = session.mergeSyncLog(bytes) catch return -1;
+    if (!changed) return 0;
+    c_session.sync();
+    return 1;
+}
+
+// ============================================================================
+// Spell Check Exports
+// ============================================================================
+
+pub const CMisspelling = extern struct {
+    start: usize,
+    end: usize,
+};
+
+/// Shared by all sessions; mapped once and kept for the life of the process
+/// since session spell checkers point into it.
+var spell_dictionary: ?SpellCheck.Dictionary = null;
+
+export fn loadSpellDictionary(word_list_path: [*:0]const u8, cache_path: [*:0]const u8) callconv(.c) c_int {
+    if (spell_dictionary != null) return 0;
+    spell_dictionary = SpellCheck.Dictionary.load(
+        std.heap.page_allocator,
+        std.mem.span(word_list_path),
+        std.mem.span(cache_path),
+    ) catch return -1;
+    return 0;
+}
+
+export fn requestSpellCheck(session_ptr: ?*CEditSession, start_offset: usize, end_offset: usize) callconv(.c) void {
+    const c_session = session_ptr orelse return;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return));
+    const dictionary = &(spell_dictionary orelse return);
+    session.requestSpellCheck(dictionary, start_offset, end_offset) catch return;
+}
+
+export fn getMisspellings(session_ptr: ?*CEditSession, out: ?[*]CMisspelling, max_count: usize) callconv(.c) isize {
+    const c_session = session_ptr orelse return -1;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return -1));
+
+    var spans = std.ArrayList(SpellCheck.Span).empty;
+    defer spans.deinit(std.heap.page_allocator);
+    const ready = session.misspellings(std.heap.page_allocator, &spans) catch return -1;
+    if (!ready) return -1;
+
+    const n = @min(spans.items.len, max_count);
+    if (out) |dst| {
+        for (spans.items[0..n], 0..) |span, i| {
+            dst[i] = .{ .start = span.start, .end = span.end };
+        }
+    }
+    return @intCast(n);
+}
+
+export fn getSpellingSuggestions(word_ptr: [*]const u8, word_len: usize, out: ?[*]u8, out_len: usize) callconv(.c) usize {
+    const dictionary = &(spell_dictionary orelse return 0);
+    const dst = out orelse return 0;
+
+    var suggestions: [8]Dawg.Suggestion = undefined;
+    const count = dictionary.suggest(word_ptr[0..word_len], &suggestions);
+
+    var written: usize = 0;
+    for (suggestions[0..count]) |*suggestion| {
+        const word = suggestion.slice();
+        const needed = word.len + @intFromBool(written > 0);
+        if (written + needed > out_len) break;
+        if (written > 0) {
+            dst[written] = '\n';
+            written += 1;
+        }
+        @memcpy(dst[written .. written + word.len], word);
+        written += word.len;
+    }
+    return written;
+}
+
+// ============================================================================
+// Completion Exports
+// ============================================================================
+
+/// Vocabulary of the open vault, shared by all sessions
+var completion_index: ?Completion.Index = null;
+
+/// Rebuild the vault's completion index at `cache_path` and map it. If the
+/// vault cannot be read, the index from an earlier run is used as is.
+export fn loadCompletionIndex(vault_root: [*:0]const u8, cache_path: [*:0]const u8) callconv(.c) c_int {
+    const allocator = std.heap.page_allocator;
+    const cache = std.mem.span(cache_path);
+    const index = Completion.Index.build(allocator, std.mem.span(vault_root), cache) catch
+        Completion.Index.open(allocator, cache) catch return -1;
+    if (completion_index) |*old| old.deinit();
+    completion_index = index;
+    return 0;
+}
+
+/// Newline-separated completions of the word or `[[link` at the cursor,
+/// best first. `replace_start` receives the offset the prefix starts at.
+export fn getCompletions(session_ptr: ?*CEditSession, out: ?[*]u8, out_len: usize, replace_start: ?*usize) callconv(.c) usize {
+    const c_session = session_ptr orelse return 0;
+    const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse return 0));
+    const index = &(completion_index orelse return 0);
+    const dst = out orelse return 0;
+
+    var completions: [8]Fst.Completion = undefined;
+    const match = session.completionsAtCursor(index, &completions) catch return 0;
+    if (replace_start) |start| start.* = match.start;
+
+    var written: usize = 0;
+    for (completions[0..match.count]) |*completion| {
+        const word = completion.slice();
+        const needed = word.len + @intFromBool(written > 0);
+        if (written + needed > out_len) break;
+        if (written > 0) {
+            dst[written] = '\n';
+            written += 1;
+        }
+        @memcpy(dst[written .. written + word.len], word);
+        written += word.len;
+    }
+    return written;
+}
+
+/// When the surface next needs a frame, for on-demand (paused) MTKViews
+pub const CFrameRequest = extern struct {
+    immediate: u8,
+    has_deadline: u8,
+    delay_seconds: f64,
+};
+
 // ============================================================================
 // Metal Surface Exports
 // ============================================================================
@@ -352,6 +934,53 @@ export fn update_scroll(renderer_ptr: ?*anyopaque, delta_y: f32) callconv(.c) vo
     r.updateScroll(delta_y);
 }
 
+export fn animate_scroll(renderer_ptr: ?*anyopaque, duration_seconds: f64) callconv(.c) void {
+    const ptr = renderer_ptr orelse return;
+    const r: *Metal = @ptrCast(@alignCast(ptr));
+    r.animateFor(@intFromFloat(@max(duration_seconds, 0) * std.time.ns_per_s));
+}
+
+/// Image probes and spell checks queued by parses finish on worker threads
+fn backgroundWorkPending() bool {
+    if (image_probe) |probe| {
+        if (!probe.isIdle()) return true;
+    }
+    for (open_sessions.items) |c_session| {
+        const session: *EditSession = @ptrCast(@alignCast(c_session.session_ptr orelse continue));
+        const checker = session.spell_checker orelse continue;
+        if (!checker.isIdle()) return true;
+    }
+    return false;
+}
+
+export fn next_frame_request(renderer_ptr: ?*anyopaque) callconv(.c) CFrameRequest {
+    const ptr = renderer_ptr orelse return .{ .immediate = 0, .has_deadline = 0, .delay_seconds = 0 };
+    const r: *Metal = @ptrCast(@alignCast(ptr));
+    // Poll while their results are outstanding; the frame after they land
+    // picks them up
+    r.setPendingWork(backgroundWorkPending());
+    const now = std.time.nanoTimestamp();
+    const request = r.nextFrame();
+
+    const deadline = request.deadline_ns orelse return .{
+        .immediate = if (request.immediate) 1 else 0,
+        .has_deadline = 0,
+        .delay_seconds = 0,
+    };
+    const delay_ns = @max(deadline - now, 0);
+    return .{
+        .immediate = if (request.immediate) 1 else 0,
+        .has_deadline = 1,
+        .delay_seconds = @as(f64, @floatFromInt(delay_ns)) / std.time.ns_per_s,
+    };
+}
+
+export fn set_font_size(renderer_ptr: ?*anyopaque, font_size: f32) callconv(.c) void {
+    const ptr = renderer_ptr orelse return;
+    const r: *Metal = @ptrCast(@alignCast(ptr));
+    r.setFontSize(font_size);
+}
+
 export fn surface_deinit(renderer_ptr: ?*anyopaque) callconv(.c) void {
     const ptr = renderer_ptr orelse return;
     const r: *Metal = @ptrCast(@alignCast(ptr));
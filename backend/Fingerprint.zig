@@ -0,0 +1,354 @@
+// Fingerprint.zig - Merkle tree of hashes over the chunks of a buffer
+//
+// Portable (std only). The text is cut into chunks of up to MAX_CHUNK bytes,
+// kept in document order in a randomized binary search tree whose nodes also
+// hash their whole subtree. The hash is a polynomial one modulo the Mersenne
+// prime 2^61 - 1, with byte c as digit c + 1:
+//
+//     H(s) = d(s[0]) * B^(n-1) + d(s[1]) * B^(n-2) + ... + d(s[n-1])
+//
+// so H(a ++ b) = H(a) * B^len(b) + H(b). A subtree's hash follows from its
+// children's without looking at the text and, unlike a hash of chunk hashes,
+// does not depend on where the chunks were cut: the fingerprint of a range
+// equals `hashBytes` of the same bytes. An edit rehashes the chunks it
+// touches and the O(log n) nodes above them.
+//
+// The tree does not hold the text. Callers edit their buffer first, then pass
+// the new text and the edited range to `splice`.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+const Fingerprint = @This();
+
+const MODULUS: u64 = (1 << 61) - 1;
+/// Polynomial base; any value in [256, MODULUS) works
+const BASE: u64 = 0x1f3d5b79a2c4e687 % MODULUS;
+/// Chunks longer than this are split; an edit rehashes at most a few
+const MAX_CHUNK = 512;
+
+const NIL: u32 = std.math.maxInt(u32);
+
+const Node = struct {
+    left: u32,
+    right: u32,
+    /// This chunk
+    len: u32,
+    hash: u64,
+    power: u64,
+    /// Subtree: chunk count, bytes, H of its bytes and B^bytes
+    count: u32,
+    total_len: usize,
+    total_hash: u64,
+    total_power: u64,
+};
+
+allocator: Allocator,
+nodes: std.ArrayList(Node) = .empty,
+free: std.ArrayList(u32) = .empty,
+root: u32 = NIL,
+prng: std.Random.DefaultPrng = std.Random.DefaultPrng.init(0x5eed),
+
+// ============================================================================
+// Hashing
+// ============================================================================
+
+fn mulMod(a: u64, b: u64) u64 {
+    const product = @as(u128, a) * b;
+    const folded = @as(u64, @truncate(product & MODULUS)) + @as(u64, @truncate(product >> 61));
+    return if (folded >= MODULUS) folded - MODULUS else folded;
+}
+
+fn addMod(a: u64, b: u64) u64 {
+    const sum = a + b;
+    return if (sum >= MODULUS) sum - MODULUS else sum;
+}
+
+/// H(a ++ b) from H(a), H(b) and B^len(b)
+fn concat(hash_a: u64, hash_b: u64, power_b: u64) u64 {
+    return addMod(mulMod(hash_a, power_b), hash_b);
+}
+
+const Hashed = struct { hash: u64, power: u64 };
+
+fn hashWithPower(bytes: []const u8) Hashed {
+    var hash: u64 = 0;
+    var power: u64 = 1;
+    for (bytes) |byte| {
+        // Digits start at 1 so leading zero bytes still count
+        hash = addMod(mulMod(hash, BASE), @as(u64, byte) + 1);
+        power = mulMod(power, BASE);
+    }
+    return .{ .hash = hash, .power = power };
+}
+
+/// Fingerprint of `bytes`, equal to that of any tree range holding them
+pub fn hashBytes(bytes: []const u8) u64 {
+    return hashWithPower(bytes).hash;
+}
+
+/// Fingerprint of `a ++ bytes`, given only `hashBytes(a)`
+pub fn extend(hash: u64, bytes: []const u8) u64 {
+    const tail = hashWithPower(bytes);
+    return concat(hash, tail.hash, tail.power);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+pub fn build(allocator: Allocator, text: []const u8) !Fingerprint {
+    var self = Fingerprint{ .allocator = allocator };
+    errdefer self.deinit();
+    try self.nodes.ensureTotalCapacity(allocator, chunksFor(text.len));
+    self.root = self.buildChunks(text);
+    return self;
+}
+
+pub fn deinit(self: *Fingerprint) void {
+    self.nodes.deinit(self.allocator);
+    self.free.deinit(self.allocator);
+}
+
+/// Fingerprint of the whole text
+pub fn whole(self: *const Fingerprint) u64 {
+    return if (self.root == NIL) 0 else self.nodes.items[self.root].total_hash;
+}
+
+/// Bytes covered; equals the text length after every splice
+pub fn len(self: *const Fingerprint) usize {
+    return self.totalLen(self.root);
+}
+
+/// Fingerprint of text[start..end]. Chunks inside the range come from the
+/// tree; only the two partly covered ones are hashed from `text`.
+pub fn range(self: *const Fingerprint, text: []const u8, start: usize, end: usize) u64 {
+    std.debug.assert(start <= end and end <= text.len);
+    var acc = Hashed{ .hash = 0, .power = 1 };
+    self.collect(self.root, 0, text, start, end, &acc);
+    return acc.hash;
+}
+
+/// Update after `text` had [start, old_end) replaced by [start, new_end).
+/// Rehashes the chunks around the edit; the rest of the tree is relinked.
+pub fn splice(self: *Fingerprint, text: []const u8, start: usize, old_end: usize, new_end: usize) !void {
+    // Reserve first so a failed allocation leaves the tree as it was. The
+    // rebuilt span is the edit plus at most one chunk on either side.
+    try self.nodes.ensureUnusedCapacity(self.allocator, chunksFor(new_end - start + 2 * MAX_CHUNK));
+    try self.free.ensureTotalCapacity(self.allocator, self.nodes.items.len);
+
+    // Take the chunk ending at `start` and the one starting at `old_end`
+    // along, so typing grows a chunk rather than adding tiny ones
+    const before = self.split(self.root, 0, start, .end_before);
+    const after = self.split(before[1], self.totalLen(before[0]), old_end, .start_at_most);
+
+    const middle_start = self.totalLen(before[0]);
+    const middle_old_len = self.totalLen(after[0]);
+    const middle_end = middle_start + middle_old_len + new_end - old_end;
+    self.release(after[0]);
+
+    const middle = self.buildChunks(text[middle_start..middle_end]);
+    self.root = self.merge(self.merge(before[0], middle), after[1]);
+}
+
+// ============================================================================
+// Tree
+// ============================================================================
+
+fn totalLen(self: *const Fingerprint, node: u32) usize {
+    return if (node == NIL) 0 else self.nodes.items[node].total_len;
+}
+
+fn count(self: *const Fingerprint, node: u32) u32 {
+    return if (node == NIL) 0 else self.nodes.items[node].count;
+}
+
+/// Recompute a node's subtree fields from its children
+fn update(self: *Fingerprint, index: u32) void {
+    const nodes = self.nodes.items;
+    var node = &nodes[index];
+    var acc = Hashed{ .hash = 0, .power = 1 };
+    node.count = 1;
+    node.total_len = node.len;
+    if (node.left != NIL) {
+        const left = nodes[node.left];
+        acc = .{ .hash = left.total_hash, .power = left.total_power };
+        node.count += left.count;
+        node.total_len += left.total_len;
+    }
+    acc = .{ .hash = concat(acc.hash, node.hash, node.power), .power = mulMod(acc.power, node.power) };
+    if (node.right != NIL) {
+        const right = nodes[node.right];
+        acc = .{ .hash = concat(acc.hash, right.total_hash, right.total_power), .power = mulMod(acc.power, right.total_power) };
+        node.count += right.count;
+        node.total_len += right.total_len;
+    }
+    node.total_hash = acc.hash;
+    node.total_power = acc.power;
+}
+
+/// Which chunks `split` puts on the left of `at`
+const SplitRule = enum {
+    /// Chunks ending before `at`
+    end_before,
+    /// Chunks starting at or before `at`
+    start_at_most,
+};
+
+/// Split `node` (whose first byte is at `base`) into the chunks `rule` puts
+/// left of `at` and the rest
+fn split(self: *Fingerprint, node: u32, base: usize, at: usize, rule: SplitRule) [2]u32 {
+    if (node == NIL) return .{ NIL, NIL };
+    const n = self.nodes.items[node];
+    const chunk_start = base + self.totalLen(n.left);
+    const chunk_end = chunk_start + n.len;
+    const goes_left = switch (rule) {
+        .end_before => chunk_end < at,
+        .start_at_most => chunk_start <= at,
+    };
+    if (goes_left) {
+        const parts = self.split(n.right, chunk_end, at, rule);
+        self.nodes.items[node].right = parts[0];
+        self.update(node);
+        return .{ node, parts[1] };
+    } else {
+        const parts = self.split(n.left, base, at, rule);
+        self.nodes.items[node].left = parts[1];
+        self.update(node);
+        return .{ parts[0], node };
+    }
+}
+
+/// Join two trees, `a` before `b`. The root is picked at random weighted by
+/// size, which keeps the expected depth logarithmic without priorities.
+fn merge(self: *Fingerprint, a: u32, b: u32) u32 {
+    if (a == NIL) return b;
+    if (b == NIL) return a;
+    const size_a = self.count(a);
+    if (self.prng.random().uintLessThan(u32, size_a + self.count(b)) < size_a) {
+        self.nodes.items[a].right = self.merge(self.nodes.items[a].right, b);
+        self.update(a);
+        return a;
+    } else {
+        self.nodes.items[b].left = self.merge(a, self.nodes.items[b].left);
+        self.update(b);
+        return b;
+    }
+}
+
+fn chunksFor(byte_count: usize) usize {
+    return (byte_count + MAX_CHUNK - 1) / MAX_CHUNK;
+}
+
+/// Balanced tree over `bytes` cut into near-equal chunks of at most
+/// MAX_CHUNK; the caller reserved the nodes
+fn buildChunks(self: *Fingerprint, bytes: []const u8) u32 {
+    const chunk_count = chunksFor(bytes.len);
+    return self.buildRange(bytes, 0, chunk_count, chunk_count);
+}
+
+fn buildRange(self: *Fingerprint, bytes: []const u8, first: usize, last: usize, chunk_count: usize) u32 {
+    if (first == last) return NIL;
+    const mid = first + (last - first) / 2;
+    const chunk = bytes[mid * bytes.len / chunk_count .. (mid + 1) * bytes.len / chunk_count];
+    const hashed = hashWithPower(chunk);
+
+    const index = self.newNode();
+    self.nodes.items[index] = .{
+        .left = self.buildRange(bytes, first, mid, chunk_count),
+        .right = self.buildRange(bytes, mid + 1, last, chunk_count),
+        .len = @intCast(chunk.len),
+        .hash = hashed.hash,
+        .power = hashed.power,
+        .count = 1,
+        .total_len = 0,
+        .total_hash = 0,
+        .total_power = 1,
+    };
+    self.update(index);
+    return index;
+}
+
+fn newNode(self: *Fingerprint) u32 {
+    if (self.free.pop()) |index| return index;
+    const index: u32 = @intCast(self.nodes.items.len);
+    _ = self.nodes.addOneAssumeCapacity();
+    return index;
+}
+
+fn release(self: *Fingerprint, node: u32) void {
+    if (node == NIL) return;
+    const n = self.nodes.items[node];
+    self.release(n.left);
+    self.release(n.right);
+    self.free.appendAssumeCapacity(node);
+}
+
+fn collect(self: *const Fingerprint, node: u32, base: usize, text: []const u8, start: usize, end: usize, acc: *Hashed) void {
+    if (node == NIL) return;
+    const n = self.nodes.items[node];
+    if (base >= end or base + n.total_len <= start) return;
+    if (start <= base and base + n.total_len <= end) {
+        acc.* = .{ .hash = concat(acc.hash, n.total_hash, n.total_power), .power = mulMod(acc.power, n.total_power) };
+        return;
+    }
+
+    self.collect(n.left, base, text, start, end, acc);
+    const chunk_start = base + self.totalLen(n.left);
+    const chunk_end = chunk_start + n.len;
+    const from = @max(chunk_start, start);
+    const to = @min(chunk_end, end);
+    if (from < to) {
+        const part = if (from == chunk_start and to == chunk_end)
+            Hashed{ .hash = n.hash, .power = n.power }
+        else
+            hashWithPower(text[from..to]);
+        acc.* = .{ .hash = concat(acc.hash, part.hash, part.power), .power = mulMod(acc.power, part.power) };
+    }
+    self.collect(n.right, chunk_end, text, start, end, acc);
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "fingerprints follow edits and match direct hashes" {
+    const allocator = std.testing.allocator;
+    var prng = std.Random.DefaultPrng.init(3);
+    const random = prng.random();
+
+    var text = std.ArrayList(u8).empty;
+    defer text.deinit(allocator);
+    for (0..5000) |_| try text.append(allocator, "abc \n#"[random.uintLessThan(usize, 6)]);
+
+    var tree = try Fingerprint.build(allocator, text.items);
+    defer tree.deinit();
+    try std.testing.expectEqual(hashBytes(text.items), tree.whole());
+
+    for (0..300) |_| {
+        const start = random.uintLessThan(usize, text.items.len + 1);
+        const old_end = @min(text.items.len, start + random.uintLessThan(usize, 40));
+        var inserted: [600]u8 = undefined;
+        const insert_len = if (random.boolean()) random.uintLessThan(usize, 4) else random.uintLessThan(usize, inserted.len);
+        for (inserted[0..insert_len]) |*byte| byte.* = random.int(u8);
+
+        try text.replaceRange(allocator, start, old_end - start, inserted[0..insert_len]);
+        try tree.splice(text.items, start, old_end, start + insert_len);
+
+        try std.testing.expectEqual(text.items.len, tree.len());
+        try std.testing.expectEqual(hashBytes(text.items), tree.whole());
+        const a = random.uintLessThan(usize, text.items.len + 1);
+        const b = random.uintLessThan(usize, text.items.len + 1);
+        try std.testing.expectEqual(hashBytes(text.items[@min(a, b)..@max(a, b)]), tree.range(text.items, @min(a, b), @max(a, b)));
+        try std.testing.expectEqual(tree.whole(), extend(hashBytes(text.items[0..a]), text.items[a..]));
+    }
+}
+
+test "different text, different fingerprint" {
+    const allocator = std.testing.allocator;
+    var tree = try Fingerprint.build(allocator, "# Title\nbody");
+    defer tree.deinit();
+    try std.testing.expect(tree.whole() != hashBytes("# Title\nbodY"));
+    try std.testing.expect(hashBytes("ab") != hashBytes("ba"));
+    try std.testing.expect(hashBytes("") != hashBytes("\x00"));
+}
@@ -0,0 +1,163 @@
+// FrameScheduler.zig - Decides when the editor surface actually needs a frame
+//
+// Portable (std only). Tracks caret blink phase, scroll animations and pending
+// background work so the view can draw on demand instead of on every vsync.
+// While idle the only frames are the two blink phase changes per period.
+
+const std = @import("std");
+
+const Self = @This();
+
+// ============================================================================
+// Constants
+// ============================================================================
+
+/// Full caret blink cycle (visible half + hidden half)
+pub const BLINK_PERIOD_NS: i128 = 2 * std.time.ns_per_s;
+/// How often to poll while background work (e.g. a parse) is still pending
+pub const PENDING_POLL_NS: i128 = 16 * std.time.ns_per_ms;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const FrameRequest = struct {
+    /// Something changed; draw as soon as possible
+    immediate: bool,
+    /// Absolute time (nanoTimestamp) of the next needed frame, null if none
+    deadline_ns: ?i128,
+};
+
+// ============================================================================
+// Struct Fields
+// ============================================================================
+
+blink_start_ns: i128,
+dirty: bool,
+animation_end_ns: i128,
+pending_work: bool,
+caret_enabled: bool,
+
+pub fn init(now_ns: i128) Self {
+    return .{
+        .blink_start_ns = now_ns,
+        .dirty = true,
+        .animation_end_ns = 0,
+        .pending_work = false,
+        .caret_enabled = true,
+    };
+}
+
+// ============================================================================
+// Events
+// ============================================================================
+
+/// Content, layout or scroll changed; the next frame is needed right away.
+pub fn markDirty(self: *Self) void {
+    self.dirty = true;
+}
+
+/// Restart the blink cycle so the caret is solid right after input or a click.
+pub fn resetBlink(self: *Self, now_ns: i128) void {
+    self.blink_start_ns = now_ns;
+    self.dirty = true;
+}
+
+/// Keep drawing every frame until `end_ns` (scroll / momentum animations).
+pub fn animateUntil(self: *Self, end_ns: i128) void {
+    self.animation_end_ns = @max(self.animation_end_ns, end_ns);
+    self.dirty = true;
+}
+
+/// Background work whose result will need a frame (e.g. a parse in flight).
+pub fn setPendingWork(self: *Self, pending: bool) void {
+    if (self.pending_work and !pending) self.dirty = true;
+    self.pending_work = pending;
+}
+
+/// Caret hidden (no focus, no cursor) means blinking needs no frames.
+pub fn setCaretEnabled(self: *Self, enabled: bool) void {
+    if (self.caret_enabled != enabled) self.dirty = true;
+    self.caret_enabled = enabled;
+}
+
+/// Call once a frame has been encoded.
+pub fn frameRendered(self: *Self) void {
+    self.dirty = false;
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+/// Caret blink is a two-phase square wave: visible, then hidden.
+pub fn caretVisible(self: *const Self, now_ns: i128) bool {
+    const elapsed = @max(now_ns - self.blink_start_ns, 0);
+    return @mod(elapsed, BLINK_PERIOD_NS) < @divTrunc(BLINK_PERIOD_NS, 2);
+}
+
+/// Absolute time of the next caret visibility flip after `now_ns`.
+pub fn nextBlinkChange(self: *const Self, now_ns: i128) i128 {
+    const half = @divTrunc(BLINK_PERIOD_NS, 2);
+    const elapsed = @max(now_ns - self.blink_start_ns, 0);
+    const phases_done = @divFloor(elapsed, half) + 1;
+    return self.blink_start_ns + phases_done * half;
+}
+
+pub fn nextFrame(self: *const Self, now_ns: i128) FrameRequest {
+    if (self.dirty or now_ns < self.animation_end_ns) {
+        return .{ .immediate = true, .deadline_ns = now_ns };
+    }
+
+    var deadline: ?i128 = null;
+    if (self.pending_work) deadline = now_ns + PENDING_POLL_NS;
+    if (self.caret_enabled) {
+        const blink = self.nextBlinkChange(now_ns);
+        deadline = if (deadline) |d| @min(d, blink) else blink;
+    }
+    return .{ .immediate = false, .deadline_ns = deadline };
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "idle caret needs two frames per blink period" {
+    var s = Self.init(0);
+    s.frameRendered();
+
+    const half = @divTrunc(BLINK_PERIOD_NS, 2);
+    try std.testing.expect(s.caretVisible(0));
+    try std.testing.expect(!s.caretVisible(half));
+    try std.testing.expect(s.caretVisible(BLINK_PERIOD_NS));
+
+    var now: i128 = 1;
+    var frames: usize = 0;
+    while (now < 3 * BLINK_PERIOD_NS) {
+        const req = s.nextFrame(now);
+        try std.testing.expect(!req.immediate);
+        now = req.deadline_ns.?;
+        s.frameRendered();
+        frames += 1;
+    }
+    try std.testing.expectEqual(@as(usize, 6), frames);
+}
+
+test "dirty and animations request immediate frames" {
+    var s = Self.init(0);
+    try std.testing.expect(s.nextFrame(10).immediate);
+    s.frameRendered();
+    try std.testing.expect(!s.nextFrame(10).immediate);
+
+    s.animateUntil(100);
+    s.frameRendered();
+    try std.testing.expect(s.nextFrame(50).immediate);
+    try std.testing.expect(!s.nextFrame(150).immediate);
+
+    s.setCaretEnabled(false);
+    s.frameRendered();
+    try std.testing.expectEqual(@as(?i128, null), s.nextFrame(200).deadline_ns);
+
+    s.setPendingWork(true);
+    try std.testing.expectEqual(@as(?i128, 200 + PENDING_POLL_NS), s.nextFrame(200).deadline_ns);
+}
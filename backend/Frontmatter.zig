@@ -0,0 +1,268 @@
+// Frontmatter.zig - Typed fields from the YAML frontmatter at the top of a note
+//
+// Portable (std only). Covers the subset notes actually use: `key: value`
+// scalars, block (`- item`) and flow (`[a, b]`) lists, quoted strings, numbers,
+// booleans and YYYY-MM-DD dates. Nested maps, anchors and multi-line scalars
+// are skipped. The block parser only records where the frontmatter is; `parse`
+// is run when the typed fields are actually needed.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const Value = union(enum) {
+    text: []const u8,
+    number: f64,
+    boolean: bool,
+    /// Days since 1970-01-01
+    date: i32,
+    /// Items are kept as (unquoted) text, as tags and aliases are
+    list: []const []const u8,
+};
+
+pub const Property = struct {
+    key: []const u8,
+    value: Value,
+};
+
+pub const Span = struct {
+    /// Text between the `---` lines
+    body: []const u8,
+    /// Offset just past the closing `---` line (and its newline)
+    end: usize,
+};
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+/// The frontmatter at the very start of `text`: a `---` line, the body, then a
+/// `---` (or `...`) line. Null if there is none or it is never closed.
+pub fn extract(text: []const u8) ?Span {
+    const first_end = std.mem.indexOfScalar(u8, text, '\n') orelse return null;
+    if (!isDelimiter(text[0..first_end], "---")) return null;
+
+    var line_start = first_end + 1;
+    while (line_start <= text.len) {
+        const line_end = std.mem.indexOfScalarPos(u8, text, line_start, '\n') orelse text.len;
+        const line = text[line_start..line_end];
+        if (isDelimiter(line, "---") or isDelimiter(line, "...")) {
+            return .{
+                .body = text[first_end + 1 .. line_start],
+                .end = @min(line_end + 1, text.len),
+            };
+        }
+        if (line_end == text.len) break;
+        line_start = line_end + 1;
+    }
+    return null;
+}
+
+/// Properties of a frontmatter body, in order; free with `free`. Strings
+/// point into `body`. Keys without a value (or with `null`/`~`) are left out.
+pub fn parse(allocator: Allocator, body: []const u8) ![]Property {
+    var properties = std.ArrayList(Property).empty;
+    errdefer {
+        for (properties.items) |property| if (property.value == .list) allocator.free(property.value.list);
+        properties.deinit(allocator);
+    }
+    var items = std.ArrayList([]const u8).empty;
+    defer items.deinit(allocator);
+
+    // Key whose value is given by the `- item` lines that follow
+    var list_key: ?[]const u8 = null;
+
+    var lines = std.mem.splitScalar(u8, body, '\n');
+    while (lines.next()) |raw_line| {
+        const line = std.mem.trimRight(u8, raw_line, " \t\r");
+        const trimmed = std.mem.trimLeft(u8, line, " \t");
+        if (trimmed.len == 0 or trimmed[0] == '#') continue;
+
+        if (list_key != null and (std.mem.eql(u8, trimmed, "-") or std.mem.startsWith(u8, trimmed, "- "))) {
+            const item = unquote(stripComment(std.mem.trim(u8, trimmed[1..], " \t")));
+            if (item.len > 0) try items.append(allocator, item);
+            continue;
+        }
+        // Anything else indented belongs to a nested map
+        if (trimmed.len != line.len) continue;
+
+        if (list_key) |key| {
+            try flushList(allocator, &properties, key, &items);
+            list_key = null;
+        }
+
+        const colon = std.mem.indexOfScalar(u8, line, ':') orelse continue;
+        const key = unquote(std.mem.trim(u8, line[0..colon], " \t"));
+        const rest = stripComment(std.mem.trim(u8, line[colon + 1 ..], " \t"));
+        if (key.len == 0) continue;
+
+        if (rest.len == 0) {
+            list_key = key;
+        } else if (rest[0] == '[' and rest[rest.len - 1] == ']') {
+            try parseFlowList(allocator, rest[1 .. rest.len - 1], &items);
+            try flushList(allocator, &properties, key, &items);
+        } else if (parseScalar(rest)) |value| {
+            try properties.append(allocator, .{ .key = key, .value = value });
+        }
+    }
+    if (list_key) |key| try flushList(allocator, &properties, key, &items);
+
+    return properties.toOwnedSlice(allocator);
+}
+
+pub fn free(allocator: Allocator, properties: []const Property) void {
+    for (properties) |property| switch (property.value) {
+        .list => |list| allocator.free(list),
+        else => {},
+    };
+    allocator.free(properties);
+}
+
+/// Type a single scalar the way YAML would: quoted text stays text, then
+/// booleans, dates and numbers are recognised. Null for `null` and `~`.
+pub fn parseScalar(raw: []const u8) ?Value {
+    if (raw.len >= 2 and (raw[0] == '"' or raw[0] == '\'') and raw[raw.len - 1] == raw[0]) {
+        return .{ .text = raw[1 .. raw.len - 1] };
+    }
+    if (std.mem.eql(u8, raw, "null") or std.mem.eql(u8, raw, "~")) return null;
+    if (std.mem.eql(u8, raw, "true") or std.mem.eql(u8, raw, "True")) return .{ .boolean = true };
+    if (std.mem.eql(u8, raw, "false") or std.mem.eql(u8, raw, "False")) return .{ .boolean = false };
+    if (parseDate(raw)) |days| return .{ .date = days };
+    if (looksNumeric(raw)) {
+        if (std.fmt.parseFloat(f64, raw)) |number| return .{ .number = number } else |_| {}
+    }
+    return .{ .text = raw };
+}
+
+/// "2024-03-09" (optionally followed by a time) -> days since 1970-01-01
+pub fn parseDate(raw: []const u8) ?i32 {
+    if (raw.len < 10 or raw[4] != '-' or raw[7] != '-') return null;
+    if (raw.len > 10 and raw[10] != 'T' and raw[10] != ' ') return null;
+    const year = std.fmt.parseInt(i32, raw[0..4], 10) catch return null;
+    const month = std.fmt.parseInt(u32, raw[5..7], 10) catch return null;
+    const day = std.fmt.parseInt(u32, raw[8..10], 10) catch return null;
+    if (month < 1 or month > 12 or day < 1 or day > 31) return null;
+    return daysFromCivil(year, month, day);
+}
+
+// ============================================================================
+// Private Helpers
+// ============================================================================
+
+fn isDelimiter(line: []const u8, marker: []const u8) bool {
+    return std.mem.eql(u8, std.mem.trimRight(u8, line, " \t\r"), marker);
+}
+
+fn flushList(
+    allocator: Allocator,
+    properties: *std.ArrayList(Property),
+    key: []const u8,
+    items: *std.ArrayList([]const u8),
+) !void {
+    defer items.clearRetainingCapacity();
+    if (items.items.len == 0) return;
+    const list = try allocator.dupe([]const u8, items.items);
+    errdefer allocator.free(list);
+    try properties.append(allocator, .{ .key = key, .value = .{ .list = list } });
+}
+
+/// `a, "b, c", d` -> a | b, c | d
+fn parseFlowList(allocator: Allocator, inner: []const u8, items: *std.ArrayList([]const u8)) !void {
+    var start: usize = 0;
+    var quote: ?u8 = null;
+    for (inner, 0..) |c, i| {
+        if (quote) |q| {
+            if (c == q) quote = null;
+        } else if (c == '"' or c == '\'') {
+            quote = c;
+        } else if (c == ',') {
+            const item = unquote(std.mem.trim(u8, inner[start..i], " \t"));
+            if (item.len > 0) try items.append(allocator, item);
+            start = i + 1;
+        }
+    }
+    const item = unquote(std.mem.trim(u8, inner[start..], " \t"));
+    if (item.len > 0) try items.append(allocator, item);
+}
+
+fn unquote(raw: []const u8) []const u8 {
+    if (raw.len >= 2 and (raw[0] == '"' or raw[0] == '\'') and raw[raw.len - 1] == raw[0]) {
+        return raw[1 .. raw.len - 1];
+    }
+    return raw;
+}
+
+/// Drop a ` # comment` unless the value is quoted
+fn stripComment(value: []const u8) []const u8 {
+    if (value.len > 0 and (value[0] == '"' or value[0] == '\'')) return value;
+    const hash = std.mem.indexOf(u8, value, " #") orelse return value;
+    return std.mem.trimRight(u8, value[0..hash], " \t");
+}
+
+fn looksNumeric(raw: []const u8) bool {
+    var i: usize = 0;
+    if (raw[0] == '-' or raw[0] == '+') i = 1;
+    if (i < raw.len and raw[i] == '.') i += 1;
+    // Rules out inf, nan and hex, which parseFloat would also accept
+    return i < raw.len and std.ascii.isDigit(raw[i]) and std.mem.indexOfAny(u8, raw, "xX") == null;
+}
+
+/// Proleptic Gregorian date -> days since 1970-01-01
+fn daysFromCivil(year: i32, month: u32, day: u32) i32 {
+    const y = if (month <= 2) year - 1 else year;
+    const era = @divFloor(y, 400);
+    const year_of_era = y - era * 400;
+    const shifted_month: i32 = @intCast((month + 9) % 12);
+    const day_of_year = @divFloor(153 * shifted_month + 2, 5) + @as(i32, @intCast(day)) - 1;
+    const day_of_era = year_of_era * 365 + @divFloor(year_of_era, 4) - @divFloor(year_of_era, 100) + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "extract finds only a closed leading block" {
+    const text = "---\ntitle: Hello\n---\n# Heading\n";
+    const span = extract(text).?;
+    try std.testing.expectEqualStrings("title: Hello\n", span.body);
+    try std.testing.expectEqualStrings("# Heading\n", text[span.end..]);
+
+    try std.testing.expectEqual(@as(usize, 10), extract("---\r\n...\r\n").?.end);
+    try std.testing.expect(extract("---\nnever closed\n") == null);
+    try std.testing.expect(extract("text\n---\na: b\n---\n") == null);
+}
+
+test "typed fields from the common subset" {
+    const allocator = std.testing.allocator;
+    const body =
+        \\title: "A: quoted title"
+        \\status: open # triage later
+        \\priority: 2
+        \\done: false
+        \\due: 2024-03-09
+        \\tags: [project, "x, y"]
+        \\aliases:
+        \\  - First
+        \\  - 'Second'
+        \\nested:
+        \\  inner: skipped
+        \\empty: ~
+    ;
+    const properties = try parse(allocator, body);
+    defer free(allocator, properties);
+
+    try std.testing.expectEqual(@as(usize, 7), properties.len);
+    try std.testing.expectEqualStrings("A: quoted title", properties[0].value.text);
+    try std.testing.expectEqualStrings("open", properties[1].value.text);
+    try std.testing.expectEqual(@as(f64, 2), properties[2].value.number);
+    try std.testing.expectEqual(false, properties[3].value.boolean);
+    try std.testing.expectEqual(@as(i32, 19791), properties[4].value.date);
+    try std.testing.expectEqualStrings("x, y", properties[5].value.list[1]);
+    try std.testing.expectEqualStrings("aliases", properties[6].key);
+    try std.testing.expectEqualStrings("Second", properties[6].value.list[1]);
+    try std.testing.expectEqual(@as(i32, 0), parseDate("1970-01-01T08:00").?);
+}
@@ -0,0 +1,522 @@
+// Fst.zig - Weighted word transducer (FST) in a flat, mmap-able format
+//
+// Portable (std only). The weighted sibling of Dawg.zig: `build` turns words
+// with weights (e.g. how often they occur) into a minimal acyclic transducer,
+// and `Transducer` reads it in place to answer "the k heaviest words starting
+// with this prefix". Weights are kept as costs (MAX_WEIGHT - weight) on the
+// edges and pushed toward the root while building, so from any state the
+// cheapest way on costs nothing extra. A best-first walk from the prefix then
+// meets the words in weight order and stops after k of them.
+//
+// Layout (little endian):
+//   Header                 32 bytes
+//   edges: [edge_count]    16 bytes each:
+//     u64 label | FINAL | LAST | target << 32
+//     u32 cost          added when taking the edge
+//     u32 final_cost    added when a word ends at the target (FINAL set)
+//
+// As in Dawg.zig, a state is the run of edges from its first edge index to the
+// edge with LAST set; edge 0 is a sentinel and target 0 means "no children".
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+pub const MAGIC = "CRFST001".*;
+/// Longer words are neither stored nor completed.
+pub const MAX_WORD_LEN = 64;
+pub const MAX_WEIGHT = std.math.maxInt(u32);
+
+const EDGE_FINAL: u64 = 1 << 8;
+const EDGE_LAST: u64 = 1 << 9;
+const EDGE_SIZE = 16;
+
+const Header = extern struct {
+    magic: [8]u8,
+    edge_count: u32,
+    root: u32,
+    word_count: u32,
+    reserved: [3]u32 = .{ 0, 0, 0 },
+};
+
+const HEADER_SIZE = @sizeOf(Header);
+
+comptime {
+    std.debug.assert(HEADER_SIZE == 32);
+}
+
+pub const Entry = struct {
+    word: []const u8,
+    weight: u32,
+};
+
+// ============================================================================
+// Construction
+// ============================================================================
+
+const BuildEdge = struct {
+    label: u8,
+    target: u32,
+    cost: u32,
+};
+
+const BuildState = struct {
+    edges: std.ArrayList(BuildEdge) = .empty,
+    final: bool = false,
+    final_cost: u32 = 0,
+};
+
+/// Edge from `parent` whose target is not yet minimized.
+const Unchecked = struct {
+    parent: u32,
+    child: u32,
+};
+
+const PackedEdge = struct {
+    bits: u64,
+    cost: u32,
+    final_cost: u32,
+};
+
+const Builder = struct {
+    allocator: Allocator,
+    states: std.ArrayList(BuildState) = .empty,
+    /// Signature (final flag, final cost + edges) -> canonical state
+    register: std.StringHashMapUnmanaged(u32) = .empty,
+    unchecked: std.ArrayList(Unchecked) = .empty,
+    previous: []const u8 = "",
+
+    fn newState(self: *Builder) !u32 {
+        try self.states.append(self.allocator, .{});
+        return @intCast(self.states.items.len - 1);
+    }
+
+    fn signature(self: *Builder, id: u32) ![]u8 {
+        const state = self.states.items[id];
+        const sig = try self.allocator.alloc(u8, 5 + state.edges.items.len * 9);
+        sig[0] = @intFromBool(state.final);
+        std.mem.writeInt(u32, sig[1..5], state.final_cost, .little);
+        for (state.edges.items, 0..) |edge, i| {
+            sig[5 + i * 9] = edge.label;
+            std.mem.writeInt(u32, sig[6 + i * 9 ..][0..4], edge.target, .little);
+            std.mem.writeInt(u32, sig[10 + i * 9 ..][0..4], edge.cost, .little);
+        }
+        return sig;
+    }
+
+    /// Replace unchecked states deeper than `depth` by equivalent registered
+    /// ones, deepest first, so each state is compared with finished children.
+    fn minimize(self: *Builder, depth: usize) !void {
+        while (self.unchecked.items.len > depth) {
+            const u = self.unchecked.pop().?;
+            const sig = try self.signature(u.child);
+            const gop = try self.register.getOrPut(self.allocator, sig);
+            if (gop.found_existing) {
+                const edges = self.states.items[u.parent].edges.items;
+                edges[edges.len - 1].target = gop.value_ptr.*;
+            } else {
+                gop.value_ptr.* = u.child;
+            }
+        }
+    }
+
+    /// Words must arrive sorted and unique. Along the prefix shared with the
+    /// previous word, each edge keeps the smaller of its cost and what is left
+    /// of this word's cost; the difference moves down onto the next state's
+    /// edges, so every word still sums to its own cost.
+    fn insert(self: *Builder, word: []const u8, cost: u32) !void {
+        const limit = @min(word.len, self.previous.len);
+        const prefix = std.mem.indexOfDiff(u8, word[0..limit], self.previous[0..limit]) orelse limit;
+        try self.minimize(prefix);
+
+        var remaining = cost;
+        var node: u32 = 0;
+        for (self.unchecked.items) |u| {
+            const edges = self.states.items[node].edges.items;
+            const edge = &edges[edges.len - 1];
+            const common = @min(edge.cost, remaining);
+            const pushed = edge.cost - common;
+            edge.cost = common;
+            remaining -= common;
+            if (pushed > 0) {
+                const child = &self.states.items[u.child];
+                for (child.edges.items) |*e| e.cost += pushed;
+                if (child.final) child.final_cost += pushed;
+            }
+            node = u.child;
+        }
+
+        // Sorted, unique input always leaves at least one new byte
+        std.debug.assert(prefix < word.len);
+        for (word[prefix..], 0..) |ch, i| {
+            const child = try self.newState();
+            try self.states.items[node].edges.append(self.allocator, .{
+                .label = ch,
+                .target = child,
+                .cost = if (i == 0) remaining else 0,
+            });
+            try self.unchecked.append(self.allocator, .{ .parent = node, .child = child });
+            node = child;
+        }
+        self.states.items[node].final = true;
+        self.previous = word;
+    }
+
+    /// Emit reachable states children-first so every edge points at a state
+    /// that is already placed. Returns the root's first edge index.
+    fn serialize(self: *Builder, edges: *std.ArrayList(PackedEdge)) !u32 {
+        const unplaced = std.math.maxInt(u32);
+        const placed = try self.allocator.alloc(u32, self.states.items.len);
+        @memset(placed, unplaced);
+
+        try edges.append(self.allocator, .{ .bits = 0, .cost = 0, .final_cost = 0 }); // sentinel
+
+        const Frame = struct { state: u32, next: usize };
+        var stack = std.ArrayList(Frame).empty;
+        try stack.append(self.allocator, .{ .state = 0, .next = 0 });
+
+        while (stack.items.len > 0) {
+            const top = &stack.items[stack.items.len - 1];
+            const out = self.states.items[top.state].edges.items;
+            if (top.next < out.len) {
+                const child = out[top.next].target;
+                top.next += 1;
+                if (placed[child] != unplaced) continue;
+                if (self.states.items[child].edges.items.len == 0) {
+                    placed[child] = 0;
+                    continue;
+                }
+                try stack.append(self.allocator, .{ .state = child, .next = 0 });
+                continue;
+            }
+
+            const first: u32 = @intCast(edges.items.len);
+            for (out, 0..) |edge, i| {
+                const target_state = self.states.items[edge.target];
+                var bits: u64 = edge.label;
+                if (target_state.final) bits |= EDGE_FINAL;
+                if (i + 1 == out.len) bits |= EDGE_LAST;
+                bits |= @as(u64, placed[edge.target]) << 32;
+                try edges.append(self.allocator, .{ .bits = bits, .cost = edge.cost, .final_cost = target_state.final_cost });
+            }
+            placed[top.state] = if (out.len == 0) 0 else first;
+            _ = stack.pop();
+        }
+        return placed[0];
+    }
+};
+
+fn lessThanEntry(_: void, a: Entry, b: Entry) bool {
+    return std.mem.lessThan(u8, a.word, b.word);
+}
+
+/// Build a serialized transducer from `entries` (any order; the weights of
+/// repeated words add up). Empty words and words longer than MAX_WORD_LEN are
+/// dropped. Caller owns the returned bytes.
+pub fn build(allocator: Allocator, entries: []const Entry) ![]u8 {
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const scratch = arena.allocator();
+
+    var sorted = std.ArrayList(Entry).empty;
+    for (entries) |entry| {
+        if (entry.word.len == 0 or entry.word.len > MAX_WORD_LEN) continue;
+        try sorted.append(scratch, entry);
+    }
+    std.mem.sort(Entry, sorted.items, {}, lessThanEntry);
+
+    var builder = Builder{ .allocator = scratch };
+    _ = try builder.newState(); // root
+
+    var word_count: u32 = 0;
+    var i: usize = 0;
+    while (i < sorted.items.len) {
+        const word = sorted.items[i].word;
+        var weight: u32 = 0;
+        while (i < sorted.items.len and std.mem.eql(u8, sorted.items[i].word, word)) : (i += 1) {
+            weight +|= sorted.items[i].weight;
+        }
+        try builder.insert(word, MAX_WEIGHT - weight);
+        word_count += 1;
+    }
+    try builder.minimize(0);
+
+    var edges = std.ArrayList(PackedEdge).empty;
+    const root = try builder.serialize(&edges);
+
+    const header = Header{
+        .magic = MAGIC,
+        .edge_count = @intCast(edges.items.len),
+        .root = root,
+        .word_count = word_count,
+    };
+
+    const bytes = try allocator.alloc(u8, HEADER_SIZE + edges.items.len * EDGE_SIZE);
+    @memcpy(bytes[0..HEADER_SIZE], std.mem.asBytes(&header));
+    for (edges.items, 0..) |edge, k| {
+        const dst = bytes[HEADER_SIZE + k * EDGE_SIZE ..][0..EDGE_SIZE];
+        std.mem.writeInt(u64, dst[0..8], edge.bits, .little);
+        std.mem.writeInt(u32, dst[8..12], edge.cost, .little);
+        std.mem.writeInt(u32, dst[12..16], edge.final_cost, .little);
+    }
+    return bytes;
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+pub const Completion = struct {
+    buf: [MAX_WORD_LEN]u8 = undefined,
+    len: u8 = 0,
+    weight: u32 = 0,
+
+    pub fn slice(self: *const Completion) []const u8 {
+        return self.buf[0..self.len];
+    }
+};
+
+const Edge = struct {
+    bits: u64,
+    cost: u32,
+    final_cost: u32,
+
+    fn label(self: Edge) u8 {
+        return @truncate(self.bits);
+    }
+
+    fn target(self: Edge) u32 {
+        return @intCast(self.bits >> 32);
+    }
+};
+
+/// A partial word on the best-first frontier, or a finished one (`done`)
+/// waiting for its turn
+const Pending = struct {
+    cost: u64,
+    state: u32,
+    done: bool,
+    len: u8,
+    buf: [MAX_WORD_LEN]u8,
+};
+
+fn cheaper(_: void, a: Pending, b: Pending) std.math.Order {
+    const by_cost = std.math.order(a.cost, b.cost);
+    if (by_cost != .eq) return by_cost;
+    // Among equals, hand out finished words before expanding further
+    return std.math.order(@intFromBool(b.done), @intFromBool(a.done));
+}
+
+/// Read-only view of a serialized transducer; does not own `bytes`.
+pub const Transducer = struct {
+    bytes: []const u8,
+    edge_count: u32,
+    root: u32,
+    word_count: u32,
+
+    pub fn init(bytes: []const u8) error{InvalidFst}!Transducer {
+        if (bytes.len < HEADER_SIZE) return error.InvalidFst;
+        var header: Header = undefined;
+        @memcpy(std.mem.asBytes(&header), bytes[0..HEADER_SIZE]);
+        if (!std.mem.eql(u8, &header.magic, &MAGIC)) return error.InvalidFst;
+
+        const edge_count = std.mem.littleToNative(u32, header.edge_count);
+        const root = std.mem.littleToNative(u32, header.root);
+        if (bytes.len < HEADER_SIZE + @as(usize, edge_count) * EDGE_SIZE or edge_count == 0 or root >= edge_count) {
+            return error.InvalidFst;
+        }
+        return .{
+            .bytes = bytes,
+            .edge_count = edge_count,
+            .root = root,
+            .word_count = std.mem.littleToNative(u32, header.word_count),
+        };
+    }
+
+    inline fn edge(self: *const Transducer, index: u32) Edge {
+        const src = self.bytes[HEADER_SIZE + @as(usize, index) * EDGE_SIZE ..][0..EDGE_SIZE];
+        return .{
+            .bits = std.mem.readInt(u64, src[0..8], .little),
+            .cost = std.mem.readInt(u32, src[8..12], .little),
+            .final_cost = std.mem.readInt(u32, src[12..16], .little),
+        };
+    }
+
+    /// Edge of `state` labelled `ch`. Edges are sorted by label.
+    fn step(self: *const Transducer, state: u32, ch: u8) ?Edge {
+        if (state == 0) return null;
+        var i = state;
+        while (i < self.edge_count) : (i += 1) {
+            const e = self.edge(i);
+            if (e.label() == ch) return e;
+            if (e.label() > ch or e.bits & EDGE_LAST != 0) return null;
+        }
+        return null;
+    }
+
+    pub fn weightOf(self: *const Transducer, word: []const u8) ?u32 {
+        if (word.len == 0 or word.len > MAX_WORD_LEN) return null;
+        var state = self.root;
+        var cost: u64 = 0;
+        var last: Edge = undefined;
+        for (word) |ch| {
+            last = self.step(state, ch) orelse return null;
+            cost += last.cost;
+            state = last.target();
+        }
+        if (last.bits & EDGE_FINAL == 0) return null;
+        return @intCast(MAX_WEIGHT - (cost + last.final_cost));
+    }
+
+    /// The heaviest words starting with `prefix` (the prefix itself included
+    /// if it is a word), heaviest first. `allocator` only backs the search
+    /// frontier. Returns the number of entries written to `out`.
+    pub fn complete(self: *const Transducer, allocator: Allocator, prefix: []const u8, out: []Completion) !usize {
+        if (prefix.len == 0 or prefix.len > MAX_WORD_LEN or out.len == 0) return 0;
+
+        var start = Pending{ .cost = 0, .state = self.root, .done = false, .len = @intCast(prefix.len), .buf = undefined };
+        @memcpy(start.buf[0..prefix.len], prefix);
+        var last: Edge = undefined;
+        for (prefix) |ch| {
+            last = self.step(start.state, ch) orelse return 0;
+            start.cost += last.cost;
+            start.state = last.target();
+        }
+
+        var frontier = std.PriorityQueue(Pending, void, cheaper).init(allocator, {});
+        defer frontier.deinit();
+        if (last.bits & EDGE_FINAL != 0) {
+            var word = start;
+            word.done = true;
+            word.cost += last.final_cost;
+            try frontier.add(word);
+        }
+        if (start.state != 0) try frontier.add(start);
+
+        var count: usize = 0;
+        while (frontier.removeOrNull()) |item| {
+            if (item.done) {
+                out[count] = .{ .len = item.len, .weight = @intCast(MAX_WEIGHT - item.cost) };
+                @memcpy(out[count].buf[0..item.len], item.buf[0..item.len]);
+                count += 1;
+                if (count == out.len) break;
+                continue;
+            }
+            if (item.len == MAX_WORD_LEN) continue;
+
+            var i = item.state;
+            while (i < self.edge_count) : (i += 1) {
+                const e = self.edge(i);
+                var next = item;
+                next.cost += e.cost;
+                next.buf[item.len] = e.label();
+                next.len += 1;
+                if (e.bits & EDGE_FINAL != 0) {
+                    var word = next;
+                    word.done = true;
+                    word.cost += e.final_cost;
+                    try frontier.add(word);
+                }
+                if (e.target() != 0) {
+                    next.state = e.target();
+                    try frontier.add(next);
+                }
+                if (e.bits & EDGE_LAST != 0) break;
+            }
+        }
+        return count;
+    }
+
+    /// Every word with its weight, for rebuilding with more entries. Words
+    /// are allocated from `allocator`.
+    pub fn collect(self: *const Transducer, allocator: Allocator, out: *std.ArrayList(Entry)) !void {
+        var prefix: [MAX_WORD_LEN]u8 = undefined;
+        try self.collectFrom(allocator, self.root, &prefix, 0, 0, out);
+    }
+
+    fn collectFrom(
+        self: *const Transducer,
+        allocator: Allocator,
+        state: u32,
+        prefix: *[MAX_WORD_LEN]u8,
+        depth: usize,
+        cost: u64,
+        out: *std.ArrayList(Entry),
+    ) !void {
+        if (state == 0 or depth >= MAX_WORD_LEN) return;
+        var i = state;
+        while (i < self.edge_count) : (i += 1) {
+            const e = self.edge(i);
+            prefix[depth] = e.label();
+            const reached = cost + e.cost;
+            if (e.bits & EDGE_FINAL != 0) {
+                try out.append(allocator, .{
+                    .word = try allocator.dupe(u8, prefix[0 .. depth + 1]),
+                    .weight = @intCast(MAX_WEIGHT - (reached + e.final_cost)),
+                });
+            }
+            try self.collectFrom(allocator, e.target(), prefix, depth + 1, reached, out);
+            if (e.bits & EDGE_LAST != 0) break;
+        }
+    }
+};
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "weights survive minimization" {
+    const allocator = std.testing.allocator;
+    const entries = [_]Entry{
+        .{ .word = "walking", .weight = 3 },
+        .{ .word = "talking", .weight = 40 },
+        .{ .word = "walk", .weight = 7 },
+        .{ .word = "talk", .weight = 2 },
+        .{ .word = "walk", .weight = 1 },
+        .{ .word = "wall", .weight = 12 },
+    };
+    const bytes = try build(allocator, &entries);
+    defer allocator.free(bytes);
+    const fst = try Transducer.init(bytes);
+
+    try std.testing.expectEqual(@as(u32, 5), fst.word_count);
+    try std.testing.expectEqual(@as(?u32, 8), fst.weightOf("walk"));
+    try std.testing.expectEqual(@as(?u32, 40), fst.weightOf("talking"));
+    try std.testing.expectEqual(@as(?u32, null), fst.weightOf("wal"));
+
+    var all = std.ArrayList(Entry).empty;
+    defer {
+        for (all.items) |entry| allocator.free(entry.word);
+        all.deinit(allocator);
+    }
+    try fst.collect(allocator, &all);
+    try std.testing.expectEqual(@as(usize, 5), all.items.len);
+    // Depth-first in label order: talk, talking, walk, walking, wall
+    try std.testing.expectEqualStrings("walking", all.items[3].word);
+    try std.testing.expectEqual(@as(u32, 3), all.items[3].weight);
+
+    try std.testing.expectError(error.InvalidFst, Transducer.init(bytes[0..16]));
+}
+
+test "prefix completions come heaviest first" {
+    const allocator = std.testing.allocator;
+    const entries = [_]Entry{
+        .{ .word = "walking", .weight = 3 },
+        .{ .word = "walk", .weight = 8 },
+        .{ .word = "wall", .weight = 12 },
+        .{ .word = "walrus", .weight = 1 },
+        .{ .word = "talk", .weight = 50 },
+    };
+    const bytes = try build(allocator, &entries);
+    defer allocator.free(bytes);
+    const fst = try Transducer.init(bytes);
+
+    var out: [3]Completion = undefined;
+    try std.testing.expectEqual(@as(usize, 3), try fst.complete(allocator, "wal", &out));
+    try std.testing.expectEqualStrings("wall", out[0].slice());
+    try std.testing.expectEqualStrings("walk", out[1].slice());
+    try std.testing.expectEqualStrings("walking", out[2].slice());
+    try std.testing.expectEqual(@as(u32, 3), out[2].weight);
+
+    try std.testing.expectEqual(@as(usize, 2), try fst.complete(allocator, "walk", &out));
+    try std.testing.expectEqual(@as(usize, 0), try fst.complete(allocator, "x", &out));
+}
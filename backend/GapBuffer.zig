@@ -0,0 +1,136 @@
+// GapBuffer.zig - TextStorage with the free space kept at the last edit
+//
+// Portable (std only). The text sits in one array around a gap; an edit
+// moves the gap to its offset, so runs of typing cost O(1) per byte instead
+// of a memmove of everything after the cursor. `contents` has to close the
+// gap (move it to the end) to hand out one slice, which costs that memmove
+// after all; the storage only pays off for consumers that read through
+// `slices` or `byteAt`.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const TextStorage = @import("TextStorage.zig");
+
+const GapBuffer = @This();
+
+const INITIAL_CAPACITY = 1024;
+
+buffer: []u8,
+gap_start: usize,
+gap_end: usize,
+lines: TextStorage.LineIndex,
+
+pub fn create(allocator: Allocator, text: []const u8) !GapBuffer {
+    var capacity: usize = INITIAL_CAPACITY;
+    while (capacity < text.len) : (capacity *= 2) {}
+    const buffer = try allocator.alloc(u8, capacity);
+    errdefer allocator.free(buffer);
+    @memcpy(buffer[0..text.len], text);
+    return .{
+        .buffer = buffer,
+        .gap_start = text.len,
+        .gap_end = capacity,
+        .lines = try TextStorage.LineIndex.build(allocator, text),
+    };
+}
+
+pub fn deinit(self: *GapBuffer, allocator: Allocator) void {
+    self.lines.deinit(allocator);
+    allocator.free(self.buffer);
+}
+
+pub fn len(self: *const GapBuffer) usize {
+    return self.buffer.len - self.gapLen();
+}
+
+fn gapLen(self: *const GapBuffer) usize {
+    return self.gap_end - self.gap_start;
+}
+
+pub fn byteAt(self: *const GapBuffer, i: usize) u8 {
+    return if (i < self.gap_start) self.buffer[i] else self.buffer[i + self.gapLen()];
+}
+
+/// Move the gap so it starts at text offset `offset`
+fn moveGap(self: *GapBuffer, offset: usize) void {
+    if (offset < self.gap_start) {
+        const moved = self.gap_start - offset;
+        std.mem.copyBackwards(u8, self.buffer[self.gap_end - moved .. self.gap_end], self.buffer[offset..self.gap_start]);
+        self.gap_start = offset;
+        self.gap_end -= moved;
+    } else if (offset > self.gap_start) {
+        const moved = offset - self.gap_start;
+        std.mem.copyForwards(u8, self.buffer[self.gap_start .. self.gap_start + moved], self.buffer[self.gap_end .. self.gap_end + moved]);
+        self.gap_start = offset;
+        self.gap_end += moved;
+    }
+}
+
+fn ensureGap(self: *GapBuffer, allocator: Allocator, needed: usize) !void {
+    if (self.gapLen() >= needed) return;
+    const size = self.len();
+    const capacity = @max(self.buffer.len * 2, size + needed);
+
+    const new_buffer = try allocator.alloc(u8, capacity);
+    const tail = self.buffer.len - self.gap_end;
+    @memcpy(new_buffer[0..self.gap_start], self.buffer[0..self.gap_start]);
+    @memcpy(new_buffer[capacity - tail ..], self.buffer[self.gap_end..]);
+
+    allocator.free(self.buffer);
+    self.buffer = new_buffer;
+    self.gap_end = capacity - tail;
+}
+
+pub fn insert(self: *GapBuffer, allocator: Allocator, i: usize, text: []const u8) !void {
+    try self.ensureGap(allocator, text.len);
+    try self.lines.insert(allocator, i, text);
+
+    self.moveGap(i);
+    @memcpy(self.buffer[self.gap_start .. self.gap_start + text.len], text);
+    self.gap_start += text.len;
+}
+
+// [start, end)
+pub fn delete_range(self: *GapBuffer, start: usize, end: usize) !void {
+    self.moveGap(start);
+    self.gap_end += end - start;
+    self.lines.delete(start, end);
+}
+
+/// Same-length replace of [i, i + text.len); the gap moves to `i` so the
+/// range is contiguous, but no text shifts
+pub fn overwrite(self: *GapBuffer, allocator: Allocator, i: usize, text: []const u8) !void {
+    self.moveGap(i);
+    const target = self.buffer[self.gap_end .. self.gap_end + text.len];
+    try self.lines.overwrite(allocator, i, target, text);
+    @memcpy(target, text);
+}
+
+pub fn slices(self: *const GapBuffer, start: usize, end: usize) TextStorage.Slices {
+    const gap = self.gapLen();
+    if (end <= self.gap_start) return .{ .parts = .{ self.buffer[start..end], &.{} } };
+    if (start >= self.gap_start) return .{ .parts = .{ self.buffer[start + gap .. end + gap], &.{} } };
+    return .{ .parts = .{ self.buffer[start..self.gap_start], self.buffer[self.gap_end .. end + gap] } };
+}
+
+/// Closes the gap; stable until the next edit
+pub fn contents(self: *GapBuffer) []const u8 {
+    self.moveGap(self.len());
+    return self.buffer[0..self.gap_start];
+}
+
+pub fn lineCount(self: *const GapBuffer) usize {
+    return self.lines.count();
+}
+
+pub fn lineStart(self: *const GapBuffer, line: usize) usize {
+    return self.lines.start(line);
+}
+
+pub fn lineOf(self: *const GapBuffer, offset: usize) usize {
+    return self.lines.lineOf(offset);
+}
+
+pub fn memoryUsed(self: *const GapBuffer) usize {
+    return self.buffer.len + self.lines.memoryUsed();
+}
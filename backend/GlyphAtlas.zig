@@ -0,0 +1,144 @@
+// GlyphAtlas.zig - Glyph atlas data types and lookup
+//
+// Portable (std only). CoreTextGlyphAtlas fills these in from a real font on
+// macOS; `synthetic` builds a fixed-metric atlas so layout, hit testing and
+// vertex generation can be tested and benchmarked on any host.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+/// Printable ASCII range: space (32) through tilde (126)
+pub const ASCII_START: u21 = 32;
+pub const ASCII_END: u21 = 126;
+pub const NUM_CHARS: usize = ASCII_END - ASCII_START + 1;
+pub const GLYPH_PAD: f32 = 2.0;
+/// Distance (in reference-size pixels) encoded on each side of a glyph edge in SDF mode.
+pub const SDF_SPREAD: f32 = 6.0;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const GlyphInfo = struct {
+    atlas_x: u32,
+    atlas_y: u32,
+    width: u32,
+    height: u32,
+    bearing_x: f32,
+    bearing_y: f32,
+    advance: f32,
+};
+
+/// What the atlas pixels hold: alpha coverage at one size, or a signed distance
+/// field that the glyph shader can reconstruct at any scale.
+pub const AtlasMode = enum {
+    coverage,
+    sdf,
+};
+
+pub const GlyphAtlas = struct {
+    pixels: []u8,
+    width: u32,
+    height: u32,
+    // TODO: probably make this a heap variable without this constraint in the future.
+    glyph_info: [NUM_CHARS]GlyphInfo,
+    line_height: f32,
+    ascent: f32,
+    mode: AtlasMode = .coverage,
+    /// Padding (in atlas texels) around each glyph bitmap
+    pad: f32 = GLYPH_PAD,
+    /// Font size the atlas was rasterized at
+    reference_size: f32,
+    /// display size / reference size; glyph_info stays in reference units
+    scale: f32 = 1.0,
+    reference_line_height: f32,
+    reference_ascent: f32,
+
+    pub fn deinit(self: *GlyphAtlas, allocator: Allocator) void {
+        allocator.free(self.pixels);
+    }
+
+    /// Glyph metrics scaled to the current display size. Atlas coordinates and
+    /// bitmap dimensions stay in texels; multiply them by `scale` for screen size.
+    pub fn getGlyphInfo(self: *const GlyphAtlas, codepoint: u21) ?GlyphInfo {
+        if (codepoint < ASCII_START or codepoint > ASCII_END) return null;
+        var info = self.glyph_info[codepoint - ASCII_START];
+        info.bearing_x *= self.scale;
+        info.bearing_y *= self.scale;
+        info.advance *= self.scale;
+        return info;
+    }
+
+    /// Rescale metrics for a new font size without touching the pixels.
+    /// Only SDF atlases stay sharp away from their reference size.
+    pub fn setDisplaySize(self: *GlyphAtlas, font_size: f32) void {
+        if (font_size <= 0) return;
+        self.scale = font_size / self.reference_size;
+        self.line_height = self.reference_line_height * self.scale;
+        self.ascent = self.reference_ascent * self.scale;
+    }
+};
+
+// ============================================================================
+// Synthetic Atlas
+// ============================================================================
+
+/// Monospaced atlas without pixels, for tests and benchmarks. Every glyph
+/// advances 0.6 em and every printable glyph except space has a box bitmap,
+/// packed 16 per row.
+pub fn synthetic(font_size: f32) GlyphAtlas {
+    const cell_w: u32 = @intFromFloat(@ceil(font_size * 0.6 + GLYPH_PAD * 2));
+    const cell_h: u32 = @intFromFloat(@ceil(font_size * 0.8 + GLYPH_PAD * 2));
+    const per_row: u32 = 16;
+    const rows: u32 = @intCast((NUM_CHARS + per_row - 1) / per_row);
+
+    var glyph_info: [NUM_CHARS]GlyphInfo = undefined;
+    for (&glyph_info, 0..) |*info, i| {
+        const idx: u32 = @intCast(i);
+        const is_space = ASCII_START + i == ' ';
+        info.* = .{
+            .atlas_x = (idx % per_row) * cell_w,
+            .atlas_y = (idx / per_row) * cell_h,
+            .width = if (is_space) 0 else cell_w,
+            .height = if (is_space) 0 else cell_h,
+            .bearing_x = 0,
+            .bearing_y = if (is_space) 0 else -font_size * 0.1,
+            .advance = font_size * 0.6,
+        };
+    }
+
+    const line_height = font_size * 1.4;
+    const ascent = font_size * 1.1;
+    return .{
+        .pixels = &.{},
+        .width = per_row * cell_w,
+        .height = rows * cell_h,
+        .glyph_info = glyph_info,
+        .line_height = line_height,
+        .ascent = ascent,
+        .reference_size = font_size,
+        .reference_line_height = line_height,
+        .reference_ascent = ascent,
+    };
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "synthetic atlas lookup and rescale" {
+    var atlas = synthetic(20);
+    try std.testing.expectEqual(@as(?GlyphInfo, null), atlas.getGlyphInfo('\n'));
+    try std.testing.expectEqual(@as(?GlyphInfo, null), atlas.getGlyphInfo(0x80));
+
+    const a = atlas.getGlyphInfo('a').?;
+    try std.testing.expectApproxEqAbs(@as(f32, 12), a.advance, 0.001);
+    try std.testing.expect(a.width > 0);
+    try std.testing.expectEqual(@as(u32, 0), atlas.getGlyphInfo(' ').?.width);
+
+    atlas.setDisplaySize(40);
+    try std.testing.expectApproxEqAbs(@as(f32, 24), atlas.getGlyphInfo('a').?.advance, 0.001);
+    try std.testing.expectApproxEqAbs(@as(f32, 56), atlas.line_height, 0.001);
+    // Bitmap size stays in texels
+    try std.testing.expectEqual(a.width, atlas.getGlyphInfo('a').?.width);
+}
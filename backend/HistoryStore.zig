@@ -0,0 +1,492 @@
+// HistoryStore.zig - Deduplicated per-note version history
+//
+// Portable (std only). Every saved version is cut into content-defined chunks
+// (FastCDC: a gear rolling hash with normalized chunking), so an edit only
+// changes the chunks around it. Chunks are stored once, keyed by a BLAKE3
+// digest, in an append-only pack file; a version is just the list of its chunk
+// numbers. Reading a version copies its chunks out of the memory-mapped pack.
+//
+// Files in the store directory (native endian, append-only):
+//   chunks.pack   chunk bytes back to back
+//   chunks.idx    [n]IndexRecord, record i describes chunk number i
+//   versions.log  VersionRecord followed by chunk_count u32 chunk numbers, repeated
+//
+// Appends go pack -> index -> log, so a torn write only leaves unreferenced
+// bytes behind; `open` drops incomplete trailing records.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+const Self = @This();
+
+const AVG_BITS = 12;
+pub const MIN_CHUNK = 1024;
+pub const AVG_CHUNK = 1 << AVG_BITS;
+pub const MAX_CHUNK = 32 * 1024;
+
+const PACK_FILE = "chunks.pack";
+const INDEX_FILE = "chunks.idx";
+const VERSIONS_FILE = "versions.log";
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const ChunkId = [16]u8;
+
+const IndexRecord = extern struct {
+    id: ChunkId,
+    offset: u64,
+    len: u32,
+    reserved: u32 = 0,
+};
+
+const VersionRecord = extern struct {
+    note_key: u64,
+    timestamp: i64,
+    size: u64,
+    chunk_count: u32,
+    reserved: u32 = 0,
+};
+
+const Chunk = struct {
+    offset: u64,
+    len: u32,
+};
+
+const Version = struct {
+    note_key: u64,
+    timestamp: i64,
+    size: u64,
+    /// Chunk numbers are refs[first_ref .. first_ref + chunk_count]
+    first_ref: usize,
+    chunk_count: u32,
+};
+
+pub const VersionInfo = struct {
+    id: u32,
+    timestamp: i64,
+    size: u64,
+};
+
+pub const SaveResult = struct {
+    id: u32,
+    /// Bytes appended to the store for this version
+    stored_bytes: u64,
+};
+
+// ============================================================================
+// Content-Defined Chunking
+// ============================================================================
+
+/// Random 64-bit value per byte (splitmix64), fixed so cut points are stable
+/// across runs and stores.
+const gear: [256]u64 = blk: {
+    var table: [256]u64 = undefined;
+    var state: u64 = 0x9E3779B97F4A7C15;
+    for (&table) |*entry| {
+        state +%= 0x9E3779B97F4A7C15;
+        var z = state;
+        z = (z ^ (z >> 30)) *% 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) *% 0x94D049BB133111EB;
+        entry.* = z ^ (z >> 31);
+    }
+    break :blk table;
+};
+
+/// Test the top bits: with `h << 1` each step they depend on the last 64
+/// bytes, the low bits only on the last few.
+fn topBits(comptime n: comptime_int) u64 {
+    return ~@as(u64, 0) << (64 - n);
+}
+
+/// Normalized chunking: harder to cut before the average size, easier after,
+/// which keeps chunk sizes close to AVG_CHUNK.
+const MASK_HARD = topBits(AVG_BITS + 2);
+const MASK_EASY = topBits(AVG_BITS - 2);
+
+/// Length of the first chunk of `data`.
+pub fn cutPoint(data: []const u8) usize {
+    if (data.len <= MIN_CHUNK) return data.len;
+    const limit = @min(data.len, MAX_CHUNK);
+    const normal = @min(limit, AVG_CHUNK);
+
+    var hash: u64 = 0;
+    var i: usize = MIN_CHUNK;
+    while (i < normal) : (i += 1) {
+        hash = (hash << 1) +% gear[data[i]];
+        if (hash & MASK_HARD == 0) return i + 1;
+    }
+    while (i < limit) : (i += 1) {
+        hash = (hash << 1) +% gear[data[i]];
+        if (hash & MASK_EASY == 0) return i + 1;
+    }
+    return limit;
+}
+
+pub fn chunkId(data: []const u8) ChunkId {
+    var id: ChunkId = undefined;
+    std.crypto.hash.Blake3.hash(data, &id, .{});
+    return id;
+}
+
+fn noteKey(note_path: []const u8) u64 {
+    return std.hash.Wyhash.hash(0, note_path);
+}
+
+// ============================================================================
+// Struct Fields
+// ============================================================================
+
+allocator: Allocator,
+dir: std.fs.Dir,
+pack_file: std.fs.File,
+index_file: std.fs.File,
+versions_file: std.fs.File,
+pack_size: u64,
+versions_size: u64,
+/// Read-only view of the pack, remapped when it has grown past the mapping
+mapped: ?[]align(std.heap.page_size_min) const u8 = null,
+chunks: std.ArrayList(Chunk) = .empty,
+by_id: std.AutoHashMapUnmanaged(ChunkId, u32) = .empty,
+versions: std.ArrayList(Version) = .empty,
+refs: std.ArrayList(u32) = .empty,
+
+/// Open the store in directory `path`, creating it if needed.
+pub fn open(allocator: Allocator, path: []const u8) !Self {
+    var dir = try std.fs.cwd().makeOpenPath(path, .{});
+    errdefer dir.close();
+    const pack_file = try dir.createFile(PACK_FILE, .{ .read = true, .truncate = false });
+    errdefer pack_file.close();
+    const index_file = try dir.createFile(INDEX_FILE, .{ .read = true, .truncate = false });
+    errdefer index_file.close();
+    const versions_file = try dir.createFile(VERSIONS_FILE, .{ .read = true, .truncate = false });
+    errdefer versions_file.close();
+
+    var self = Self{
+        .allocator = allocator,
+        .dir = dir,
+        .pack_file = pack_file,
+        .index_file = index_file,
+        .versions_file = versions_file,
+        .pack_size = (try pack_file.stat()).size,
+        .versions_size = 0,
+    };
+    errdefer self.freeTables();
+    try self.loadIndex();
+    try self.loadVersions();
+    return self;
+}
+
+pub fn close(self: *Self) void {
+    if (self.mapped) |mapped| std.posix.munmap(mapped);
+    self.freeTables();
+    self.pack_file.close();
+    self.index_file.close();
+    self.versions_file.close();
+    self.dir.close();
+}
+
+fn freeTables(self: *Self) void {
+    self.chunks.deinit(self.allocator);
+    self.by_id.deinit(self.allocator);
+    self.versions.deinit(self.allocator);
+    self.refs.deinit(self.allocator);
+}
+
+fn loadIndex(self: *Self) !void {
+    const bytes = try self.index_file.readToEndAlloc(self.allocator, std.math.maxInt(usize));
+    defer self.allocator.free(bytes);
+
+    const count = bytes.len / @sizeOf(IndexRecord);
+    try self.chunks.ensureTotalCapacity(self.allocator, count);
+    try self.by_id.ensureTotalCapacity(self.allocator, @intCast(count));
+    for (0..count) |i| {
+        var record: IndexRecord = undefined;
+        @memcpy(std.mem.asBytes(&record), bytes[i * @sizeOf(IndexRecord) ..][0..@sizeOf(IndexRecord)]);
+        // Torn append: the chunk bytes never made it into the pack
+        if (record.offset + record.len > self.pack_size) break;
+        self.by_id.putAssumeCapacity(record.id, @intCast(self.chunks.items.len));
+        self.chunks.appendAssumeCapacity(.{ .offset = record.offset, .len = record.len });
+    }
+    try self.index_file.setEndPos(self.chunks.items.len * @sizeOf(IndexRecord));
+}
+
+fn loadVersions(self: *Self) !void {
+    const bytes = try self.versions_file.readToEndAlloc(self.allocator, std.math.maxInt(usize));
+    defer self.allocator.free(bytes);
+
+    var pos: usize = 0;
+    while (pos + @sizeOf(VersionRecord) <= bytes.len) {
+        var record: VersionRecord = undefined;
+        @memcpy(std.mem.asBytes(&record), bytes[pos..][0..@sizeOf(VersionRecord)]);
+        const refs_start = pos + @sizeOf(VersionRecord);
+        const refs_end = refs_start + @as(usize, record.chunk_count) * @sizeOf(u32);
+        if (refs_end > bytes.len) break;
+
+        const first_ref = self.refs.items.len;
+        var valid = true;
+        try self.refs.ensureUnusedCapacity(self.allocator, record.chunk_count);
+        for (0..record.chunk_count) |i| {
+            const ref = std.mem.bytesToValue(u32, bytes[refs_start + i * 4 ..][0..4]);
+            if (ref >= self.chunks.items.len) valid = false;
+            self.refs.appendAssumeCapacity(ref);
+        }
+        if (!valid) {
+            self.refs.shrinkRetainingCapacity(first_ref);
+            break;
+        }
+
+        try self.versions.append(self.allocator, .{
+            .note_key = record.note_key,
+            .timestamp = record.timestamp,
+            .size = record.size,
+            .first_ref = first_ref,
+            .chunk_count = record.chunk_count,
+        });
+        pos = refs_end;
+    }
+    self.versions_size = pos;
+    try self.versions_file.setEndPos(pos);
+}
+
+// ============================================================================
+// Public Methods
+// ============================================================================
+
+/// Record `text` as the newest version of `note_path`. Only chunks the store
+/// has not seen before are written. Saving the same text as the note's latest
+/// version again returns that version without storing anything.
+pub fn saveVersion(self: *Self, note_path: []const u8, text: []const u8, timestamp: i64) !SaveResult {
+    const allocator = self.allocator;
+    const key = noteKey(note_path);
+
+    var version_refs = std.ArrayList(u32).empty;
+    defer version_refs.deinit(allocator);
+    var new_records = std.ArrayList(IndexRecord).empty;
+    defer new_records.deinit(allocator);
+    var new_bytes = std.ArrayList(u8).empty;
+    defer new_bytes.deinit(allocator);
+
+    const chunks_before = self.chunks.items.len;
+    errdefer {
+        for (new_records.items) |record| _ = self.by_id.remove(record.id);
+        self.chunks.shrinkRetainingCapacity(chunks_before);
+    }
+
+    var pos: usize = 0;
+    while (pos < text.len) {
+        const piece = text[pos .. pos + cutPoint(text[pos..])];
+        pos += piece.len;
+
+        const id = chunkId(piece);
+        const gop = try self.by_id.getOrPut(allocator, id);
+        if (!gop.found_existing) {
+            const chunk = Chunk{ .offset = self.pack_size + new_bytes.items.len, .len = @intCast(piece.len) };
+            gop.value_ptr.* = @intCast(self.chunks.items.len);
+            self.chunks.append(allocator, chunk) catch |err| {
+                _ = self.by_id.remove(id);
+                return err;
+            };
+            try new_records.append(allocator, .{ .id = id, .offset = chunk.offset, .len = chunk.len });
+            try new_bytes.appendSlice(allocator, piece);
+        }
+        try version_refs.append(allocator, gop.value_ptr.*);
+    }
+
+    if (self.latestVersion(key)) |latest| {
+        const v = self.versions.items[latest];
+        if (std.mem.eql(u32, self.refs.items[v.first_ref..][0..v.chunk_count], version_refs.items)) {
+            return .{ .id = latest, .stored_bytes = 0 };
+        }
+    }
+
+    const record = VersionRecord{
+        .note_key = key,
+        .timestamp = timestamp,
+        .size = text.len,
+        .chunk_count = @intCast(version_refs.items.len),
+    };
+    const refs_bytes = std.mem.sliceAsBytes(version_refs.items);
+    const index_bytes = std.mem.sliceAsBytes(new_records.items);
+
+    try self.pack_file.pwriteAll(new_bytes.items, self.pack_size);
+    try self.index_file.pwriteAll(index_bytes, chunks_before * @sizeOf(IndexRecord));
+    try self.versions_file.pwriteAll(std.mem.asBytes(&record), self.versions_size);
+    try self.versions_file.pwriteAll(refs_bytes, self.versions_size + @sizeOf(VersionRecord));
+
+    const first_ref = self.refs.items.len;
+    try self.refs.appendSlice(allocator, version_refs.items);
+    errdefer self.refs.shrinkRetainingCapacity(first_ref);
+    try self.versions.append(allocator, .{
+        .note_key = key,
+        .timestamp = timestamp,
+        .size = text.len,
+        .first_ref = first_ref,
+        .chunk_count = record.chunk_count,
+    });
+
+    self.pack_size += new_bytes.items.len;
+    self.versions_size += @sizeOf(VersionRecord) + refs_bytes.len;
+    return .{
+        .id = @intCast(self.versions.items.len - 1),
+        .stored_bytes = new_bytes.items.len + index_bytes.len + @sizeOf(VersionRecord) + refs_bytes.len,
+    };
+}
+
+fn latestVersion(self: *const Self, key: u64) ?u32 {
+    var i = self.versions.items.len;
+    while (i > 0) {
+        i -= 1;
+        if (self.versions.items[i].note_key == key) return @intCast(i);
+    }
+    return null;
+}
+
+/// Versions of `note_path`, newest first. Caller frees.
+pub fn versionsOf(self: *const Self, allocator: Allocator, note_path: []const u8) ![]VersionInfo {
+    const key = noteKey(note_path);
+    var out = std.ArrayList(VersionInfo).empty;
+    errdefer out.deinit(allocator);
+
+    var i = self.versions.items.len;
+    while (i > 0) {
+        i -= 1;
+        const v = self.versions.items[i];
+        if (v.note_key != key) continue;
+        try out.append(allocator, .{ .id = @intCast(i), .timestamp = v.timestamp, .size = v.size });
+    }
+    return out.toOwnedSlice(allocator);
+}
+
+/// Size in bytes of version `id`, or null if there is no such version.
+pub fn versionSize(self: *const Self, id: u32) ?u64 {
+    if (id >= self.versions.items.len) return null;
+    return self.versions.items[id].size;
+}
+
+/// Reassemble version `id` into `out`, which must be `versionSize(id)` bytes.
+pub fn readVersionInto(self: *Self, id: u32, out: []u8) !void {
+    if (id >= self.versions.items.len) return error.NoSuchVersion;
+    const v = self.versions.items[id];
+    std.debug.assert(out.len == v.size);
+    const pack = try self.mappedPack();
+
+    var written: usize = 0;
+    for (self.refs.items[v.first_ref..][0..v.chunk_count]) |ref| {
+        const chunk = self.chunks.items[ref];
+        @memcpy(out[written .. written + chunk.len], pack[chunk.offset..][0..chunk.len]);
+        written += chunk.len;
+    }
+}
+
+/// Reassemble version `id`. Caller frees.
+pub fn readVersion(self: *Self, allocator: Allocator, id: u32) ![]u8 {
+    const size = self.versionSize(id) orelse return error.NoSuchVersion;
+    const out = try allocator.alloc(u8, size);
+    errdefer allocator.free(out);
+    try self.readVersionInto(id, out);
+    return out;
+}
+
+fn mappedPack(self: *Self) ![]const u8 {
+    if (self.pack_size == 0) return &.{};
+    if (self.mapped) |mapped| {
+        if (mapped.len >= self.pack_size) return mapped;
+        std.posix.munmap(mapped);
+        self.mapped = null;
+    }
+    const mapped = try std.posix.mmap(
+        null,
+        @intCast(self.pack_size),
+        std.posix.PROT.READ,
+        .{ .TYPE = .SHARED },
+        self.pack_file.handle,
+        0,
+    );
+    self.mapped = mapped;
+    return mapped;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+fn testNote(allocator: Allocator, size: usize) ![]u8 {
+    const words = [_][]const u8{ "alpha ", "beta ", "gamma ", "delta\n", "epsilon ", "zeta ", "eta ", "theta\n\n" };
+    var prng = std.Random.DefaultPrng.init(1);
+    const random = prng.random();
+    var text = std.ArrayList(u8).empty;
+    while (text.items.len < size) {
+        try text.appendSlice(allocator, words[random.uintLessThan(usize, words.len)]);
+    }
+    return text.toOwnedSlice(allocator);
+}
+
+test "chunk boundaries resynchronize after an insertion" {
+    const allocator = std.testing.allocator;
+    const text = try testNote(allocator, 64 * 1024);
+    defer allocator.free(text);
+    const edited = try std.mem.concat(allocator, u8, &.{ text[0..20_000], "inserted text", text[20_000..] });
+    defer allocator.free(edited);
+
+    var ids = std.AutoHashMapUnmanaged(ChunkId, void).empty;
+    defer ids.deinit(allocator);
+    var pos: usize = 0;
+    while (pos < text.len) {
+        const n = cutPoint(text[pos..]);
+        try std.testing.expect(n >= @min(MIN_CHUNK, text.len - pos) and n <= MAX_CHUNK);
+        try ids.put(allocator, chunkId(text[pos..][0..n]), {});
+        pos += n;
+    }
+
+    var total: usize = 0;
+    var shared: usize = 0;
+    pos = 0;
+    while (pos < edited.len) {
+        const n = cutPoint(edited[pos..]);
+        total += 1;
+        if (ids.contains(chunkId(edited[pos..][0..n]))) shared += 1;
+        pos += n;
+    }
+    try std.testing.expect(total >= 8);
+    try std.testing.expect(total - shared <= 2);
+}
+
+test "versions round trip, dedupe and survive reopening" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(path);
+
+    const v1 = try testNote(allocator, 48 * 1024);
+    defer allocator.free(v1);
+    const v2 = try std.mem.concat(allocator, u8, &.{ v1[0..30_000], "a small edit", v1[30_100..] });
+    defer allocator.free(v2);
+
+    {
+        var store = try Self.open(allocator, path);
+        defer store.close();
+        const first = try store.saveVersion("notes/a.md", v1, 100);
+        try std.testing.expect(first.stored_bytes > v1.len);
+        const second = try store.saveVersion("notes/a.md", v2, 200);
+        try std.testing.expect(second.stored_bytes < 2 * MAX_CHUNK);
+        try std.testing.expectEqual(@as(u64, 0), (try store.saveVersion("notes/a.md", v2, 300)).stored_bytes);
+        _ = try store.saveVersion("notes/b.md", "other note", 250);
+    }
+
+    var store = try Self.open(allocator, path);
+    defer store.close();
+    const versions = try store.versionsOf(allocator, "notes/a.md");
+    defer allocator.free(versions);
+    try std.testing.expectEqual(@as(usize, 2), versions.len);
+    try std.testing.expectEqual(@as(i64, 200), versions[0].timestamp);
+
+    const old = try store.readVersion(allocator, versions[1].id);
+    defer allocator.free(old);
+    try std.testing.expectEqualSlices(u8, v1, old);
+    const new = try store.readVersion(allocator, versions[0].id);
+    defer allocator.free(new);
+    try std.testing.expectEqualSlices(u8, v2, new);
+}
@@ -0,0 +1,280 @@
+// ImageProbe.zig - Image dimensions from file headers, without decoding
+//
+// Portable (std only). PNG, GIF and WebP store their size in the first 30
+// bytes; JPEG stores it in the first SOF segment, which is found by hopping
+// from one segment header to the next (a few small reads even past a large
+// EXIF block). `Service` probes files on a thread pool and caches the result
+// by path and mtime, so layout can reserve an image's space before it loads.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+/// Enough for the PNG, GIF and WebP headers and the JPEG start marker
+const HEADER_LEN = 32;
+/// Give up on JPEGs whose SOF is not within this many segments
+const MAX_JPEG_SEGMENTS = 64;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const Format = enum {
+    png,
+    jpeg,
+    gif,
+    webp,
+};
+
+pub const Info = struct {
+    format: Format,
+    width: u32,
+    height: u32,
+};
+
+// ============================================================================
+// Header Parsing
+// ============================================================================
+
+/// Dimensions from the first HEADER_LEN bytes of a PNG, GIF or WebP file.
+/// JPEGs are only recognised (width and height 0): see `probeFile`.
+pub fn probeHeader(header: []const u8) ?Info {
+    if (header.len >= 24 and std.mem.eql(u8, header[0..8], "\x89PNG\r\n\x1a\n") and std.mem.eql(u8, header[12..16], "IHDR")) {
+        return .{
+            .format = .png,
+            .width = std.mem.readInt(u32, header[16..20], .big),
+            .height = std.mem.readInt(u32, header[20..24], .big),
+        };
+    }
+    if (header.len >= 10 and (std.mem.eql(u8, header[0..6], "GIF87a") or std.mem.eql(u8, header[0..6], "GIF89a"))) {
+        return .{
+            .format = .gif,
+            .width = std.mem.readInt(u16, header[6..8], .little),
+            .height = std.mem.readInt(u16, header[8..10], .little),
+        };
+    }
+    if (header.len >= 30 and std.mem.eql(u8, header[0..4], "RIFF") and std.mem.eql(u8, header[8..12], "WEBP")) {
+        return probeWebp(header);
+    }
+    if (header.len >= 3 and header[0] == 0xFF and header[1] == 0xD8 and header[2] == 0xFF) {
+        return .{ .format = .jpeg, .width = 0, .height = 0 };
+    }
+    return null;
+}
+
+fn probeWebp(header: []const u8) ?Info {
+    const chunk = header[12..16];
+    if (std.mem.eql(u8, chunk, "VP8 ")) {
+        // Lossy: 14-bit sizes after the key frame start code
+        return .{
+            .format = .webp,
+            .width = std.mem.readInt(u16, header[26..28], .little) & 0x3FFF,
+            .height = std.mem.readInt(u16, header[28..30], .little) & 0x3FFF,
+        };
+    }
+    if (std.mem.eql(u8, chunk, "VP8L")) {
+        // Lossless: two 14-bit (size - 1) fields packed after the 0x2F signature
+        const bits = std.mem.readInt(u32, header[21..25], .little);
+        return .{
+            .format = .webp,
+            .width = (bits & 0x3FFF) + 1,
+            .height = ((bits >> 14) & 0x3FFF) + 1,
+        };
+    }
+    if (std.mem.eql(u8, chunk, "VP8X")) {
+        // Extended: 24-bit (size - 1) canvas fields
+        return .{
+            .format = .webp,
+            .width = std.mem.readInt(u24, header[24..27], .little) + 1,
+            .height = std.mem.readInt(u24, header[27..30], .little) + 1,
+        };
+    }
+    return null;
+}
+
+fn isStartOfFrame(marker: u8) bool {
+    return marker >= 0xC0 and marker <= 0xCF and marker != 0xC4 and marker != 0xC8 and marker != 0xCC;
+}
+
+/// Walk JPEG segment headers from just after the SOI marker to the first SOF.
+fn probeJpeg(file: std.fs.File) !?Info {
+    var offset: u64 = 2;
+    var buf: [9]u8 = undefined;
+    for (0..MAX_JPEG_SEGMENTS) |_| {
+        if (try file.preadAll(&buf, offset) < buf.len) return null;
+        if (buf[0] != 0xFF) return null;
+        // Fill bytes: any number of 0xFF before the marker
+        if (buf[1] == 0xFF) {
+            offset += 1;
+            continue;
+        }
+        const marker = buf[1];
+        if (isStartOfFrame(marker)) {
+            return .{
+                .format = .jpeg,
+                .width = std.mem.readInt(u16, buf[7..9], .big),
+                .height = std.mem.readInt(u16, buf[5..7], .big),
+            };
+        }
+        // Standalone markers carry no length
+        if (marker == 0x01 or (marker >= 0xD0 and marker <= 0xD7)) {
+            offset += 2;
+            continue;
+        }
+        if (marker == 0xD9 or marker == 0xDA) return null; // end of image / scan data
+        offset += 2 + std.mem.readInt(u16, buf[2..4], .big);
+    }
+    return null;
+}
+
+/// Dimensions of the image at `path`, or null if it is not a supported format.
+pub fn probeFile(path: []const u8) !?Info {
+    const file = try std.fs.cwd().openFile(path, .{});
+    defer file.close();
+
+    var header: [HEADER_LEN]u8 = undefined;
+    const n = try file.preadAll(&header, 0);
+    const info = probeHeader(header[0..n]) orelse return null;
+    if (info.format == .jpeg) return probeJpeg(file);
+    return info;
+}
+
+// ============================================================================
+// Probe Service
+// ============================================================================
+
+pub const Service = struct {
+    allocator: Allocator,
+    pool: std.Thread.Pool,
+    wait_group: std.Thread.WaitGroup = .{},
+    mutex: std.Thread.Mutex = .{},
+    /// Guarded by `mutex`
+    entries: std.StringHashMapUnmanaged(Entry) = .empty,
+    /// Probes queued and not yet finished; guarded by `mutex`
+    in_flight: usize = 0,
+
+    const Entry = struct {
+        mtime: i128,
+        state: union(enum) {
+            pending,
+            done: ?Info,
+        },
+    };
+
+    /// `allocator` must be thread safe; the pool's workers use it.
+    pub fn create(allocator: Allocator) !*Service {
+        const self = try allocator.create(Service);
+        errdefer allocator.destroy(self);
+        self.* = .{ .allocator = allocator, .pool = undefined };
+        try self.pool.init(.{ .allocator = allocator });
+        return self;
+    }
+
+    pub fn destroy(self: *Service) void {
+        self.waitIdle();
+        self.pool.deinit();
+        var it = self.entries.keyIterator();
+        while (it.next()) |key| self.allocator.free(key.*);
+        self.entries.deinit(self.allocator);
+        self.allocator.destroy(self);
+    }
+
+    /// Cached dimensions of the image at `path` if they are known for the
+    /// file's current mtime. Otherwise a probe is queued (once) and null is
+    /// returned; call again after it finishes. Unsupported or unreadable
+    /// files also return null.
+    pub fn request(self: *Service, path: []const u8) !?Info {
+        const stat = std.fs.cwd().statFile(path) catch return null;
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        const gop = try self.entries.getOrPut(self.allocator, path);
+        if (gop.found_existing) {
+            if (gop.value_ptr.mtime == stat.mtime) {
+                return switch (gop.value_ptr.state) {
+                    .pending => null,
+                    .done => |info| info,
+                };
+            }
+        } else {
+            gop.key_ptr.* = self.allocator.dupe(u8, path) catch |err| {
+                self.entries.removeByPtr(gop.key_ptr);
+                return err;
+            };
+        }
+        gop.value_ptr.* = .{ .mtime = stat.mtime, .state = .pending };
+        self.in_flight += 1;
+        self.pool.spawnWg(&self.wait_group, probeTask, .{ self, gop.key_ptr.*, stat.mtime });
+        return null;
+    }
+
+    /// Whether no probe is queued or running
+    pub fn isIdle(self: *Service) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.in_flight == 0;
+    }
+
+    /// Block until every queued probe has finished.
+    pub fn waitIdle(self: *Service) void {
+        self.pool.waitAndWork(&self.wait_group);
+        self.wait_group.reset();
+    }
+
+    /// `path` is the entry's key, which lives as long as the service.
+    fn probeTask(self: *Service, path: []const u8, mtime: i128) void {
+        const info = probeFile(path) catch null;
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        self.in_flight -= 1;
+        const entry = self.entries.getPtr(path) orelse return;
+        // A newer version of the file was queued meanwhile; that probe wins
+        if (entry.mtime != mtime) return;
+        entry.state = .{ .done = info };
+    }
+};
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "header parsing for each format" {
+    const png = "\x89PNG\r\n\x1a\n\x00\x00\x00\x0dIHDR\x00\x00\x02\x80\x00\x00\x01\xe0";
+    try std.testing.expectEqual(Info{ .format = .png, .width = 640, .height = 480 }, probeHeader(png).?);
+
+    const gif = "GIF89a\x20\x03\x58\x02";
+    try std.testing.expectEqual(Info{ .format = .gif, .width = 800, .height = 600 }, probeHeader(gif).?);
+
+    const webp_lossy = "RIFF\x00\x00\x00\x00WEBPVP8 \x00\x00\x00\x00\x00\x00\x00\x9d\x01\x2a\x40\x01\xf0\x00";
+    try std.testing.expectEqual(Info{ .format = .webp, .width = 320, .height = 240 }, probeHeader(webp_lossy).?);
+
+    const webp_ext = "RIFFxxxxWEBPVP8X\x0a\x00\x00\x00\x10\x00\x00\x00\xff\x03\x00\xff\x02\x00";
+    try std.testing.expectEqual(Info{ .format = .webp, .width = 1024, .height = 768 }, probeHeader(webp_ext).?);
+
+    try std.testing.expectEqual(@as(?Info, null), probeHeader("not an image at all, just text.."));
+}
+
+test "service probes files in the background and caches by mtime" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const allocator = std.testing.allocator;
+    const dir = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir);
+
+    // SOI, an APP0 segment to skip, then SOF0 with 100x50
+    const jpeg = "\xff\xd8\xff\xe0\x00\x04ab\xff\xc0\x00\x11\x08\x00\x32\x00\x64\x03";
+    try tmp.dir.writeFile(.{ .sub_path = "photo.jpg", .data = jpeg });
+    const path = try std.fs.path.join(allocator, &.{ dir, "photo.jpg" });
+    defer allocator.free(path);
+
+    const service = try Service.create(allocator);
+    defer service.destroy();
+
+    try std.testing.expectEqual(@as(?Info, null), try service.request(path));
+    service.waitIdle();
+    try std.testing.expectEqual(Info{ .format = .jpeg, .width = 100, .height = 50 }, (try service.request(path)).?);
+
+    const missing = try std.fs.path.join(allocator, &.{ dir, "missing.png" });
+    defer allocator.free(missing);
+    try std.testing.expectEqual(@as(?Info, null), try service.request(missing));
+}
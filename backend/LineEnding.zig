@@ -0,0 +1,142 @@
+// LineEnding.zig - LF and CRLF line breaks over an unmodified buffer
+//
+// Portable (std only). Notes written on Windows end lines with "\r\n". The
+// buffer keeps whatever the file had, so saving writes the endings back
+// untouched; instead, the code that walks lines treats a '\r' right before a
+// '\n' as part of the break: the parser strips it from lines, layout gives it
+// no width, and the cursor never stops between the two bytes (nor inside a
+// UTF-8 sequence). New line breaks are typed in the note's own style,
+// detected once on open.
+
+const std = @import("std");
+
+/// Bytes examined per @Vector step
+const LANES = 16;
+
+pub const Style = enum(u8) {
+    lf = 0,
+    crlf = 1,
+
+    /// What pressing Return inserts
+    pub fn newline(self: Style) []const u8 {
+        return switch (self) {
+            .lf => "\n",
+            .crlf => "\r\n",
+        };
+    }
+};
+
+/// The style of the first line break; LF if there is none
+pub fn detect(text: []const u8) Style {
+    const newline_index = firstNewline(text) orelse return .lf;
+    return if (newline_index > 0 and text[newline_index - 1] == '\r') .crlf else .lf;
+}
+
+fn firstNewline(text: []const u8) ?usize {
+    const newlines: @Vector(LANES, u8) = @splat('\n');
+    var i: usize = 0;
+    while (i + LANES <= text.len) : (i += LANES) {
+        const chunk: @Vector(LANES, u8) = text[i..][0..LANES].*;
+        if (@reduce(.Or, chunk == newlines)) break;
+    }
+    return std.mem.indexOfScalarPos(u8, text, i, '\n');
+}
+
+/// True for the '\r' of a "\r\n" pair, which belongs to the line break
+pub fn isBreakCr(text: []const u8, i: usize) bool {
+    return text[i] == '\r' and i + 1 < text.len and text[i + 1] == '\n';
+}
+
+/// `line` (up to but excluding its '\n') without a trailing '\r'
+pub fn trimCr(line: []const u8) []const u8 {
+    return if (line.len > 0 and line[line.len - 1] == '\r') line[0 .. line.len - 1] else line;
+}
+
+/// Length of the line break starting at `i`: 2 for "\r\n", 1 for '\n', else 0
+pub fn breakLen(text: []const u8, i: usize) usize {
+    if (i >= text.len) return 0;
+    if (text[i] == '\n') return 1;
+    return if (isBreakCr(text, i)) 2 else 0;
+}
+
+/// `text` with every line break ("\n" or "\r\n") written in `style`.
+/// Caller frees.
+pub fn convert(allocator: std.mem.Allocator, text: []const u8, style: Style) ![]u8 {
+    var out = try std.ArrayList(u8).initCapacity(allocator, text.len);
+    errdefer out.deinit(allocator);
+    var i: usize = 0;
+    while (i < text.len) {
+        const break_len = breakLen(text, i);
+        if (break_len > 0) {
+            try out.appendSlice(allocator, style.newline());
+            i += break_len;
+        } else {
+            try out.append(allocator, text[i]);
+            i += 1;
+        }
+    }
+    return out.toOwnedSlice(allocator);
+}
+
+/// `offset` moved off the middle of a "\r\n" pair, to the start of the pair
+pub fn snap(text: []const u8, offset: usize) usize {
+    return if (offset > 0 and offset < text.len and isBreakCr(text, offset - 1)) offset - 1 else offset;
+}
+
+/// Offset one step before `offset`, stepping over "\r\n" and a whole UTF-8
+/// sequence as one
+pub fn stepBack(text: []const u8, offset: usize) usize {
+    if (offset == 0) return 0;
+    if (offset >= 2 and text[offset - 1] == '\n' and text[offset - 2] == '\r') return offset - 2;
+    // Back over up to three continuation bytes (0b10xxxxxx) to the lead byte
+    var i = offset - 1;
+    while (i > 0 and offset - i < 4 and text[i] & 0xC0 == 0x80) i -= 1;
+    return i;
+}
+
+/// Offset one step after `offset`, stepping over "\r\n" and a whole UTF-8
+/// sequence as one
+pub fn stepForward(text: []const u8, offset: usize) usize {
+    if (offset >= text.len) return text.len;
+    const break_len = breakLen(text, offset);
+    if (break_len > 0) return offset + break_len;
+    const seq_len = std.unicode.utf8ByteSequenceLength(text[offset]) catch 1;
+    return @min(offset + seq_len, text.len);
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "style comes from the first line break" {
+    try std.testing.expectEqual(Style.lf, detect("no breaks at all"));
+    try std.testing.expectEqual(Style.crlf, detect("a line long enough to need a vector step\r\nnext\n"));
+    try std.testing.expectEqual(Style.lf, detect("first\nsecond\r\n"));
+    try std.testing.expectEqual(Style.lf, detect("\n"));
+}
+
+test "stepping treats CRLF as one break" {
+    const text = "ab\r\ncd\n";
+    try std.testing.expectEqual(@as(usize, 2), stepBack(text, 4));
+    try std.testing.expectEqual(@as(usize, 4), stepForward(text, 2));
+    try std.testing.expectEqual(@as(usize, 6), stepBack(text, 7));
+    try std.testing.expectEqual(@as(usize, 2), snap(text, 3));
+    try std.testing.expectEqual(@as(usize, 4), snap(text, 4));
+    try std.testing.expectEqualStrings("ab", trimCr(text[0..3]));
+    try std.testing.expectEqual(@as(usize, 2), breakLen(text, 2));
+    try std.testing.expectEqual(@as(usize, 0), breakLen(text, 4));
+}
+
+test "stepping moves over whole UTF-8 characters" {
+    const text = "a\u{E9}\u{20AC}\u{1F600}b";
+    try std.testing.expectEqual(@as(usize, 1), stepForward(text, 0));
+    try std.testing.expectEqual(@as(usize, 3), stepForward(text, 1));
+    try std.testing.expectEqual(@as(usize, 6), stepForward(text, 3));
+    try std.testing.expectEqual(@as(usize, 10), stepForward(text, 6));
+    try std.testing.expectEqual(@as(usize, 6), stepBack(text, 10));
+    try std.testing.expectEqual(@as(usize, 3), stepBack(text, 6));
+    try std.testing.expectEqual(@as(usize, 1), stepBack(text, 3));
+    // A stray continuation byte or a cut sequence is one step, not a hang
+    try std.testing.expectEqual(@as(usize, 1), stepForward("\x80a", 0));
+    try std.testing.expectEqual(@as(usize, 2), stepForward("a\xE2", 1));
+}
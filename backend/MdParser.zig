@@ -1,6 +1,9 @@
 const std = @import("std");
 const Allocator = std.mem.Allocator;
 
+const Frontmatter = @import("Frontmatter.zig");
+const LineEnding = @import("LineEnding.zig");
+
 const RawToken = union(enum) {
     star: void,
     underscore: void,
@@ -27,6 +30,9 @@ pub const BlockTypeTag = enum(c_int) {
     StrongEmph = 12,
     Link = 13,
     Image = 14,
+    Embed = 15,
+    // block types added later
+    Frontmatter = 16,
 };
 
 pub const BlockType = union(BlockTypeTag) {
@@ -47,6 +53,12 @@ pub const BlockType = union(BlockTypeTag) {
     StrongEmph: void,
     Link: []const u8,
     Image: []const u8,
+    /// `![[target]]` transclusion; children are the embedded note's blocks
+    /// once resolved (see Transclusion.zig), shared with the cache
+    Embed: []const u8,
+    /// Leading `---` YAML block; content spans both delimiter lines. Parse
+    /// its fields with Frontmatter.zig when they are needed.
+    Frontmatter: void,
 
     pub fn format(
         self: @This(),
@@ -71,15 +83,68 @@ pub const BlockType = union(BlockTypeTag) {
         };
     }
 
-    /// Get the string value for Link/Image URL
+    /// Get the string value for Link/Image URL or Embed target
     pub fn getStr(self: @This()) ?[]const u8 {
         return switch (self) {
-            .Link, .Image => |url| url,
+            .Link, .Image, .Embed => |url| url,
             else => null,
         };
     }
 };
 
+/// Syntax extensions beyond the CommonMark core. A parser is instantiated per
+/// feature set at comptime, so a disabled extension compiles out of the
+/// scanning loops entirely.
+pub const Features = struct {
+    /// Leading `---` YAML block (see Frontmatter.zig)
+    frontmatter: bool = false,
+    /// `![[Note]]` transclusions (see Transclusion.zig)
+    embeds: bool = false,
+
+    /// Headings, paragraphs, lists, block quotes, code, emphasis, links, images
+    pub const core = Features{};
+    /// What notes in a vault use; the editor parses with this
+    pub const vault = Features{ .frontmatter = true, .embeds = true };
+};
+
+pub fn Parser(comptime features: Features) type {
+    return struct {
+        pub fn parseBlocks(allocator: Allocator, text: []const u8) !*Block {
+            return parseBlocksWith(features, allocator, text, null);
+        }
+
+        /// `parseBlocks`, also recording what `reparseBlocks` needs
+        pub fn parseBlocksIndexed(allocator: Allocator, text: []const u8, index: *ParseIndex) !*Block {
+            return parseBlocksWith(features, allocator, text, index);
+        }
+
+        pub fn reparseBlocks(allocator: Allocator, text: []const u8, index: *const ParseIndex, edit: Edit) !?Region {
+            return reparseBlocksWith(features, allocator, text, index, edit);
+        }
+
+        pub fn parseInline(allocator: Allocator, root: *Block) !void {
+            return parseInlineWith(features, allocator, root);
+        }
+
+        /// Parse a paragraph or heading's inline children again after bytes
+        /// of its source lines in `text` were overwritten in place
+        pub fn reparseInline(allocator: Allocator, text: []const u8, leaf: *Block) !void {
+            leaf.content = inlineSource(text, leaf) orelse return;
+            leaf.children.clearRetainingCapacity();
+            return parseInlineWith(features, allocator, leaf);
+        }
+    };
+}
+
+pub const Core = Parser(Features.core);
+pub const Vault = Parser(Features.vault);
+
+pub const parseBlocks = Vault.parseBlocks;
+pub const parseBlocksIndexed = Vault.parseBlocksIndexed;
+pub const reparseBlocks = Vault.reparseBlocks;
+pub const parseInline = Vault.parseInline;
+pub const reparseInline = Vault.reparseInline;
+
 fn getFirstWord(block_stack: *std.ArrayList(*Block), line: []const u8) struct { []const u8, usize, usize } {
     var words = std.mem.tokenizeAny(u8, line, " ");
 
@@ -132,13 +197,14 @@ pub const Block = struct {
             .Paragraph => true,
             .Heading => false,
             .CodeBlock => true, // handled in handleBlockType
+            .Frontmatter => false,
             // Lists can continue if: nested content (more indented) OR same-level list item
             .UnorderedList => |depth| depth < first_word_depth or (depth == first_word_depth and std.mem.eql(u8, first_word, "-")),
             .OrderedList => |depth| depth < first_word_depth or (depth == first_word_depth and isOrderedNumber(first_word)),
             // List items can continue if content is more indented (nested)
             .OrderedListItem => |depth| depth < first_word_depth,
             .UnorderedListItem => |depth| depth < first_word_depth,
-            .RawStr, .Strong, .Emphasis, .Link, .StrongEmph, .Image => unreachable, // inline
+            .RawStr, .Strong, .Emphasis, .Link, .StrongEmph, .Image, .Embed => unreachable, // inline
         };
     }
 
@@ -160,7 +226,7 @@ fn determineBlockType(block_stack: *std.ArrayList(*Block), line: []const u8) ?Bl
 
     if (std.mem.eql(u8, first_word, ">")) {
         return BlockType{ .BlockQuote = block_quote_depth + 1 };
-    } else if (std.mem.eql(u8, first_word, "```")) {
+    } else if (std.mem.startsWith(u8, first_word, "```")) {
         return BlockType.CodeBlock;
     }
 
@@ -276,6 +342,10 @@ pub fn handleBlockType(allocator: Allocator, block_stack: *std.ArrayList(*Block)
         },
         .CodeBlock => {
             if (block_stack.items.len >= 1 and block_stack.items[block_stack.items.len - 1].blockType == .CodeBlock) {
+                // Only a bare fence closes; "```zig" inside a block is code
+                const first_word, _, _ = getFirstWord(block_stack, line);
+                if (!std.mem.eql(u8, first_word, "```")) return handleBlockType(allocator, block_stack, .Paragraph, line, text);
+
                 // const b = block_stack.pop() orelse unreachable;
                 // b.is_open = false;
 
@@ -286,50 +356,481 @@ pub fn handleBlockType(allocator: Allocator, block_stack: *std.ArrayList(*Block)
                 _ = try addToStack(allocator, block_stack, block_type);
             }
         },
-        .Document => {},
-        .RawStr, .Strong, .Emphasis, .Link, .StrongEmph, .Image => unreachable, // inline
+        .Document, .Frontmatter => {},
+        .RawStr, .Strong, .Emphasis, .Link, .StrongEmph, .Image, .Embed => unreachable, // inline
     }
 }
 
-pub fn parseBlocks(allocator: Allocator, text: []const u8) !*Block {
-    var lines = std.mem.tokenizeAny(u8, text, "\n");
-
+fn parseBlocksWith(comptime features: Features, allocator: Allocator, text: []const u8, index: ?*ParseIndex) !*Block {
     const document_block = try allocator.create(Block);
     document_block.* = Block{ .blockType = .Document, .children = std.ArrayList(*Block).empty, .content = null };
 
-    var block_stack = std.ArrayList(*Block).empty;
-    try block_stack.append(allocator, document_block);
+    // Only the span is recorded here; the YAML is parsed on demand
+    var body_start: usize = 0;
+    if (features.frontmatter) {
+        if (Frontmatter.extract(text)) |frontmatter| {
+            const frontmatter_block = try allocator.create(Block);
+            const content = std.mem.trimRight(u8, text[0..frontmatter.end], "\r\n");
+            frontmatter_block.* = Block{ .blockType = .Frontmatter, .children = std.ArrayList(*Block).empty, .content = content, .is_open = false };
+            try document_block.children.append(allocator, frontmatter_block);
+            body_start = frontmatter.end;
+        }
+    }
+
+    var recorder = IndexRecorder{ .base = 0 };
+    var line_parser = LineParser{
+        .allocator = allocator,
+        .text = text,
+        .document = document_block,
+        .recorder = if (index != null) &recorder else null,
+    };
+    try line_parser.block_stack.append(allocator, document_block);
+
+    var lines = std.mem.tokenizeAny(u8, text[body_start..], "\n");
+    while (lines.next()) |raw_line| try line_parser.feed(raw_line);
+    line_parser.finish();
+
+    if (index) |out| out.* = try recorder.finish(allocator, text, body_start);
+    return document_block;
+}
+
+/// Block parsing state carried from line to line
+const LineParser = struct {
+    allocator: Allocator,
+    text: []const u8,
+    document: *Block,
+    block_stack: std.ArrayList(*Block) = .empty,
+    recorder: ?*IndexRecorder = null,
+
+    fn feed(self: *LineParser, raw_line: []const u8) !void {
+        // "\r\n" is one break; a CRLF blank line is skipped like an LF one
+        const line = LineEnding.trimCr(raw_line);
+        if (line.len == 0) return;
+        const line_start = @intFromPtr(line.ptr) - @intFromPtr(self.text.ptr);
+        if (self.recorder) |recorder| {
+            if (self.isQuiet()) try recorder.resumeAt(self.allocator, line_start, self.document.children.items.len);
+        }
+        const fences_before = self.openFences();
 
-    while (lines.next()) |line| {
         var i: usize = 0;
 
         // reset the stack
-        for (block_stack.items) |b| {
-            if (!b.can_continue(&block_stack, line)) {
+        for (self.block_stack.items) |b| {
+            if (!b.can_continue(&self.block_stack, line)) {
                 break;
             }
             i += 1;
         }
 
-        while (i < block_stack.items.len) {
-            const b = block_stack.pop() orelse unreachable;
+        while (i < self.block_stack.items.len) {
+            const b = self.block_stack.pop() orelse unreachable;
             b.is_open = false;
         }
 
-        const block_type = determineBlockType(&block_stack, line) orelse {
-            block_stack.items[block_stack.items.len - 1].is_open = false; //TODO: this line feels a bit sus, can I do this if its not paragraph?
-            continue;
+        if (determineBlockType(&self.block_stack, line)) |block_type| {
+            try handleBlockType(self.allocator, &self.block_stack, block_type, line, self.text);
+        } else {
+            self.block_stack.items[self.block_stack.items.len - 1].is_open = false; //TODO: this line feels a bit sus, can I do this if its not paragraph?
+        }
+
+        if (self.recorder) |recorder| {
+            const fences_after = self.openFences();
+            // A fence line opens one block; a line that ends an enclosing
+            // block can end several
+            if (fences_after > fences_before) try recorder.openFence(self.allocator, line_start);
+            for (fences_after..fences_before) |_| recorder.closeFence(line_start);
+        }
+    }
+
+    fn finish(self: *LineParser) void {
+        while (self.block_stack.items.len > 0) {
+            const b = self.block_stack.pop() orelse unreachable;
+            b.is_open = false;
+        }
+    }
+
+    /// Nothing on the stack can take the next line: headings never continue,
+    /// so only the document is really open. Parsing from here depends on
+    /// nothing before.
+    fn isQuiet(self: *const LineParser) bool {
+        for (self.block_stack.items[1..]) |b| {
+            if (b.blockType != .Heading) return false;
+        }
+        return true;
+    }
+
+    fn openFences(self: *const LineParser) usize {
+        var count: usize = 0;
+        for (self.block_stack.items) |b| count += @intFromBool(b.blockType == .CodeBlock);
+        return count;
+    }
+};
+
+// ============================================================================
+// Incremental Reparse
+// ============================================================================
+
+/// A text edit in byte offsets: [start, old_end) of the old text became
+/// [start, new_end) of the new one
+pub const Edit = struct {
+    start: usize,
+    old_end: usize,
+    new_end: usize,
+
+    pub fn delta(self: Edit) isize {
+        return @as(isize, @intCast(self.new_end)) - @as(isize, @intCast(self.old_end));
+    }
+
+    /// One edit covering `self` followed by `next` (in offsets after `self`)
+    pub fn merge(self: ?Edit, next: Edit) Edit {
+        const prior = self orelse return next;
+        const prior_end = if (prior.new_end <= next.start)
+            prior.new_end
+        else if (prior.new_end >= next.old_end)
+            prior.new_end - next.old_end + next.new_end
+        else
+            next.new_end;
+        const start = @min(prior.start, next.start);
+        const new_end = @max(prior_end, next.new_end);
+        const total_delta = prior.delta() + next.delta();
+        return .{ .start = start, .old_end = @intCast(@as(isize, @intCast(new_end)) - total_delta), .new_end = new_end };
+    }
+
+    /// Where a slice of the old text `old` lies in the new text. The slice
+    /// must not overlap the edited range; slices of other memory are kept.
+    pub fn rebase(self: Edit, slice: []const u8, old: []const u8, new_base: [*]const u8) []const u8 {
+        const address = @intFromPtr(slice.ptr);
+        if (address < @intFromPtr(old.ptr) or address > @intFromPtr(old.ptr) + old.len) return slice;
+        var offset = address - @intFromPtr(old.ptr);
+        if (offset >= self.old_end) offset = shift(offset, self.delta());
+        return new_base[offset .. offset + slice.len];
+    }
+};
+
+/// A ``` block by the line starts of its fences
+pub const Fence = struct {
+    open: usize,
+    /// Null while the block runs to the end of its container
+    close: ?usize,
+    /// Index of the fence enclosing this one, inside a list in a code block
+    parent: ?u32,
+};
+
+/// Line start at which the parser holds no open block. A parse of the text
+/// from here, starting from an empty document, yields exactly the document
+/// children from `child_index` on.
+pub const ResumePoint = struct {
+    offset: usize,
+    child_index: usize,
+};
+
+/// Recorded alongside a parse so later edits can reparse only what they
+/// affect (see `reparseBlocks`)
+pub const ParseIndex = struct {
+    /// The text the index describes; kept blocks still point into it until
+    /// `splice` moves them (it is never read)
+    text: []const u8 = "",
+    body_start: usize = 0,
+    /// Ordered by `open`
+    fences: []const Fence = &.{},
+    /// Ordered by `offset`
+    resume_points: []const ResumePoint = &.{},
+
+    /// Whether the line at `offset` is inside a fenced code block
+    pub fn insideFence(self: *const ParseIndex, offset: usize) bool {
+        var low: usize = 0;
+        var high: usize = self.fences.len;
+        while (low < high) {
+            const mid = low + (high - low) / 2;
+            if (self.fences[mid].open <= offset) low = mid + 1 else high = mid;
+        }
+        if (low == 0) return false;
+        var i: ?u32 = @intCast(low - 1);
+        while (i) |fence_index| {
+            const fence = self.fences[fence_index];
+            if (fence.close == null or offset < fence.close.?) return true;
+            i = fence.parent;
+        }
+        return false;
+    }
+
+    /// Last resume point at or before `offset`
+    fn resumeBefore(self: *const ParseIndex, offset: usize) ?ResumePoint {
+        var low: usize = 0;
+        var high: usize = self.resume_points.len;
+        while (low < high) {
+            const mid = low + (high - low) / 2;
+            if (self.resume_points[mid].offset <= offset) low = mid + 1 else high = mid;
+        }
+        return if (low > 0) self.resume_points[low - 1] else null;
+    }
+
+    fn resumeAt(self: *const ParseIndex, offset: usize) ?ResumePoint {
+        const point = self.resumeBefore(offset) orelse return null;
+        return if (point.offset == offset) point else null;
+    }
+};
+
+const IndexRecorder = struct {
+    /// Added to recorded child indices, for region parses
+    base: usize,
+    fences: std.ArrayList(Fence) = .empty,
+    open_fences: std.ArrayList(u32) = .empty,
+    resume_points: std.ArrayList(ResumePoint) = .empty,
+
+    fn resumeAt(self: *IndexRecorder, allocator: Allocator, offset: usize, child_index: usize) !void {
+        try self.resume_points.append(allocator, .{ .offset = offset, .child_index = self.base + child_index });
+    }
+
+    fn openFence(self: *IndexRecorder, allocator: Allocator, offset: usize) !void {
+        const parent = self.open_fences.getLastOrNull();
+        try self.open_fences.append(allocator, @intCast(self.fences.items.len));
+        try self.fences.append(allocator, .{ .open = offset, .close = null, .parent = parent });
+    }
+
+    fn closeFence(self: *IndexRecorder, offset: usize) void {
+        const fence_index = self.open_fences.pop() orelse return;
+        self.fences.items[fence_index].close = offset;
+    }
+
+    fn finish(self: *IndexRecorder, allocator: Allocator, text: []const u8, body_start: usize) !ParseIndex {
+        self.open_fences.deinit(allocator);
+        return .{
+            .text = text,
+            .body_start = body_start,
+            .fences = try self.fences.toOwnedSlice(allocator),
+            .resume_points = try self.resume_points.toOwnedSlice(allocator),
         };
-        std.debug.print("what that line do: \"{s}\", block_type: {any}\n", .{ line, block_type });
-        try handleBlockType(allocator, &block_stack, block_type, line, text);
     }
+};
 
-    while (block_stack.items.len > 0) {
-        const b = block_stack.pop() orelse unreachable;
-        b.is_open = false;
+/// Blocks reparsed for an edit, not yet part of the document. Parse their
+/// inlines (and build anything that needs the raw blocks) before `splice`.
+pub const Region = struct {
+    /// Holds the new top-level blocks
+    document: *Block,
+    edit: Edit,
+    /// New-text offset of the first reparsed line
+    start: usize,
+    /// New-text offset where the old parse takes over again
+    end: usize,
+    /// Document children the region replaces: [first_child, end_child)
+    first_child: usize,
+    end_child: usize,
+    /// Fences and resume points found in the region
+    index: ParseIndex,
+
+    /// Old-text offset of `end`
+    pub fn oldEnd(self: Region) usize {
+        return shiftBack(self.end, self.edit);
     }
+};
 
-    return document_block;
+/// Reparse the lines an edit affects, from the last point before it where
+/// no block was open, until the first point after it where the new parse is
+/// in the same state as the old one. A ``` typed or deleted flips the lines
+/// after it, so the region runs to the next fence that closes the same way
+/// as before. Null if the front matter changed; reparse everything then.
+fn reparseBlocksWith(comptime features: Features, allocator: Allocator, text: []const u8, index: *const ParseIndex, edit: Edit) !?Region {
+    if (edit.start < index.body_start) return null;
+    if (features.frontmatter) {
+        const body_start = if (Frontmatter.extract(text)) |frontmatter| frontmatter.end else 0;
+        if (body_start != index.body_start) return null;
+    }
+    const first = index.resumeBefore(edit.start) orelse return null;
+
+    const region_document = try allocator.create(Block);
+    region_document.* = Block{ .blockType = .Document, .children = std.ArrayList(*Block).empty, .content = null };
+    var recorder = IndexRecorder{ .base = first.child_index };
+    var line_parser = LineParser{ .allocator = allocator, .text = text, .document = region_document, .recorder = &recorder };
+    try line_parser.block_stack.append(allocator, region_document);
+
+    // Without a match the region runs to the end
+    var end = text.len;
+    var end_child: usize = std.math.maxInt(usize);
+    var lines = std.mem.tokenizeAny(u8, text[first.offset..], "\n");
+    while (lines.peek()) |raw_line| {
+        const line_start = @intFromPtr(raw_line.ptr) - @intFromPtr(text.ptr);
+        if (line_start >= edit.new_end and line_parser.isQuiet()) {
+            if (index.resumeAt(shiftBack(line_start, edit))) |point| {
+                end = line_start;
+                end_child = point.child_index;
+                break;
+            }
+        }
+        _ = lines.next();
+        try line_parser.feed(raw_line);
+    }
+    line_parser.finish();
+
+    return .{
+        .document = region_document,
+        .edit = edit,
+        .start = first.offset,
+        .end = end,
+        .first_child = first.child_index,
+        .end_child = end_child,
+        .index = try recorder.finish(allocator, text, index.body_start),
+    };
+}
+
+/// Put a reparsed region into `document` (from the parse `index` describes),
+/// moving the kept blocks' slices to the new `text`, and update `index`.
+pub fn splice(allocator: Allocator, document: *Block, index: *ParseIndex, region: Region, text: []const u8) !void {
+    const edit = region.edit;
+    const end_child = @min(region.end_child, document.children.items.len);
+    for (document.children.items[0..region.first_child]) |child| rebaseBlock(child, edit, index.text, text.ptr);
+    for (document.children.items[end_child..]) |child| rebaseBlock(child, edit, index.text, text.ptr);
+    try document.children.replaceRange(allocator, region.first_child, end_child - region.first_child, region.document.children.items);
+
+    const child_shift = @as(isize, @intCast(region.document.children.items.len)) - @as(isize, @intCast(end_child - region.first_child));
+
+    // Fences and resume points: before the region, from it, then after it
+    var fences = std.ArrayList(Fence).empty;
+    var kept_before: usize = 0;
+    while (kept_before < index.fences.len and index.fences[kept_before].open < region.start) kept_before += 1;
+    try fences.appendSlice(allocator, index.fences[0..kept_before]);
+    for (region.index.fences) |fence| {
+        var moved = fence;
+        if (moved.parent) |parent| moved.parent = parent + @as(u32, @intCast(kept_before));
+        try fences.append(allocator, moved);
+    }
+    const region_old_end = region.oldEnd();
+    var after = kept_before;
+    while (after < index.fences.len and index.fences[after].open < region_old_end) after += 1;
+    const fence_shift = @as(isize, @intCast(fences.items.len)) - @as(isize, @intCast(after));
+    for (index.fences[after..]) |fence| {
+        try fences.append(allocator, .{
+            .open = shift(fence.open, edit.delta()),
+            .close = if (fence.close) |close| shift(close, edit.delta()) else null,
+            .parent = if (fence.parent) |parent| @as(u32, @intCast(@as(isize, parent) + fence_shift)) else null,
+        });
+    }
+
+    var points = std.ArrayList(ResumePoint).empty;
+    for (index.resume_points) |point| {
+        if (point.offset >= region.start) break;
+        try points.append(allocator, point);
+    }
+    try points.appendSlice(allocator, region.index.resume_points);
+    for (index.resume_points) |point| {
+        if (point.offset < region_old_end) continue;
+        try points.append(allocator, .{ .offset = shift(point.offset, edit.delta()), .child_index = shift(point.child_index, child_shift) });
+    }
+
+    index.* = .{
+        .text = text,
+        .body_start = index.body_start,
+        .fences = fences.items,
+        .resume_points = points.items,
+    };
+}
+
+/// Old-text offset of new-text `offset`, which is at or after the edit
+fn shiftBack(offset: usize, edit: Edit) usize {
+    return shift(offset, -edit.delta());
+}
+
+fn shift(value: usize, by: isize) usize {
+    return @intCast(@as(isize, @intCast(value)) + by);
+}
+
+fn rebaseBlock(block: *Block, edit: Edit, old: []const u8, new_base: [*]const u8) void {
+    if (block.content) |content| block.content = edit.rebase(content, old, new_base);
+    switch (block.blockType) {
+        .Link => |url| block.blockType = .{ .Link = edit.rebase(url, old, new_base) },
+        .Image => |url| block.blockType = .{ .Image = edit.rebase(url, old, new_base) },
+        .Embed => |target| block.blockType = .{ .Embed = edit.rebase(target, old, new_base) },
+        else => {},
+    }
+    for (block.children.items) |child| rebaseBlock(child, edit, old, new_base);
+}
+
+// ============================================================================
+// In-Place Edits
+// ============================================================================
+
+/// Whether overwriting text[start..end] in place (with bytes holding no line
+/// break, like the ones replaced) can change only inline content. Lines are
+/// sorted into blocks by their first word after any ">" markers, so an edit
+/// that starts past that word and the space after it cannot move a block
+/// boundary.
+pub fn isInlineOnlyEdit(text: []const u8, start: usize, end: usize) bool {
+    if (std.mem.indexOfAny(u8, text[start..end], "\r\n") != null) return false;
+    const line_start = if (std.mem.lastIndexOfScalar(u8, text[0..start], '\n')) |i| i + 1 else 0;
+    var words = std.mem.tokenizeScalar(u8, text[line_start..start], ' ');
+    while (words.next()) |word| {
+        if (std.mem.eql(u8, word, ">")) continue;
+        const word_end = @intFromPtr(word.ptr) + word.len - @intFromPtr(text.ptr);
+        return word_end < start;
+    }
+    return false;
+}
+
+/// The paragraph or heading whose source lines hold text[start..end], if the
+/// edit is in one; null for code and anything else without inline content
+pub fn inlineBlockAt(text: []const u8, root: *Block, start: usize, end: usize) ?*Block {
+    var parent = root;
+    while (true) {
+        switch (parent.blockType) {
+            .Paragraph, .Heading => {
+                const source = inlineSource(text, parent) orelse return null;
+                const source_start = @intFromPtr(source.ptr) - @intFromPtr(text.ptr);
+                return if (source_start <= start and end <= source_start + source.len) parent else null;
+            },
+            .Document, .BlockQuote, .OrderedList, .UnorderedList, .OrderedListItem, .UnorderedListItem => {},
+            else => return null,
+        }
+        // Children are in document order: take the last that starts before
+        var next: ?*Block = null;
+        var i = parent.children.items.len;
+        while (i > 0) {
+            i -= 1;
+            const child = parent.children.items[i];
+            const bounds = sliceBounds(text, child) orelse continue;
+            const line_start = if (std.mem.lastIndexOfScalar(u8, text[0..bounds[0]], '\n')) |n| n + 1 else 0;
+            if (line_start <= start) {
+                next = child;
+                break;
+            }
+        }
+        parent = next orelse return null;
+    }
+}
+
+/// Source lines of a paragraph or heading, after `parseInline` moved its text
+/// into children. Block content always spans whole lines, so it runs from the
+/// start of the line holding the first byte any child points at to the end
+/// of the line holding the last.
+fn inlineSource(text: []const u8, leaf: *const Block) ?[]const u8 {
+    if (leaf.content) |content| return content;
+    const bounds = sliceBounds(text, leaf) orelse return null;
+    const start = if (std.mem.lastIndexOfScalar(u8, text[0..bounds[0]], '\n')) |i| i + 1 else 0;
+    const line_end = std.mem.indexOfScalarPos(u8, text, bounds[1] -| 1, '\n') orelse text.len;
+    return text[start..@max(bounds[1], line_end - @intFromBool(line_end > start and text[line_end - 1] == '\r'))];
+}
+
+/// First and past-the-last offsets of `text` that `node` and its children
+/// point at
+fn sliceBounds(text: []const u8, node: *const Block) ?[2]usize {
+    var bounds: ?[2]usize = null;
+    const slices = [_]?[]const u8{ node.content, node.blockType.getStr() };
+    for (slices) |maybe_slice| {
+        const slice = maybe_slice orelse continue;
+        const address = @intFromPtr(slice.ptr);
+        if (address < @intFromPtr(text.ptr) or address + slice.len > @intFromPtr(text.ptr) + text.len) continue;
+        const start = address - @intFromPtr(text.ptr);
+        bounds = widen(bounds, .{ start, start + slice.len });
+    }
+    for (node.children.items) |child| {
+        if (sliceBounds(text, child)) |child_bounds| bounds = widen(bounds, child_bounds);
+    }
+    return bounds;
+}
+
+fn widen(bounds: ?[2]usize, by: [2]usize) [2]usize {
+    const current = bounds orelse return by;
+    return .{ @min(current[0], by[0]), @max(current[1], by[1]) };
 }
 
 const InlineDelimiterType = enum {
@@ -608,6 +1109,30 @@ fn lookForLinkOrImage(
     return null;
 }
 
+/// Look for an embed `![[target]]` starting at the '!' at `start`. The target
+/// may not span lines. Returns the position after the closing "]]" if found.
+fn lookForEmbed(allocator: Allocator, content: []const u8, start: usize, segments: *std.ArrayList(InlineSegment)) !?usize {
+    if (!std.mem.startsWith(u8, content[start..], "![[")) return null;
+    const target_start = start + 3;
+    const close = std.mem.indexOfPos(u8, content, target_start, "]]") orelse return null;
+    const target = content[target_start..close];
+    if (target.len == 0 or std.mem.indexOfAny(u8, target, "\n[]") != null) return null;
+
+    const embed_block = try allocator.create(Block);
+    embed_block.* = Block{
+        .blockType = .{ .Embed = target },
+        .content = target,
+        .children = std.ArrayList(*Block).empty,
+        .is_open = false,
+    };
+    try segments.append(allocator, InlineSegment{
+        .block = embed_block,
+        .start_pos = start,
+        .end_pos = close + 2,
+    });
+    return close + 2;
+}
+
 inline fn isAsciiPunctuation(c: u8) bool {
     return switch (c) {
         '!', '"', '#', '$', '%', '&', '\'', '(', ')', '*', '+', ',', '-', '.', '/', ':', ';', '<', '=', '>', '?', '@', '[', '\\', ']', '^', '_', '`', '{', '|', '}', '~' => true,
@@ -643,15 +1168,7 @@ fn buildInlineChildren(allocator: Allocator, content: []const u8, segments: *std
     for (segments.items) |segment| {
         // Add RawStr for any text before this segment
         if (segment.start_pos > last_pos) {
-            const text = content[last_pos..segment.start_pos];
-            const raw_block = try allocator.create(Block);
-            raw_block.* = Block{
-                .blockType = .RawStr,
-                .content = text,
-                .children = std.ArrayList(*Block).empty,
-                .is_open = false,
-            };
-            try parent.children.append(allocator, raw_block);
+            try appendRawStr(allocator, content[last_pos..segment.start_pos], parent);
         }
 
         // Fix the content pointer for emphasis blocks (was storing indices, not actual content)
@@ -674,19 +1191,33 @@ fn buildInlineChildren(allocator: Allocator, content: []const u8, segments: *std
 
     // Add RawStr for any remaining text after the last segment
     if (last_pos < content.len) {
-        const text = content[last_pos..];
-        const raw_block = try allocator.create(Block);
-        raw_block.* = Block{
-            .blockType = .RawStr,
-            .content = text,
-            .children = std.ArrayList(*Block).empty,
-            .is_open = false,
-        };
-        try parent.children.append(allocator, raw_block);
+        try appendRawStr(allocator, content[last_pos..], parent);
+    }
+}
+
+/// Add `text` to `parent` as RawStr children. A paragraph's content spans its
+/// lines in the buffer, so the '\r' of each CRLF break is inside it; the text
+/// is split around those bytes to keep them out of the runs.
+fn appendRawStr(allocator: Allocator, text: []const u8, parent: *Block) !void {
+    var start: usize = 0;
+    while (start < text.len) {
+        var end = start;
+        while (end < text.len and !LineEnding.isBreakCr(text, end)) end += 1;
+        if (end > start) {
+            const raw_block = try allocator.create(Block);
+            raw_block.* = Block{
+                .blockType = .RawStr,
+                .content = text[start..end],
+                .children = std.ArrayList(*Block).empty,
+                .is_open = false,
+            };
+            try parent.children.append(allocator, raw_block);
+        }
+        start = end + 1;
     }
 }
 
-pub fn parseInline(allocator: Allocator, current_block: *Block) !void {
+fn parseInlineWith(comptime features: Features, allocator: Allocator, current_block: *Block) !void {
     // Skip inline parsing for code blocks - they should preserve raw content
     if (current_block.blockType == .CodeBlock) {
         return;
@@ -706,6 +1237,12 @@ pub fn parseInline(allocator: Allocator, current_block: *Block) !void {
                     i += 1;
                 },
                 '!' => {
+                    if (features.embeds) {
+                        if (try lookForEmbed(allocator, content, i, &segments)) |end_pos| {
+                            i = end_pos;
+                            continue;
+                        }
+                    }
                     if (i + 1 < len and content[i + 1] == '[') {
                         try appendDelimiter(allocator, &stack, .ExcSquareBracket, 1, i, true, false);
                         i += 2;
@@ -796,7 +1333,7 @@ pub fn parseInline(allocator: Allocator, current_block: *Block) !void {
         current_block.content = null;
     } else {
         for (current_block.children.items) |child_block| {
-            try parseInline(allocator, child_block);
+            try parseInlineWith(features, allocator, child_block);
         }
     }
 }
@@ -953,3 +1490,176 @@ test "inline parser" {
 
     try std.testing.expectEqualDeep(expected, document);
 }
+
+test "embed inline" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const expected = try block(allocator, .Document, &.{
+        try block(allocator, .Paragraph, &.{
+            try block(allocator, .RawStr, &.{}, "See "),
+            try block(allocator, .{ .Embed = "Other Note" }, &.{}, "Other Note"),
+            try block(allocator, .RawStr, &.{}, " and ![[]] or "),
+            try block(allocator, .{ .Image = "img.png" }, &.{}, "alt"),
+        }, null),
+    }, null);
+
+    const document = try parseBlocks(allocator, "See ![[Other Note]] and ![[]] or ![alt](img.png)");
+    try parseInline(allocator, document);
+    try std.testing.expectEqualDeep(expected, document);
+}
+
+test "frontmatter block" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const expected = try block(allocator, .Document, &.{
+        try block(allocator, .Frontmatter, &.{}, "---\nstatus: open\n---"),
+        try block(allocator, .{ .Heading = 1 }, &.{}, "# Title"),
+        try block(allocator, .Paragraph, &.{}, "---"),
+    }, null);
+
+    const document = try parseBlocks(allocator, "---\nstatus: open\n---\n# Title\n---\n");
+    try std.testing.expectEqualDeep(expected, document);
+}
+
+test "core features leave vault syntax as text" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const text = "---\ntitle: x\n---\nSee ![[Other Note]]";
+    const expected = try block(allocator, .Document, &.{
+        try block(allocator, .Paragraph, &.{
+            try block(allocator, .RawStr, &.{}, text),
+        }, null),
+    }, null);
+
+    const document = try Core.parseBlocks(allocator, text);
+    try Core.parseInline(allocator, document);
+    try std.testing.expectEqualDeep(expected, document);
+}
+
+test "CRLF line breaks stay out of block content" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const expected = try block(allocator, .Document, &.{
+        try block(allocator, .{ .Heading = 1 }, &.{}, "# Title"),
+        try block(allocator, .Paragraph, &.{}, "Body"),
+    }, null);
+
+    const document = try parseBlocks(allocator, "# Title\r\n\r\nBody\r\n");
+    try std.testing.expectEqualDeep(expected, document);
+
+    // A paragraph's content spans its lines; the text runs leave out each CR
+    const expected_lines = try block(allocator, .Document, &.{
+        try block(allocator, .Paragraph, &.{
+            try block(allocator, .RawStr, &.{}, "One"),
+            try block(allocator, .RawStr, &.{}, "\ntwo "),
+            try block(allocator, .Strong, &.{}, "bold"),
+            try block(allocator, .RawStr, &.{}, "\nthree"),
+        }, null),
+    }, null);
+    const lines = try parseBlocks(allocator, "One\r\ntwo **bold**\r\nthree\r\n");
+    try parseInline(allocator, lines);
+    try std.testing.expectEqualDeep(expected_lines, lines);
+}
+
+fn expectSameTree(expected: *const Block, actual: *const Block) !void {
+    try std.testing.expectEqualDeep(expected.blockType, actual.blockType);
+    try std.testing.expectEqualDeep(expected.content, actual.content);
+    try std.testing.expectEqual(expected.children.items.len, actual.children.items.len);
+    for (expected.children.items, actual.children.items) |e, a| try expectSameTree(e, a);
+}
+
+test "region reparse matches a full parse" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    var text: []const u8 = "---\ntags: [a]\n---\n# A\npara one\n```zig\ncode\n```\n# B\n```py\nmore\n```\n# C\ntail *x* [l](u)\n";
+    var index = ParseIndex{};
+    const document = try parseBlocksIndexed(allocator, text, &index);
+    try parseInline(allocator, document);
+    try std.testing.expect(index.insideFence(std.mem.indexOf(u8, text, "code").?));
+    try std.testing.expect(!index.insideFence(std.mem.indexOf(u8, text, "# B").?));
+
+    const Step = struct { at: []const u8, remove: usize, insert: []const u8 };
+    const steps = [_]Step{
+        // A bare fence opens a block that "```zig" cannot close, so the
+        // region ends at the next bare fence
+        .{ .at = "para one", .remove = 0, .insert = "```\n" },
+        .{ .at = "```\npara", .remove = 4, .insert = "" },
+        .{ .at = "one", .remove = 3, .insert = "two" },
+        .{ .at = "\n# B", .remove = 1, .insert = "" },
+        .{ .at = "tail", .remove = 0, .insert = "- item\n" },
+        .{ .at = "# C", .remove = 0, .insert = "```\n" },
+    };
+    for (steps, 0..) |step, i| {
+        const start = std.mem.indexOf(u8, text, step.at).?;
+        const new_text = try std.mem.concat(allocator, u8, &.{ text[0..start], step.insert, text[start + step.remove ..] });
+        const edit = Edit{ .start = start, .old_end = start + step.remove, .new_end = start + step.insert.len };
+
+        const region = (try reparseBlocks(allocator, new_text, &index, edit)).?;
+        if (i == 0) try std.testing.expectEqual(std.mem.indexOf(u8, new_text, "# B").?, region.end);
+        try parseInline(allocator, region.document);
+        try splice(allocator, document, &index, region, new_text);
+
+        var expected_index = ParseIndex{};
+        const expected = try parseBlocksIndexed(allocator, new_text, &expected_index);
+        try parseInline(allocator, expected);
+        try expectSameTree(expected, document);
+        try std.testing.expectEqualSlices(Fence, expected_index.fences, index.fences);
+        try std.testing.expectEqualSlices(ResumePoint, expected_index.resume_points, index.resume_points);
+        text = new_text;
+    }
+
+    // Editing the front matter takes a full parse
+    try std.testing.expect(try reparseBlocks(allocator, text, &index, .{ .start = 4, .old_end = 4, .new_end = 4 }) == null);
+}
+
+test "in-place edits past the block marker only reparse inline content" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const text = try allocator.dupe(u8, "# Title *x*\n- [ ] task one\n> quote **b**\npara line\nsecond *line*\n");
+    const document = try parseBlocks(allocator, text);
+    try parseInline(allocator, document);
+
+    try std.testing.expect(!isInlineOnlyEdit(text, 0, 1));
+    try std.testing.expect(!isInlineOnlyEdit(text, std.mem.indexOf(u8, text, "para").?, std.mem.indexOf(u8, text, " line").?));
+    try std.testing.expect(!isInlineOnlyEdit(text, std.mem.indexOf(u8, text, " line").?, std.mem.indexOf(u8, text, "second").?));
+
+    const Step = struct { at: []const u8, with: []const u8 };
+    const steps = [_]Step{
+        .{ .at = "[ ]", .with = "[x]" },
+        .{ .at = "*x*", .with = "_y_" },
+        .{ .at = "**b**", .with = "[b](" },
+        .{ .at = "*line*", .with = "lines!" },
+        .{ .at = "line\nsecond", .with = "LINE" },
+    };
+    for (steps) |step| {
+        const start = std.mem.indexOf(u8, text, step.at).?;
+        const end = start + step.with.len;
+        @memcpy(text[start..end], step.with);
+        try std.testing.expect(isInlineOnlyEdit(text, start, end));
+        try reparseInline(allocator, text, inlineBlockAt(text, document, start, end).?);
+
+        const expected = try parseBlocks(allocator, text);
+        try parseInline(allocator, expected);
+        try expectSameTree(expected, document);
+    }
+}
+
+test "edits merge into one range" {
+    // Insert "abc" at 10, then delete [5, 12): old [5, 10) plus two of "abc"
+    const merged = Edit.merge(Edit{ .start = 10, .old_end = 10, .new_end = 13 }, .{ .start = 5, .old_end = 12, .new_end = 5 });
+    try std.testing.expectEqual(Edit{ .start = 5, .old_end = 10, .new_end = 6 }, merged);
+    const typed = Edit.merge(Edit{ .start = 3, .old_end = 3, .new_end = 4 }, .{ .start = 4, .old_end = 4, .new_end = 5 });
+    try std.testing.expectEqual(Edit{ .start = 3, .old_end = 3, .new_end = 5 }, typed);
+}
@@ -7,6 +7,8 @@
 const std = @import("std");
 const Renderer = @import("Renderer.zig");
 const CoreTextGlyphAtlas = @import("CoreTextGlyphAtlas.zig");
+const FrameScheduler = @import("FrameScheduler.zig");
+const Damage = @import("Damage.zig");
 
 const Self = @This();
 
@@ -86,6 +88,14 @@ const MTLBlendFactorOne: c_ulong = 1;
 const MTLBlendFactorSourceAlpha: c_ulong = 4;
 const MTLBlendFactorOneMinusSourceAlpha: c_ulong = 5;
 
+// Render targets
+const MTLLoadActionLoad: c_ulong = 1;
+const MTLLoadActionClear: c_ulong = 2;
+const MTLStoreActionStore: c_ulong = 1;
+const MTLTextureUsageShaderRead: c_ulong = 1;
+const MTLTextureUsageRenderTarget: c_ulong = 4;
+const MTLStorageModePrivate: c_ulong = 2;
+
 // ============================================================================
 // MTLClearColor
 // ============================================================================
@@ -118,6 +128,27 @@ const MTLRegion = extern struct {
     size: MTLSize = .{},
 };
 
+// ============================================================================
+// MTLScissorRect (for partial redraw)
+// ============================================================================
+
+const MTLScissorRect = extern struct {
+    x: c_ulong = 0,
+    y: c_ulong = 0,
+    width: c_ulong = 0,
+    height: c_ulong = 0,
+};
+
+/// Screen-space damage band -> scissor rect clamped to the render target.
+fn scissorForBand(band: Damage.Band, tex_width: c_ulong, tex_height: c_ulong) MTLScissorRect {
+    const max_y: f32 = @floatFromInt(tex_height);
+    const top = std.math.clamp(@floor(band.top), 0, max_y);
+    const bottom = std.math.clamp(@ceil(band.bottom), 0, max_y);
+    const y: c_ulong = @intFromFloat(top);
+    const y_end: c_ulong = @intFromFloat(bottom);
+    return .{ .x = 0, .y = y, .width = tex_width, .height = y_end -| y };
+}
+
 // ============================================================================
 // MSL Shader Source (embedded at compile time from .metal file)
 // ============================================================================
@@ -135,7 +166,8 @@ const GlyphPipeline = struct {
     vertex_buffer: Id,
     texture: Id,
     sampler: Id,
-    char_capacity: usize,
+    /// Glyph vertices the buffer holds; VertexArena hands out ranges of it
+    vertex_capacity: usize,
 };
 
 const CursorPipeline = struct {
@@ -160,24 +192,43 @@ view: Id,
 glyph: GlyphPipeline,
 cursor: CursorPipeline,
 selection: SelectionPipeline,
+/// Persistent render target; damaged bands are redrawn into it, then it is
+/// copied to the drawable.
+canvas: OptId = null,
+canvas_width: c_ulong = 0,
+canvas_height: c_ulong = 0,
+
+fn glyphVertices(self: *Self) [*]GlyphVertex {
+    const ptr = msgSend(*anyopaque, self.glyph.vertex_buffer, sel_("contents"), .{});
+    return @ptrCast(@alignCast(ptr));
+}
 
-fn ensureVertexCapacity(self: *Self, required_chars: usize) bool {
-    if (required_chars <= self.glyph.char_capacity) return true;
-
-    var new_capacity = self.glyph.char_capacity;
-    while (new_capacity < required_chars) {
-        new_capacity *= 2;
+/// Make room in the glyph arena: squeeze out holes if they are worth it,
+/// otherwise double the buffer, keeping the cached chunks.
+fn growGlyphArena(self: *Self) bool {
+    const arena = &self.state.glyph_chunks;
+    if (arena.needsCompaction()) {
+        arena.compact(std.heap.page_allocator, GlyphVertex, self.glyphVertices()) catch return false;
+        return true;
     }
 
-    const new_size = new_capacity * Renderer.VERTICES_PER_CHAR * @sizeOf(GlyphVertex);
+    const new_capacity = self.glyph.vertex_capacity * 2;
     const new_buffer = msgSend(OptId, self.device, sel_("newBufferWithLength:options:"), .{
-        @as(c_ulong, new_size),
+        @as(c_ulong, new_capacity * @sizeOf(GlyphVertex)),
         @as(c_ulong, 0),
     }) orelse return false;
 
+    const new_ptr = msgSend(*anyopaque, new_buffer, sel_("contents"), .{});
+    const new_vertices: [*]GlyphVertex = @ptrCast(@alignCast(new_ptr));
+    @memcpy(new_vertices[0..self.glyph.vertex_capacity], self.glyphVertices()[0..self.glyph.vertex_capacity]);
+    arena.grow(std.heap.page_allocator, new_capacity) catch {
+        release(new_buffer);
+        return false;
+    };
+
     release(self.glyph.vertex_buffer);
     self.glyph.vertex_buffer = new_buffer;
-    self.glyph.char_capacity = new_capacity;
+    self.glyph.vertex_capacity = new_capacity;
     return true;
 }
 
@@ -201,6 +252,78 @@ fn ensureSelectionCapacity(self: *Self, required_rects: usize) bool {
     return true;
 }
 
+fn ensureCanvas(self: *Self, width: c_ulong, height: c_ulong) bool {
+    if (self.canvas) |canvas| {
+        if (self.canvas_width == width and self.canvas_height == height) return true;
+        release(canvas);
+        self.canvas = null;
+    }
+
+    const tex_desc_class = objc_getClass("MTLTextureDescriptor") orelse return false;
+    const tex_desc = msgSend(OptId, tex_desc_class, sel_("texture2DDescriptorWithPixelFormat:width:height:mipmapped:"), .{
+        MTLPixelFormatBGRA8Unorm,
+        width,
+        height,
+        @as(i8, 0),
+    }) orelse return false;
+    msgSend(void, tex_desc, sel_("setUsage:"), .{MTLTextureUsageRenderTarget | MTLTextureUsageShaderRead});
+    msgSend(void, tex_desc, sel_("setStorageMode:"), .{MTLStorageModePrivate});
+
+    self.canvas = msgSend(OptId, self.device, sel_("newTextureWithDescriptor:"), .{tex_desc}) orelse return false;
+    self.canvas_width = width;
+    self.canvas_height = height;
+    self.state.needs_full_redraw = true;
+    return true;
+}
+
+/// Render pass into the canvas: clear for a full redraw, otherwise keep the
+/// previous contents so only damaged bands are touched.
+fn canvasPassDescriptor(canvas: Id, clear: bool) OptId {
+    const RPDClass = objc_getClass("MTLRenderPassDescriptor") orelse return null;
+    const pass = msgSend(OptId, RPDClass, sel_("renderPassDescriptor"), .{}) orelse return null;
+    const attachments = msgSend(OptId, pass, sel_("colorAttachments"), .{}) orelse return null;
+    const attachment0 = msgSend(OptId, attachments, sel_("objectAtIndexedSubscript:"), .{@as(c_ulong, 0)}) orelse return null;
+
+    msgSend(void, attachment0, sel_("setTexture:"), .{canvas});
+    msgSend(void, attachment0, sel_("setLoadAction:"), .{if (clear) MTLLoadActionClear else MTLLoadActionLoad});
+    msgSend(void, attachment0, sel_("setStoreAction:"), .{MTLStoreActionStore});
+    msgSend(void, attachment0, sel_("setClearColor:"), .{MTLClearColor{
+        .red = Renderer.BACKGROUND_R,
+        .green = Renderer.BACKGROUND_G,
+        .blue = Renderer.BACKGROUND_B,
+        .alpha = 1.0,
+    }});
+    return pass;
+}
+
+/// Fill a document-space band with the background colour (scissor limits it).
+fn encodeBandBackground(self: *Self, encoder: Id, doc_band: Damage.Band, view_width: f32, viewport: *const [2]f32) void {
+    const background = [4]f32{
+        @floatCast(Renderer.BACKGROUND_R),
+        @floatCast(Renderer.BACKGROUND_G),
+        @floatCast(Renderer.BACKGROUND_B),
+        1.0,
+    };
+    const opacity: f32 = 1.0;
+    const pos = Renderer.quadPositions(0, doc_band.top, view_width, doc_band.bottom);
+    var verts: [Renderer.CURSOR_VERTICES]CursorVertex = undefined;
+    for (0..Renderer.CURSOR_VERTICES) |vi| {
+        verts[vi] = .{ .position = pos[vi] };
+    }
+
+    msgSend(void, encoder, sel_("setRenderPipelineState:"), .{self.cursor.pipeline_state});
+    setVertexBytes(encoder, @ptrCast(&verts), @sizeOf(@TypeOf(verts)), 0);
+    setVertexBytes(encoder, @ptrCast(viewport), @sizeOf([2]f32), 1);
+    setVertexBytes(encoder, @ptrCast(&self.state.scroll_y), @sizeOf(f32), 2);
+    setFragmentBytes(encoder, @ptrCast(&opacity), @sizeOf(f32), 0);
+    setFragmentBytes(encoder, @ptrCast(&background), @sizeOf([4]f32), 1);
+    msgSend(void, encoder, sel_("drawPrimitives:vertexStart:vertexCount:"), .{
+        MTLPrimitiveTypeTriangle,
+        @as(c_ulong, 0),
+        @as(c_ulong, Renderer.CURSOR_VERTICES),
+    });
+}
+
 // ============================================================================
 // Shader Pipeline Compilation
 // ============================================================================
@@ -322,6 +445,8 @@ pub fn init(view: Id) !*Self {
     // 2. Configure the MTKView
     msgSend(void, view, sel_("setDevice:"), .{device});
     msgSend(void, view, sel_("setColorPixelFormat:"), .{MTLPixelFormatBGRA8Unorm});
+    // The persistent canvas is blitted into the drawable each frame
+    msgSend(void, view, sel_("setFramebufferOnly:"), .{@as(i8, 0)});
     msgSend(void, view, sel_("setClearColor:"), .{MTLClearColor{
         .red = Renderer.BACKGROUND_R,
         .green = Renderer.BACKGROUND_G,
@@ -332,10 +457,10 @@ pub fn init(view: Id) !*Self {
     // 3. Create command queue
     const queue = msgSend(OptId, device, sel_("newCommandQueue"), .{}) orelse return error.NoCommandQueue;
 
-    // 4. Rasterize glyph atlas (all printable ASCII at 48pt)
-    var atlas = CoreTextGlyphAtlas.rasterize_atlas(
+    // 4. Rasterize glyph atlas (all printable ASCII as a distance field at 48pt)
+    var atlas = CoreTextGlyphAtlas.rasterize_sdf_atlas(
         std.heap.page_allocator,
-        48.0,
+        Renderer.ATLAS_REFERENCE_SIZE,
         Renderer.font_data,
     ) catch return error.GlyphRasterFailed;
 
@@ -378,7 +503,11 @@ pub fn init(view: Id) !*Self {
     const sampler = msgSend(OptId, device, sel_("newSamplerStateWithDescriptor:"), .{sampler_desc}) orelse return error.SamplerFailed;
 
     // 7. Compile shader pipelines
-    const glyph_pipeline_state = try compileShaderPipeline(device, glyph_shader_source, "glyph_vertex_main", "glyph_fragment_main");
+    const glyph_fragment_name: [*:0]const u8 = switch (atlas.mode) {
+        .coverage => "glyph_fragment_main",
+        .sdf => "glyph_sdf_fragment_main",
+    };
+    const glyph_pipeline_state = try compileShaderPipeline(device, glyph_shader_source, "glyph_vertex_main", glyph_fragment_name);
     const cursor_pipeline_state = try compileShaderPipeline(device, cursor_shader_source, "cursor_vertex_main", "cursor_fragment_main");
     const selection_pipeline_state = try compileInvertShaderPipeline(
         device,
@@ -408,22 +537,10 @@ pub fn init(view: Id) !*Self {
         @as(c_ulong, 0),
     }) orelse return error.BufferFailed;
 
-    // 11. Allocate layout buffer
-    const layout_buf = try std.heap.page_allocator.alloc(Renderer.CharPos, Renderer.INITIAL_TEXT_CAPACITY);
-
-    // 12. Allocate and return Metal instance
+    // 11. Allocate and return Metal instance
     const self = try std.heap.page_allocator.create(Self);
     self.* = .{
-        .state = .{
-            .atlas = atlas,
-            .start_time = std.time.nanoTimestamp(),
-            .layout_buf = layout_buf,
-            .layout_result = .{ .count = 0, .final_x = Renderer.MARGIN, .final_baseline_y = Renderer.MARGIN },
-            .layout_text_len = 0,
-            .scroll_y = 0,
-            .last_view_height = 0,
-            .last_cursor_byte_offset = -1,
-        },
+        .state = Renderer.init(atlas),
         .device = device,
         .command_queue = queue,
         .view = view,
@@ -432,7 +549,7 @@ pub fn init(view: Id) !*Self {
             .vertex_buffer = glyph_vertex_buffer,
             .texture = texture,
             .sampler = sampler,
-            .char_capacity = Renderer.INITIAL_TEXT_CAPACITY,
+            .vertex_capacity = Renderer.INITIAL_TEXT_CAPACITY * Renderer.VERTICES_PER_CHAR,
         },
         .cursor = .{
             .pipeline_state = cursor_pipeline_state,
@@ -444,6 +561,9 @@ pub fn init(view: Id) !*Self {
             .rect_capacity = Renderer.INITIAL_TEXT_CAPACITY,
         },
     };
+    // Preallocate the layout buffer and glyph arena
+    if (!self.state.ensureLayoutCapacity(Renderer.INITIAL_TEXT_CAPACITY)) return error.OutOfMemory;
+    try self.state.glyph_chunks.grow(std.heap.page_allocator, self.glyph.vertex_capacity);
 
     return self;
 }
@@ -466,127 +586,228 @@ pub fn render(
 
     // Ensure buffers are large enough
     const needed = if (text.len > 0) text.len else 1;
-    if (!self.ensureVertexCapacity(needed)) return;
-    if (!self.ensureSelectionCapacity(needed)) return;
     if (!self.state.ensureLayoutCapacity(needed)) return;
 
     // Run shared layout and cache results
     self.state.layout_result = self.state.layoutText(text, view_width, self.state.layout_buf);
     self.state.layout_text_len = text.len;
 
+    // Selection is one rect per visual line, so size its buffer by line count
+    if (!self.ensureSelectionCapacity(self.state.visualLineCount())) return;
+
     // Resolve cursor position
     const cursor_info = self.state.resolveCursorPos(cursor_byte_offset, text);
 
-    // Auto-scroll when cursor moves
+    // Auto-scroll when cursor moves; a moved caret restarts its blink cycle
+    const now = std.time.nanoTimestamp();
+    if (cursor_byte_offset != self.state.last_cursor_byte_offset) {
+        self.state.frames.resetBlink(now);
+    }
+    self.state.frames.setCaretEnabled(cursor_byte_offset >= 0);
     self.state.autoScroll(cursor_info, cursor_byte_offset, view_height);
     self.state.last_cursor_byte_offset = cursor_byte_offset;
 
+    const opacity = self.state.cursorOpacity();
+    const caret_drawn = cursor_byte_offset >= 0 and opacity > 0 and self.state.isCursorVisible(cursor_info, view_height);
+    const caret = self.state.caretState(cursor_info, caret_drawn);
+
+    // Only the line bands that changed since the last frame get redrawn
+    const damage = self.state.computeDamage(
+        text,
+        view_width,
+        view_height,
+        caret,
+        selection_start_byte_offset,
+        selection_end_byte_offset,
+    );
+    if (damage.isEmpty()) {
+        self.finishFrame(text, view_width, view_height, caret, selection_start_byte_offset, selection_end_byte_offset);
+        return;
+    }
+
+    // Rebuild vertices only for paragraphs that changed since they were cached
+    while (true) {
+        self.state.updateGlyphChunks(text, view_width, self.glyphVertices()) catch |err| switch (err) {
+            error.OutOfSpace => {
+                if (!self.growGlyphArena()) return;
+                continue;
+            },
+            error.OutOfMemory => return,
+        };
+        break;
+    }
+
     // --- Metal draw calls below ---
 
-    // Get current render pass descriptor and drawable from MTKView
-    const rpd = msgSend(OptId, self.view, sel_("currentRenderPassDescriptor"), .{}) orelse return;
     const drawable = msgSend(OptId, self.view, sel_("currentDrawable"), .{}) orelse return;
+    const drawable_texture = msgSend(OptId, drawable, sel_("texture"), .{}) orelse return;
+    const tex_width = msgSend(c_ulong, drawable_texture, sel_("width"), .{});
+    const tex_height = msgSend(c_ulong, drawable_texture, sel_("height"), .{});
+
+    // Draw into the persistent canvas; a new canvas has no old contents to keep
+    if (!self.ensureCanvas(tex_width, tex_height)) return;
+    const canvas = self.canvas orelse return;
+    const full = damage.full or self.state.needs_full_redraw;
+
+    const pass = canvasPassDescriptor(canvas, full) orelse return;
 
     // Create command buffer
     const cmd_buffer = msgSend(OptId, self.command_queue, sel_("commandBuffer"), .{}) orelse return;
 
     // Create render command encoder
-    const encoder = msgSend(OptId, cmd_buffer, sel_("renderCommandEncoderWithDescriptor:"), .{rpd}) orelse return;
+    const encoder = msgSend(OptId, cmd_buffer, sel_("renderCommandEncoderWithDescriptor:"), .{pass}) orelse return;
 
     // Uniforms for shaders
     const viewport = [2]f32{ view_width, view_height };
     const text_color = [4]f32{ Renderer.TEXT_R, Renderer.TEXT_G, Renderer.TEXT_B, 1.0 };
-    const max_vertices = self.glyph.char_capacity * Renderer.VERTICES_PER_CHAR;
-    const glyph_buf_ptr = msgSend(*anyopaque, self.glyph.vertex_buffer, sel_("contents"), .{});
-    const glyph_vertices: [*]GlyphVertex = @ptrCast(@alignCast(glyph_buf_ptr));
-
-    // Draw full text glyphs first.
-    const full_text_vertex_count = self.state.buildGlyphVertices(
-        text,
-        glyph_vertices,
-        max_vertices,
-    );
-    if (full_text_vertex_count > 0) {
-        msgSend(void, encoder, sel_("setRenderPipelineState:"), .{self.glyph.pipeline_state});
-        msgSend(void, encoder, sel_("setFragmentTexture:atIndex:"), .{ self.glyph.texture, @as(c_ulong, 0) });
-        msgSend(void, encoder, sel_("setFragmentSamplerState:atIndex:"), .{ self.glyph.sampler, @as(c_ulong, 0) });
-        setFragmentBytes(encoder, @ptrCast(&text_color), @sizeOf([4]f32), 1);
-        msgSend(void, encoder, sel_("setVertexBuffer:offset:atIndex:"), .{
-            self.glyph.vertex_buffer,
-            @as(c_ulong, 0),
-            @as(c_ulong, 0),
-        });
-        setVertexBytes(encoder, @ptrCast(&viewport), @sizeOf([2]f32), 1);
-        setVertexBytes(encoder, @ptrCast(&self.state.scroll_y), @sizeOf(f32), 2);
-        msgSend(void, encoder, sel_("drawPrimitives:vertexStart:vertexCount:"), .{
-            MTLPrimitiveTypeTriangle,
-            @as(c_ulong, 0),
-            @as(c_ulong, full_text_vertex_count),
-        });
-    }
-
-    // Invert the selected region as a separate pass.
     const max_selection_vertices = self.selection.rect_capacity * Renderer.CURSOR_VERTICES;
     const selection_buf_ptr = msgSend(*anyopaque, self.selection.vertex_buffer, sel_("contents"), .{});
     const selection_vertices: [*]CursorVertex = @ptrCast(@alignCast(selection_buf_ptr));
-    const selection_vertex_count = self.state.buildSelectionVertices(
-        text,
-        selection_vertices,
-        max_selection_vertices,
-        selection_start_byte_offset,
-        selection_end_byte_offset,
-    );
-
-    if (selection_vertex_count > 0) {
-        msgSend(void, encoder, sel_("setRenderPipelineState:"), .{self.selection.pipeline_state});
-        msgSend(void, encoder, sel_("setVertexBuffer:offset:atIndex:"), .{
-            self.selection.vertex_buffer,
-            @as(c_ulong, 0),
-            @as(c_ulong, 0),
-        });
-        setVertexBytes(encoder, @ptrCast(&viewport), @sizeOf([2]f32), 1);
-        setVertexBytes(encoder, @ptrCast(&self.state.scroll_y), @sizeOf(f32), 2);
-        msgSend(void, encoder, sel_("drawPrimitives:vertexStart:vertexCount:"), .{
-            MTLPrimitiveTypeTriangle,
-            @as(c_ulong, 0),
-            @as(c_ulong, selection_vertex_count),
-        });
-    }
-
-    // Draw cursor if visible
-    const has_cursor = cursor_byte_offset >= 0;
-    if (has_cursor and self.state.isCursorVisible(cursor_info, view_height)) {
-        const opacity = self.state.cursorOpacity();
 
+    if (caret) |c| {
         // Write cursor vertices into Metal buffer
         const cbuf_ptr = msgSend(*anyopaque, self.cursor.vertex_buffer, sel_("contents"), .{});
         const cursor_verts: [*]CursorVertex = @ptrCast(@alignCast(cbuf_ptr));
-        self.state.buildCursorVertices(cursor_info, cursor_verts);
-
-        // Switch to cursor pipeline and draw
-        msgSend(void, encoder, sel_("setRenderPipelineState:"), .{self.cursor.pipeline_state});
-        msgSend(void, encoder, sel_("setVertexBuffer:offset:atIndex:"), .{
-            self.cursor.vertex_buffer,
-            @as(c_ulong, 0),
-            @as(c_ulong, 0),
-        });
-        setVertexBytes(encoder, @ptrCast(&viewport), @sizeOf([2]f32), 1);
-        setVertexBytes(encoder, @ptrCast(&self.state.scroll_y), @sizeOf(f32), 2);
-        setFragmentBytes(encoder, @ptrCast(&opacity), @sizeOf(f32), 0);
-        setFragmentBytes(encoder, @ptrCast(&text_color), @sizeOf([4]f32), 1);
-        msgSend(void, encoder, sel_("drawPrimitives:vertexStart:vertexCount:"), .{
-            MTLPrimitiveTypeTriangle,
-            @as(c_ulong, 0),
-            @as(c_ulong, Renderer.CURSOR_VERTICES),
-        });
+        self.state.buildCursorVertices(.{ .x = c.x, .y = c.band.top + self.state.atlas.ascent, .found = true }, cursor_verts);
+    }
+
+    const full_band = [_]Damage.Band{.{ .top = 0, .bottom = view_height }};
+    const bands: []const Damage.Band = if (full) &full_band else damage.slice();
+
+    // Each band's selection vertices go after the previous band's
+    var selection_base: usize = 0;
+
+    for (bands) |band| {
+        const scissor = scissorForBand(band, tex_width, tex_height);
+        if (scissor.height == 0) continue;
+        msgSend(void, encoder, sel_("setScissorRect:"), .{scissor});
+
+        const doc_band = Damage.Band{
+            .top = band.top + self.state.scroll_y,
+            .bottom = band.bottom + self.state.scroll_y,
+        };
+        const range = self.state.layoutRangeForBand(doc_band);
+
+        // A full redraw was already cleared by the load action
+        if (!full) self.encodeBandBackground(encoder, doc_band, view_width, &viewport);
+
+        // Draw the cached glyph chunks of the paragraphs in this band
+        const paras = self.state.paragraphRangeForBand(doc_band);
+        if (paras.end > paras.start) {
+            msgSend(void, encoder, sel_("setRenderPipelineState:"), .{self.glyph.pipeline_state});
+            msgSend(void, encoder, sel_("setFragmentTexture:atIndex:"), .{ self.glyph.texture, @as(c_ulong, 0) });
+            msgSend(void, encoder, sel_("setFragmentSamplerState:atIndex:"), .{ self.glyph.sampler, @as(c_ulong, 0) });
+            setFragmentBytes(encoder, @ptrCast(&text_color), @sizeOf([4]f32), 1);
+            msgSend(void, encoder, sel_("setVertexBuffer:offset:atIndex:"), .{
+                self.glyph.vertex_buffer,
+                @as(c_ulong, 0),
+                @as(c_ulong, 0),
+            });
+            setVertexBytes(encoder, @ptrCast(&viewport), @sizeOf([2]f32), 1);
+
+            const chunks = self.state.glyph_chunks.chunks.items[paras.start..paras.end];
+            for (chunks, self.state.paragraphs.items[paras.start..paras.end]) |chunk, para| {
+                if (chunk.len == 0) continue;
+                // Chunk vertices are relative to the paragraph top
+                const offset_y = self.state.scroll_y - para.top;
+                setVertexBytes(encoder, @ptrCast(&offset_y), @sizeOf(f32), 2);
+                msgSend(void, encoder, sel_("drawPrimitives:vertexStart:vertexCount:"), .{
+                    MTLPrimitiveTypeTriangle,
+                    @as(c_ulong, chunk.offset),
+                    @as(c_ulong, chunk.len),
+                });
+            }
+        }
+
+        // Invert the selected region as a separate pass.
+        const selection_count = self.state.buildSelectionVerticesInRange(
+            text,
+            range,
+            selection_vertices + selection_base,
+            max_selection_vertices - selection_base,
+            selection_start_byte_offset,
+            selection_end_byte_offset,
+        );
+        if (selection_count > 0) {
+            msgSend(void, encoder, sel_("setRenderPipelineState:"), .{self.selection.pipeline_state});
+            msgSend(void, encoder, sel_("setVertexBuffer:offset:atIndex:"), .{
+                self.selection.vertex_buffer,
+                @as(c_ulong, 0),
+                @as(c_ulong, 0),
+            });
+            setVertexBytes(encoder, @ptrCast(&viewport), @sizeOf([2]f32), 1);
+            setVertexBytes(encoder, @ptrCast(&self.state.scroll_y), @sizeOf(f32), 2);
+            msgSend(void, encoder, sel_("drawPrimitives:vertexStart:vertexCount:"), .{
+                MTLPrimitiveTypeTriangle,
+                @as(c_ulong, selection_base),
+                @as(c_ulong, selection_count),
+            });
+            selection_base += selection_count;
+        }
+
+        // Draw cursor if it falls in this band
+        if (caret) |c| {
+            if (c.band.intersects(doc_band)) {
+                msgSend(void, encoder, sel_("setRenderPipelineState:"), .{self.cursor.pipeline_state});
+                msgSend(void, encoder, sel_("setVertexBuffer:offset:atIndex:"), .{
+                    self.cursor.vertex_buffer,
+                    @as(c_ulong, 0),
+                    @as(c_ulong, 0),
+                });
+                setVertexBytes(encoder, @ptrCast(&viewport), @sizeOf([2]f32), 1);
+                setVertexBytes(encoder, @ptrCast(&self.state.scroll_y), @sizeOf(f32), 2);
+                setFragmentBytes(encoder, @ptrCast(&opacity), @sizeOf(f32), 0);
+                setFragmentBytes(encoder, @ptrCast(&text_color), @sizeOf([4]f32), 1);
+                msgSend(void, encoder, sel_("drawPrimitives:vertexStart:vertexCount:"), .{
+                    MTLPrimitiveTypeTriangle,
+                    @as(c_ulong, 0),
+                    @as(c_ulong, Renderer.CURSOR_VERTICES),
+                });
+            }
+        }
     }
 
     // End encoding
     msgSend(void, encoder, sel_("endEncoding"), .{});
 
+    // Copy the canvas to the drawable (drawables do not keep their contents)
+    const blit = msgSend(OptId, cmd_buffer, sel_("blitCommandEncoder"), .{}) orelse return;
+    msgSend(void, blit, sel_("copyFromTexture:toTexture:"), .{ canvas, drawable_texture });
+    msgSend(void, blit, sel_("endEncoding"), .{});
+
     // Present drawable and commit
     msgSend(void, cmd_buffer, sel_("presentDrawable:"), .{drawable});
     msgSend(void, cmd_buffer, sel_("commit"), .{});
+
+    self.finishFrame(text, view_width, view_height, caret, selection_start_byte_offset, selection_end_byte_offset);
+}
+
+/// Record what is now on screen; only called once the frame was actually drawn.
+fn finishFrame(
+    self: *Self,
+    text: []const u8,
+    view_width: f32,
+    view_height: f32,
+    caret: ?Renderer.CaretState,
+    selection_start_byte_offset: i32,
+    selection_end_byte_offset: i32,
+) void {
+    self.state.commitFrameState(text, view_width, view_height, caret, selection_start_byte_offset, selection_end_byte_offset);
+    self.state.frames.frameRendered();
+}
+
+/// Background work whose results will need a frame is still running
+pub fn setPendingWork(self: *Self, pending: bool) void {
+    self.state.frames.setPendingWork(pending);
+}
+
+/// Draw every frame for the next `duration_ns` (scroll gestures, momentum)
+pub fn animateFor(self: *Self, duration_ns: i128) void {
+    self.state.frames.animateUntil(std.time.nanoTimestamp() + duration_ns);
+}
+
+pub fn nextFrame(self: *Self) FrameScheduler.FrameRequest {
+    return self.state.frames.nextFrame(std.time.nanoTimestamp());
 }
 
 pub fn hitTest(self: *Self, text: []const u8, view_width: f32, click_x: f32, click_y: f32) i32 {
@@ -597,7 +818,17 @@ pub fn updateScroll(self: *Self, delta_y: f32) void {
     self.state.updateScroll(delta_y);
 }
 
+/// Zoom: rescale the atlas metrics; the SDF texture is reused as-is.
+pub fn setFontSize(self: *Self, font_size: f32) void {
+    self.state.atlas.setDisplaySize(font_size);
+    // Force a relayout on the next hit test and a full redraw
+    self.state.layout_text_len = std.math.maxInt(usize);
+    self.state.needs_full_redraw = true;
+    self.state.frames.markDirty();
+}
+
 pub fn deinit(self: *Self) void {
+    if (self.canvas) |canvas| release(canvas);
     release(self.selection.pipeline_state);
     release(self.selection.vertex_buffer);
     release(self.cursor.pipeline_state);
@@ -608,8 +839,6 @@ pub fn deinit(self: *Self) void {
     release(self.glyph.vertex_buffer);
     release(self.command_queue);
     release(self.device);
-    if (self.state.layout_buf.len > 0) {
-        std.heap.page_allocator.free(self.state.layout_buf);
-    }
+    self.state.deinit();
     std.heap.page_allocator.destroy(self);
 }
@@ -0,0 +1,253 @@
+// Outline.zig - Headings and block start offsets of the open note
+//
+// Portable (std only). Built from the block tree right after `parseBlocks`,
+// while headings and paragraphs still carry their source lines, so every
+// block start is a plain byte offset into the note. Offsets are kept sorted,
+// which turns "jump to the next heading/block" into a binary search.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+const MdParser = @import("MdParser.zig");
+
+const Block = MdParser.Block;
+const BlockTypeTag = MdParser.BlockTypeTag;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const Entry = struct {
+    /// Byte offset of the block's first character
+    offset: usize,
+    block_type: BlockTypeTag,
+    /// 1-6 for headings, 0 for every other block
+    level: u8,
+    /// Heading text without the `#` markers; empty for other blocks
+    title: []const u8,
+};
+
+pub const Jump = enum { next_heading, prev_heading, next_block, prev_block };
+
+/// Every block that starts a line of its own, in document order
+entries: []const Entry = &.{},
+/// `entries[i].offset`, ascending
+block_offsets: []const usize = &.{},
+/// Offsets of the heading entries only, ascending
+heading_offsets: []const usize = &.{},
+
+const Outline = @This();
+
+// ============================================================================
+// Building
+// ============================================================================
+
+/// Outline of a tree from `parseBlocks` over `text`. Must run before
+/// `parseInline`, which moves heading and paragraph text into inline children.
+/// Everything is allocated from `allocator`; the editor passes its AST arena so
+/// the outline lives and dies with the tree it describes.
+pub fn build(allocator: Allocator, text: []const u8, root: *const Block) !Outline {
+    var builder = Builder{ .allocator = allocator, .text = text };
+    try builder.collect(root, null);
+
+    return fromEntries(allocator, builder.entries.items);
+}
+
+/// The outline after a region reparse: entries before `region.start` and
+/// from the region's end on are kept (moved to the new text), the region's
+/// come from `region_outline`, built over the region's blocks.
+pub fn splice(self: Outline, allocator: Allocator, region_outline: Outline, region: MdParser.Region, old_text: []const u8, text: []const u8) !Outline {
+    const region_old_end = region.oldEnd();
+
+    var entries = std.ArrayList(Entry).empty;
+    const head = lowerBound(self.block_offsets, region.start);
+    const tail = lowerBound(self.block_offsets, region_old_end);
+    try entries.ensureTotalCapacity(allocator, head + region_outline.entries.len + self.entries.len - tail);
+    for (self.entries[0..head]) |entry| {
+        var moved = entry;
+        moved.title = region.edit.rebase(entry.title, old_text, text.ptr);
+        entries.appendAssumeCapacity(moved);
+    }
+    entries.appendSliceAssumeCapacity(region_outline.entries);
+    for (self.entries[tail..]) |entry| {
+        var moved = entry;
+        moved.offset = @intCast(@as(isize, @intCast(entry.offset)) + region.edit.delta());
+        moved.title = region.edit.rebase(entry.title, old_text, text.ptr);
+        entries.appendAssumeCapacity(moved);
+    }
+    return fromEntries(allocator, entries.items);
+}
+
+fn fromEntries(allocator: Allocator, entries: []const Entry) !Outline {
+    const block_offsets = try allocator.alloc(usize, entries.len);
+    var heading_offsets = std.ArrayList(usize).empty;
+    for (entries, block_offsets) |entry, *offset| {
+        offset.* = entry.offset;
+        if (entry.level > 0) try heading_offsets.append(allocator, entry.offset);
+    }
+    return .{
+        .entries = entries,
+        .block_offsets = block_offsets,
+        .heading_offsets = heading_offsets.items,
+    };
+}
+
+const Builder = struct {
+    allocator: Allocator,
+    text: []const u8,
+    entries: std.ArrayList(Entry) = .empty,
+
+    /// A list item's paragraph starts where the item does; only the
+    /// outermost block at an offset gets an entry
+    fn collect(self: *Builder, parent: *const Block, parent_offset: ?usize) !void {
+        for (parent.children.items) |child| {
+            const start = self.startOffset(child) orelse continue;
+            switch (child.blockType) {
+                .Heading => |level| try self.entries.append(self.allocator, .{
+                    .offset = start,
+                    .block_type = .Heading,
+                    .level = level,
+                    .title = headingTitle(child.content orelse ""),
+                }),
+                .Paragraph, .CodeBlock, .BlockQuote, .OrderedListItem, .UnorderedListItem, .Frontmatter => {
+                    if (parent_offset == null or parent_offset.? != start) try self.entries.append(self.allocator, .{
+                        .offset = start,
+                        .block_type = child.blockType,
+                        .level = 0,
+                        .title = "",
+                    });
+                },
+                // Lists begin with their first item, which is recorded instead
+                .OrderedList, .UnorderedList => {},
+                .Document, .RawStr, .Strong, .Emphasis, .StrongEmph, .Link, .Image, .Embed => continue,
+            }
+            // Lines inside a code block are code, not blocks to jump between
+            if (child.blockType != .CodeBlock) try self.collect(child, start);
+        }
+    }
+
+    /// Offset of the first source line under `block`. Containers have no
+    /// content of their own, so it comes from their first descendant.
+    fn startOffset(self: *const Builder, block: *const Block) ?usize {
+        if (block.content) |content| {
+            const base = @intFromPtr(self.text.ptr);
+            const ptr = @intFromPtr(content.ptr);
+            // Embedded notes point into other buffers
+            if (ptr < base or ptr > base + self.text.len) return null;
+            return ptr - base;
+        }
+        for (block.children.items) |child| {
+            if (self.startOffset(child)) |offset| return offset;
+        }
+        return null;
+    }
+};
+
+/// "  ## Title ##" -> "Title"
+fn headingTitle(line: []const u8) []const u8 {
+    const after_marker = std.mem.trimLeft(u8, std.mem.trimLeft(u8, line, " \t>"), "#");
+    const title = std.mem.trim(u8, after_marker, " \t\r");
+    return std.mem.trimRight(u8, std.mem.trimRight(u8, title, "#"), " \t");
+}
+
+// ============================================================================
+// Navigation
+// ============================================================================
+
+/// Where `jump` lands from `offset`, or null if there is nothing in that
+/// direction. From inside a block, "previous" first returns to that block's
+/// start, as Option-Up does in text views.
+pub fn find(self: Outline, jump: Jump, offset: usize) ?usize {
+    return switch (jump) {
+        .next_heading => firstAfter(self.heading_offsets, offset),
+        .prev_heading => lastBefore(self.heading_offsets, offset),
+        .next_block => firstAfter(self.block_offsets, offset),
+        .prev_block => lastBefore(self.block_offsets, offset),
+    };
+}
+
+/// Index of the heading whose section contains `offset` (the last heading at
+/// or before it), for highlighting the outline; null above the first heading
+pub fn sectionAt(self: Outline, offset: usize) ?usize {
+    const count = upperBound(self.heading_offsets, offset);
+    if (count == 0) return null;
+    // Map back to the entry: headings appear in entries in the same order
+    const heading_offset = self.heading_offsets[count - 1];
+    return lowerBound(self.block_offsets, heading_offset);
+}
+
+fn firstAfter(offsets: []const usize, offset: usize) ?usize {
+    const i = upperBound(offsets, offset);
+    return if (i < offsets.len) offsets[i] else null;
+}
+
+fn lastBefore(offsets: []const usize, offset: usize) ?usize {
+    const i = lowerBound(offsets, offset);
+    return if (i > 0) offsets[i - 1] else null;
+}
+
+/// First index whose offset is >= `offset`
+fn lowerBound(offsets: []const usize, offset: usize) usize {
+    var low: usize = 0;
+    var high: usize = offsets.len;
+    while (low < high) {
+        const mid = low + (high - low) / 2;
+        if (offsets[mid] < offset) low = mid + 1 else high = mid;
+    }
+    return low;
+}
+
+/// First index whose offset is > `offset`
+fn upperBound(offsets: []const usize, offset: usize) usize {
+    var low: usize = 0;
+    var high: usize = offsets.len;
+    while (low < high) {
+        const mid = low + (high - low) / 2;
+        if (offsets[mid] <= offset) low = mid + 1 else high = mid;
+    }
+    return low;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "headings and block starts in document order" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const text = "---\ntags: [a]\n---\n# Title\n\nIntro line\n- one\n- two\n\n## Details ##\n> quoted\n";
+    const root = try MdParser.parseBlocks(allocator, text);
+    const outline = try build(allocator, text, root);
+
+    try std.testing.expectEqual(@as(usize, 2), outline.heading_offsets.len);
+    const title = outline.entries[1];
+    try std.testing.expectEqual(BlockTypeTag.Heading, title.block_type);
+    try std.testing.expectEqual(@as(u8, 1), title.level);
+    try std.testing.expectEqualStrings("Title", title.title);
+    try std.testing.expectEqualStrings("Details", outline.entries[outline.sectionAt(text.len).?].title);
+
+    // Items are recorded once, not again for the paragraph inside them
+    var items: usize = 0;
+    for (outline.entries, 0..) |entry, i| {
+        if (entry.block_type == .UnorderedListItem) items += 1;
+        if (i > 0) try std.testing.expect(entry.offset > outline.entries[i - 1].offset);
+    }
+    try std.testing.expectEqual(@as(usize, 2), items);
+    try std.testing.expectEqual(@as(usize, 0), outline.entries[0].offset);
+}
+
+test "jumps skip to the neighbouring start" {
+    const outline = Outline{
+        .block_offsets = &.{ 0, 10, 20, 30 },
+        .heading_offsets = &.{ 10, 30 },
+    };
+    try std.testing.expectEqual(@as(?usize, 30), outline.find(.next_heading, 10));
+    try std.testing.expectEqual(@as(?usize, 10), outline.find(.prev_heading, 25));
+    try std.testing.expectEqual(@as(?usize, null), outline.find(.prev_heading, 10));
+    try std.testing.expectEqual(@as(?usize, null), outline.find(.next_heading, 30));
+    try std.testing.expectEqual(@as(?usize, 20), outline.find(.next_block, 15));
+    try std.testing.expectEqual(@as(?usize, 10), outline.find(.prev_block, 20));
+    try std.testing.expectEqual(@as(?usize, null), outline.sectionAt(5));
+}
@@ -0,0 +1,517 @@
+// PropertyIndex.zig - Vault-wide columnar index of note metadata
+//
+// Portable (std only). Each indexed note is a row and each frontmatter key seen
+// anywhere in the vault is a column with one slot per row, so a filter such as
+// status = open scans one packed array instead of opening every file. Text is
+// dictionary-encoded per column: a filter looks its value up once and then
+// compares u32 codes. List items (tags, aliases) are codes in a side array
+// that the row's slot points into. Built-in columns hold each note's mtime,
+// word count and link count, and inline #tags are merged into `tags`.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+const Frontmatter = @import("Frontmatter.zig");
+
+const Self = @This();
+
+const MAX_NOTE_SIZE = 16 * 1024 * 1024;
+/// Frontmatter `tags` and inline #tags share this column
+pub const TAGS_KEY = "tags";
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const Kind = enum(u8) {
+    missing,
+    text,
+    number,
+    boolean,
+    date,
+    list,
+};
+
+/// One property across every row. All per-row arrays have the same length.
+pub const Column = struct {
+    kinds: std.ArrayList(Kind) = .empty,
+    /// text: dictionary code; list: index of the first item in `items`
+    codes: std.ArrayList(u32) = .empty,
+    /// list: item count; 0 otherwise
+    lens: std.ArrayList(u32) = .empty,
+    /// number; boolean as 0/1; date in days since 1970-01-01
+    numbers: std.ArrayList(f64) = .empty,
+    /// Dictionary codes of list items
+    items: std.ArrayList(u32) = .empty,
+    /// Distinct text values (and list items); a value's code is its index
+    strings: std.ArrayList([]const u8) = .empty,
+    codes_by_string: std.StringHashMapUnmanaged(u32) = .empty,
+
+    fn deinit(self: *Column, allocator: Allocator) void {
+        self.kinds.deinit(allocator);
+        self.codes.deinit(allocator);
+        self.lens.deinit(allocator);
+        self.numbers.deinit(allocator);
+        self.items.deinit(allocator);
+        self.strings.deinit(allocator);
+        self.codes_by_string.deinit(allocator);
+    }
+
+    /// Dictionary code of `text`, if any row of this column has it
+    pub fn code(self: *const Column, text: []const u8) ?u32 {
+        return self.codes_by_string.get(text);
+    }
+
+    pub fn listItems(self: *const Column, row: usize) []const u32 {
+        return self.items.items[self.codes.items[row]..][0..self.lens.items[row]];
+    }
+
+    fn grow(self: *Column, allocator: Allocator, rows: usize) !void {
+        const n = rows - self.kinds.items.len;
+        try self.kinds.appendNTimes(allocator, .missing, n);
+        try self.codes.appendNTimes(allocator, 0, n);
+        try self.lens.appendNTimes(allocator, 0, n);
+        try self.numbers.appendNTimes(allocator, 0, n);
+    }
+
+    fn intern(self: *Column, allocator: Allocator, arena: Allocator, text: []const u8) !u32 {
+        if (self.codes_by_string.get(text)) |existing| return existing;
+        const owned = try arena.dupe(u8, text);
+        const new_code: u32 = @intCast(self.strings.items.len);
+        try self.strings.append(allocator, owned);
+        errdefer _ = self.strings.pop();
+        try self.codes_by_string.put(allocator, owned, new_code);
+        return new_code;
+    }
+
+    fn set(self: *Column, allocator: Allocator, arena: Allocator, row: usize, value: Frontmatter.Value) !void {
+        switch (value) {
+            .text => |text| self.codes.items[row] = try self.intern(allocator, arena, text),
+            .number => |number| self.numbers.items[row] = number,
+            .boolean => |flag| self.numbers.items[row] = @floatFromInt(@intFromBool(flag)),
+            .date => |days| self.numbers.items[row] = @floatFromInt(days),
+            .list => |list| {
+                // Reuse the row's old item run when the new list fits in it
+                var start = self.codes.items[row];
+                if (list.len > self.lens.items[row]) {
+                    start = @intCast(self.items.items.len);
+                    try self.items.appendNTimes(allocator, 0, list.len);
+                }
+                for (list, 0..) |item, i| {
+                    self.items.items[start + i] = try self.intern(allocator, arena, item);
+                }
+                self.codes.items[row] = start;
+                self.lens.items[row] = @intCast(list.len);
+            },
+        }
+        if (value != .list) self.lens.items[row] = 0;
+        self.kinds.items[row] = std.meta.activeTag(value);
+    }
+};
+
+// ============================================================================
+// Struct Fields
+// ============================================================================
+
+allocator: Allocator,
+/// Property keys and dictionary strings; kept until deinit
+strings: std.heap.ArenaAllocator,
+/// Row -> note path; empty for rows freed by `remove`
+paths: std.ArrayList([]const u8) = .empty,
+rows_by_path: std.StringHashMapUnmanaged(u32) = .empty,
+free_rows: std.ArrayList(u32) = .empty,
+columns: std.StringArrayHashMapUnmanaged(Column) = .empty,
+/// Built-in columns; mtimes are seconds since the epoch
+mtimes: std.ArrayList(i64) = .empty,
+word_counts: std.ArrayList(u32) = .empty,
+link_counts: std.ArrayList(u32) = .empty,
+/// Whether each note ends inside fenced code, for `appendText`
+fence_open: std.ArrayList(bool) = .empty,
+
+pub fn init(allocator: Allocator) Self {
+    return .{ .allocator = allocator, .strings = .init(allocator) };
+}
+
+pub fn deinit(self: *Self) void {
+    for (self.paths.items) |note_path| self.allocator.free(note_path);
+    self.paths.deinit(self.allocator);
+    self.rows_by_path.deinit(self.allocator);
+    self.free_rows.deinit(self.allocator);
+    for (self.columns.values()) |*col| col.deinit(self.allocator);
+    self.columns.deinit(self.allocator);
+    self.mtimes.deinit(self.allocator);
+    self.word_counts.deinit(self.allocator);
+    self.link_counts.deinit(self.allocator);
+    self.fence_open.deinit(self.allocator);
+    self.strings.deinit();
+}
+
+// ============================================================================
+// Public Methods
+// ============================================================================
+
+/// (Re)index the note at `note_path` from its text; `mtime` is in seconds.
+pub fn update(self: *Self, note_path: []const u8, text: []const u8, mtime: i64) !void {
+    const span = Frontmatter.extract(text);
+    const properties: []const Frontmatter.Property = if (span) |s| try Frontmatter.parse(self.allocator, s.body) else &.{};
+    defer Frontmatter.free(self.allocator, properties);
+
+    var tags = std.ArrayList([]const u8).empty;
+    defer tags.deinit(self.allocator);
+    const stats = try scanBody(self.allocator, text[(if (span) |s| s.end else 0)..], false, &tags);
+
+    const row = try self.rowFor(note_path);
+    self.mtimes.items[row] = mtime;
+    self.word_counts.items[row] = stats.words;
+    self.link_counts.items[row] = stats.links;
+    self.fence_open.items[row] = stats.in_fence;
+    for (self.columns.values()) |*col| col.kinds.items[row] = .missing;
+    for (properties) |property| {
+        if (std.mem.eql(u8, property.key, TAGS_KEY)) {
+            switch (property.value) {
+                .list => |list| for (list) |tag| try appendTag(self.allocator, &tags, tag),
+                .text => |tag| try appendTag(self.allocator, &tags, tag),
+                else => {},
+            }
+            continue;
+        }
+        try self.setProperty(row, property.key, property.value);
+    }
+    if (tags.items.len > 0) try self.setProperty(row, TAGS_KEY, .{ .list = tags.items });
+}
+
+/// `text` was appended to the note at `note_path` right after `last_line`,
+/// the note's last line before (see QuickAppend.zig). Updates the row from
+/// those two alone instead of reading the note again; frontmatter cannot
+/// change, as an append lands after it. A tag the old end cut short ("#ho"
+/// then "me") stays listed until the note is indexed again. Returns false if
+/// the note has no row.
+pub fn appendText(self: *Self, note_path: []const u8, last_line: []const u8, text: []const u8, mtime: i64) !bool {
+    const row = self.rows_by_path.get(note_path) orelse return false;
+
+    var tags = std.ArrayList([]const u8).empty;
+    defer tags.deinit(self.allocator);
+    if (self.columns.getPtr(TAGS_KEY)) |col| {
+        if (col.kinds.items[row] == .list) {
+            for (col.listItems(row)) |item| try tags.append(self.allocator, col.strings.items[item]);
+        }
+    }
+    const known_tags = tags.items.len;
+
+    // A word, link or tag may straddle the old end of the note, so the last
+    // line is scanned again with the text and what it counted before is
+    // taken away
+    const joined = try std.mem.concat(self.allocator, u8, &.{ last_line, text });
+    defer self.allocator.free(joined);
+    const fence_open = self.fence_open.items[row];
+    const line_in_fence = if (isFence(last_line)) !fence_open else fence_open;
+    const before = try scanBody(self.allocator, last_line, line_in_fence, &tags);
+    const after = try scanBody(self.allocator, joined, line_in_fence, &tags);
+
+    self.mtimes.items[row] = mtime;
+    self.word_counts.items[row] += after.words - before.words;
+    self.link_counts.items[row] += after.links - before.links;
+    self.fence_open.items[row] = after.in_fence;
+    if (tags.items.len > known_tags) try self.setProperty(row, TAGS_KEY, .{ .list = tags.items });
+    return true;
+}
+
+pub fn remove(self: *Self, note_path: []const u8) void {
+    const removed = self.rows_by_path.fetchRemove(note_path) orelse return;
+    const row = removed.value;
+    for (self.columns.values()) |*col| col.kinds.items[row] = .missing;
+    self.allocator.free(self.paths.items[row]);
+    self.paths.items[row] = "";
+    // Keeping the row reserved is harmless if this fails
+    self.free_rows.append(self.allocator, row) catch {};
+}
+
+/// Index every .md file under `vault_root` (absolute). Returns the number of
+/// notes indexed.
+pub fn indexVault(self: *Self, vault_root: []const u8) !usize {
+    var vault = try std.fs.cwd().openDir(vault_root, .{ .iterate = true });
+    defer vault.close();
+    var walker = try vault.walk(self.allocator);
+    defer walker.deinit();
+
+    // One buffer reused for every note
+    var buffer = std.ArrayList(u8).empty;
+    defer buffer.deinit(self.allocator);
+
+    var count: usize = 0;
+    while (try walker.next()) |entry| {
+        if (entry.kind != .file or !std.mem.endsWith(u8, entry.basename, ".md")) continue;
+        const file = entry.dir.openFile(entry.basename, .{}) catch continue;
+        defer file.close();
+        const stat = file.stat() catch continue;
+        if (stat.size > MAX_NOTE_SIZE) continue;
+        try buffer.resize(self.allocator, @intCast(stat.size));
+        const n = file.readAll(buffer.items) catch continue;
+
+        const note_path = try std.fs.path.join(self.allocator, &.{ vault_root, entry.path });
+        defer self.allocator.free(note_path);
+        const mtime: i64 = @intCast(@divFloor(stat.mtime, std.time.ns_per_s));
+        try self.update(note_path, buffer.items[0..n], mtime);
+        count += 1;
+    }
+    return count;
+}
+
+pub fn column(self: *const Self, key: []const u8) ?*const Column {
+    return self.columns.getPtr(key);
+}
+
+pub fn rowCount(self: *const Self) usize {
+    return self.paths.items.len;
+}
+
+/// Note path of `row`; empty if the row is free
+pub fn path(self: *const Self, row: usize) []const u8 {
+    return self.paths.items[row];
+}
+
+/// Rows whose `key` equals `value`: the same text, a list containing it, or
+/// the same number, boolean or date once `value` is typed as a YAML scalar.
+pub fn findEquals(self: *const Self, allocator: Allocator, key: []const u8, value: []const u8) ![]u32 {
+    var rows = std.ArrayList(u32).empty;
+    errdefer rows.deinit(allocator);
+    const col = self.column(key) orelse return rows.toOwnedSlice(allocator);
+
+    const text_code = col.code(value);
+    const typed = typedScalar(value);
+
+    for (col.kinds.items, 0..) |kind, row| {
+        const hit = switch (kind) {
+            .missing => false,
+            .text => text_code != null and col.codes.items[row] == text_code.?,
+            .list => text_code != null and std.mem.indexOfScalar(u32, col.listItems(row), text_code.?) != null,
+            .number, .boolean, .date => kind == typed.kind and col.numbers.items[row] == typed.number,
+        };
+        if (hit) try rows.append(allocator, @intCast(row));
+    }
+    return rows.toOwnedSlice(allocator);
+}
+
+/// Rows that hold a note (rather than being free)
+pub fn isLive(self: *const Self, row: usize) bool {
+    return self.paths.items[row].len > 0;
+}
+
+// ============================================================================
+// Private Helpers
+// ============================================================================
+
+fn setProperty(self: *Self, row: u32, key: []const u8, value: Frontmatter.Value) !void {
+    const gop = try self.columns.getOrPut(self.allocator, key);
+    if (!gop.found_existing) {
+        gop.key_ptr.* = self.strings.allocator().dupe(u8, key) catch |err| {
+            self.columns.swapRemoveAt(gop.index);
+            return err;
+        };
+        gop.value_ptr.* = .{};
+        try gop.value_ptr.grow(self.allocator, self.paths.items.len);
+    }
+    try gop.value_ptr.set(self.allocator, self.strings.allocator(), row, value);
+}
+
+const BodyStats = struct {
+    words: u32 = 0,
+    links: u32 = 0,
+    /// Whether the body ends inside fenced code
+    in_fence: bool = false,
+};
+
+/// Count words and links in the note body and collect its #tags. Fenced code
+/// is skipped; `in_fence` says whether the body starts inside it.
+fn scanBody(allocator: Allocator, body: []const u8, in_fence: bool, tags: *std.ArrayList([]const u8)) !BodyStats {
+    var stats = BodyStats{ .in_fence = in_fence };
+    var lines = std.mem.splitScalar(u8, body, '\n');
+    while (lines.next()) |line| {
+        if (isFence(line)) {
+            stats.in_fence = !stats.in_fence;
+            continue;
+        }
+        if (stats.in_fence) continue;
+
+        stats.links += @intCast(std.mem.count(u8, line, "[[") + std.mem.count(u8, line, "]("));
+        var words = std.mem.tokenizeAny(u8, line, " \t\r");
+        while (words.next()) |word| {
+            if (word[0] == '#') {
+                const tag = tagName(word[1..]);
+                if (tag.len > 0) try appendTag(allocator, tags, tag);
+            }
+            for (word) |c| {
+                if (std.ascii.isAlphanumeric(c) or c >= 0x80) {
+                    stats.words += 1;
+                    break;
+                }
+            }
+        }
+    }
+    return stats;
+}
+
+fn isFence(line: []const u8) bool {
+    const trimmed = std.mem.trimLeft(u8, line, " \t");
+    return std.mem.startsWith(u8, trimmed, "```") or std.mem.startsWith(u8, trimmed, "~~~");
+}
+
+/// "project/alpha," -> "project/alpha"; empty if it is not a tag (#123, ##)
+fn tagName(text: []const u8) []const u8 {
+    var end: usize = 0;
+    var has_letter = false;
+    while (end < text.len) : (end += 1) {
+        const c = text[end];
+        if (std.ascii.isAlphabetic(c) or c == '_' or c == '-' or c == '/' or c >= 0x80) {
+            has_letter = true;
+        } else if (!std.ascii.isDigit(c)) break;
+    }
+    return if (has_letter) text[0..end] else "";
+}
+
+fn appendTag(allocator: Allocator, tags: *std.ArrayList([]const u8), raw: []const u8) !void {
+    const tag = if (std.mem.startsWith(u8, raw, "#")) raw[1..] else raw;
+    if (tag.len == 0) return;
+    for (tags.items) |existing| {
+        if (std.mem.eql(u8, existing, tag)) return;
+    }
+    try tags.append(allocator, tag);
+}
+
+const Typed = struct {
+    kind: Kind,
+    number: f64,
+};
+
+/// `value` typed as a scalar, in the form number, boolean and date slots hold
+fn typedScalar(value: []const u8) Typed {
+    const typed = Frontmatter.parseScalar(value) orelse return .{ .kind = .missing, .number = 0 };
+    return switch (typed) {
+        .number => |number| .{ .kind = .number, .number = number },
+        .boolean => |flag| .{ .kind = .boolean, .number = @floatFromInt(@intFromBool(flag)) },
+        .date => |days| .{ .kind = .date, .number = @floatFromInt(days) },
+        .text, .list => .{ .kind = .missing, .number = 0 },
+    };
+}
+
+fn rowFor(self: *Self, note_path: []const u8) !u32 {
+    if (self.rows_by_path.get(note_path)) |row| return row;
+
+    const owned = try self.allocator.dupe(u8, note_path);
+    errdefer self.allocator.free(owned);
+    const row: u32 = if (self.free_rows.pop()) |free_row| free_row else blk: {
+        try self.paths.append(self.allocator, "");
+        try self.mtimes.append(self.allocator, 0);
+        try self.word_counts.append(self.allocator, 0);
+        try self.link_counts.append(self.allocator, 0);
+        try self.fence_open.append(self.allocator, false);
+        for (self.columns.values()) |*col| try col.grow(self.allocator, self.paths.items.len);
+        break :blk @intCast(self.paths.items.len - 1);
+    };
+    try self.rows_by_path.put(self.allocator, owned, row);
+    self.paths.items[row] = owned;
+    return row;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "filters run over the columns and follow updates" {
+    const allocator = std.testing.allocator;
+    var index = Self.init(allocator);
+    defer index.deinit();
+
+    try index.update("/v/a.md", "---\nstatus: open\ntags: [work, \"#urgent\"]\npriority: 1\n---\nbody", 0);
+    try index.update("/v/b.md", "---\nstatus: done\ntags:\n  - work\ndue: 2024-03-09\n---\n", 0);
+    try index.update("/v/c.md", "---\nstatus: open\n---\n", 0);
+    try index.update("/v/d.md", "No frontmatter, but #work and [[a]]\n```\n#not-a-tag\n```\n# Heading #2", 0);
+
+    const open = try index.findEquals(allocator, "status", "open");
+    defer allocator.free(open);
+    try std.testing.expectEqual(@as(usize, 2), open.len);
+    try std.testing.expectEqualStrings("/v/a.md", index.path(open[0]));
+    try std.testing.expectEqualStrings("/v/c.md", index.path(open[1]));
+
+    const work = try index.findEquals(allocator, "tags", "work");
+    defer allocator.free(work);
+    try std.testing.expectEqualSlices(u32, &.{ 0, 1, 3 }, work);
+    try std.testing.expectEqual(@as(u32, 8), index.word_counts.items[3]);
+    try std.testing.expectEqual(@as(u32, 1), index.link_counts.items[3]);
+
+    const due = try index.findEquals(allocator, "due", "2024-03-09");
+    defer allocator.free(due);
+    try std.testing.expectEqualSlices(u32, &.{1}, due);
+    const priority = try index.findEquals(allocator, "priority", "1.0");
+    defer allocator.free(priority);
+    try std.testing.expectEqualSlices(u32, &.{0}, priority);
+
+    // a closes, c is deleted and its row is reused
+    try index.update("/v/a.md", "---\nstatus: done\n---\n", 1);
+    index.remove("/v/c.md");
+    try index.update("/v/e.md", "---\nstatus: open\n---\n", 2);
+    const still_open = try index.findEquals(allocator, "status", "open");
+    defer allocator.free(still_open);
+    try std.testing.expectEqualSlices(u32, &.{2}, still_open);
+    try std.testing.expectEqualStrings("/v/e.md", index.path(2));
+    try std.testing.expectEqual(@as(usize, 4), index.rowCount());
+
+    const urgent = try index.findEquals(allocator, "tags", "urgent");
+    defer allocator.free(urgent);
+    try std.testing.expectEqual(@as(usize, 0), urgent.len);
+}
+
+test "appends update a row like reindexing the whole note" {
+    const allocator = std.testing.allocator;
+    var index = Self.init(allocator);
+    defer index.deinit();
+    var reindexed = Self.init(allocator);
+    defer reindexed.deinit();
+
+    const start = "---\ntags: [log]\n---\n#work entry\n```\ncode #not";
+    const appends = [_][]const u8{ "\n```\nmore #ho", "me wor", "ds [", "[x]]\n```\n" };
+    try index.update("/v/log.md", start, 0);
+    var text = std.ArrayList(u8).empty;
+    defer text.deinit(allocator);
+    try text.appendSlice(allocator, start);
+    for (appends) |appended| {
+        const line_start = if (std.mem.lastIndexOfScalar(u8, text.items, '\n')) |i| i + 1 else 0;
+        try std.testing.expect(try index.appendText("/v/log.md", text.items[line_start..], appended, 1));
+        try text.appendSlice(allocator, appended);
+    }
+    try reindexed.update("/v/log.md", text.items, 1);
+
+    try std.testing.expectEqual(reindexed.word_counts.items[0], index.word_counts.items[0]);
+    try std.testing.expectEqual(reindexed.link_counts.items[0], index.link_counts.items[0]);
+    try std.testing.expectEqual(reindexed.fence_open.items[0], index.fence_open.items[0]);
+    try std.testing.expectEqual(@as(i64, 1), index.mtimes.items[0]);
+    for ([_][]const u8{ "log", "work", "home" }) |tag| {
+        const rows = try index.findEquals(allocator, "tags", tag);
+        defer allocator.free(rows);
+        try std.testing.expectEqualSlices(u32, &.{0}, rows);
+    }
+    try std.testing.expect(!try index.appendText("/v/other.md", "", "text", 1));
+}
+
+test "indexVault reads markdown files only" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{ .iterate = true });
+    defer tmp.cleanup();
+    const root = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(root);
+
+    try tmp.dir.makePath("projects");
+    try tmp.dir.writeFile(.{ .sub_path = "projects/plan.md", .data = "---\nstatus: open\n---\n# Plan" });
+    try tmp.dir.writeFile(.{ .sub_path = "plain.md", .data = "# No properties" });
+    try tmp.dir.writeFile(.{ .sub_path = "notes.txt", .data = "---\nstatus: open\n---\n" });
+
+    var index = Self.init(allocator);
+    defer index.deinit();
+    try std.testing.expectEqual(@as(usize, 2), try index.indexVault(root));
+
+    const open = try index.findEquals(allocator, "status", "open");
+    defer allocator.free(open);
+    try std.testing.expectEqual(@as(usize, 1), open.len);
+    try std.testing.expect(std.mem.endsWith(u8, index.path(open[0]), "projects/plan.md"));
+    try std.testing.expect(index.mtimes.items[open[0]] > 0);
+}
@@ -0,0 +1,184 @@
+// QuickAppend.zig - Append a capture to a note without opening a session
+//
+// Portable (std + posix flock). Running logs and journals get appended to
+// many times a day; a session would read, parse and lay out the whole note
+// and saving would rewrite it. `append` opens the file with O_APPEND, holds
+// an exclusive flock while it writes, and only reads the two ends of the
+// file: the head for a BOM and the tail for the line the capture continues,
+// which callers need to update their indexes without rereading the note.
+// Writers that skip the lock still cannot overwrite a capture (O_APPEND puts
+// every write at the end of the file), but their writes may interleave.
+//
+// A note without a BOM is UTF-8 or Latin-1 (see Encoding.zig). A caller with
+// the note open passes the encoding its session detected; otherwise a valid
+// UTF-8 tail is taken as UTF-8, so a capture never reads more of a bigger
+// note. A Latin-1 note whose tail happens to be ASCII is then written a UTF-8
+// capture and opens as Latin-1 with that capture's characters garbled, which
+// is the price of not reading the whole file. Line breaks in the capture are
+// written in the note's style (see LineEnding.zig), taken from the tail.
+
+const std = @import("std");
+const posix = std.posix;
+const Allocator = std.mem.Allocator;
+
+const Encoding = @import("Encoding.zig");
+const LineEnding = @import("LineEnding.zig");
+
+/// Bytes read back from the end of the file for the last line
+const TAIL_WINDOW = 4096;
+
+pub const Appended = struct {
+    kind: Encoding.Kind,
+    line_ending: LineEnding.Style,
+    /// The capture as written, in UTF-8 with the note's line breaks; allocated
+    text: []const u8,
+    /// The note held no text before the capture (it was created or empty)
+    was_empty: bool,
+    /// The last line before the capture as UTF-8, cut to its final
+    /// TAIL_WINDOW bytes if longer; allocated
+    last_line: []const u8,
+    /// mtime after the write, in seconds since the epoch
+    mtime: i64,
+
+    pub fn deinit(self: Appended, allocator: Allocator) void {
+        allocator.free(self.text);
+        allocator.free(self.last_line);
+    }
+};
+
+/// Append UTF-8 `text` to the note at absolute `path` in the note's encoding
+/// and line break style, creating the note if it does not exist. `known` is
+/// the note's encoding if an open session has detected it. Fails with
+/// Unencodable if the note is Latin-1 and `text` has characters Latin-1 lacks.
+pub fn append(allocator: Allocator, path: []const u8, text: []const u8, known: ?Encoding.Kind) !Appended {
+    if (!Encoding.isValidUtf8(text)) return error.InvalidUtf8;
+
+    const fd = try posix.open(path, .{ .ACCMODE = .RDWR, .APPEND = true, .CREAT = true, .CLOEXEC = true }, 0o644);
+    const file = std.fs.File{ .handle = fd };
+    defer file.close();
+    // Released when the file is closed
+    try posix.flock(fd, posix.LOCK.EX);
+
+    const size = (try file.stat()).size;
+    var head: [3]u8 = undefined;
+    const marked: ?Encoding.Kind = switch (Encoding.detect(head[0..try file.preadAll(&head, 0)])) {
+        .utf8_bom, .utf16le, .utf16be => |bom_kind| bom_kind,
+        .utf8, .latin1 => null,
+    };
+    const bom_len = if (marked) |bom_kind| bom_kind.bom().len else 0;
+
+    var window_start = @max(bom_len, size -| TAIL_WINDOW);
+    // Keep UTF-16 code units whole
+    if (marked != null and marked.? != .utf8_bom) window_start += (window_start - bom_len) % 2;
+    const window = try allocator.alloc(u8, @intCast(size - window_start));
+    defer allocator.free(window);
+    var tail = window[0..try file.preadAll(window, window_start)];
+    if (window_start > bom_len and (marked == null or marked.? == .utf8_bom)) {
+        // Skip the rest of a UTF-8 sequence the window cut into
+        while (tail.len > 0 and tail[0] & 0xC0 == 0x80) tail = tail[1..];
+    }
+    const kind = marked orelse unmarked: {
+        // A session's BOM kind is stale if the file has no BOM now
+        if (known) |session_kind| {
+            if (session_kind == .utf8 or session_kind == .latin1) break :unmarked session_kind;
+        }
+        break :unmarked if (Encoding.isValidUtf8(tail)) Encoding.Kind.utf8 else Encoding.Kind.latin1;
+    };
+
+    var decoded = std.ArrayList(u8).empty;
+    defer decoded.deinit(allocator);
+    var decoder = Encoding.Decoder.init(kind);
+    try decoder.feed(allocator, tail, &decoded);
+    try decoder.finish(allocator, &decoded);
+    const line_start = if (std.mem.lastIndexOfScalar(u8, decoded.items, '\n')) |i| i + 1 else 0;
+
+    // A tail without a break (a new note, or one long last line) gets LF
+    const line_ending = LineEnding.detect(decoded.items);
+    const written = try LineEnding.convert(allocator, text, line_ending);
+    errdefer allocator.free(written);
+    var encoded = std.ArrayList(u8).empty;
+    defer encoded.deinit(allocator);
+    try Encoding.encode(allocator, written, kind, &encoded);
+    try file.writeAll(encoded.items[kind.bom().len..]);
+
+    const last_line = try allocator.dupe(u8, decoded.items[line_start..]);
+    errdefer allocator.free(last_line);
+    return .{
+        .kind = kind,
+        .line_ending = line_ending,
+        .text = written,
+        .was_empty = size == bom_len,
+        .last_line = last_line,
+        .mtime = @intCast(@divFloor((try file.stat()).mtime, std.time.ns_per_s)),
+    };
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "captures keep the note's encoding and report the line they continue" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const root = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(root);
+
+    const log_path = try std.fs.path.join(allocator, &.{ root, "log.md" });
+    defer allocator.free(log_path);
+    const first = try append(allocator, log_path, "# Log\n- one", null);
+    defer first.deinit(allocator);
+    try std.testing.expect(first.was_empty);
+    const second = try append(allocator, log_path, " more\n- två\n", null);
+    defer second.deinit(allocator);
+    try std.testing.expect(!second.was_empty);
+    try std.testing.expectEqual(Encoding.Kind.utf8, second.kind);
+    try std.testing.expectEqualStrings("- one", second.last_line);
+    const log = try tmp.dir.readFileAlloc(allocator, "log.md", 1024);
+    defer allocator.free(log);
+    try std.testing.expectEqualStrings("# Log\n- one more\n- två\n", log);
+
+    try tmp.dir.writeFile(.{ .sub_path = "wide.md", .data = "\xFF\xFEa\x00\n\x00b\x00" });
+    const wide_path = try std.fs.path.join(allocator, &.{ root, "wide.md" });
+    defer allocator.free(wide_path);
+    const wide = try append(allocator, wide_path, "é", null);
+    defer wide.deinit(allocator);
+    try std.testing.expectEqual(Encoding.Kind.utf16le, wide.kind);
+    try std.testing.expectEqualStrings("b", wide.last_line);
+    const wide_bytes = try tmp.dir.readFileAlloc(allocator, "wide.md", 1024);
+    defer allocator.free(wide_bytes);
+    try std.testing.expectEqualSlices(u8, "\xFF\xFEa\x00\n\x00b\x00\xE9\x00", wide_bytes);
+
+    try tmp.dir.writeFile(.{ .sub_path = "old.md", .data = "caf\xE9" });
+    const old_path = try std.fs.path.join(allocator, &.{ root, "old.md" });
+    defer allocator.free(old_path);
+    const latin = try append(allocator, old_path, "ü", null);
+    defer latin.deinit(allocator);
+    try std.testing.expectEqual(Encoding.Kind.latin1, latin.kind);
+    try std.testing.expectEqualStrings("café", latin.last_line);
+    try std.testing.expectError(error.Unencodable, append(allocator, old_path, "€", null));
+
+    // An ASCII tail says nothing, so the session's encoding wins
+    var long_latin = [_]u8{'a'} ** (TAIL_WINDOW + 8);
+    long_latin[0] = 0xE9;
+    try tmp.dir.writeFile(.{ .sub_path = "long.md", .data = &long_latin });
+    const long_path = try std.fs.path.join(allocator, &.{ root, "long.md" });
+    defer allocator.free(long_path);
+    const guessed = try append(allocator, long_path, "", null);
+    defer guessed.deinit(allocator);
+    try std.testing.expectEqual(Encoding.Kind.utf8, guessed.kind);
+    const told = try append(allocator, long_path, "ü", .latin1);
+    defer told.deinit(allocator);
+    try std.testing.expectEqual(Encoding.Kind.latin1, told.kind);
+
+    try tmp.dir.writeFile(.{ .sub_path = "dos.md", .data = "# Journal\r\n- one\r\n" });
+    const dos_path = try std.fs.path.join(allocator, &.{ root, "dos.md" });
+    defer allocator.free(dos_path);
+    const dos = try append(allocator, dos_path, "- two\n- three\r\n", null);
+    defer dos.deinit(allocator);
+    try std.testing.expectEqual(LineEnding.Style.crlf, dos.line_ending);
+    try std.testing.expectEqualStrings("- two\r\n- three\r\n", dos.text);
+    const dos_bytes = try tmp.dir.readFileAlloc(allocator, "dos.md", 1024);
+    defer allocator.free(dos_bytes);
+    try std.testing.expectEqualStrings("# Journal\r\n- one\r\n- two\r\n- three\r\n", dos_bytes);
+}
@@ -1,9 +1,14 @@
 // Renderer.zig - Pure rendering logic (text layout, hit testing, scroll, vertex generation)
 //
-// No Metal/ObjC dependencies. Only imports std and CoreTextGlyphAtlas.
+// No Metal/ObjC/CoreText dependencies. Only imports std, GlyphAtlas, FrameScheduler,
+// Damage and VertexArena, so it builds and tests on any host.
 
 const std = @import("std");
-const CoreTextGlyphAtlas = @import("CoreTextGlyphAtlas.zig");
+const GlyphAtlas = @import("GlyphAtlas.zig");
+const FrameScheduler = @import("FrameScheduler.zig");
+const Damage = @import("Damage.zig");
+const LineEnding = @import("LineEnding.zig");
+const VertexArena = @import("VertexArena.zig");
 
 const Self = @This();
 
@@ -20,10 +25,7 @@ pub const CursorVertex = extern struct {
     position: [2]f32,
 };
 
-const SelectionRange = struct {
-    start: usize,
-    end: usize,
-};
+const SelectionRange = Damage.ByteRange;
 
 // ============================================================================
 // Constants
@@ -34,6 +36,11 @@ pub const VERTICES_PER_CHAR = 6;
 pub const CURSOR_WIDTH: f32 = 2.0;
 pub const CURSOR_VERTICES = 6;
 pub const MARGIN: f32 = 20.0;
+/// Size the SDF glyph atlas is rasterized at; other sizes rescale it.
+pub const ATLAS_REFERENCE_SIZE: f64 = 48.0;
+/// Paragraphs end at blank lines, or at the next newline once this long, so a
+/// long code block does not become one giant vertex chunk.
+pub const MAX_PARAGRAPH_BYTES = 2048;
 
 // ============================================================================
 // Theme Colors
@@ -110,18 +117,72 @@ pub const CursorInfo = struct {
     found: bool,
 };
 
+/// Drawn caret, in document space; compared frame to frame for damage.
+pub const CaretState = struct {
+    x: f32,
+    band: Damage.Band,
+};
+
+/// Run of hard lines whose glyph vertices are cached as one VertexArena chunk.
+pub const Paragraph = struct {
+    /// Layout entries (= bytes) [start, end)
+    start: usize,
+    end: usize,
+    /// Document-space extent; chunk vertices are stored relative to `top`
+    top: f32,
+    bottom: f32,
+};
+
 // ============================================================================
 // Struct Fields
 // ============================================================================
 
-atlas: CoreTextGlyphAtlas.GlyphAtlas,
-start_time: i128,
+atlas: GlyphAtlas.GlyphAtlas,
+frames: FrameScheduler,
 layout_buf: []CharPos,
 layout_result: LayoutResult,
 layout_text_len: usize,
 scroll_y: f32,
 last_view_height: f32,
 last_cursor_byte_offset: i32,
+/// Previous frame, kept to compute damage (text and layout only copied when changed)
+prev_text: []u8 = &.{},
+prev_text_len: usize = 0,
+prev_layout: []CharPos = &.{},
+prev_layout_result: LayoutResult = .{ .count = 0, .final_x = MARGIN, .final_baseline_y = MARGIN },
+prev_caret: ?CaretState = null,
+prev_selection: ?SelectionRange = null,
+prev_scroll_y: f32 = 0,
+prev_view_width: f32 = 0,
+prev_view_height: f32 = 0,
+/// Set when everything must be redrawn (first frame, new render target, zoom)
+needs_full_redraw: bool = true,
+/// Glyph vertices cached per paragraph; chunk i belongs to paragraphs[i]
+paragraphs: std.ArrayList(Paragraph) = .empty,
+paragraph_keys: std.ArrayList(u64) = .empty,
+glyph_chunks: VertexArena = .{},
+
+pub fn init(atlas: GlyphAtlas.GlyphAtlas) Self {
+    return .{
+        .atlas = atlas,
+        .frames = FrameScheduler.init(std.time.nanoTimestamp()),
+        .layout_buf = &.{},
+        .layout_result = .{ .count = 0, .final_x = MARGIN, .final_baseline_y = MARGIN },
+        .layout_text_len = 0,
+        .scroll_y = 0,
+        .last_view_height = 0,
+        .last_cursor_byte_offset = -1,
+    };
+}
+
+/// Frees layout and frame state; the atlas belongs to the caller.
+pub fn deinit(self: *Self) void {
+    self.freeFrameState();
+    if (self.layout_buf.len > 0) {
+        std.heap.page_allocator.free(self.layout_buf);
+    }
+    self.layout_buf = &.{};
+}
 
 pub fn ensureLayoutCapacity(self: *Self, needed: usize) bool {
     if (self.layout_buf.len >= needed) return true;
@@ -152,6 +213,14 @@ pub fn layoutText(self: *const Self, text: []const u8, view_width: f32, out: []C
 
     var i: usize = 0;
     while (i < text.len) {
+        // The CR of a CRLF break takes no space; the '\n' after it breaks
+        if (LineEnding.isBreakCr(text, i)) {
+            out[count] = .{ .x = cursor_x, .baseline_y = baseline_y, .advance = 0, .byte_index = i };
+            count += 1;
+            i += 1;
+            continue;
+        }
+
         if (text[i] == '\n') {
             out[count] = .{ .x = cursor_x, .baseline_y = baseline_y, .advance = 0, .byte_index = i };
             count += 1;
@@ -172,7 +241,7 @@ pub fn layoutText(self: *const Self, text: []const u8, view_width: f32, out: []C
 
         // Find word boundary
         const word_start = i;
-        while (i < text.len and text[i] != ' ' and text[i] != '\n') : (i += 1) {}
+        while (i < text.len and text[i] != ' ' and text[i] != '\n' and !LineEnding.isBreakCr(text, i)) : (i += 1) {}
         const word = text[word_start..i];
 
         // Measure word width
@@ -216,6 +285,7 @@ pub fn layoutText(self: *const Self, text: []const u8, view_width: f32, out: []C
 // ============================================================================
 
 pub fn updateScroll(self: *Self, delta_y: f32) void {
+    self.frames.markDirty();
     self.scroll_y += delta_y;
 
     // Clamp scroll_y: minimum 0, maximum so bottom of content aligns with bottom of view
@@ -235,23 +305,37 @@ pub fn buildGlyphVertices(
     text: []const u8,
     vertices: [*]GlyphVertex,
     max_vertices: usize,
+) usize {
+    const all = SelectionRange{ .start = 0, .end = self.layout_result.count };
+    return self.buildGlyphVerticesInRange(text, all, vertices, max_vertices);
+}
+
+/// Build glyph vertices for layout entries [range.start, range.end) only.
+pub fn buildGlyphVerticesInRange(
+    self: *const Self,
+    text: []const u8,
+    range: SelectionRange,
+    vertices: [*]GlyphVertex,
+    max_vertices: usize,
 ) usize {
     const aw: f32 = @floatFromInt(self.atlas.width);
     const ah: f32 = @floatFromInt(self.atlas.height);
-    const pad = CoreTextGlyphAtlas.GLYPH_PAD;
+    // Bitmap dimensions are in atlas texels; scale them to the display size
+    const scale = self.atlas.scale;
+    const pad = self.atlas.pad * scale;
     var vertex_count: usize = 0;
 
-    for (self.layout_buf[0..self.layout_result.count]) |cp| {
+    for (self.layout_buf[range.start..range.end]) |cp| {
         if (cp.byte_index >= text.len) break;
         const ch = text[cp.byte_index];
-        if (ch == '\n' or ch == ' ') continue;
+        if (ch == '\n' or ch == '\r' or ch == ' ') continue;
 
         const glyph = self.atlas.getGlyphInfo(@intCast(ch)) orelse continue;
         if (glyph.width == 0 or glyph.height == 0) continue;
         if (vertex_count + 6 > max_vertices) break;
 
-        const gw: f32 = @floatFromInt(glyph.width);
-        const gh: f32 = @floatFromInt(glyph.height);
+        const gw: f32 = @as(f32, @floatFromInt(glyph.width)) * scale;
+        const gh: f32 = @as(f32, @floatFromInt(glyph.height)) * scale;
 
         const quad_left = cp.x + glyph.bearing_x - pad;
         const quad_top = cp.baseline_y - glyph.bearing_y - gh + pad;
@@ -275,6 +359,83 @@ pub fn buildGlyphVertices(
     return vertex_count;
 }
 
+// ============================================================================
+// Paragraph Chunks
+// ============================================================================
+
+/// Split the current layout into paragraphs. A paragraph's key covers
+/// everything its vertices depend on: its bytes, the wrap width and the atlas
+/// scale. Its position is not part of the key since vertices are stored
+/// relative to the paragraph top.
+fn splitParagraphs(self: *Self, text: []const u8, view_width: f32) !void {
+    self.paragraphs.clearRetainingCapacity();
+    self.paragraph_keys.clearRetainingCapacity();
+
+    const count = @min(self.layout_result.count, text.len);
+    const seed = (@as(u64, @as(u32, @bitCast(view_width))) << 32) | @as(u32, @bitCast(self.atlas.scale));
+
+    var start: usize = 0;
+    var i: usize = 0;
+    while (i < count) : (i += 1) {
+        if (text[i] != '\n') continue;
+        const before_blank_line = LineEnding.breakLen(text[0..count], i + 1) > 0;
+        if (!before_blank_line and i + 1 - start < MAX_PARAGRAPH_BYTES) continue;
+        try self.appendParagraph(text, start, i + 1, seed);
+        start = i + 1;
+    }
+    if (start < count) try self.appendParagraph(text, start, count, seed);
+}
+
+fn appendParagraph(self: *Self, text: []const u8, start: usize, end: usize, seed: u64) !void {
+    const allocator = std.heap.page_allocator;
+    const top = self.layout_buf[start].baseline_y - self.atlas.ascent;
+    const bottom = self.layout_buf[end - 1].baseline_y - self.atlas.ascent + self.atlas.line_height;
+    try self.paragraphs.append(allocator, .{ .start = start, .end = end, .top = top, .bottom = bottom });
+    try self.paragraph_keys.append(allocator, std.hash.Wyhash.hash(seed, text[start..end]));
+}
+
+/// Bring the glyph chunks in `storage` up to date with the current layout.
+/// Paragraphs whose key is unchanged keep last frame's vertices (even if they
+/// moved); only new or edited paragraphs are rebuilt. Returns error.OutOfSpace
+/// when `storage` must grow or be compacted first; chunks rebuilt so far stay
+/// valid, so the caller can just retry.
+pub fn updateGlyphChunks(self: *Self, text: []const u8, view_width: f32, storage: [*]GlyphVertex) VertexArena.Error!void {
+    const allocator = std.heap.page_allocator;
+    try self.splitParagraphs(text, view_width);
+    try self.glyph_chunks.sync(allocator, self.paragraph_keys.items);
+
+    for (self.glyph_chunks.chunks.items, self.paragraphs.items, 0..) |chunk, para, i| {
+        if (!chunk.dirty) continue;
+        const max_vertices = (para.end - para.start) * VERTICES_PER_CHAR;
+        const offset = try self.glyph_chunks.reserve(allocator, i, max_vertices);
+        const count = self.buildGlyphVerticesInRange(text, .{ .start = para.start, .end = para.end }, storage + offset, max_vertices);
+        for (storage[offset .. offset + count]) |*v| {
+            v.position[1] -= para.top;
+        }
+        try self.glyph_chunks.commit(allocator, i, count);
+    }
+}
+
+/// Paragraphs intersecting the document-space band [top, bottom).
+pub fn paragraphRangeForBand(self: *const Self, band: Damage.Band) SelectionRange {
+    const paras = self.paragraphs.items;
+
+    var lo: usize = 0;
+    var hi: usize = paras.len;
+    while (lo < hi) {
+        const mid = lo + (hi - lo) / 2;
+        if (paras[mid].bottom <= band.top) lo = mid + 1 else hi = mid;
+    }
+    const start = lo;
+
+    hi = paras.len;
+    while (lo < hi) {
+        const mid = lo + (hi - lo) / 2;
+        if (paras[mid].top < band.bottom) lo = mid + 1 else hi = mid;
+    }
+    return .{ .start = start, .end = lo };
+}
+
 pub fn buildSelectionVertices(
     self: *const Self,
     text: []const u8,
@@ -282,17 +443,36 @@ pub fn buildSelectionVertices(
     max_vertices: usize,
     selection_start_byte_offset: i32,
     selection_end_byte_offset: i32,
+) usize {
+    const all = SelectionRange{ .start = 0, .end = self.layout_result.count };
+    return self.buildSelectionVerticesInRange(text, all, selection_verts, max_vertices, selection_start_byte_offset, selection_end_byte_offset);
+}
+
+/// Build selection vertices for layout entries [range.start, range.end) only.
+pub fn buildSelectionVerticesInRange(
+    self: *const Self,
+    text: []const u8,
+    range: SelectionRange,
+    selection_verts: [*]CursorVertex,
+    max_vertices: usize,
+    selection_start_byte_offset: i32,
+    selection_end_byte_offset: i32,
 ) usize {
     const selection = normalizedSelectionRange(selection_start_byte_offset, selection_end_byte_offset, text.len) orelse return 0;
     var vertex_count: usize = 0;
 
-    for (self.layout_buf[0..self.layout_result.count]) |cp| {
-        if (cp.byte_index >= text.len) break;
-        if (cp.byte_index < selection.start or cp.byte_index >= selection.end) continue;
+    // Layout has one entry per byte, so the selected entries are a contiguous slice
+    const first = @max(range.start, selection.start);
+    const last = @min(@min(range.end, selection.end), self.layout_result.count);
+    if (first >= last) return 0;
 
+    // One rectangle per visual line: extend the current span while the
+    // baseline stays the same, emit it when the line changes.
+    var span: ?SelectionSpan = null;
+    for (self.layout_buf[first..last]) |cp| {
+        if (cp.byte_index >= text.len) break;
         const ch = text[cp.byte_index];
-        if (ch == '\n') continue;
-        if (vertex_count + 6 > max_vertices) break;
+        if (ch == '\n' or ch == '\r') continue;
 
         var width = cp.advance;
         if (width <= 0) {
@@ -302,21 +482,56 @@ pub fn buildSelectionVertices(
         }
         if (width <= 0) continue;
 
-        const left = cp.x;
-        const right = cp.x + width;
-        const top = cp.baseline_y - self.atlas.ascent;
-        const bottom = top + self.atlas.line_height;
-
-        const pos = quadPositions(left, top, right, bottom);
-        for (0..6) |vi| {
-            selection_verts[vertex_count + vi] = .{ .position = pos[vi] };
+        if (span) |*current| {
+            if (current.baseline_y == cp.baseline_y) {
+                current.right = cp.x + width;
+                continue;
+            }
+            if (!self.appendSelectionSpan(current.*, selection_verts, &vertex_count, max_vertices)) return vertex_count;
         }
-        vertex_count += 6;
+        span = .{ .left = cp.x, .right = cp.x + width, .baseline_y = cp.baseline_y };
     }
 
+    if (span) |current| {
+        _ = self.appendSelectionSpan(current, selection_verts, &vertex_count, max_vertices);
+    }
     return vertex_count;
 }
 
+/// Selected part of one visual line.
+const SelectionSpan = struct {
+    left: f32,
+    right: f32,
+    baseline_y: f32,
+};
+
+fn appendSelectionSpan(
+    self: *const Self,
+    span: SelectionSpan,
+    selection_verts: [*]CursorVertex,
+    vertex_count: *usize,
+    max_vertices: usize,
+) bool {
+    if (vertex_count.* + 6 > max_vertices) return false;
+
+    const top = span.baseline_y - self.atlas.ascent;
+    const bottom = top + self.atlas.line_height;
+    const pos = quadPositions(span.left, top, span.right, bottom);
+    for (0..6) |vi| {
+        selection_verts[vertex_count.* + vi] = .{ .position = pos[vi] };
+    }
+    vertex_count.* += 6;
+    return true;
+}
+
+/// Number of visual lines in the current layout (selection needs one rect each).
+pub fn visualLineCount(self: *const Self) usize {
+    const first_baseline = MARGIN + self.atlas.ascent;
+    if (self.atlas.line_height <= 0) return 1;
+    const lines = (self.layout_result.final_baseline_y - first_baseline) / self.atlas.line_height;
+    return @as(usize, @intFromFloat(@max(@round(lines), 0))) + 1;
+}
+
 // ============================================================================
 // Cursor Resolution
 // ============================================================================
@@ -383,12 +598,205 @@ pub fn buildCursorVertices(self: *const Self, cursor_info: CursorInfo, cursor_ve
     }
 }
 
-/// Cursor blink opacity via sine wave.
+/// Cursor blink opacity. A two-phase blink (instead of a smooth fade) means an
+/// idle editor only needs a frame at each phase change.
 pub fn cursorOpacity(self: *const Self) f32 {
-    const now = std.time.nanoTimestamp();
-    const elapsed_ns = now - self.start_time;
-    const elapsed_s: f32 = @as(f32, @floatFromInt(@divTrunc(elapsed_ns, 1_000_000))) / 1000.0;
-    return 0.5 + 0.5 * @cos(elapsed_s * std.math.pi);
+    return if (self.frames.caretVisible(std.time.nanoTimestamp())) 1.0 else 0.0;
+}
+
+// ============================================================================
+// Damage Tracking
+// ============================================================================
+
+/// Where the caret was drawn this frame, or null when it was not drawn.
+pub fn caretState(self: *const Self, cursor_info: CursorInfo, drawn: bool) ?CaretState {
+    if (!drawn or !cursor_info.found) return null;
+    const top = cursor_info.y - self.atlas.ascent;
+    return .{ .x = cursor_info.x, .band = .{ .top = top, .bottom = top + self.atlas.line_height } };
+}
+
+/// Line band of `byte` in a layout. Layout has exactly one entry per text byte,
+/// so the entry index is the byte offset.
+fn lineBandIn(self: *const Self, layout: []const CharPos, result: LayoutResult, byte: usize) Damage.Band {
+    const baseline = if (byte < result.count) layout[byte].baseline_y else result.final_baseline_y;
+    const top = baseline - self.atlas.ascent;
+    return .{ .top = top, .bottom = top + self.atlas.line_height };
+}
+
+fn rangeBandIn(self: *const Self, layout: []const CharPos, result: LayoutResult, range: SelectionRange) Damage.Band {
+    const first = self.lineBandIn(layout, result, range.start);
+    const last = self.lineBandIn(layout, result, if (range.end > range.start) range.end - 1 else range.start);
+    return .{ .top = first.top, .bottom = last.bottom };
+}
+
+fn contentBottom(self: *const Self, result: LayoutResult) f32 {
+    return result.final_baseline_y - self.atlas.ascent + self.atlas.line_height;
+}
+
+/// Compare this frame against the previous one and return the screen-space
+/// line bands that need redrawing. Call after layout and auto-scroll.
+pub fn computeDamage(
+    self: *const Self,
+    text: []const u8,
+    view_width: f32,
+    view_height: f32,
+    caret: ?CaretState,
+    selection_start_byte_offset: i32,
+    selection_end_byte_offset: i32,
+) Damage.DamageList {
+    var damage = Damage.DamageList{};
+    if (self.needs_full_redraw or
+        self.scroll_y != self.prev_scroll_y or
+        view_width != self.prev_view_width or
+        view_height != self.prev_view_height)
+    {
+        damage.markFull();
+        return damage;
+    }
+
+    const new_layout = self.layout_buf[0..self.layout_result.count];
+    const old_layout = self.prev_layout[0..self.prev_layout_result.count];
+    const new_result = self.layout_result;
+    const old_result = self.prev_layout_result;
+    const old_text = self.prev_text[0..self.prev_text_len];
+    const selection = normalizedSelectionRange(selection_start_byte_offset, selection_end_byte_offset, text.len);
+
+    // Edits: from the edited line down to where the layouts line up again
+    const text_change = Damage.diffText(old_text, text);
+    if (text_change) |change| {
+        // Re-wrapping can move the edited word between lines; start one byte early
+        const from = if (change.start > 0) change.start - 1 else 0;
+        const top = @min(
+            self.lineBandIn(old_layout, old_result, from).top,
+            self.lineBandIn(new_layout, new_result, from).top,
+        );
+        var bottom = @max(self.contentBottom(old_result), self.contentBottom(new_result));
+
+        // Layout from a whitespace byte on depends only on its position, so the
+        // first whitespace byte of the common suffix at an unchanged position
+        // means everything after it is unchanged too.
+        var k: usize = 0;
+        while (change.new_end + k < new_layout.len and change.old_end + k < old_layout.len) : (k += 1) {
+            const ch = text[change.new_end + k];
+            if (ch != ' ' and ch != '\n') continue;
+            const a = old_layout[change.old_end + k];
+            const b = new_layout[change.new_end + k];
+            if (a.x == b.x and a.baseline_y == b.baseline_y) {
+                bottom = self.lineBandIn(new_layout, new_result, change.new_end + k).bottom;
+                break;
+            }
+        }
+        damage.add(.{ .top = top, .bottom = bottom });
+
+        // Selection bands may have moved with the text
+        if (self.prev_selection) |old_sel| damage.add(self.rangeBandIn(old_layout, old_result, old_sel));
+        if (selection) |new_sel| damage.add(self.rangeBandIn(new_layout, new_result, new_sel));
+    } else {
+        var changed: [2]SelectionRange = undefined;
+        const n = Damage.selectionChanges(self.prev_selection, selection, &changed);
+        for (changed[0..n]) |range| {
+            damage.add(self.rangeBandIn(new_layout, new_result, range));
+        }
+    }
+
+    // Caret moved, appeared or blinked off
+    const caret_changed = blk: {
+        const old = self.prev_caret orelse break :blk caret != null;
+        const new = caret orelse break :blk true;
+        break :blk old.x != new.x or old.band.top != new.band.top;
+    };
+    if (caret_changed or text_change != null) {
+        if (self.prev_caret) |old| damage.add(old.band);
+        if (caret) |new| damage.add(new.band);
+    }
+
+    // Document space -> screen space
+    for (damage.bands[0..damage.len]) |*band| {
+        band.top -= self.scroll_y;
+        band.bottom -= self.scroll_y;
+    }
+    damage.clip(.{ .top = 0, .bottom = view_height });
+    return damage;
+}
+
+/// Remember what was drawn this frame for the next damage computation.
+pub fn commitFrameState(
+    self: *Self,
+    text: []const u8,
+    view_width: f32,
+    view_height: f32,
+    caret: ?CaretState,
+    selection_start_byte_offset: i32,
+    selection_end_byte_offset: i32,
+) void {
+    const changed = self.needs_full_redraw or
+        view_width != self.prev_view_width or
+        !std.mem.eql(u8, self.prev_text[0..self.prev_text_len], text);
+
+    if (changed) {
+        const allocator = std.heap.page_allocator;
+        const count = self.layout_result.count;
+        if (self.prev_text.len < text.len or self.prev_layout.len < count) {
+            if (self.prev_text.len > 0) allocator.free(self.prev_text);
+            if (self.prev_layout.len > 0) allocator.free(self.prev_layout);
+            self.prev_text = &.{};
+            self.prev_layout = &.{};
+            self.prev_text_len = 0;
+            self.prev_layout_result.count = 0;
+
+            const cap = @max(self.layout_buf.len, text.len);
+            self.prev_text = allocator.alloc(u8, cap) catch return;
+            self.prev_layout = allocator.alloc(CharPos, cap) catch {
+                allocator.free(self.prev_text);
+                self.prev_text = &.{};
+                return;
+            };
+        }
+        @memcpy(self.prev_text[0..text.len], text);
+        @memcpy(self.prev_layout[0..count], self.layout_buf[0..count]);
+        self.prev_text_len = text.len;
+        self.prev_layout_result = self.layout_result;
+    }
+
+    self.prev_caret = caret;
+    self.prev_selection = normalizedSelectionRange(selection_start_byte_offset, selection_end_byte_offset, text.len);
+    self.prev_scroll_y = self.scroll_y;
+    self.prev_view_width = view_width;
+    self.prev_view_height = view_height;
+    self.needs_full_redraw = false;
+}
+
+/// Layout entries whose line intersects the document-space band [top, bottom).
+pub fn layoutRangeForBand(self: *const Self, band: Damage.Band) SelectionRange {
+    const entries = self.layout_buf[0..self.layout_result.count];
+    const ascent = self.atlas.ascent;
+    const line_height = self.atlas.line_height;
+
+    // Baselines are non-decreasing, so both ends can be binary searched
+    var lo: usize = 0;
+    var hi: usize = entries.len;
+    while (lo < hi) {
+        const mid = lo + (hi - lo) / 2;
+        if (entries[mid].baseline_y - ascent + line_height <= band.top) lo = mid + 1 else hi = mid;
+    }
+    const start = lo;
+
+    hi = entries.len;
+    while (lo < hi) {
+        const mid = lo + (hi - lo) / 2;
+        if (entries[mid].baseline_y - ascent < band.bottom) lo = mid + 1 else hi = mid;
+    }
+    return .{ .start = start, .end = lo };
+}
+
+pub fn freeFrameState(self: *Self) void {
+    if (self.prev_text.len > 0) std.heap.page_allocator.free(self.prev_text);
+    if (self.prev_layout.len > 0) std.heap.page_allocator.free(self.prev_layout);
+    self.prev_text = &.{};
+    self.prev_layout = &.{};
+    self.paragraphs.deinit(std.heap.page_allocator);
+    self.paragraph_keys.deinit(std.heap.page_allocator);
+    self.glyph_chunks.deinit(std.heap.page_allocator);
 }
 
 // ============================================================================
@@ -505,7 +913,100 @@ pub fn hitTest(self: *Self, text: []const u8, view_width: f32, click_x: f32, cli
     if (best_byte > text.len) best_byte = text.len;
 
     // Reset cursor blink timer so cursor is fully visible after click
-    self.start_time = std.time.nanoTimestamp();
+    self.frames.resetBlink(std.time.nanoTimestamp());
 
     return @intCast(best_byte);
 }
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+/// Synthetic 10px atlas: every glyph advances 6px, lines are 14px apart.
+fn testRenderer() Self {
+    return Self.init(GlyphAtlas.synthetic(10));
+}
+
+fn testLayout(self: *Self, text: []const u8, view_width: f32) !void {
+    if (!self.ensureLayoutCapacity(@max(text.len, 1))) return error.OutOfMemory;
+    self.layout_result = self.layoutText(text, view_width, self.layout_buf);
+    self.layout_text_len = text.len;
+}
+
+test "layoutText wraps words and hitTest finds them again" {
+    var r = testRenderer();
+    defer r.deinit();
+
+    // 72px between the margins: twelve glyphs per line, so "again" wraps
+    const text = "hello world again\nx";
+    const width = 2 * MARGIN + 72;
+    try testLayout(&r, text, width);
+    try std.testing.expectEqual(text.len, r.layout_result.count);
+
+    const first = r.layout_buf[0];
+    const again = r.layout_buf[12];
+    try std.testing.expectEqual(MARGIN, again.x);
+    try std.testing.expectApproxEqAbs(first.baseline_y + r.atlas.line_height, again.baseline_y, 0.001);
+    try std.testing.expectApproxEqAbs(first.baseline_y + 2 * r.atlas.line_height, r.layout_buf[18].baseline_y, 0.001);
+
+    for ([_]usize{ 0, 4, 6, 12, 18 }) |i| {
+        const cp = r.layout_buf[i];
+        const hit = r.hitTest(text, width, cp.x + 1, cp.baseline_y - 1);
+        try std.testing.expectEqual(@as(i32, @intCast(i)), hit);
+    }
+
+    // One selection rectangle per visual line
+    var verts: [64]CursorVertex = undefined;
+    const n = r.buildSelectionVertices(text, &verts, verts.len, 0, @intCast(text.len));
+    try std.testing.expectEqual(@as(usize, 3 * CURSOR_VERTICES), n);
+}
+
+test "CRLF breaks lay out like LF" {
+    var r = testRenderer();
+    defer r.deinit();
+
+    const width = 2 * MARGIN + 72;
+    try testLayout(&r, "ab\r\ncd", width);
+    const cr = r.layout_buf[2];
+    try std.testing.expectEqual(@as(f32, 0), cr.advance);
+    try std.testing.expectEqual(r.layout_buf[3].x, cr.x);
+    try std.testing.expectEqual(MARGIN, r.layout_buf[4].x);
+    try std.testing.expectApproxEqAbs(cr.baseline_y + r.atlas.line_height, r.layout_buf[4].baseline_y, 0.001);
+
+    // A CRLF blank line separates paragraphs
+    try testLayout(&r, "aaa\r\n\r\nbbb", width);
+    try r.splitParagraphs("aaa\r\n\r\nbbb", width);
+    try std.testing.expectEqual(@as(usize, 2), r.paragraphs.items.len);
+}
+
+test "glyph chunks keep unchanged paragraphs" {
+    var r = testRenderer();
+    defer r.deinit();
+    var storage: [1024]GlyphVertex = undefined;
+    try r.glyph_chunks.grow(std.heap.page_allocator, storage.len);
+
+    const width = 2 * MARGIN + 60;
+    try testLayout(&r, "aaa\n\nbbb\n\nccc", width);
+    try r.updateGlyphChunks("aaa\n\nbbb\n\nccc", width, &storage);
+    try std.testing.expectEqual(@as(usize, 3), r.paragraphs.items.len);
+
+    // Mark the cached vertices of "ccc" to see whether they get rebuilt
+    const ccc = r.glyph_chunks.chunks.items[2];
+    try std.testing.expectEqual(@as(usize, 3 * VERTICES_PER_CHAR), ccc.len);
+    storage[ccc.offset].texcoord = .{ -1, -1 };
+
+    // Edit "bbb" and insert a paragraph on top: "ccc" moves down but is reused
+    const edited = "zz\n\naaa\n\nbXb\n\nccc";
+    try testLayout(&r, edited, width);
+    try r.updateGlyphChunks(edited, width, &storage);
+    try std.testing.expectEqual(@as(usize, 4), r.paragraphs.items.len);
+
+    const moved = r.glyph_chunks.chunks.items[3];
+    try std.testing.expectEqual(ccc.offset, moved.offset);
+    try std.testing.expectEqual(@as(f32, -1), storage[moved.offset].texcoord[0]);
+
+    // Vertices are paragraph-relative, so the visible band picks the right chunk
+    const para = r.paragraphs.items[3];
+    const range = r.paragraphRangeForBand(.{ .top = para.top, .bottom = para.top + 1 });
+    try std.testing.expectEqual(SelectionRange{ .start = 3, .end = 4 }, range);
+}
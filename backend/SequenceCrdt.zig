@@ -0,0 +1,1032 @@
+// SequenceCrdt.zig - Mergeable edit history of one note
+//
+// Portable (std only). An RGA-style sequence CRDT over bytes: every inserted
+// byte gets an id (replica, counter) and is placed right after the byte it was
+// typed after (its origin). Concurrent inserts after the same origin are
+// ordered by (lamport, replica), later first; deletes leave tombstones. Two
+// machines editing a note each keep a log of the operations they applied, and
+// merging the other machine's log gives both the same text whichever way round
+// the logs are exchanged.
+//
+// Bytes typed one after another form a single run, both in the log and in the
+// sequence, so a long history stays compact. Runs live in a B-tree counted by
+// visible bytes, and ids map to their leaf through a treap, so integrating an
+// op costs O(log n) plus the skip over concurrent inserts at the same spot.
+//
+// Log file (little endian): "CRDTLOG1", base hash u64, op count u32, content
+// length u32, content bytes, then the ops (see `encode`).
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+const SequenceCrdt = @This();
+
+/// Ids of the text sync was enabled on. Every replica seeds the same base run
+/// from the saved file, so their histories share it.
+pub const BASE_REPLICA: u32 = 0;
+
+const LEAF_CAPACITY = 32;
+const NODE_CAPACITY = 16;
+const MAGIC = "CRDTLOG1";
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const Id = struct {
+    replica: u32,
+    counter: u32,
+
+    pub fn plus(self: Id, n: u32) Id {
+        return .{ .replica = self.replica, .counter = self.counter + n };
+    }
+
+    pub fn eql(self: Id, other: Id) bool {
+        return self.replica == other.replica and self.counter == other.counter;
+    }
+};
+
+pub const Op = struct {
+    /// Id of the first unit; the op covers counters [id.counter, id.counter + len)
+    id: Id,
+    len: u32,
+    kind: Kind,
+
+    pub const Kind = union(enum) {
+        insert: Insert,
+        /// Tombstone the bytes with ids [target, target + len)
+        delete: Id,
+    };
+
+    /// `len` bytes at `content` in the log's content, placed after `origin`
+    /// (null: start of the note). Byte i > 0 follows byte i - 1.
+    pub const Insert = struct {
+        origin: ?Id,
+        /// Of the first byte; byte i has lamport + i
+        lamport: u32,
+        content: u32,
+    };
+};
+
+/// Ops in the order one replica applied them. That order is causal, so any
+/// other replica can apply them front to back.
+pub const Log = struct {
+    base_hash: u64,
+    ops: []const Op,
+    content: []const u8,
+};
+
+pub const Error = error{
+    /// The logs started from different saved text
+    DifferentBase,
+    /// The log skips ops of a replica this one has not seen
+    MissingOps,
+    /// The log is cut short or references bytes it never inserted
+    CorruptLog,
+} || Allocator.Error;
+
+const Run = struct {
+    id: Id,
+    lamport: u32,
+    origin: ?Id,
+    /// Offset of the bytes in `content`
+    content: u32,
+    len: u32,
+    deleted: bool = false,
+
+    fn visible(self: Run) usize {
+        return if (self.deleted) 0 else self.len;
+    }
+
+    /// Bytes [at, len) as a run of their own
+    fn tail(self: Run, at: u32) Run {
+        return .{
+            .id = self.id.plus(at),
+            .lamport = self.lamport + at,
+            .origin = self.id.plus(at - 1),
+            .content = self.content + at,
+            .len = self.len - at,
+            .deleted = self.deleted,
+        };
+    }
+};
+
+const Leaf = struct {
+    runs: [LEAF_CAPACITY]Run = undefined,
+    count: u32 = 0,
+    parent: ?*Node = null,
+    next: ?*Leaf = null,
+
+    fn width(self: *const Leaf) usize {
+        var total: usize = 0;
+        for (self.runs[0..self.count]) |run| total += run.visible();
+        return total;
+    }
+};
+
+const Node = struct {
+    children: [NODE_CAPACITY]*anyopaque = undefined,
+    /// Visible bytes under each child
+    widths: [NODE_CAPACITY]usize = undefined,
+    count: u32 = 0,
+    parent: ?*Node = null,
+    leaf_children: bool,
+
+    fn width(self: *const Node) usize {
+        var total: usize = 0;
+        for (self.widths[0..self.count]) |w| total += w;
+        return total;
+    }
+
+    fn indexOf(self: *const Node, child: *const anyopaque) u32 {
+        for (self.children[0..self.count], 0..) |c, i| {
+            if (@intFromPtr(c) == @intFromPtr(child)) return @intCast(i);
+        }
+        unreachable;
+    }
+};
+
+/// A run in a leaf, or the gap before it when used as an insert position
+const Cursor = struct {
+    leaf: *Leaf,
+    index: u32,
+};
+
+/// Ids [id, id + len) live in runs of `leaf`
+const IndexKey = struct {
+    id: Id,
+    len: u32,
+    leaf: *Leaf,
+};
+
+const IdIndex = std.Treap(IndexKey, compareKeys);
+
+allocator: Allocator,
+/// Leaves, inner nodes and index entries. Nothing is freed before deinit,
+/// since deleted text stays behind as tombstones.
+arena: std.heap.ArenaAllocator,
+replica: u32,
+/// Highest lamport timestamp seen
+clock: u32 = 0,
+base_hash: u64,
+/// Next counter expected from each replica, this one included
+versions: std.AutoHashMapUnmanaged(u32, u32) = .empty,
+ops: std.ArrayList(Op) = .empty,
+/// Bytes of every insert, in log order
+content: std.ArrayList(u8) = .empty,
+root: *anyopaque,
+/// 0 while the root is a leaf
+height: u32 = 0,
+head: *Leaf,
+index: IdIndex = .{},
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+/// Start a history on `base`, the note as last saved. `replica` identifies
+/// this machine and must not be BASE_REPLICA.
+pub fn init(allocator: Allocator, replica: u32, base: []const u8) !SequenceCrdt {
+    std.debug.assert(replica != BASE_REPLICA);
+    var self = SequenceCrdt{
+        .allocator = allocator,
+        .arena = std.heap.ArenaAllocator.init(allocator),
+        .replica = replica,
+        .base_hash = std.hash.Wyhash.hash(0, base),
+        .root = undefined,
+        .head = undefined,
+    };
+    errdefer self.deinit();
+
+    const leaf = try self.arena.allocator().create(Leaf);
+    leaf.* = .{};
+    self.root = leaf;
+    self.head = leaf;
+
+    if (base.len > 0) {
+        try self.content.appendSlice(allocator, base);
+        try self.record(.{
+            .id = .{ .replica = BASE_REPLICA, .counter = 0 },
+            .len = @intCast(base.len),
+            .kind = .{ .insert = .{ .origin = null, .lamport = 0, .content = 0 } },
+        });
+    }
+    return self;
+}
+
+/// Pick up a history saved with `encode`, as replica `replica` again
+pub fn load(allocator: Allocator, replica: u32, saved: Log) Error!SequenceCrdt {
+    var self = try init(allocator, replica, "");
+    errdefer self.deinit();
+    self.base_hash = saved.base_hash;
+    _ = try self.merge(saved);
+    return self;
+}
+
+pub fn deinit(self: *SequenceCrdt) void {
+    self.versions.deinit(self.allocator);
+    self.ops.deinit(self.allocator);
+    self.content.deinit(self.allocator);
+    self.arena.deinit();
+}
+
+// ============================================================================
+// Local Edits
+// ============================================================================
+
+/// Record `bytes` typed at visible offset `pos`
+pub fn localInsert(self: *SequenceCrdt, pos: usize, bytes: []const u8) !void {
+    if (bytes.len == 0) return;
+    const content: u32 = @intCast(self.content.items.len);
+    try self.content.appendSlice(self.allocator, bytes);
+    try self.record(.{
+        .id = .{ .replica = self.replica, .counter = self.nextCounter(self.replica) },
+        .len = @intCast(bytes.len),
+        .kind = .{ .insert = .{ .origin = self.anchorAt(pos), .lamport = self.clock + 1, .content = content } },
+    });
+}
+
+/// Record the deletion of visible bytes [pos, pos + count)
+pub fn localDelete(self: *SequenceCrdt, pos: usize, count: usize) !void {
+    var remaining = count;
+    while (remaining > 0) {
+        // Deleted bytes vanish, so the next piece is at `pos` again
+        const at, const offset = self.findVisible(pos);
+        const run = at.leaf.runs[at.index];
+        const piece: u32 = @intCast(@min(run.len - offset, remaining));
+        try self.record(.{
+            .id = .{ .replica = self.replica, .counter = self.nextCounter(self.replica) },
+            .len = piece,
+            .kind = .{ .delete = run.id.plus(offset) },
+        });
+        remaining -= piece;
+    }
+}
+
+/// Id of the byte before visible offset `pos`, which stays put while text is
+/// merged in around it; null at the start
+pub fn anchorAt(self: *SequenceCrdt, pos: usize) ?Id {
+    if (pos == 0) return null;
+    const at, const offset = self.findVisible(pos - 1);
+    return at.leaf.runs[at.index].id.plus(offset);
+}
+
+/// Visible offset just after `anchor` (where it was, if it has since been
+/// deleted)
+pub fn offsetAfter(self: *SequenceCrdt, anchor: ?Id) usize {
+    const id = anchor orelse return 0;
+    const at, const offset = self.locate(id);
+    const run = at.leaf.runs[at.index];
+
+    var pos: usize = if (run.deleted) 0 else offset + 1;
+    for (at.leaf.runs[0..at.index]) |before| pos += before.visible();
+    var child: *anyopaque = at.leaf;
+    var parent = at.leaf.parent;
+    while (parent) |node| {
+        for (node.widths[0..node.indexOf(child)]) |w| pos += w;
+        child = node;
+        parent = node.parent;
+    }
+    return pos;
+}
+
+// ============================================================================
+// Merging
+// ============================================================================
+
+/// Apply the ops in another replica's log that this one has not seen yet.
+/// Returns the number of new units (bytes inserted or deleted). A log that
+/// fails to merge changes nothing.
+pub fn merge(self: *SequenceCrdt, other: Log) Error!usize {
+    if (other.base_hash != self.base_hash) return error.DifferentBase;
+    try self.checkLog(other);
+
+    var applied: usize = 0;
+    for (other.ops) |remote| {
+        const known = self.nextCounter(remote.id.replica);
+        if (remote.id.counter + remote.len <= known) continue;
+
+        // Logs overlap where both sides saw the same ops; drop the known prefix
+        const skip = known - remote.id.counter;
+        var op = Op{ .id = remote.id.plus(skip), .len = remote.len - skip, .kind = remote.kind };
+        switch (op.kind) {
+            .insert => |*insert| {
+                const start = remote.kind.insert.content + skip;
+                if (skip > 0) {
+                    insert.origin = remote.id.plus(skip - 1);
+                    insert.lamport += skip;
+                }
+                insert.content = @intCast(self.content.items.len);
+                try self.content.appendSlice(self.allocator, other.content[start..][0..op.len]);
+            },
+            .delete => |*target| target.* = target.plus(skip),
+        }
+        try self.record(op);
+        applied += op.len;
+    }
+    return applied;
+}
+
+/// Counters of one replica's inserts in a log being checked
+const Inserted = struct {
+    start: u32,
+    end: u32,
+};
+
+/// What `checkLog` knows of one replica part way through a log
+const CheckedReplica = struct {
+    next: u32,
+    /// Ranges the log's inserts add beyond what this replica holds, in order
+    inserts: std.ArrayList(Inserted) = .empty,
+};
+
+const CheckedReplicas = std.AutoHashMapUnmanaged(u32, CheckedReplica);
+
+/// Walk `other` as `merge` will without recording anything: every op must
+/// follow on from the ones before it, and every id an op references must be
+/// inserted here already or by an earlier op of the log
+fn checkLog(self: *SequenceCrdt, other: Log) Error!void {
+    var arena = std.heap.ArenaAllocator.init(self.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+    var replicas = CheckedReplicas.empty;
+
+    for (other.ops) |remote| {
+        if (std.math.maxInt(u32) - remote.id.counter < remote.len) return error.CorruptLog;
+        const gop = try replicas.getOrPut(allocator, remote.id.replica);
+        if (!gop.found_existing) gop.value_ptr.* = .{ .next = self.nextCounter(remote.id.replica) };
+        const known = gop.value_ptr.next;
+        const end = remote.id.counter + remote.len;
+        if (end <= known) continue;
+        if (remote.id.counter > known) return error.MissingOps;
+
+        switch (remote.kind) {
+            .insert => |insert| {
+                if (@as(usize, insert.content) + remote.len > other.content.len) return error.CorruptLog;
+                // Past the known prefix the origin is the op's own byte before
+                if (known == remote.id.counter) {
+                    if (insert.origin) |origin| {
+                        if (!self.isInserted(&replicas, origin, 1)) return error.CorruptLog;
+                    }
+                }
+                const inserts = &gop.value_ptr.inserts;
+                if (inserts.items.len > 0 and inserts.items[inserts.items.len - 1].end == known) {
+                    inserts.items[inserts.items.len - 1].end = end;
+                } else {
+                    try inserts.append(allocator, .{ .start = known, .end = end });
+                }
+            },
+            .delete => |target| if (!self.isInserted(&replicas, target, remote.len)) return error.CorruptLog,
+        }
+        gop.value_ptr.next = end;
+    }
+}
+
+/// Whether bytes [id, id + count) are held here or inserted by the part of
+/// the log `checkLog` has accepted so far
+fn isInserted(self: *SequenceCrdt, replicas: *const CheckedReplicas, id: Id, count: u32) bool {
+    if (std.math.maxInt(u32) - id.counter < count) return false;
+    const end = id.counter + count;
+    const held = self.nextCounter(id.replica);
+    if (id.counter < held and !self.holdsUnits(id, @min(end, held) - id.counter)) return false;
+    if (end <= held) return true;
+
+    const inserts = (replicas.get(id.replica) orelse return false).inserts.items;
+    var at = @max(id.counter, held);
+    const first = std.sort.partitionPoint(Inserted, inserts, at, struct {
+        fn before(counter: u32, range: Inserted) bool {
+            return range.end <= counter;
+        }
+    }.before);
+    for (inserts[first..]) |range| {
+        if (range.start > at) return false;
+        at = range.end;
+        if (at >= end) return true;
+    }
+    return false;
+}
+
+/// This replica's log: every op it applied, local or merged
+pub fn log(self: *const SequenceCrdt) Log {
+    return .{ .base_hash = self.base_hash, .ops = self.ops.items, .content = self.content.items };
+}
+
+/// Serialize `log()` for writing to the sync folder
+pub fn encode(self: *const SequenceCrdt, allocator: Allocator) ![]u8 {
+    var out = std.ArrayList(u8).empty;
+    errdefer out.deinit(allocator);
+
+    try out.appendSlice(allocator, MAGIC);
+    try putInt(&out, allocator, u64, self.base_hash);
+    try putInt(&out, allocator, u32, @intCast(self.ops.items.len));
+    try putInt(&out, allocator, u32, @intCast(self.content.items.len));
+    try out.appendSlice(allocator, self.content.items);
+
+    for (self.ops.items) |op| {
+        try out.append(allocator, @intFromEnum(op.kind));
+        try putId(&out, allocator, op.id);
+        try putInt(&out, allocator, u32, op.len);
+        switch (op.kind) {
+            .insert => |insert| {
+                try putInt(&out, allocator, u32, insert.lamport);
+                try putInt(&out, allocator, u32, insert.content);
+                try out.append(allocator, @intFromBool(insert.origin != null));
+                try putId(&out, allocator, insert.origin orelse .{ .replica = 0, .counter = 0 });
+            },
+            .delete => |target| try putId(&out, allocator, target),
+        }
+    }
+    return out.toOwnedSlice(allocator);
+}
+
+/// Read a log written by `encode`. `content` points into `bytes`; free the
+/// ops with `freeLog`.
+pub fn decode(allocator: Allocator, bytes: []const u8) Error!Log {
+    var reader = Reader{ .bytes = bytes };
+    if (!std.mem.eql(u8, try reader.take(MAGIC.len), MAGIC)) return error.CorruptLog;
+    const base_hash = try reader.int(u64);
+    const op_count = try reader.int(u32);
+    const content = try reader.take(try reader.int(u32));
+
+    // Each op is at least 21 bytes; bound the allocation by what is there
+    if (op_count > (bytes.len - reader.pos) / 21) return error.CorruptLog;
+    const ops = try allocator.alloc(Op, op_count);
+    errdefer allocator.free(ops);
+
+    const Tag = std.meta.Tag(Op.Kind);
+
+    for (ops) |*op| {
+        const tag = (try reader.take(1))[0];
+        const id = try reader.id();
+        const count = try reader.int(u32);
+        op.* = switch (tag) {
+            @intFromEnum(Tag.insert) => blk: {
+                const lamport = try reader.int(u32);
+                const offset = try reader.int(u32);
+                const has_origin = (try reader.take(1))[0] != 0;
+                const origin = try reader.id();
+                if (@as(u64, offset) + count > content.len) return error.CorruptLog;
+                break :blk .{ .id = id, .len = count, .kind = .{ .insert = .{
+                    .origin = if (has_origin) origin else null,
+                    .lamport = lamport,
+                    .content = offset,
+                } } };
+            },
+            @intFromEnum(Tag.delete) => .{ .id = id, .len = count, .kind = .{ .delete = try reader.id() } },
+            else => return error.CorruptLog,
+        };
+        if (count == 0) return error.CorruptLog;
+    }
+    return .{ .base_hash = base_hash, .ops = ops, .content = content };
+}
+
+pub fn freeLog(allocator: Allocator, decoded: Log) void {
+    allocator.free(decoded.ops);
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+/// Visible text, in sequence order
+pub fn text(self: *const SequenceCrdt, allocator: Allocator) ![]u8 {
+    var out = try std.ArrayList(u8).initCapacity(allocator, self.len());
+    errdefer out.deinit(allocator);
+    var leaf: ?*Leaf = self.head;
+    while (leaf) |l| : (leaf = l.next) {
+        for (l.runs[0..l.count]) |run| {
+            if (!run.deleted) out.appendSliceAssumeCapacity(self.content.items[run.content..][0..run.len]);
+        }
+    }
+    return out.toOwnedSlice(allocator);
+}
+
+/// Visible length in bytes
+pub fn len(self: *const SequenceCrdt) usize {
+    if (self.height == 0) return asLeaf(self.root).width();
+    return asNode(self.root).width();
+}
+
+// ============================================================================
+// Integration
+// ============================================================================
+
+fn nextCounter(self: *const SequenceCrdt, replica: u32) u32 {
+    return self.versions.get(replica) orelse 0;
+}
+
+fn record(self: *SequenceCrdt, op: Op) !void {
+    switch (op.kind) {
+        .insert => |insert| try self.integrateInsert(op.id, op.len, insert),
+        .delete => |target| try self.integrateDelete(target, op.len),
+    }
+    try self.appendOp(op);
+    try self.versions.put(self.allocator, op.id.replica, op.id.counter + op.len);
+}
+
+fn integrateInsert(self: *SequenceCrdt, id: Id, count: u32, insert: Op.Insert) !void {
+    var cursor = Cursor{ .leaf = self.head, .index = 0 };
+    if (insert.origin) |origin| {
+        const at, const offset = self.locate(origin);
+        cursor = try self.splitRun(at, offset + 1);
+    }
+
+    // Concurrent inserts after the same origin with a later (lamport,
+    // replica) go first, along with everything typed after them
+    while (true) {
+        if (cursor.index == cursor.leaf.count) {
+            cursor = .{ .leaf = cursor.leaf.next orelse break, .index = 0 };
+            continue;
+        }
+        const run = cursor.leaf.runs[cursor.index];
+        const later = run.lamport > insert.lamport or
+            (run.lamport == insert.lamport and run.id.replica > id.replica);
+        if (!later) break;
+        cursor.index += 1;
+    }
+    self.clock = @max(self.clock, insert.lamport + count - 1);
+
+    // Typing extends the run it continues
+    if (cursor.index > 0) {
+        const prev = &cursor.leaf.runs[cursor.index - 1];
+        if (prev.id.replica == id.replica and prev.id.counter + prev.len == id.counter and
+            prev.lamport + prev.len == insert.lamport and prev.content + prev.len == insert.content and
+            !prev.deleted and insert.origin != null and insert.origin.?.eql(prev.id.plus(prev.len - 1)))
+        {
+            prev.len += count;
+            const entry = self.indexFloor(.{ .replica = id.replica, .counter = id.counter - 1 });
+            if (entry.key.leaf == cursor.leaf and entry.key.id.replica == id.replica and
+                entry.key.id.counter + entry.key.len == id.counter)
+            {
+                entry.key.len += count;
+            } else {
+                _ = try self.addIndex(.{ .id = id, .len = count, .leaf = cursor.leaf });
+            }
+            propagate(cursor.leaf);
+            return;
+        }
+    }
+
+    cursor = try self.reserve(cursor, 1);
+    insertRuns(cursor.leaf, cursor.index, &.{.{
+        .id = id,
+        .lamport = insert.lamport,
+        .origin = insert.origin,
+        .content = insert.content,
+        .len = count,
+    }});
+    _ = try self.addIndex(.{ .id = id, .len = count, .leaf = cursor.leaf });
+    propagate(cursor.leaf);
+}
+
+fn integrateDelete(self: *SequenceCrdt, target: Id, count: u32) !void {
+    var done: u32 = 0;
+    while (done < count) {
+        const at, const offset = self.locate(target.plus(done));
+        const start = try self.splitRun(at, offset);
+        const piece = @min(start.leaf.runs[start.index].len, count - done);
+        // The piece ends up just before the returned cursor, in its leaf
+        const after = try self.splitRun(start, piece);
+        after.leaf.runs[after.index - 1].deleted = true;
+        propagate(after.leaf);
+        done += piece;
+    }
+}
+
+fn appendOp(self: *SequenceCrdt, op: Op) !void {
+    if (self.ops.items.len > 0) {
+        const last = &self.ops.items[self.ops.items.len - 1];
+        if (last.id.replica == op.id.replica and last.id.counter + last.len == op.id.counter) {
+            switch (last.kind) {
+                .insert => |insert| if (op.kind == .insert) {
+                    const next = op.kind.insert;
+                    if (next.origin != null and next.origin.?.eql(last.id.plus(last.len - 1)) and
+                        next.lamport == insert.lamport + last.len and next.content == insert.content + last.len)
+                    {
+                        last.len += op.len;
+                        return;
+                    }
+                },
+                // Forward delete extends the range. Backspace is not merged:
+                // unit i of an op must keep deleting target + i, or a peer
+                // that has a prefix of the op would skip the wrong bytes.
+                .delete => |target| if (op.kind == .delete and op.kind.delete.eql(target.plus(last.len))) {
+                    last.len += op.len;
+                    return;
+                },
+            }
+        }
+    }
+    try self.ops.append(self.allocator, op);
+}
+
+// ============================================================================
+// B-tree
+// ============================================================================
+
+fn asLeaf(ptr: *anyopaque) *Leaf {
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn asNode(ptr: *anyopaque) *Node {
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn parentOf(ptr: *anyopaque, leaf: bool) ?*Node {
+    return if (leaf) asLeaf(ptr).parent else asNode(ptr).parent;
+}
+
+fn setParent(ptr: *anyopaque, leaf: bool, parent: *Node) void {
+    if (leaf) asLeaf(ptr).parent = parent else asNode(ptr).parent = parent;
+}
+
+fn widthOf(ptr: *anyopaque, leaf: bool) usize {
+    return if (leaf) asLeaf(ptr).width() else asNode(ptr).width();
+}
+
+/// The run holding visible byte `pos`, and the offset of the byte in it
+fn findVisible(self: *SequenceCrdt, pos: usize) struct { Cursor, u32 } {
+    var remaining = pos;
+    var ptr = self.root;
+    var level = self.height;
+    while (level > 0) : (level -= 1) {
+        const node = asNode(ptr);
+        var i: u32 = 0;
+        while (i + 1 < node.count and remaining >= node.widths[i]) : (i += 1) remaining -= node.widths[i];
+        ptr = node.children[i];
+    }
+    const leaf = asLeaf(ptr);
+    for (leaf.runs[0..leaf.count], 0..) |run, i| {
+        if (remaining < run.visible()) return .{ .{ .leaf = leaf, .index = @intCast(i) }, @intCast(remaining) };
+        remaining -= run.visible();
+    }
+    unreachable; // pos is past the end of the text
+}
+
+/// The run holding byte `id`, and the offset of the byte in it
+fn locate(self: *SequenceCrdt, id: Id) struct { Cursor, u32 } {
+    const leaf = self.indexFloor(id).key.leaf;
+    for (leaf.runs[0..leaf.count], 0..) |run, i| {
+        if (run.id.replica == id.replica and id.counter >= run.id.counter and id.counter < run.id.counter + run.len) {
+            return .{ .{ .leaf = leaf, .index = @intCast(i) }, id.counter - run.id.counter };
+        }
+    }
+    unreachable; // merge only records ops whose ids are integrated
+}
+
+/// Whether bytes with ids [id, id + count) have all been inserted
+fn holdsUnits(self: *SequenceCrdt, id: Id, count: u32) bool {
+    if (std.math.maxInt(u32) - id.counter < count) return false;
+    var done: u32 = 0;
+    while (done < count) {
+        const start = id.plus(done);
+        const key = (self.findFloor(start) orelse return false).key;
+        if (key.id.replica != id.replica or key.id.counter + key.len <= start.counter) return false;
+        done += key.id.counter + key.len - start.counter;
+    }
+    return true;
+}
+
+/// Cut the run at `cursor` so a run starts `at` bytes into it; returns the
+/// position of that boundary
+fn splitRun(self: *SequenceCrdt, cursor: Cursor, at: u32) !Cursor {
+    if (at == 0) return cursor;
+    if (at >= cursor.leaf.runs[cursor.index].len) return .{ .leaf = cursor.leaf, .index = cursor.index + 1 };
+
+    const c = try self.reserve(cursor, 1);
+    const run = &c.leaf.runs[c.index];
+    const rest = run.tail(at);
+    run.len = at;
+    insertRuns(c.leaf, c.index + 1, &.{rest});
+    return .{ .leaf = c.leaf, .index = c.index + 1 };
+}
+
+fn insertRuns(leaf: *Leaf, index: u32, runs: []const Run) void {
+    const n: u32 = @intCast(runs.len);
+    std.mem.copyBackwards(Run, leaf.runs[index + n .. leaf.count + n], leaf.runs[index..leaf.count]);
+    @memcpy(leaf.runs[index..][0..n], runs);
+    leaf.count += n;
+}
+
+/// Make room for `extra` runs at `cursor`, splitting its leaf if needed.
+/// Returns the same position, possibly in the new right-hand leaf.
+fn reserve(self: *SequenceCrdt, cursor: Cursor, extra: u32) !Cursor {
+    const leaf = cursor.leaf;
+    if (leaf.count + extra <= LEAF_CAPACITY) return cursor;
+
+    const right = try self.arena.allocator().create(Leaf);
+    right.* = .{ .next = leaf.next };
+    const keep = leaf.count / 2;
+    const moved = leaf.count - keep;
+    @memcpy(right.runs[0..moved], leaf.runs[keep..leaf.count]);
+    right.count = moved;
+    leaf.count = keep;
+    leaf.next = right;
+    for (right.runs[0..moved]) |run| try self.moveIndex(run.id, run.len, right);
+    try self.insertChild(leaf, right, true);
+
+    if (cursor.index >= keep) return .{ .leaf = right, .index = cursor.index - keep };
+    return cursor;
+}
+
+/// Put `right` after its new sibling `left` in their parent, growing the tree
+/// at the root and splitting full nodes on the way up
+fn insertChild(self: *SequenceCrdt, left: *anyopaque, right: *anyopaque, leaves: bool) !void {
+    const parent = parentOf(left, leaves) orelse {
+        const root = try self.arena.allocator().create(Node);
+        root.* = .{ .leaf_children = leaves, .count = 2 };
+        root.children[0] = left;
+        root.children[1] = right;
+        root.widths[0] = widthOf(left, leaves);
+        root.widths[1] = widthOf(right, leaves);
+        setParent(left, leaves, root);
+        setParent(right, leaves, root);
+        self.root = root;
+        self.height += 1;
+        return;
+    };
+
+    const i = parent.indexOf(left);
+    const n = parent.count;
+    std.mem.copyBackwards(*anyopaque, parent.children[i + 2 .. n + 1], parent.children[i + 1 .. n]);
+    std.mem.copyBackwards(usize, parent.widths[i + 2 .. n + 1], parent.widths[i + 1 .. n]);
+    parent.children[i + 1] = right;
+    parent.widths[i] = widthOf(left, leaves);
+    parent.widths[i + 1] = widthOf(right, leaves);
+    parent.count += 1;
+    setParent(right, leaves, parent);
+
+    if (parent.count < NODE_CAPACITY) return;
+    const sibling = try self.arena.allocator().create(Node);
+    sibling.* = .{ .leaf_children = leaves };
+    const keep = parent.count / 2;
+    const moved = parent.count - keep;
+    @memcpy(sibling.children[0..moved], parent.children[keep..parent.count]);
+    @memcpy(sibling.widths[0..moved], parent.widths[keep..parent.count]);
+    sibling.count = moved;
+    parent.count = keep;
+    for (sibling.children[0..moved]) |child| setParent(child, leaves, sibling);
+    try self.insertChild(parent, sibling, false);
+}
+
+/// Refresh the visible widths on the path from `leaf` to the root
+fn propagate(leaf: *Leaf) void {
+    var child: *anyopaque = leaf;
+    var w = leaf.width();
+    var parent = leaf.parent;
+    while (parent) |node| {
+        node.widths[node.indexOf(child)] = w;
+        w = node.width();
+        child = node;
+        parent = node.parent;
+    }
+}
+
+// ============================================================================
+// Id Index
+// ============================================================================
+
+fn compareIds(a: Id, b: Id) std.math.Order {
+    if (a.replica != b.replica) return std.math.order(a.replica, b.replica);
+    return std.math.order(a.counter, b.counter);
+}
+
+fn compareKeys(a: IndexKey, b: IndexKey) std.math.Order {
+    return compareIds(a.id, b.id);
+}
+
+/// The entry with the greatest id <= `id`, which covers it
+fn indexFloor(self: *SequenceCrdt, id: Id) *IdIndex.Node {
+    return self.findFloor(id).?;
+}
+
+/// The entry with the greatest id <= `id`, if any; it covers `id` only if
+/// `id` was inserted
+fn findFloor(self: *SequenceCrdt, id: Id) ?*IdIndex.Node {
+    var node = self.index.root;
+    var best: ?*IdIndex.Node = null;
+    while (node) |n| {
+        if (compareIds(n.key.id, id) == .gt) {
+            node = n.children[0];
+        } else {
+            best = n;
+            node = n.children[1];
+        }
+    }
+    return best;
+}
+
+fn addIndex(self: *SequenceCrdt, key: IndexKey) !*IdIndex.Node {
+    const node = try self.arena.allocator().create(IdIndex.Node);
+    var entry = self.index.getEntryFor(key);
+    entry.set(node);
+    return node;
+}
+
+/// Point ids [id, id + count) at `leaf` after their run moved there
+fn moveIndex(self: *SequenceCrdt, id: Id, count: u32, leaf: *Leaf) !void {
+    var done: u32 = 0;
+    while (done < count) {
+        const start = id.plus(done);
+        var node = self.indexFloor(start);
+        if (node.key.id.counter < start.counter) {
+            const head_len = start.counter - node.key.id.counter;
+            const rest = IndexKey{ .id = start, .len = node.key.len - head_len, .leaf = node.key.leaf };
+            node.key.len = head_len;
+            node = try self.addIndex(rest);
+        }
+        const piece = @min(node.key.len, count - done);
+        if (node.key.len > piece) {
+            _ = try self.addIndex(.{ .id = start.plus(piece), .len = node.key.len - piece, .leaf = node.key.leaf });
+            node.key.len = piece;
+        }
+        node.key.leaf = leaf;
+        done += piece;
+    }
+}
+
+// ============================================================================
+// Private Helpers
+// ============================================================================
+
+fn putInt(out: *std.ArrayList(u8), allocator: Allocator, comptime T: type, value: T) !void {
+    var buf: [@sizeOf(T)]u8 = undefined;
+    std.mem.writeInt(T, &buf, value, .little);
+    try out.appendSlice(allocator, &buf);
+}
+
+fn putId(out: *std.ArrayList(u8), allocator: Allocator, id: Id) !void {
+    try putInt(out, allocator, u32, id.replica);
+    try putInt(out, allocator, u32, id.counter);
+}
+
+const Reader = struct {
+    bytes: []const u8,
+    pos: usize = 0,
+
+    fn take(self: *Reader, n: usize) error{CorruptLog}![]const u8 {
+        if (n > self.bytes.len - self.pos) return error.CorruptLog;
+        defer self.pos += n;
+        return self.bytes[self.pos..][0..n];
+    }
+
+    fn int(self: *Reader, comptime T: type) error{CorruptLog}!T {
+        return std.mem.readInt(T, (try self.take(@sizeOf(T)))[0..@sizeOf(T)], .little);
+    }
+
+    fn id(self: *Reader) error{CorruptLog}!Id {
+        return .{ .replica = try self.int(u32), .counter = try self.int(u32) };
+    }
+};
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+fn expectText(expected: []const u8, sequence: *const SequenceCrdt) !void {
+    const actual = try sequence.text(std.testing.allocator);
+    defer std.testing.allocator.free(actual);
+    try std.testing.expectEqualStrings(expected, actual);
+}
+
+/// Merge `from`'s log into `into` through the file format
+fn exchange(into: *SequenceCrdt, from: *const SequenceCrdt) !usize {
+    const bytes = try from.encode(std.testing.allocator);
+    defer std.testing.allocator.free(bytes);
+    const decoded = try decode(std.testing.allocator, bytes);
+    defer freeLog(std.testing.allocator, decoded);
+    return into.merge(decoded);
+}
+
+test "two replicas converge after exchanging logs" {
+    const allocator = std.testing.allocator;
+    var a = try SequenceCrdt.init(allocator, 1, "hello world");
+    defer a.deinit();
+    var b = try SequenceCrdt.init(allocator, 2, "hello world");
+    defer b.deinit();
+
+    try a.localInsert(5, ", dear");
+    try b.localDelete(6, 5);
+    for ("there", 6..) |c, pos| try b.localInsert(pos, &.{c});
+    // Typing one byte at a time still logs a single insert
+    try std.testing.expectEqual(@as(usize, 3), b.ops.items.len);
+
+    try std.testing.expectEqual(@as(usize, 10), try exchange(&a, &b));
+    try std.testing.expectEqual(@as(usize, 6), try exchange(&b, &a));
+    try std.testing.expectEqual(@as(usize, 0), try exchange(&a, &b));
+    try expectText("hello, dear there", &a);
+    try expectText("hello, dear there", &b);
+
+    var other = try SequenceCrdt.init(allocator, 3, "hello");
+    defer other.deinit();
+    try std.testing.expectError(error.DifferentBase, exchange(&other, &a));
+}
+
+test "concurrent inserts at one spot order the same everywhere" {
+    const allocator = std.testing.allocator;
+    var a = try SequenceCrdt.init(allocator, 1, "ab");
+    defer a.deinit();
+    var b = try SequenceCrdt.init(allocator, 2, "ab");
+    defer b.deinit();
+
+    try a.localInsert(1, "x");
+    const anchor = a.anchorAt(2);
+    try b.localInsert(1, "y");
+    try b.localInsert(2, "z");
+
+    _ = try exchange(&a, &b);
+    _ = try exchange(&b, &a);
+    // Equal lamports: the higher replica goes first, keeping "yz" together
+    try expectText("ayzxb", &a);
+    try expectText("ayzxb", &b);
+    try std.testing.expectEqual(@as(usize, 4), a.offsetAfter(anchor));
+}
+
+test "logs referencing bytes never inserted are rejected" {
+    const allocator = std.testing.allocator;
+    var a = try SequenceCrdt.init(allocator, 1, "ab");
+    defer a.deinit();
+    var b = try SequenceCrdt.init(allocator, 2, "ab");
+    defer b.deinit();
+    try b.localInsert(1, "x");
+
+    var ops = [_]Op{b.log().ops[1]};
+    ops[0].kind.insert.origin = .{ .replica = 9, .counter = 5 };
+    const dangling_origin = Log{ .base_hash = b.base_hash, .ops = &ops, .content = b.log().content };
+    try std.testing.expectError(error.CorruptLog, a.merge(dangling_origin));
+
+    // The base run holds two bytes, not three
+    ops[0] = .{ .id = .{ .replica = 2, .counter = 0 }, .len = 3, .kind = .{ .delete = .{ .replica = 0, .counter = 0 } } };
+    const dangling_delete = Log{ .base_hash = b.base_hash, .ops = &ops, .content = "" };
+    try std.testing.expectError(error.CorruptLog, a.merge(dangling_delete));
+    try expectText("ab", &a);
+
+    // A bad op after good ones rejects the whole log, so the history still
+    // matches the text and editing carries on
+    const partial_ops = [_]Op{
+        b.log().ops[1],
+        .{ .id = .{ .replica = 2, .counter = 1 }, .len = 1, .kind = .{ .delete = .{ .replica = 9, .counter = 0 } } },
+    };
+    const partial = Log{ .base_hash = b.base_hash, .ops = &partial_ops, .content = b.log().content };
+    try std.testing.expectError(error.CorruptLog, a.merge(partial));
+    try expectText("ab", &a);
+    try a.localInsert(2, "c");
+    try a.localDelete(0, 1);
+    try expectText("bc", &a);
+    _ = try exchange(&a, &b);
+    _ = try exchange(&b, &a);
+    try expectText("xbc", &a);
+    try expectText("xbc", &b);
+}
+
+test "backspaces synced one at a time converge" {
+    const allocator = std.testing.allocator;
+    var a = try SequenceCrdt.init(allocator, 1, "abcd");
+    defer a.deinit();
+    var b = try SequenceCrdt.init(allocator, 2, "abcd");
+    defer b.deinit();
+
+    try a.localDelete(3, 1);
+    _ = try exchange(&b, &a);
+    try a.localDelete(2, 1);
+    _ = try exchange(&b, &a);
+    try a.localDelete(1, 1);
+    _ = try exchange(&b, &a);
+
+    const a_text = try a.text(allocator);
+    defer allocator.free(a_text);
+    const b_text = try b.text(allocator);
+    defer allocator.free(b_text);
+    try std.testing.expectEqualStrings(a_text, b_text);
+    try std.testing.expectEqualStrings("a", a_text);
+}
+
+test "long random history stays in step with a plain buffer" {
+    const allocator = std.testing.allocator;
+    var a = try SequenceCrdt.init(allocator, 1, "");
+    defer a.deinit();
+    var model = std.ArrayList(u8).empty;
+    defer model.deinit(allocator);
+
+    var prng = std.Random.DefaultPrng.init(0x5eed);
+    const random = prng.random();
+    for (0..4000) |_| {
+        const pos = random.uintAtMost(usize, model.items.len);
+        if (model.items.len > 0 and random.uintLessThan(u8, 4) == 0) {
+            const n = @min(random.uintAtMost(usize, 8), model.items.len - pos);
+            try a.localDelete(pos, n);
+            try model.replaceRange(allocator, pos, n, "");
+        } else {
+            const c = "abcdefgh"[random.uintLessThan(usize, 8)];
+            try a.localInsert(pos, &.{c});
+            try model.insert(allocator, pos, c);
+        }
+    }
+    try std.testing.expect(a.height > 0);
+    try expectText(model.items, &a);
+
+    var b = try SequenceCrdt.init(allocator, 2, "");
+    defer b.deinit();
+    _ = try exchange(&b, &a);
+    try expectText(model.items, &b);
+}
@@ -0,0 +1,187 @@
+// SignedDistanceField.zig - Coverage bitmap -> signed distance field (8SSEDT)
+//
+// Portable CPU code, only imports std. Used by the SDF glyph atlas so glyphs can
+// be rasterized once at a reference size and reconstructed by the shader at any
+// scale.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+/// Coverage values at or above this are treated as inside the glyph.
+pub const INSIDE_THRESHOLD: u8 = 128;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/// Offset from a pixel to its nearest seed pixel.
+const Point = struct {
+    dx: i32,
+    dy: i32,
+
+    fn distSq(self: Point) i32 {
+        return self.dx * self.dx + self.dy * self.dy;
+    }
+};
+
+const EMPTY = Point{ .dx = 9999, .dy = 9999 };
+const SEED = Point{ .dx = 0, .dy = 0 };
+
+/// One 8SSEDT grid: every pixel holds the offset to the nearest seed.
+const Grid = struct {
+    points: []Point,
+    width: usize,
+    height: usize,
+
+    inline fn get(self: *const Grid, x: isize, y: isize) Point {
+        if (x < 0 or y < 0) return EMPTY;
+        const ux: usize = @intCast(x);
+        const uy: usize = @intCast(y);
+        if (ux >= self.width or uy >= self.height) return EMPTY;
+        return self.points[uy * self.width + ux];
+    }
+
+    inline fn compare(self: *const Grid, p: *Point, x: isize, y: isize, ox: i32, oy: i32) void {
+        var other = self.get(x + ox, y + oy);
+        other.dx += ox;
+        other.dy += oy;
+        if (other.distSq() < p.distSq()) p.* = other;
+    }
+
+    /// Two-pass 8-point sequential Euclidean distance transform.
+    fn propagate(self: *Grid) void {
+        const w: isize = @intCast(self.width);
+        const h: isize = @intCast(self.height);
+
+        // Pass 0: top to bottom
+        var y: isize = 0;
+        while (y < h) : (y += 1) {
+            var x: isize = 0;
+            while (x < w) : (x += 1) {
+                const idx: usize = @intCast(y * w + x);
+                var p = self.points[idx];
+                self.compare(&p, x, y, -1, 0);
+                self.compare(&p, x, y, 0, -1);
+                self.compare(&p, x, y, -1, -1);
+                self.compare(&p, x, y, 1, -1);
+                self.points[idx] = p;
+            }
+            x = w - 1;
+            while (x >= 0) : (x -= 1) {
+                const idx: usize = @intCast(y * w + x);
+                var p = self.points[idx];
+                self.compare(&p, x, y, 1, 0);
+                self.points[idx] = p;
+            }
+        }
+
+        // Pass 1: bottom to top
+        y = h - 1;
+        while (y >= 0) : (y -= 1) {
+            var x: isize = w - 1;
+            while (x >= 0) : (x -= 1) {
+                const idx: usize = @intCast(y * w + x);
+                var p = self.points[idx];
+                self.compare(&p, x, y, 1, 0);
+                self.compare(&p, x, y, 0, 1);
+                self.compare(&p, x, y, -1, 1);
+                self.compare(&p, x, y, 1, 1);
+                self.points[idx] = p;
+            }
+            x = 0;
+            while (x < w) : (x += 1) {
+                const idx: usize = @intCast(y * w + x);
+                var p = self.points[idx];
+                self.compare(&p, x, y, -1, 0);
+                self.points[idx] = p;
+            }
+        }
+    }
+};
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+/// Convert a `width * height` coverage bitmap into a signed distance field.
+///
+/// Output encoding: 0.5 (128) is the glyph edge, larger values are inside.
+/// `spread` is the distance in pixels mapped to the full [0, 255] range on each
+/// side of the edge. `out` may alias `coverage`.
+pub fn generate(
+    allocator: Allocator,
+    coverage: []const u8,
+    width: usize,
+    height: usize,
+    spread: f32,
+    out: []u8,
+) !void {
+    const n = width * height;
+    std.debug.assert(coverage.len >= n and out.len >= n);
+    if (n == 0) return;
+
+    const inside_points = try allocator.alloc(Point, n);
+    defer allocator.free(inside_points);
+    const outside_points = try allocator.alloc(Point, n);
+    defer allocator.free(outside_points);
+
+    // `to_inside` measures the distance to the nearest inside pixel (zero inside),
+    // `to_outside` the distance to the nearest outside pixel (zero outside).
+    var to_inside = Grid{ .points = inside_points, .width = width, .height = height };
+    var to_outside = Grid{ .points = outside_points, .width = width, .height = height };
+
+    for (coverage[0..n], 0..) |value, i| {
+        const inside = value >= INSIDE_THRESHOLD;
+        to_inside.points[i] = if (inside) SEED else EMPTY;
+        to_outside.points[i] = if (inside) EMPTY else SEED;
+    }
+
+    to_inside.propagate();
+    to_outside.propagate();
+
+    const scale: f32 = 0.5 / @max(spread, 1.0);
+    for (0..n) |i| {
+        const d_in: f32 = @sqrt(@as(f32, @floatFromInt(to_inside.points[i].distSq())));
+        const d_out: f32 = @sqrt(@as(f32, @floatFromInt(to_outside.points[i].distSq())));
+        // Positive outside the glyph, negative inside
+        const signed_dist = d_in - d_out;
+        const normalized = std.math.clamp(0.5 - signed_dist * scale, 0.0, 1.0);
+        out[i] = @intFromFloat(@round(normalized * 255.0));
+    }
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "sdf of a filled square" {
+    const size = 32;
+    var coverage = [_]u8{0} ** (size * size);
+    for (8..24) |y| {
+        for (8..24) |x| coverage[y * size + x] = 255;
+    }
+
+    var sdf: [size * size]u8 = undefined;
+    try generate(std.testing.allocator, &coverage, size, size, 8.0, &sdf);
+
+    // Center is deep inside, corners are far outside
+    try std.testing.expect(sdf[16 * size + 16] > 200);
+    try std.testing.expectEqual(@as(u8, 0), sdf[0]);
+
+    // Pixels on either side of the edge straddle the 0.5 threshold
+    try std.testing.expect(sdf[16 * size + 8] >= 128);
+    try std.testing.expect(sdf[16 * size + 7] < 128);
+
+    // Distance grows monotonically moving away from the edge
+    try std.testing.expect(sdf[16 * size + 6] < sdf[16 * size + 7]);
+    try std.testing.expect(sdf[16 * size + 10] > sdf[16 * size + 9]);
+}
+
+test "sdf generation in place" {
+    const size = 16;
+    var buf = [_]u8{0} ** (size * size);
+    buf[8 * size + 8] = 255;
+    try generate(std.testing.allocator, &buf, size, size, 4.0, &buf);
+    try std.testing.expect(buf[8 * size + 8] > 128);
+    try std.testing.expect(buf[8 * size + 12] == 0);
+}
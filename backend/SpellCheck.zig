@@ -0,0 +1,399 @@
+// SpellCheck.zig - Dictionary loading and background spell checking
+//
+// Portable (std + posix mmap). Word lists are compiled once into a Dawg file
+// next to them and memory-mapped from then on. A Checker owns a worker thread
+// that checks block texts off the main thread; results are cached per block
+// content, so after an edit only the changed blocks are checked again.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const Dawg = @import("Dawg.zig");
+
+pub const MAX_WORD_LEN = Dawg.MAX_WORD_LEN;
+/// Edit distance searched for suggestions
+pub const SUGGEST_DISTANCE: u8 = 2;
+/// Worker cache entries before it is cleared
+const CACHE_LIMIT = 4096;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/// Half-open byte range [start, end) of a word.
+pub const Span = struct {
+    start: usize,
+    end: usize,
+};
+
+/// Text to check and where it sits in the document.
+pub const BlockText = struct {
+    offset: usize,
+    text: []const u8,
+};
+
+// ============================================================================
+// Dictionary
+// ============================================================================
+
+pub const Dictionary = struct {
+    mapped: []align(std.heap.page_size_min) const u8,
+    automaton: Dawg.Automaton,
+
+    /// Map a compiled dictionary file read-only.
+    pub fn open(path: []const u8) !Dictionary {
+        const file = try std.fs.cwd().openFile(path, .{});
+        defer file.close();
+
+        const size = (try file.stat()).size;
+        if (size == 0) return error.InvalidDictionary;
+        const mapped = try std.posix.mmap(
+            null,
+            @intCast(size),
+            std.posix.PROT.READ,
+            .{ .TYPE = .PRIVATE },
+            file.handle,
+            0,
+        );
+        errdefer std.posix.munmap(mapped);
+
+        return .{ .mapped = mapped, .automaton = try Dawg.Automaton.init(mapped) };
+    }
+
+    /// Open `cache_path`, first (re)compiling it from `word_list_path` when it
+    /// is missing, invalid or older than the word list.
+    pub fn load(allocator: Allocator, word_list_path: []const u8, cache_path: []const u8) !Dictionary {
+        const list_mtime = (try std.fs.cwd().statFile(word_list_path)).mtime;
+        const cache_fresh = if (std.fs.cwd().statFile(cache_path)) |st| st.mtime >= list_mtime else |_| false;
+
+        if (cache_fresh) {
+            if (open(cache_path)) |dict| return dict else |_| {}
+        }
+        try compileWordList(allocator, word_list_path, cache_path);
+        return open(cache_path);
+    }
+
+    pub fn close(self: *Dictionary) void {
+        std.posix.munmap(self.mapped);
+    }
+
+    /// Dictionary words are stored lowercase; so is the lookup.
+    pub fn isCorrect(self: *const Dictionary, word: []const u8) bool {
+        if (word.len > MAX_WORD_LEN) return true;
+        var buf: [MAX_WORD_LEN]u8 = undefined;
+        const lower = std.ascii.lowerString(&buf, word);
+        return self.automaton.contains(lower);
+    }
+
+    pub fn suggest(self: *const Dictionary, word: []const u8, out: []Dawg.Suggestion) usize {
+        if (word.len > MAX_WORD_LEN) return 0;
+        var buf: [MAX_WORD_LEN]u8 = undefined;
+        const lower = std.ascii.lowerString(&buf, word);
+        return self.automaton.suggest(lower, SUGGEST_DISTANCE, out);
+    }
+};
+
+/// One word per line; hunspell `.dic` style "word/FLAGS" lines and the leading
+/// count line are accepted too. Written to a temp file and renamed into place.
+pub fn compileWordList(allocator: Allocator, word_list_path: []const u8, cache_path: []const u8) !void {
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const scratch = arena.allocator();
+
+    const list = try std.fs.cwd().readFileAlloc(scratch, word_list_path, std.math.maxInt(u32));
+
+    var words = std.ArrayList([]const u8).empty;
+    var lines = std.mem.tokenizeAny(u8, list, "\r\n");
+    while (lines.next()) |line| {
+        const end = std.mem.indexOfScalar(u8, line, '/') orelse line.len;
+        const word = std.mem.trim(u8, line[0..end], " \t");
+        if (word.len == 0 or word[0] == '#') continue;
+        if (std.mem.indexOfAny(u8, word, "0123456789") != null) continue;
+        try words.append(scratch, try std.ascii.allocLowerString(scratch, word));
+    }
+
+    const bytes = try Dawg.build(scratch, words.items);
+
+    const tmp_path = try std.fmt.allocPrint(scratch, "{s}.tmp", .{cache_path});
+    {
+        const file = try std.fs.cwd().createFile(tmp_path, .{ .truncate = true });
+        defer file.close();
+        try file.writeAll(bytes);
+    }
+    try std.fs.cwd().rename(tmp_path, cache_path);
+}
+
+// ============================================================================
+// Tokenizer
+// ============================================================================
+
+fn isWordByte(c: u8) bool {
+    return std.ascii.isAlphanumeric(c) or c == '\'' or c == '_' or c >= 0x80;
+}
+
+/// Next word to check at or after `pos.*`: a run of letters with inner
+/// apostrophes. Runs touching digits, underscores or non-ASCII bytes
+/// (identifiers, numbers, other scripts) and runs joined by '.', '/', ':' or
+/// '@' (URLs, paths, addresses) are skipped, as are single letters and
+/// all-caps acronyms.
+pub fn nextWord(text: []const u8, pos: *usize) ?Span {
+    var i = pos.*;
+    while (i < text.len) {
+        while (i < text.len and !isWordByte(text[i])) : (i += 1) {}
+        if (i >= text.len) break;
+
+        const start = i;
+        var skip = false;
+        while (i < text.len) : (i += 1) {
+            const c = text[i];
+            if (isWordByte(c)) {
+                if (!std.ascii.isAlphabetic(c) and c != '\'') skip = true;
+                continue;
+            }
+            const joins = (c == '.' or c == '/' or c == ':' or c == '@') and
+                i + 1 < text.len and std.ascii.isAlphanumeric(text[i + 1]);
+            if (!joins) break;
+            skip = true;
+        }
+
+        var s = start;
+        var e = i;
+        while (s < e and text[s] == '\'') : (s += 1) {}
+        while (e > s and text[e - 1] == '\'') : (e -= 1) {}
+        if (skip or e - s < 2 or e - s > MAX_WORD_LEN) continue;
+
+        var all_caps = true;
+        for (text[s..e]) |c| {
+            if (std.ascii.isLower(c)) all_caps = false;
+        }
+        if (all_caps) continue;
+
+        pos.* = i;
+        return .{ .start = s, .end = e };
+    }
+    pos.* = text.len;
+    return null;
+}
+
+/// Append misspelled words of `text` (offsets relative to `text`).
+pub fn checkText(allocator: Allocator, dictionary: *const Dictionary, text: []const u8, out: *std.ArrayList(Span)) !void {
+    var pos: usize = 0;
+    while (nextWord(text, &pos)) |word| {
+        if (!dictionary.isCorrect(text[word.start..word.end])) {
+            try out.append(allocator, word);
+        }
+    }
+}
+
+// ============================================================================
+// Background Checker
+// ============================================================================
+
+pub const Checker = struct {
+    allocator: Allocator,
+    dictionary: *const Dictionary,
+    thread: std.Thread,
+    mutex: std.Thread.Mutex = .{},
+    cond: std.Thread.Condition = .{},
+
+    // Guarded by `mutex`
+    pending: ?[]BlockText = null,
+    pending_generation: u64 = 0,
+    busy: bool = false,
+    quit: bool = false,
+    results: std.ArrayList(Span) = .empty,
+    results_generation: u64 = 0,
+
+    // Worker thread only: block text hash -> misspellings relative to the block
+    cache: std.AutoHashMapUnmanaged(u64, []Span) = .empty,
+
+    /// `allocator` must be thread safe; it is used from both threads.
+    pub fn create(allocator: Allocator, dictionary: *const Dictionary) !*Checker {
+        const self = try allocator.create(Checker);
+        errdefer allocator.destroy(self);
+        self.* = .{ .allocator = allocator, .dictionary = dictionary, .thread = undefined };
+        self.thread = try std.Thread.spawn(.{}, worker, .{self});
+        return self;
+    }
+
+    pub fn destroy(self: *Checker) void {
+        self.mutex.lock();
+        self.quit = true;
+        self.cond.broadcast();
+        self.mutex.unlock();
+        self.thread.join();
+
+        if (self.pending) |batch| self.freeBatch(batch);
+        self.results.deinit(self.allocator);
+        self.clearCache();
+        self.cache.deinit(self.allocator);
+        self.allocator.destroy(self);
+    }
+
+    /// Queue blocks for checking under `generation`, replacing a batch the
+    /// worker has not started yet. Texts are copied.
+    pub fn submit(self: *Checker, generation: u64, blocks: []const BlockText) !void {
+        const batch = try self.allocator.alloc(BlockText, blocks.len);
+        var copied: usize = 0;
+        errdefer {
+            for (batch[0..copied]) |b| self.allocator.free(b.text);
+            self.allocator.free(batch);
+        }
+        for (blocks, 0..) |b, i| {
+            batch[i] = .{ .offset = b.offset, .text = try self.allocator.dupe(u8, b.text) };
+            copied += 1;
+        }
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (self.pending) |old| self.freeBatch(old);
+        self.pending = batch;
+        self.pending_generation = generation;
+        self.cond.broadcast();
+    }
+
+    /// Copy the latest finished results into `out` if they belong to
+    /// `generation`. Returns false while that generation is still being checked.
+    pub fn latest(self: *Checker, generation: u64, allocator: Allocator, out: *std.ArrayList(Span)) !bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        if (self.results_generation != generation) return false;
+        try out.appendSlice(allocator, self.results.items);
+        return true;
+    }
+
+    /// Whether every submitted batch has been checked
+    pub fn isIdle(self: *Checker) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        return self.pending == null and !self.busy;
+    }
+
+    /// Block until every submitted batch has been checked.
+    pub fn waitIdle(self: *Checker) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+        while (self.pending != null or self.busy) self.cond.wait(&self.mutex);
+    }
+
+    fn freeBatch(self: *Checker, batch: []BlockText) void {
+        for (batch) |b| self.allocator.free(b.text);
+        self.allocator.free(batch);
+    }
+
+    fn clearCache(self: *Checker) void {
+        var it = self.cache.valueIterator();
+        while (it.next()) |spans| self.allocator.free(spans.*);
+        self.cache.clearRetainingCapacity();
+    }
+
+    fn worker(self: *Checker) void {
+        var found = std.ArrayList(Span).empty;
+        defer found.deinit(self.allocator);
+
+        while (true) {
+            self.mutex.lock();
+            while (!self.quit and self.pending == null) self.cond.wait(&self.mutex);
+            if (self.quit) {
+                self.mutex.unlock();
+                return;
+            }
+            const batch = self.pending.?;
+            const generation = self.pending_generation;
+            self.pending = null;
+            self.busy = true;
+            self.mutex.unlock();
+
+            found.clearRetainingCapacity();
+            self.checkBatch(batch, &found) catch found.clearRetainingCapacity();
+            self.freeBatch(batch);
+
+            self.mutex.lock();
+            self.results.clearRetainingCapacity();
+            self.results.appendSlice(self.allocator, found.items) catch {};
+            self.results_generation = generation;
+            self.busy = false;
+            self.cond.broadcast();
+            self.mutex.unlock();
+        }
+    }
+
+    fn checkBatch(self: *Checker, batch: []const BlockText, found: *std.ArrayList(Span)) !void {
+        if (self.cache.count() > CACHE_LIMIT) self.clearCache();
+
+        var block_spans = std.ArrayList(Span).empty;
+        defer block_spans.deinit(self.allocator);
+
+        for (batch) |block| {
+            const key = std.hash.Wyhash.hash(0, block.text);
+            const spans = self.cache.get(key) orelse blk: {
+                block_spans.clearRetainingCapacity();
+                try checkText(self.allocator, self.dictionary, block.text, &block_spans);
+                const owned = try self.allocator.dupe(Span, block_spans.items);
+                errdefer self.allocator.free(owned);
+                try self.cache.put(self.allocator, key, owned);
+                break :blk owned;
+            };
+            for (spans) |s| {
+                try found.append(self.allocator, .{ .start = block.offset + s.start, .end = block.offset + s.end });
+            }
+        }
+    }
+};
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "nextWord skips code-like tokens" {
+    const text = "Teh quick, brown fox's x NASA v2 snake_case example.com don't-stop 'quoted'";
+    var pos: usize = 0;
+    var words = std.ArrayList([]const u8).empty;
+    defer words.deinit(std.testing.allocator);
+    while (nextWord(text, &pos)) |w| try words.append(std.testing.allocator, text[w.start..w.end]);
+
+    const expected = [_][]const u8{ "Teh", "quick", "brown", "fox's", "don't", "stop", "quoted" };
+    try std.testing.expectEqual(expected.len, words.items.len);
+    for (expected, words.items) |e, w| try std.testing.expectEqualStrings(e, w);
+}
+
+test "dictionary cache and background checker" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    try tmp.dir.writeFile(.{ .sub_path = "words.dic", .data = "5\nthe/S\nquick\nBrown\nfox\njumps\n" });
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const list_path = try std.fs.path.join(allocator, &.{ dir_path, "words.dic" });
+    defer allocator.free(list_path);
+    const cache_path = try std.fs.path.join(allocator, &.{ dir_path, "words.dawg" });
+    defer allocator.free(cache_path);
+
+    var dict = try Dictionary.load(allocator, list_path, cache_path);
+    defer dict.close();
+    try std.testing.expect(dict.isCorrect("The"));
+    try std.testing.expect(dict.isCorrect("brown"));
+    try std.testing.expect(!dict.isCorrect("jumsp"));
+
+    var out: [2]Dawg.Suggestion = undefined;
+    try std.testing.expect(dict.suggest("jumsp", &out) >= 1);
+    try std.testing.expectEqualStrings("jumps", out[0].slice());
+
+    const checker = try Checker.create(allocator, &dict);
+    defer checker.destroy();
+
+    const blocks = [_]BlockText{
+        .{ .offset = 0, .text = "The quikc brown fox" },
+        .{ .offset = 100, .text = "fox jumsp" },
+    };
+    try checker.submit(7, &blocks);
+    checker.waitIdle();
+
+    var spans = std.ArrayList(Span).empty;
+    defer spans.deinit(allocator);
+    try std.testing.expect(!try checker.latest(6, allocator, &spans));
+    try std.testing.expect(try checker.latest(7, allocator, &spans));
+    try std.testing.expectEqual(@as(usize, 2), spans.items.len);
+    try std.testing.expectEqual(Span{ .start = 4, .end = 9 }, spans.items[0]);
+    try std.testing.expectEqual(Span{ .start = 104, .end = 109 }, spans.items[1]);
+}
@@ -0,0 +1,201 @@
+// TextStorage.zig - Interface of the buffer holding a session's text
+//
+// Portable (std only). EditSession and the exports only touch the text
+// through the declarations `check` lists, so the storage can be swapped at
+// compile time with `zig build -Dtext_storage=gap` (default: array):
+//
+//   create(allocator, text) !T        deinit(*T, allocator)
+//   len(*const T) usize               byteAt(*const T, i) u8
+//   insert(*T, allocator, i, text)    delete_range(*T, start, end)
+//   overwrite(*T, allocator, i, text) (same-length replace; nothing moves)
+//   slices(*const T, start, end)      contents(*T) []const u8
+//   lineCount / lineStart / lineOf    memoryUsed(*const T) usize
+//
+// `slices` walks a range in the pieces the storage keeps it in; `contents`
+// makes the whole text contiguous, which the parser and layout need.
+// `zig build bench` replays the same edit traces against every storage.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const build_options = @import("build_options");
+
+pub const Editor = @import("Editor.zig");
+pub const GapBuffer = @import("GapBuffer.zig");
+
+/// The storage sessions use, picked by the `text_storage` build option
+pub const Storage = switch (build_options.text_storage) {
+    .array => Editor,
+    .gap => GapBuffer,
+};
+
+/// Fails compilation if `T` lacks part of the interface
+pub fn check(comptime T: type) void {
+    const required = .{
+        "create",    "deinit",   "len",      "byteAt",    "insert",    "delete_range",
+        "overwrite", "slices",   "contents", "lineCount", "lineStart", "lineOf",
+        "memoryUsed",
+    };
+    inline for (required) |name| {
+        if (!@hasDecl(T, name)) @compileError(@typeName(T) ++ " does not implement TextStorage." ++ name);
+    }
+}
+
+comptime {
+    check(Editor);
+    check(GapBuffer);
+}
+
+/// A range of the text in at most two contiguous pieces
+pub const Slices = struct {
+    parts: [2][]const u8,
+    index: usize = 0,
+
+    pub fn next(self: *Slices) ?[]const u8 {
+        while (self.index < self.parts.len) {
+            const part = self.parts[self.index];
+            self.index += 1;
+            if (part.len > 0) return part;
+        }
+        return null;
+    }
+};
+
+// ============================================================================
+// Line Index
+// ============================================================================
+
+/// Offsets where lines start, kept in step with edits. Line 0 starts at 0;
+/// `starts` holds the offset after every '\n'. An edit shifts the starts
+/// after it, so it costs O(lines after the edit) on top of the scan of the
+/// inserted text.
+pub const LineIndex = struct {
+    starts: std.ArrayList(usize) = .empty,
+
+    pub fn build(allocator: Allocator, text: []const u8) !LineIndex {
+        var index = LineIndex{};
+        errdefer index.deinit(allocator);
+        for (text, 0..) |byte, i| {
+            if (byte == '\n') try index.starts.append(allocator, i + 1);
+        }
+        return index;
+    }
+
+    pub fn deinit(self: *LineIndex, allocator: Allocator) void {
+        self.starts.deinit(allocator);
+    }
+
+    pub fn count(self: *const LineIndex) usize {
+        return self.starts.items.len + 1;
+    }
+
+    pub fn start(self: *const LineIndex, line: usize) usize {
+        return if (line == 0) 0 else self.starts.items[line - 1];
+    }
+
+    /// Line holding byte `offset`
+    pub fn lineOf(self: *const LineIndex, offset: usize) usize {
+        return std.sort.upperBound(usize, self.starts.items, offset, orderOffsets);
+    }
+
+    /// `text` was inserted at `offset`
+    pub fn insert(self: *LineIndex, allocator: Allocator, offset: usize, text: []const u8) !void {
+        const first_after = std.sort.upperBound(usize, self.starts.items, offset, orderOffsets);
+        var added: usize = 0;
+        for (text) |byte| added += @intFromBool(byte == '\n');
+        try self.starts.ensureUnusedCapacity(allocator, added);
+
+        for (self.starts.items[first_after..]) |*line_start| line_start.* += text.len;
+        const new_starts = self.starts.addManyAtAssumeCapacity(first_after, added);
+        var next: usize = 0;
+        for (text, 0..) |byte, i| {
+            if (byte != '\n') continue;
+            new_starts[next] = offset + i + 1;
+            next += 1;
+        }
+    }
+
+    /// Bytes [from, to) were deleted
+    pub fn delete(self: *LineIndex, from: usize, to: usize) void {
+        // Lines starting in (from, to] lost the '\n' before them
+        const first = std.sort.upperBound(usize, self.starts.items, from, orderOffsets);
+        const last = std.sort.upperBound(usize, self.starts.items, to, orderOffsets);
+        self.starts.replaceRangeAssumeCapacity(first, last - first, &.{});
+        for (self.starts.items[first..]) |*line_start| line_start.* -= to - from;
+    }
+
+    /// `old` at `offset` was overwritten by `new` of the same length
+    pub fn overwrite(self: *LineIndex, allocator: Allocator, offset: usize, old: []const u8, new: []const u8) !void {
+        const old_breaks = std.mem.count(u8, old, "\n");
+        const new_breaks = std.mem.count(u8, new, "\n");
+        if (old_breaks == 0 and new_breaks == 0) return;
+        try self.starts.ensureUnusedCapacity(allocator, new_breaks);
+        self.delete(offset, offset + old.len);
+        self.insert(allocator, offset, new) catch unreachable; // reserved above
+    }
+
+    pub fn memoryUsed(self: *const LineIndex) usize {
+        return self.starts.capacity * @sizeOf(usize);
+    }
+
+    fn orderOffsets(key: usize, item: usize) std.math.Order {
+        return std.math.order(key, item);
+    }
+};
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+fn expectSameStorage(comptime T: type) !void {
+    const allocator = std.testing.allocator;
+    var prng = std.Random.DefaultPrng.init(9);
+    const random = prng.random();
+
+    var expected = std.ArrayList(u8).empty;
+    defer expected.deinit(allocator);
+    try expected.appendSlice(allocator, "# Title\n\nfirst line\nsecond\n");
+    var storage = try T.create(allocator, expected.items);
+    defer storage.deinit(allocator);
+
+    for (0..500) |_| {
+        const at = random.uintLessThan(usize, expected.items.len + 1);
+        const roll = random.uintLessThan(u32, 5);
+        if (roll == 0) {
+            const end = @min(expected.items.len, at + 4);
+            const text = "a\nb\n"[0 .. end - at];
+            @memcpy(expected.items[at..end], text);
+            try storage.overwrite(allocator, at, text);
+        } else if (roll < 3) {
+            const text = ([_][]const u8{ "a", "\n", "word ", "two\nlines\n", "x" ** 700 })[random.uintLessThan(usize, 5)];
+            try expected.insertSlice(allocator, at, text);
+            try storage.insert(allocator, at, text);
+        } else {
+            const end = @min(expected.items.len, at + random.uintLessThan(usize, 30));
+            expected.replaceRangeAssumeCapacity(at, end - at, &.{});
+            try storage.delete_range(at, end);
+        }
+
+        try std.testing.expectEqual(expected.items.len, storage.len());
+        if (expected.items.len > 0) {
+            const probe = random.uintLessThan(usize, expected.items.len);
+            try std.testing.expectEqual(expected.items[probe], storage.byteAt(probe));
+            try std.testing.expectEqual(std.mem.count(u8, expected.items[0..probe], "\n"), storage.lineOf(probe));
+        }
+        try std.testing.expectEqual(std.mem.count(u8, expected.items, "\n") + 1, storage.lineCount());
+
+        var pieces = storage.slices(0, storage.len());
+        var offset: usize = 0;
+        while (pieces.next()) |piece| : (offset += piece.len) {
+            try std.testing.expectEqualStrings(expected.items[offset .. offset + piece.len], piece);
+        }
+        try std.testing.expectEqual(expected.items.len, offset);
+    }
+    try std.testing.expectEqualStrings(expected.items, storage.contents());
+    const last_line = storage.lineCount() - 1;
+    try std.testing.expectEqual(if (std.mem.lastIndexOfScalar(u8, expected.items, '\n')) |i| i + 1 else 0, storage.lineStart(last_line));
+}
+
+test "array and gap storage agree with a plain list" {
+    try expectSameStorage(Editor);
+    try expectSameStorage(GapBuffer);
+}
@@ -0,0 +1,322 @@
+// Transclusion.zig - Resolve `![[Note]]` embeds through a cache of parsed notes
+//
+// Portable (std only). An embed target is looked up next to the embedding note
+// ("Other Note" -> "Other Note.md"; "|alias" and "#heading" suffixes are
+// ignored). Each embedded note is read and parsed once and cached by path
+// until its mtime changes or it is invalidated because an open session edited
+// it. Cached trees are never modified: `resolve` copies only the blocks on the
+// way down to an Embed and shares every other subtree, so resolving a note is
+// a pointer walk rather than a parse. An embed of a note that is already being
+// resolved (a cycle) or more than MAX_DEPTH levels down gets no children.
+//
+// Invalidated entries are retired rather than freed, since resolved trees may
+// still point into them. `resolve` records which entries a tree uses, so
+// only the trees for which `referencesRetired` holds need resolving again
+// before `releaseRetired`.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+const MdParser = @import("MdParser.zig");
+const Encoding = @import("Encoding.zig");
+const Block = MdParser.Block;
+
+const Self = @This();
+
+/// Embed levels below the note being resolved
+pub const MAX_DEPTH = 4;
+const MAX_NOTE_SIZE = 16 * 1024 * 1024;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/// Where to get the text of notes that are open in an editor, whose buffers
+/// may be ahead of the file on disk.
+pub const TextSource = struct {
+    ctx: *anyopaque,
+    /// Text of the note at `path` if it is open, else null
+    textFn: *const fn (ctx: *anyopaque, path: []const u8) ?[]const u8,
+};
+
+/// Cached notes a resolved tree points into
+pub const Used = struct {
+    allocator: Allocator,
+    /// Entry paths, compared by address with retired entries
+    paths: std.ArrayList([]const u8) = .empty,
+
+    pub fn deinit(self: *Used) void {
+        self.paths.deinit(self.allocator);
+    }
+};
+
+const Entry = struct {
+    arena: std.heap.ArenaAllocator,
+    path: []const u8,
+    /// Parsed tree with its own embeds unresolved
+    root: *Block,
+    /// mtime of the file it was parsed from; null if it came from an editor
+    mtime: ?i128,
+
+    fn destroy(self: *Entry, allocator: Allocator) void {
+        self.arena.deinit();
+        allocator.destroy(self);
+    }
+};
+
+// ============================================================================
+// Struct Fields
+// ============================================================================
+
+allocator: Allocator,
+source: ?TextSource = null,
+entries: std.StringHashMapUnmanaged(*Entry) = .empty,
+retired: std.ArrayList(*Entry) = .empty,
+
+pub fn init(allocator: Allocator) Self {
+    return .{ .allocator = allocator };
+}
+
+pub fn deinit(self: *Self) void {
+    var it = self.entries.valueIterator();
+    while (it.next()) |entry| entry.*.destroy(self.allocator);
+    self.entries.deinit(self.allocator);
+    self.releaseRetired();
+    self.retired.deinit(self.allocator);
+}
+
+// ============================================================================
+// Public Methods
+// ============================================================================
+
+/// Resolve the embeds in `root`, the parsed text of the note at `note_path`.
+/// Returns `root` itself if it has no embeds, else a copy of the blocks above
+/// them (allocated from `allocator`) sharing everything else. `used`, if
+/// given, is refilled with the entries the result points into.
+pub fn resolve(self: *Self, allocator: Allocator, note_path: []const u8, root: *Block, used: ?*Used) !*Block {
+    var stack = std.ArrayList([]const u8).empty;
+    defer stack.deinit(self.allocator);
+    try stack.append(self.allocator, note_path);
+    if (used) |u| u.paths.clearRetainingCapacity();
+    return self.resolveBlock(allocator, root, &stack, used);
+}
+
+/// Whether a tree whose entries are `used` points into a retired one
+pub fn referencesRetired(self: *const Self, used: *const Used) bool {
+    for (self.retired.items) |entry| {
+        for (used.paths.items) |path| {
+            if (path.ptr == entry.path.ptr) return true;
+        }
+    }
+    return false;
+}
+
+/// The note at `path` changed (e.g. it was edited in a session): drop its
+/// cached tree. Returns true if there was one.
+pub fn invalidate(self: *Self, path: []const u8) bool {
+    const removed = self.entries.fetchRemove(path) orelse return false;
+    self.retired.append(self.allocator, removed.value) catch {
+        // Nowhere to park it; leaking is safer than freeing a tree in use
+        return true;
+    };
+    return true;
+}
+
+pub fn hasRetired(self: *const Self) bool {
+    return self.retired.items.len > 0;
+}
+
+/// Free invalidated trees. Only call once no resolved tree points into them.
+pub fn releaseRetired(self: *Self) void {
+    for (self.retired.items) |entry| entry.destroy(self.allocator);
+    self.retired.clearRetainingCapacity();
+}
+
+// ============================================================================
+// Private Helpers
+// ============================================================================
+
+fn resolveBlock(self: *Self, allocator: Allocator, block: *Block, stack: *std.ArrayList([]const u8), used: ?*Used) !*Block {
+    switch (block.blockType) {
+        .Embed => |target| {
+            const embed = try allocator.create(Block);
+            embed.* = .{
+                .blockType = block.blockType,
+                .children = std.ArrayList(*Block).empty,
+                .content = block.content,
+                .is_open = false,
+            };
+            if (stack.items.len > MAX_DEPTH) return embed;
+
+            const path = try targetPath(allocator, stack.getLast(), target);
+            for (stack.items) |on_stack| {
+                if (std.mem.eql(u8, on_stack, path)) return embed;
+            }
+            const entry = self.load(path) catch |err| switch (err) {
+                error.OutOfMemory => return err,
+                // Missing or unreadable note: leave the embed empty
+                else => return embed,
+            };
+
+            if (used) |u| try u.paths.append(u.allocator, entry.path);
+            try stack.append(self.allocator, entry.path);
+            defer _ = stack.pop();
+            try embed.children.append(allocator, try self.resolveBlock(allocator, entry.root, stack, used));
+            return embed;
+        },
+        else => {
+            var copy: ?*Block = null;
+            for (block.children.items, 0..) |child, i| {
+                const resolved = try self.resolveBlock(allocator, child, stack, used);
+                if (resolved == child) continue;
+                if (copy == null) {
+                    const c = try allocator.create(Block);
+                    c.* = block.*;
+                    c.children = .empty;
+                    try c.children.appendSlice(allocator, block.children.items);
+                    copy = c;
+                }
+                copy.?.children.items[i] = resolved;
+            }
+            return copy orelse block;
+        },
+    }
+}
+
+/// "Other Note|alias" embedded from "/vault/dir/host.md" -> "/vault/dir/Other Note.md"
+fn targetPath(allocator: Allocator, note_path: []const u8, target: []const u8) ![]const u8 {
+    const end = std.mem.indexOfAny(u8, target, "|#") orelse target.len;
+    const name = std.mem.trim(u8, target[0..end], " ");
+    const dir = std.fs.path.dirname(note_path) orelse ".";
+    const extension: []const u8 = if (std.mem.endsWith(u8, name, ".md")) "" else ".md";
+    const file_name = try std.mem.concat(allocator, u8, &.{ name, extension });
+    return std.fs.path.resolve(allocator, &.{ dir, file_name });
+}
+
+fn load(self: *Self, path: []const u8) !*Entry {
+    const open_text = if (self.source) |source| source.textFn(source.ctx, path) else null;
+    if (self.entries.get(path)) |entry| {
+        if (isFresh(entry, open_text != null)) return entry;
+        _ = self.invalidate(path);
+    }
+
+    const entry = try self.allocator.create(Entry);
+    entry.* = .{ .arena = .init(self.allocator), .path = undefined, .root = undefined, .mtime = null };
+    errdefer entry.destroy(self.allocator);
+    const allocator = entry.arena.allocator();
+    entry.path = try allocator.dupe(u8, path);
+
+    const text = if (open_text) |t| try allocator.dupe(u8, t) else blk: {
+        const file = try std.fs.cwd().openFile(path, .{});
+        defer file.close();
+        entry.mtime = (try file.stat()).mtime;
+        const raw = try file.readToEndAlloc(allocator, MAX_NOTE_SIZE);
+        break :blk (try Encoding.decode(allocator, raw)).text;
+    };
+    entry.root = try MdParser.parseBlocks(allocator, text);
+    try MdParser.parseInline(allocator, entry.root);
+
+    try self.entries.put(self.allocator, entry.path, entry);
+    return entry;
+}
+
+fn isFresh(entry: *const Entry, is_open: bool) bool {
+    const mtime = entry.mtime orelse return is_open;
+    if (is_open) return false;
+    const stat = std.fs.cwd().statFile(entry.path) catch return false;
+    return stat.mtime == mtime;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "embeds resolve through the cache with cycles and depth cut" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir);
+
+    try tmp.dir.writeFile(.{ .sub_path = "a.md", .data = "A embeds ![[b]]" });
+    try tmp.dir.writeFile(.{ .sub_path = "b.md", .data = "B embeds ![[a|back]] and ![[missing]]" });
+
+    var cache = Self.init(allocator);
+    defer cache.deinit();
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const ast = arena.allocator();
+
+    const host_path = try std.fs.path.join(ast, &.{ dir, "a.md" });
+    const parsed = try MdParser.parseBlocks(ast, "A embeds ![[b]]");
+    try MdParser.parseInline(ast, parsed);
+    var used = Used{ .allocator = allocator };
+    defer used.deinit();
+    const root = try cache.resolve(ast, host_path, parsed, &used);
+
+    // Document > Paragraph > [RawStr, Embed > Document(b) > Paragraph > [RawStr, Embed(a), RawStr, Embed(missing)]]
+    try std.testing.expect(root != parsed);
+    const embed_b = root.children.items[0].children.items[1];
+    try std.testing.expectEqualStrings("b", embed_b.blockType.Embed);
+    try std.testing.expectEqual(@as(usize, 1), embed_b.children.items.len);
+    const b_paragraph = embed_b.children.items[0].children.items[0];
+    const back = b_paragraph.children.items[1];
+    try std.testing.expectEqualStrings("a|back", back.blockType.Embed);
+    try std.testing.expectEqual(@as(usize, 0), back.children.items.len); // cycle
+    try std.testing.expectEqual(@as(usize, 0), b_paragraph.children.items[3].children.items.len);
+    // The unresolved parse is left alone
+    try std.testing.expectEqual(@as(usize, 0), parsed.children.items[0].children.items[1].children.items.len);
+
+    // b is cached; invalidating it retires the old tree
+    try std.testing.expectEqual(@as(u32, 1), cache.entries.count());
+    const b_root = embed_b.children.items[0];
+    const again = try cache.resolve(ast, host_path, parsed, null);
+    try std.testing.expectEqual(b_root, again.children.items[0].children.items[1].children.items[0]);
+    const b_path = try std.fs.path.join(ast, &.{ dir, "b.md" });
+    // Hosts of other notes are left alone
+    try std.testing.expect(!cache.invalidate(host_path));
+    try std.testing.expect(!cache.referencesRetired(&used));
+    try std.testing.expect(cache.invalidate(b_path));
+    try std.testing.expect(cache.hasRetired());
+    try std.testing.expect(cache.referencesRetired(&used));
+    const fresh = try cache.resolve(ast, host_path, parsed, &used);
+    try std.testing.expect(!cache.referencesRetired(&used));
+    try std.testing.expect(fresh.children.items[0].children.items[1].children.items[0] != b_root);
+    cache.releaseRetired();
+}
+
+test "embed chains stop at MAX_DEPTH" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir);
+
+    var name_buf: [32]u8 = undefined;
+    var text_buf: [32]u8 = undefined;
+    for (1..MAX_DEPTH + 3) |i| {
+        const name = try std.fmt.bufPrint(&name_buf, "n{d}.md", .{i});
+        const text = try std.fmt.bufPrint(&text_buf, "![[n{d}]]", .{i + 1});
+        try tmp.dir.writeFile(.{ .sub_path = name, .data = text });
+    }
+
+    var cache = Self.init(allocator);
+    defer cache.deinit();
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const ast = arena.allocator();
+
+    const parsed = try MdParser.parseBlocks(ast, "![[n1]]");
+    try MdParser.parseInline(ast, parsed);
+    var block = try cache.resolve(ast, try std.fs.path.join(ast, &.{ dir, "n0.md" }), parsed, null);
+
+    // Document > Paragraph > Embed > Document > ...
+    var depth: usize = 0;
+    while (true) {
+        const embed = block.children.items[0].children.items[0];
+        if (embed.children.items.len == 0) break;
+        depth += 1;
+        block = embed.children.items[0];
+    }
+    try std.testing.expectEqual(@as(usize, MAX_DEPTH), depth);
+}
@@ -0,0 +1,666 @@
+// VaultQuery.zig - Dataview-style queries over the PropertyIndex columns
+//
+// Portable (std only). A query such as
+//
+//     #project AND modified >= today-7 SORT words DESC LIMIT 20
+//
+// is parsed into a small expression tree and evaluated a column at a time:
+// each comparison scans one packed array with @Vector compares into a
+// selection bitmap (one bit per row), AND/OR/NOT combine bitmaps a word at a
+// time, and only the surviving rows are looked at again to sort them. With a
+// LIMIT the sort keeps a K-element heap instead of ordering every match.
+//
+//     query := [WHERE] [expr] [SORT field [ASC | DESC]] [LIMIT n]
+//     expr  := term {[AND | OR] term}     AND (or nothing) binds tighter than OR
+//     term  := NOT term | ( expr ) | #tag | field op value
+//     op    := = | != | < | <= | > | >=
+//
+// Keywords are case-insensitive. Fields are frontmatter keys plus the
+// built-ins `modified`, `words` and `links`. Values are typed like YAML
+// scalars (quote them to force text); `today` and `today-N` are dates relative
+// to when the query runs. Dates are local days: `modified` compares against one
+// at day granularity, so `modified = today` matches any time today.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+const Frontmatter = @import("Frontmatter.zig");
+const PropertyIndex = @import("PropertyIndex.zig");
+
+/// Rows compared per @Vector step; a whole number of steps fits in a bitmap word
+const LANES = 8;
+const SECONDS_PER_DAY = 24 * 60 * 60;
+
+pub const Error = error{InvalidQuery} || Allocator.Error;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+pub const Op = enum { eq, ne, lt, le, gt, ge };
+
+pub const Compare = struct {
+    field: []const u8,
+    op: Op,
+    /// As written; typed when the query runs
+    value: []const u8,
+};
+
+pub const Expr = union(enum) {
+    all: [2]*const Expr,
+    any: [2]*const Expr,
+    negate: *const Expr,
+    compare: Compare,
+};
+
+pub const Sort = struct {
+    field: []const u8,
+    descending: bool,
+};
+
+pub const Query = struct {
+    filter: ?*const Expr = null,
+    sort: ?Sort = null,
+    limit: ?usize = null,
+};
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+const Token = union(enum) {
+    /// Bare word or quoted string (quotes included)
+    word: []const u8,
+    op: Op,
+    lparen,
+    rparen,
+};
+
+fn tokenize(allocator: Allocator, text: []const u8) Error![]Token {
+    var tokens = std.ArrayList(Token).empty;
+    var i: usize = 0;
+    while (i < text.len) {
+        const c = text[i];
+        switch (c) {
+            ' ', '\t', '\r', '\n' => i += 1,
+            '(' => {
+                try tokens.append(allocator, .lparen);
+                i += 1;
+            },
+            ')' => {
+                try tokens.append(allocator, .rparen);
+                i += 1;
+            },
+            '"', '\'' => {
+                const close = std.mem.indexOfScalarPos(u8, text, i + 1, c) orelse return error.InvalidQuery;
+                try tokens.append(allocator, .{ .word = text[i .. close + 1] });
+                i = close + 1;
+            },
+            '=', '!', '<', '>' => {
+                const has_eq = i + 1 < text.len and text[i + 1] == '=';
+                const op: Op = switch (c) {
+                    '=' => .eq,
+                    '!' => if (has_eq) .ne else return error.InvalidQuery,
+                    '<' => if (has_eq) .le else .lt,
+                    else => if (has_eq) .ge else .gt,
+                };
+                try tokens.append(allocator, .{ .op = op });
+                i += if (has_eq) 2 else 1;
+            },
+            else => {
+                const start = i;
+                while (i < text.len and std.mem.indexOfScalar(u8, " \t\r\n()\"'=!<>", text[i]) == null) i += 1;
+                try tokens.append(allocator, .{ .word = text[start..i] });
+            },
+        }
+    }
+    return tokens.toOwnedSlice(allocator);
+}
+
+const Parser = struct {
+    allocator: Allocator,
+    tokens: []const Token,
+    pos: usize = 0,
+
+    fn peek(self: *const Parser) ?Token {
+        return if (self.pos < self.tokens.len) self.tokens[self.pos] else null;
+    }
+
+    fn isKeyword(self: *const Parser, word: []const u8) bool {
+        const token = self.peek() orelse return false;
+        return token == .word and std.ascii.eqlIgnoreCase(token.word, word);
+    }
+
+    /// Consume `keyword` if it is next
+    fn keyword(self: *Parser, word: []const u8) bool {
+        if (!self.isKeyword(word)) return false;
+        self.pos += 1;
+        return true;
+    }
+
+    fn expectWord(self: *Parser) Error![]const u8 {
+        const token = self.peek() orelse return error.InvalidQuery;
+        if (token != .word) return error.InvalidQuery;
+        self.pos += 1;
+        return token.word;
+    }
+
+    /// Whether the next token can start a term (for implicit AND)
+    fn atTerm(self: *const Parser) bool {
+        const token = self.peek() orelse return false;
+        return switch (token) {
+            .lparen => true,
+            .word => !self.isKeyword("OR") and !self.isKeyword("SORT") and !self.isKeyword("LIMIT"),
+            .op, .rparen => false,
+        };
+    }
+
+    fn node(self: *Parser, expr: Expr) Error!*const Expr {
+        const result = try self.allocator.create(Expr);
+        result.* = expr;
+        return result;
+    }
+
+    fn parseOr(self: *Parser) Error!*const Expr {
+        var left = try self.parseAnd();
+        while (self.keyword("OR")) {
+            left = try self.node(.{ .any = .{ left, try self.parseAnd() } });
+        }
+        return left;
+    }
+
+    fn parseAnd(self: *Parser) Error!*const Expr {
+        var left = try self.parseTerm();
+        while (self.keyword("AND") or self.atTerm()) {
+            left = try self.node(.{ .all = .{ left, try self.parseTerm() } });
+        }
+        return left;
+    }
+
+    fn parseTerm(self: *Parser) Error!*const Expr {
+        if (self.keyword("NOT")) return self.node(.{ .negate = try self.parseTerm() });
+        const token = self.peek() orelse return error.InvalidQuery;
+        if (token == .lparen) {
+            self.pos += 1;
+            const inner = try self.parseOr();
+            const close = self.peek() orelse return error.InvalidQuery;
+            if (close != .rparen) return error.InvalidQuery;
+            self.pos += 1;
+            return inner;
+        }
+
+        const word = try self.expectWord();
+        if (word.len > 1 and word[0] == '#') {
+            return self.node(.{ .compare = .{ .field = PropertyIndex.TAGS_KEY, .op = .eq, .value = word[1..] } });
+        }
+        const op_token = self.peek() orelse return error.InvalidQuery;
+        if (op_token != .op) return error.InvalidQuery;
+        self.pos += 1;
+        return self.node(.{ .compare = .{ .field = unquote(word), .op = op_token.op, .value = try self.expectWord() } });
+    }
+};
+
+/// Parse `text`. The tree is allocated from `allocator` (use an arena) and
+/// points into `text`.
+pub fn parse(allocator: Allocator, text: []const u8) Error!Query {
+    var parser = Parser{ .allocator = allocator, .tokens = try tokenize(allocator, text) };
+    var query = Query{};
+
+    _ = parser.keyword("WHERE");
+    if (parser.atTerm() and !parser.isKeyword("SORT") and !parser.isKeyword("LIMIT")) {
+        query.filter = try parser.parseOr();
+    }
+    if (parser.keyword("SORT")) {
+        const field = unquote(try parser.expectWord());
+        const descending = parser.keyword("DESC");
+        if (!descending) _ = parser.keyword("ASC");
+        query.sort = .{ .field = field, .descending = descending };
+    }
+    if (parser.keyword("LIMIT")) {
+        query.limit = std.fmt.parseInt(usize, try parser.expectWord(), 10) catch return error.InvalidQuery;
+    }
+    if (parser.peek() != null) return error.InvalidQuery;
+    return query;
+}
+
+fn unquote(word: []const u8) []const u8 {
+    if (word.len >= 2 and (word[0] == '"' or word[0] == '\'')) return word[1 .. word.len - 1];
+    return word;
+}
+
+// ============================================================================
+// Evaluation
+// ============================================================================
+
+const Context = struct {
+    allocator: Allocator,
+    index: *const PropertyIndex,
+    /// Local days since 1970-01-01 when the query runs
+    today: i32,
+    /// Seconds the local time zone is ahead of UTC
+    utc_offset: i32,
+};
+
+/// Rows of `index` matching `query`, in order, with dates taken in the time
+/// zone `utc_offset` seconds ahead of UTC. Caller frees.
+pub fn run(allocator: Allocator, index: *const PropertyIndex, query: Query, now: i64, utc_offset: i32) Error![]u32 {
+    const row_count = index.rowCount();
+    const selection = try allocator.alloc(u64, bitmapWords(row_count));
+    defer allocator.free(selection);
+
+    const ctx = Context{
+        .allocator = allocator,
+        .index = index,
+        .today = @intCast(@divFloor(now + utc_offset, SECONDS_PER_DAY)),
+        .utc_offset = utc_offset,
+    };
+    if (query.filter) |filter| {
+        try eval(ctx, filter, selection);
+    } else {
+        @memset(selection, ~@as(u64, 0));
+    }
+    // Freed rows never match, and neither do the padding bits of the last word
+    for (0..row_count) |row| {
+        if (!index.isLive(row)) selection[row / 64] &= ~bit(row);
+    }
+    if (row_count % 64 != 0) selection[selection.len - 1] &= bit(row_count % 64) - 1;
+
+    var rows = std.ArrayList(u32).empty;
+    errdefer rows.deinit(allocator);
+    for (selection, 0..) |word, w| {
+        var remaining = word;
+        while (remaining != 0) : (remaining &= remaining - 1) {
+            try rows.append(allocator, @intCast(w * 64 + @ctz(remaining)));
+        }
+    }
+
+    if (query.sort) |sort| {
+        const sorted = try sortRows(allocator, index, sort, rows.items, query.limit);
+        rows.deinit(allocator);
+        return sorted;
+    }
+    if (query.limit) |limit| rows.shrinkRetainingCapacity(@min(limit, rows.items.len));
+    return rows.toOwnedSlice(allocator);
+}
+
+/// Parse and run `text`. Caller frees the rows.
+pub fn execute(allocator: Allocator, index: *const PropertyIndex, text: []const u8, now: i64, utc_offset: i32) Error![]u32 {
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const query = try parse(arena.allocator(), text);
+    return run(allocator, index, query, now, utc_offset);
+}
+
+fn bitmapWords(rows: usize) usize {
+    return (rows + 63) / 64;
+}
+
+fn bit(row: usize) u64 {
+    return @as(u64, 1) << @intCast(row % 64);
+}
+
+fn eval(ctx: Context, expr: *const Expr, out: []u64) Error!void {
+    switch (expr.*) {
+        .all, .any => |operands| {
+            try eval(ctx, operands[0], out);
+            const other = try ctx.allocator.alloc(u64, out.len);
+            defer ctx.allocator.free(other);
+            try eval(ctx, operands[1], other);
+            if (expr.* == .all) {
+                for (out, other) |*word, o| word.* &= o;
+            } else {
+                for (out, other) |*word, o| word.* |= o;
+            }
+        },
+        .negate => |inner| {
+            try eval(ctx, inner, out);
+            for (out) |*word| word.* = ~word.*;
+        },
+        .compare => |compare| try evalCompare(ctx, compare, out),
+    }
+}
+
+fn evalCompare(ctx: Context, compare: Compare, out: []u64) Error!void {
+    @memset(out, 0);
+    const index = ctx.index;
+    const value = resolveValue(ctx, compare.value) orelse return;
+
+    if (std.mem.eql(u8, compare.field, "modified")) {
+        return switch (value) {
+            .number => |seconds| selectWhere(i64, index.mtimes.items, compare.op, seconds, out),
+            .date => |day| selectModifiedOn(ctx, day, compare.op, out),
+            else => {},
+        };
+    }
+    const counts = if (std.mem.eql(u8, compare.field, "words"))
+        index.word_counts.items
+    else if (std.mem.eql(u8, compare.field, "links"))
+        index.link_counts.items
+    else
+        null;
+    if (counts) |values| {
+        if (value != .number) return;
+        return selectWhere(u32, values, compare.op, value.number, out);
+    }
+
+    // A note without the property is "not equal" to any value
+    if (compare.op == .ne) {
+        try evalCompare(ctx, .{ .field = compare.field, .op = .eq, .value = compare.value }, out);
+        for (out) |*word| word.* = ~word.*;
+        return;
+    }
+    const column = index.column(compare.field) orelse return;
+    switch (value) {
+        .text => |text| {
+            if (compare.op == .eq) {
+                const code = column.code(text) orelse return;
+                selectKind(column.kinds.items, .text, out);
+                const matches = try ctx.allocator.alloc(u64, out.len);
+                defer ctx.allocator.free(matches);
+                @memset(matches, 0);
+                selectWhere(u32, column.codes.items, .eq, @floatFromInt(code), matches);
+                for (out, matches) |*word, m| word.* &= m;
+                // List items (tags, aliases) match if any item does
+                for (column.kinds.items, 0..) |kind, row| {
+                    if (kind == .list and std.mem.indexOfScalar(u32, column.listItems(row), code) != null) out[row / 64] |= bit(row);
+                }
+            } else {
+                for (column.kinds.items, 0..) |kind, row| {
+                    if (kind != .text) continue;
+                    const order = std.mem.order(u8, column.strings.items[column.codes.items[row]], text);
+                    if (orderHolds(compare.op, order)) out[row / 64] |= bit(row);
+                }
+            }
+        },
+        .number, .boolean, .date => {
+            const kind: PropertyIndex.Kind = switch (value) {
+                .number => .number,
+                .boolean => .boolean,
+                .date => .date,
+                else => unreachable,
+            };
+            const number: f64 = switch (value) {
+                .number => |n| n,
+                .boolean => |flag| @floatFromInt(@intFromBool(flag)),
+                .date => |days| @floatFromInt(days),
+                else => unreachable,
+            };
+            selectKind(column.kinds.items, kind, out);
+            const matches = try ctx.allocator.alloc(u64, out.len);
+            defer ctx.allocator.free(matches);
+            @memset(matches, 0);
+            selectWhere(f64, column.numbers.items, compare.op, number, matches);
+            for (out, matches) |*word, m| word.* &= m;
+        },
+        .list => {},
+    }
+}
+
+/// `modified op day` at day granularity: mtimes anywhere in local day `day`
+/// compare equal to it
+fn selectModifiedOn(ctx: Context, day: i32, op: Op, out: []u64) Error!void {
+    const mtimes = ctx.index.mtimes.items;
+    const start: f64 = @floatFromInt(@as(i64, day) * SECONDS_PER_DAY - ctx.utc_offset);
+    const end = start + SECONDS_PER_DAY;
+    switch (op) {
+        .lt, .ge => selectWhere(i64, mtimes, op, start, out),
+        .le => selectWhere(i64, mtimes, .lt, end, out),
+        .gt => selectWhere(i64, mtimes, .ge, end, out),
+        .eq, .ne => {
+            selectWhere(i64, mtimes, .ge, start, out);
+            const before_end = try ctx.allocator.alloc(u64, out.len);
+            defer ctx.allocator.free(before_end);
+            @memset(before_end, 0);
+            selectWhere(i64, mtimes, .lt, end, before_end);
+            for (out, before_end) |*word, b| word.* = if (op == .eq) word.* & b else ~(word.* & b);
+        },
+    }
+}
+
+/// `today`, `today-N` and `today+N` as dates; anything else typed as a scalar
+fn resolveValue(ctx: Context, raw: []const u8) ?Frontmatter.Value {
+    if (raw.len >= 5 and std.ascii.eqlIgnoreCase(raw[0..5], "today")) {
+        if (raw.len == 5) return .{ .date = ctx.today };
+        const days = std.fmt.parseInt(i32, raw[5..], 10) catch return Frontmatter.parseScalar(raw);
+        return .{ .date = ctx.today + days };
+    }
+    return Frontmatter.parseScalar(raw);
+}
+
+fn orderHolds(op: Op, order: std.math.Order) bool {
+    return switch (op) {
+        .eq => order == .eq,
+        .ne => order != .eq,
+        .lt => order == .lt,
+        .le => order != .gt,
+        .gt => order == .gt,
+        .ge => order != .lt,
+    };
+}
+
+// ============================================================================
+// Vectorized Selection
+// ============================================================================
+
+/// Set the bit of every row where `values[row] op rhs`.
+fn selectWhere(comptime T: type, values: []const T, op: Op, rhs: f64, out: []u64) void {
+    switch (op) {
+        inline else => |comptime_op| selectWhereOp(T, comptime_op, values, rhs, out),
+    }
+}
+
+fn selectWhereOp(comptime T: type, comptime op: Op, values: []const T, rhs: f64, out: []u64) void {
+    const Lanes = @Vector(LANES, f64);
+    const splat: Lanes = @splat(rhs);
+    var i: usize = 0;
+    while (i + LANES <= values.len) : (i += LANES) {
+        const chunk: @Vector(LANES, T) = values[i..][0..LANES].*;
+        const lanes: Lanes = if (T == f64) chunk else @floatFromInt(chunk);
+        const hits: u8 = @bitCast(holds(op, lanes, splat));
+        out[i / 64] |= @as(u64, hits) << @intCast(i % 64);
+    }
+    while (i < values.len) : (i += 1) {
+        const lane: f64 = if (T == f64) values[i] else @floatFromInt(values[i]);
+        if (holds(op, lane, rhs)) out[i / 64] |= bit(i);
+    }
+}
+
+/// Set the bit of every row whose slot holds a value of `kind`.
+fn selectKind(kinds: []const PropertyIndex.Kind, kind: PropertyIndex.Kind, out: []u64) void {
+    const bytes: []const u8 = @ptrCast(kinds);
+    const splat: @Vector(LANES, u8) = @splat(@intFromEnum(kind));
+    var i: usize = 0;
+    while (i + LANES <= bytes.len) : (i += LANES) {
+        const chunk: @Vector(LANES, u8) = bytes[i..][0..LANES].*;
+        const hits: u8 = @bitCast(chunk == splat);
+        out[i / 64] |= @as(u64, hits) << @intCast(i % 64);
+    }
+    while (i < bytes.len) : (i += 1) {
+        if (bytes[i] == @intFromEnum(kind)) out[i / 64] |= bit(i);
+    }
+}
+
+inline fn holds(comptime op: Op, a: anytype, b: @TypeOf(a)) @TypeOf(a == b) {
+    return switch (op) {
+        .eq => a == b,
+        .ne => a != b,
+        .lt => a < b,
+        .le => a <= b,
+        .gt => a > b,
+        .ge => a >= b,
+    };
+}
+
+// ============================================================================
+// Top-K Sort
+// ============================================================================
+
+const SortItem = struct {
+    row: u32,
+    present: bool,
+    /// Text values sort after numbers
+    text: ?[]const u8,
+    number: f64,
+};
+
+const SortOrder = struct {
+    descending: bool,
+
+    /// Whether `a` comes before `b`; rows without the field always go last
+    fn before(self: SortOrder, a: SortItem, b: SortItem) bool {
+        if (a.present != b.present) return a.present;
+        if (a.present) {
+            const order: std.math.Order = if (a.text != null and b.text != null)
+                std.mem.order(u8, a.text.?, b.text.?)
+            else if (a.text != null or b.text != null)
+                (if (a.text != null) .gt else .lt)
+            else
+                std.math.order(a.number, b.number);
+            if (order != .eq) return if (self.descending) order == .gt else order == .lt;
+        }
+        return a.row < b.row;
+    }
+
+    /// Heap order with the item to evict first (the last in sort order) on top
+    fn lastFirst(self: SortOrder, a: SortItem, b: SortItem) std.math.Order {
+        if (self.before(b, a)) return .lt;
+        if (self.before(a, b)) return .gt;
+        return .eq;
+    }
+};
+
+fn sortItem(index: *const PropertyIndex, field: []const u8, row: u32) SortItem {
+    var item = SortItem{ .row = row, .present = true, .text = null, .number = 0 };
+    if (std.mem.eql(u8, field, "modified")) {
+        item.number = @floatFromInt(index.mtimes.items[row]);
+    } else if (std.mem.eql(u8, field, "words")) {
+        item.number = @floatFromInt(index.word_counts.items[row]);
+    } else if (std.mem.eql(u8, field, "links")) {
+        item.number = @floatFromInt(index.link_counts.items[row]);
+    } else if (std.mem.eql(u8, field, "path")) {
+        item.text = index.path(row);
+    } else if (index.column(field)) |column| {
+        switch (column.kinds.items[row]) {
+            .missing => item.present = false,
+            .text => item.text = column.strings.items[column.codes.items[row]],
+            .list => item.text = column.strings.items[column.listItems(row)[0]],
+            .number, .boolean, .date => item.number = column.numbers.items[row],
+        }
+    } else {
+        item.present = false;
+    }
+    return item;
+}
+
+/// `rows` ordered by `sort`, cut to `limit`. A limit keeps only a heap of
+/// that many candidates instead of sorting every row.
+fn sortRows(allocator: Allocator, index: *const PropertyIndex, sort: Sort, rows: []const u32, limit: ?usize) Error![]u32 {
+    const order = SortOrder{ .descending = sort.descending };
+    const k = @min(limit orelse rows.len, rows.len);
+
+    var items = std.ArrayList(SortItem).empty;
+    defer items.deinit(allocator);
+    if (k < rows.len) {
+        var heap = std.PriorityQueue(SortItem, SortOrder, SortOrder.lastFirst).init(allocator, order);
+        defer heap.deinit();
+        try heap.ensureTotalCapacity(k + 1);
+        for (rows) |row| {
+            const item = sortItem(index, sort.field, row);
+            if (heap.count() < k) {
+                heap.add(item) catch unreachable;
+            } else if (k > 0 and order.before(item, heap.peek().?)) {
+                _ = heap.remove();
+                heap.add(item) catch unreachable;
+            }
+        }
+        try items.ensureTotalCapacity(allocator, heap.count());
+        while (heap.removeOrNull()) |item| items.appendAssumeCapacity(item);
+    } else {
+        try items.ensureTotalCapacity(allocator, rows.len);
+        for (rows) |row| items.appendAssumeCapacity(sortItem(index, sort.field, row));
+    }
+    std.mem.sort(SortItem, items.items, order, SortOrder.before);
+
+    const sorted = try allocator.alloc(u32, items.items.len);
+    for (items.items, sorted) |item, *row| row.* = item.row;
+    return sorted;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "query syntax" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const query = try parse(allocator, "#project and (status != \"done\" OR NOT priority>=2) sort words desc limit 5");
+    try std.testing.expectEqual(@as(?usize, 5), query.limit);
+    try std.testing.expect(query.sort.?.descending);
+    const filter = query.filter.?.all;
+    try std.testing.expectEqualStrings("project", filter[0].compare.value);
+    const either = filter[1].any;
+    try std.testing.expectEqual(Op.ne, either[0].compare.op);
+    try std.testing.expectEqualStrings("\"done\"", either[0].compare.value);
+    try std.testing.expectEqual(Op.ge, either[1].negate.compare.op);
+
+    // Juxtaposed terms are ANDed; an empty filter selects everything
+    try std.testing.expect((try parse(allocator, "#a #b")).filter.?.* == .all);
+    try std.testing.expect((try parse(allocator, "SORT modified")).filter == null);
+
+    for ([_][]const u8{ "status =", "(#a", "#a LIMIT x", "words ! 3", "\"open", "#a SORT" }) |bad| {
+        try std.testing.expectError(error.InvalidQuery, parse(allocator, bad));
+    }
+}
+
+test "vectorized filters with top-K sort" {
+    const allocator = std.testing.allocator;
+    var index = PropertyIndex.init(allocator);
+    defer index.deinit();
+
+    // 100 notes (more than a bitmap word and not a whole number of vectors);
+    // note i has i words, is a project if i is even and was modified i days ago
+    const now: i64 = 20_000 * SECONDS_PER_DAY + 3600;
+    var text = std.ArrayList(u8).empty;
+    defer text.deinit(allocator);
+    var path_buf: [32]u8 = undefined;
+    for (0..100) |i| {
+        text.clearRetainingCapacity();
+        const status = if (i % 3 == 0) "done" else "open";
+        try text.print(allocator, "---\nstatus: {s}\npriority: {d}\n---\n", .{ status, i % 4 });
+        if (i % 2 == 0) try text.appendSlice(allocator, "#project ");
+        for (0..i) |_| try text.appendSlice(allocator, "w ");
+        const note_path = try std.fmt.bufPrint(&path_buf, "/v/{d}.md", .{i});
+        try index.update(note_path, text.items, now - @as(i64, @intCast(i)) * SECONDS_PER_DAY);
+    }
+    index.remove("/v/4.md");
+
+    // Even notes modified within the last week, minus the removed one: 0, 2, 6
+    const recent = try execute(allocator, &index, "#project modified >= today-7 SORT words DESC", now, 0);
+    defer allocator.free(recent);
+    try std.testing.expectEqualSlices(u32, &.{ 6, 2, 0 }, recent);
+
+    const top = try execute(allocator, &index, "status = open AND words > 10 SORT words DESC LIMIT 3", now, 0);
+    defer allocator.free(top);
+    try std.testing.expectEqualSlices(u32, &.{ 98, 97, 95 }, top);
+
+    const bottom = try execute(allocator, &index, "NOT status = open priority <= 1 SORT words LIMIT 2", now, 0);
+    defer allocator.free(bottom);
+    try std.testing.expectEqualSlices(u32, &.{ 0, 9 }, bottom);
+
+    const all = try execute(allocator, &index, "", now, 0);
+    defer allocator.free(all);
+    try std.testing.expectEqual(@as(usize, 99), all.len);
+
+    // Dates match the whole local day: note i was modified at 01:00 UTC, which
+    // two hours west of UTC is still the day before
+    const yesterday = try execute(allocator, &index, "modified = 2024-10-03", now, 0);
+    defer allocator.free(yesterday);
+    try std.testing.expectEqualSlices(u32, &.{1}, yesterday);
+    const west = try execute(allocator, &index, "modified = 2024-10-03", now, -2 * 3600);
+    defer allocator.free(west);
+    try std.testing.expectEqualSlices(u32, &.{0}, west);
+
+    try std.testing.expectError(error.InvalidQuery, execute(allocator, &index, "words >", now, 0));
+}
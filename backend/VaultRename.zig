@@ -0,0 +1,488 @@
+// VaultRename.zig - Link-aware note rename across a vault
+//
+// Portable (std only). Renaming a note rewrites every markdown link or image
+// (`[text](path)`, `![alt](path)`) whose destination resolves to it. Notes are
+// scanned and rewritten on a thread pool in batches; each note is rebuilt in a
+// single pass into a new buffer and written to a temp file that is renamed over
+// the original, so a crash never leaves a half-written note. Open edit sessions
+// apply the same `Edit` lists to their buffers (EditSession.replaceRanges).
+//
+// Paths are vault-relative with '/' separators. Link destinations resolve
+// against the linking note's directory, or the vault root if they start with
+// '/'. Fenced code blocks and code spans are left alone.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+const fs_path = std.fs.path;
+
+/// Notes handed to one pool task
+const BATCH_FILES = 32;
+const MAX_NOTE_SIZE = 64 * 1024 * 1024;
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/// Replace bytes [start, end) with `text`.
+pub const Edit = struct {
+    start: usize,
+    end: usize,
+    text: []const u8,
+};
+
+pub const Rename = struct {
+    /// Rooted ("/dir/note.md"), normalized
+    old_path: []const u8,
+    new_path: []const u8,
+
+    pub fn init(allocator: Allocator, old_path: []const u8, new_path: []const u8) !Rename {
+        const old_rooted = try rooted(allocator, old_path);
+        errdefer allocator.free(old_rooted);
+        return .{ .old_path = old_rooted, .new_path = try rooted(allocator, new_path) };
+    }
+
+    pub fn deinit(self: Rename, allocator: Allocator) void {
+        allocator.free(self.old_path);
+        allocator.free(self.new_path);
+    }
+
+    /// Where `note_path` (rooted) lives after the rename.
+    pub fn movedPath(self: Rename, note_path: []const u8) []const u8 {
+        return if (std.mem.eql(u8, note_path, self.old_path)) self.new_path else note_path;
+    }
+};
+
+pub const Result = struct {
+    files_changed: usize = 0,
+    links_changed: usize = 0,
+    /// Notes that could not be read or written; they keep their old links
+    failures: usize = 0,
+};
+
+fn rooted(allocator: Allocator, path: []const u8) ![]u8 {
+    return fs_path.resolvePosix(allocator, &.{ "/", path });
+}
+
+// ============================================================================
+// Link Scanning
+// ============================================================================
+
+/// Half-open byte range of a link destination's path, without angle brackets,
+/// title, `#fragment` or `?query`.
+const Destination = struct {
+    start: usize,
+    end: usize,
+    angle: bool,
+};
+
+/// Calls `ctx.visit(dest)` for every inline link destination in `text`.
+fn scanLinks(text: []const u8, ctx: anytype) !void {
+    var in_fence = false;
+    var fence_char: u8 = 0;
+    var line_start: usize = 0;
+    while (line_start < text.len) {
+        const line_end = std.mem.indexOfScalarPos(u8, text, line_start, '\n') orelse text.len;
+        const line = text[line_start..line_end];
+
+        const indent = std.mem.indexOfNone(u8, line, " ") orelse line.len;
+        const rest = line[indent..];
+        if (indent <= 3 and rest.len >= 3 and (std.mem.startsWith(u8, rest, "```") or std.mem.startsWith(u8, rest, "~~~"))) {
+            if (!in_fence) {
+                in_fence = true;
+                fence_char = rest[0];
+            } else if (rest[0] == fence_char) {
+                in_fence = false;
+            }
+        } else if (!in_fence) {
+            try scanLine(text, line_start, line_end, ctx);
+        }
+        line_start = line_end + 1;
+    }
+}
+
+fn scanLine(text: []const u8, start: usize, end: usize, ctx: anytype) !void {
+    var i = start;
+    while (i < end) {
+        switch (text[i]) {
+            '`' => {
+                // Code span: skip to a closing run of the same length
+                const run_end = std.mem.indexOfNonePos(u8, text[0..end], i, "`") orelse end;
+                const run = text[i..run_end];
+                i = if (std.mem.indexOfPos(u8, text[0..end], run_end, run)) |close| close + run.len else run_end;
+            },
+            ']' => {
+                if (i + 1 < end and text[i + 1] == '(') {
+                    if (parseDestination(text, i + 2, end)) |parsed| {
+                        if (parsed.dest) |dest| try ctx.visit(dest);
+                        i = parsed.close + 1;
+                        continue;
+                    }
+                }
+                i += 1;
+            },
+            else => i += 1,
+        }
+    }
+}
+
+/// Parse `url)` starting after "](", matching parentheses like MdParser does.
+fn parseDestination(text: []const u8, open: usize, end: usize) ?struct { dest: ?Destination, close: usize } {
+    var depth: usize = 1;
+    var close: usize = open;
+    while (close < end) : (close += 1) {
+        if (text[close] == '(') depth += 1;
+        if (text[close] == ')') {
+            depth -= 1;
+            if (depth == 0) break;
+        }
+    } else return null;
+
+    var start = open;
+    while (start < close and text[start] == ' ') start += 1;
+    var angle = false;
+    var stop: usize = undefined;
+    if (start < close and text[start] == '<') {
+        angle = true;
+        start += 1;
+        stop = std.mem.indexOfScalarPos(u8, text[0..close], start, '>') orelse return .{ .dest = null, .close = close };
+    } else {
+        stop = std.mem.indexOfAnyPos(u8, text[0..close], start, " \t") orelse close;
+    }
+    stop = std.mem.indexOfAnyPos(u8, text[0..stop], start, "#?") orelse stop;
+
+    const path = text[start..stop];
+    if (path.len == 0 or hasScheme(path)) return .{ .dest = null, .close = close };
+    return .{ .dest = .{ .start = start, .end = stop, .angle = angle }, .close = close };
+}
+
+/// "https:", "mailto:" and friends: a colon before any slash
+fn hasScheme(path: []const u8) bool {
+    const colon = std.mem.indexOfScalar(u8, path, ':') orelse return false;
+    const slash = std.mem.indexOfScalar(u8, path, '/') orelse path.len;
+    return colon < slash;
+}
+
+fn percentDecode(allocator: Allocator, s: []const u8) ![]u8 {
+    const out = try allocator.alloc(u8, s.len);
+    var n: usize = 0;
+    var i: usize = 0;
+    while (i < s.len) : (n += 1) {
+        if (s[i] == '%' and i + 2 < s.len) {
+            if (std.fmt.parseInt(u8, s[i + 1 .. i + 3], 16)) |byte| {
+                out[n] = byte;
+                i += 3;
+                continue;
+            } else |_| {}
+        }
+        out[n] = s[i];
+        i += 1;
+    }
+    return out[0..n];
+}
+
+/// Path of rooted `target` relative to rooted directory `dir`. Both are
+/// normalized already, so this is just prefix matching on components.
+fn relativePath(allocator: Allocator, dir: []const u8, target: []const u8) ![]u8 {
+    var dir_parts = std.mem.tokenizeScalar(u8, dir, '/');
+    var target_parts = std.mem.tokenizeScalar(u8, target, '/');
+    while (dir_parts.peek()) |d| {
+        const t = target_parts.peek() orelse break;
+        if (!std.mem.eql(u8, d, t)) break;
+        _ = dir_parts.next();
+        _ = target_parts.next();
+    }
+
+    var out = std.ArrayList(u8).empty;
+    while (dir_parts.next() != null) try out.appendSlice(allocator, "../");
+    try out.appendSlice(allocator, target_parts.rest());
+    return out.items;
+}
+
+/// Spaces would end an unbracketed destination, so encode them.
+fn encodeDestination(allocator: Allocator, path: []const u8, angle: bool) ![]u8 {
+    if (angle) return allocator.dupe(u8, path);
+    const spaces = std.mem.count(u8, path, " ");
+    const out = try allocator.alloc(u8, path.len + spaces * 2);
+    var n: usize = 0;
+    for (path) |c| {
+        if (c == ' ') {
+            @memcpy(out[n .. n + 3], "%20");
+            n += 3;
+        } else {
+            out[n] = c;
+            n += 1;
+        }
+    }
+    return out;
+}
+
+// ============================================================================
+// Planning and Applying Edits
+// ============================================================================
+
+const Planner = struct {
+    allocator: Allocator,
+    text: []const u8,
+    rename: Rename,
+    /// Directory links resolve against (where the note is now)
+    from_dir: []const u8,
+    /// Directory links are written relative to (where the note will be)
+    to_dir: []const u8,
+    edits: std.ArrayList(Edit) = .empty,
+
+    fn visit(self: *Planner, dest: Destination) !void {
+        const raw = self.text[dest.start..dest.end];
+        const path = try percentDecode(self.allocator, raw);
+        const absolute = path[0] == '/';
+        const target = if (absolute)
+            try fs_path.resolvePosix(self.allocator, &.{path})
+        else
+            try fs_path.resolvePosix(self.allocator, &.{ self.from_dir, path });
+
+        const renamed = std.mem.eql(u8, target, self.rename.old_path);
+        const moved = !std.mem.eql(u8, self.from_dir, self.to_dir);
+        if (!renamed and (absolute or !moved)) return;
+
+        const new_target = if (renamed) self.rename.new_path else target;
+        const new_path = if (absolute)
+            new_target
+        else
+            try relativePath(self.allocator, self.to_dir, new_target);
+
+        const text = try encodeDestination(self.allocator, new_path, dest.angle);
+        if (std.mem.eql(u8, text, raw)) return;
+        try self.edits.append(self.allocator, .{ .start = dest.start, .end = dest.end, .text = text });
+    }
+};
+
+/// Link edits `rename` implies for the note at `note_path` (vault-relative)
+/// with contents `text`, sorted by offset. If the note is the one being
+/// renamed and changes directory, its other relative links are rebased too.
+/// Everything is allocated from `allocator`; use an arena.
+pub fn planEdits(allocator: Allocator, text: []const u8, note_path: []const u8, rename: Rename) ![]Edit {
+    const note = try rooted(allocator, note_path);
+    var planner = Planner{
+        .allocator = allocator,
+        .text = text,
+        .rename = rename,
+        .from_dir = fs_path.dirnamePosix(note) orelse "/",
+        .to_dir = fs_path.dirnamePosix(rename.movedPath(note)) orelse "/",
+    };
+    try scanLinks(text, &planner);
+    return planner.edits.items;
+}
+
+/// Rebuild `text` with `edits` applied in one pass. Edit offsets are document
+/// offsets and `text` is the part of the document starting at `base`.
+pub fn applyEdits(allocator: Allocator, text: []const u8, base: usize, edits: []const Edit) ![]u8 {
+    var len = text.len;
+    for (edits) |edit| len = len - (edit.end - edit.start) + edit.text.len;
+
+    const out = try allocator.alloc(u8, len);
+    var read: usize = 0;
+    var write: usize = 0;
+    for (edits) |edit| {
+        const start = edit.start - base;
+        @memcpy(out[write .. write + start - read], text[read..start]);
+        write += start - read;
+        @memcpy(out[write .. write + edit.text.len], edit.text);
+        write += edit.text.len;
+        read = edit.end - base;
+    }
+    @memcpy(out[write..], text[read..]);
+    return out;
+}
+
+/// Where byte `offset` ends up after `edits`; offsets inside an edit move to its end.
+pub fn mapOffset(edits: []const Edit, offset: usize) usize {
+    var shifted = offset;
+    for (edits) |edit| {
+        if (edit.start >= offset) break;
+        const new_end = shifted - offset + edit.start + edit.text.len;
+        if (offset < edit.end) return new_end;
+        shifted = shifted + edit.text.len - (edit.end - edit.start);
+    }
+    return shifted;
+}
+
+// ============================================================================
+// Vault Rename
+// ============================================================================
+
+const Job = struct {
+    allocator: Allocator,
+    vault: std.fs.Dir,
+    rename: Rename,
+    /// Every link to the note contains this once percent escapes are decoded
+    needle: []const u8,
+    files_changed: std.atomic.Value(usize) = .init(0),
+    links_changed: std.atomic.Value(usize) = .init(0),
+    failures: std.atomic.Value(usize) = .init(0),
+
+    fn runBatch(self: *Job, paths: []const []const u8) void {
+        var arena = std.heap.ArenaAllocator.init(self.allocator);
+        defer arena.deinit();
+        for (paths) |path| {
+            _ = arena.reset(.retain_capacity);
+            self.rewriteNote(arena.allocator(), path) catch {
+                _ = self.failures.fetchAdd(1, .monotonic);
+            };
+        }
+    }
+
+    fn rewriteNote(self: *Job, scratch: Allocator, path: []const u8) !void {
+        const text = try self.vault.readFileAlloc(scratch, path, MAX_NOTE_SIZE);
+        const is_renamed = std.mem.eql(u8, (try rooted(scratch, path)), self.rename.old_path);
+        if (!is_renamed and !try mayLinkTo(scratch, text, self.needle)) return;
+
+        const edits = try planEdits(scratch, text, path, self.rename);
+        if (edits.len == 0) return;
+        try writeAtomic(self.vault, scratch, path, try applyEdits(scratch, text, 0, edits));
+        _ = self.files_changed.fetchAdd(1, .monotonic);
+        _ = self.links_changed.fetchAdd(edits.len, .monotonic);
+    }
+};
+
+/// Whether `text` can hold a link whose destination names `basename`. Any
+/// byte of a destination may be percent-encoded, so a note with escapes is
+/// searched again decoded; one that is not UTF-8 is always scanned.
+fn mayLinkTo(scratch: Allocator, text: []const u8, basename: []const u8) !bool {
+    if (std.mem.indexOf(u8, text, basename) != null) return true;
+    if (!std.unicode.utf8ValidateSlice(text)) return true;
+    if (std.mem.indexOfScalar(u8, text, '%') == null) return false;
+    return std.mem.indexOf(u8, try percentDecode(scratch, text), basename) != null;
+}
+
+fn writeAtomic(dir: std.fs.Dir, scratch: Allocator, path: []const u8, bytes: []const u8) !void {
+    const tmp_path = try std.fmt.allocPrint(scratch, "{s}.rename-tmp", .{path});
+    {
+        const file = try dir.createFile(tmp_path, .{ .truncate = true });
+        defer file.close();
+        try file.writeAll(bytes);
+    }
+    errdefer dir.deleteFile(tmp_path) catch {};
+    try dir.rename(tmp_path, path);
+}
+
+/// Rename the note `old_path` to `new_path` (both relative to `vault`, which
+/// must be opened with `.iterate = true`) and rewrite every link to it in the
+/// vault's `.md` files. `allocator` must be thread-safe.
+pub fn renameNote(allocator: Allocator, vault: std.fs.Dir, old_path: []const u8, new_path: []const u8) !Result {
+    const rename = try Rename.init(allocator, old_path, new_path);
+    defer rename.deinit(allocator);
+    if (std.mem.eql(u8, rename.old_path, rename.new_path)) return .{};
+
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const scratch = arena.allocator();
+
+    var paths = std.ArrayList([]const u8).empty;
+    {
+        var walker = try vault.walk(allocator);
+        defer walker.deinit();
+        while (try walker.next()) |entry| {
+            if (entry.kind != .file or !std.mem.endsWith(u8, entry.basename, ".md")) continue;
+            try paths.append(scratch, try scratch.dupe(u8, entry.path));
+        }
+    }
+
+    var job = Job{
+        .allocator = allocator,
+        .vault = vault,
+        .rename = rename,
+        .needle = fs_path.basenamePosix(rename.old_path),
+    };
+
+    {
+        var pool: std.Thread.Pool = undefined;
+        try pool.init(.{ .allocator = allocator });
+        defer pool.deinit();
+
+        var wait_group: std.Thread.WaitGroup = .{};
+        var start: usize = 0;
+        while (start < paths.items.len) : (start += BATCH_FILES) {
+            const batch = paths.items[start..@min(start + BATCH_FILES, paths.items.len)];
+            pool.spawnWg(&wait_group, Job.runBatch, .{ &job, batch });
+        }
+        pool.waitAndWork(&wait_group);
+    }
+
+    const new_relative = rename.new_path[1..];
+    if (fs_path.dirnamePosix(new_relative)) |dir| try vault.makePath(dir);
+    try vault.rename(rename.old_path[1..], new_relative);
+
+    return .{
+        .files_changed = job.files_changed.load(.monotonic),
+        .links_changed = job.links_changed.load(.monotonic),
+        .failures = job.failures.load(.monotonic),
+    };
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+fn testRewrite(allocator: Allocator, text: []const u8, note_path: []const u8, old_path: []const u8, new_path: []const u8) ![]u8 {
+    const rename = try Rename.init(allocator, old_path, new_path);
+    const edits = try planEdits(allocator, text, note_path, rename);
+    return applyEdits(allocator, text, 0, edits);
+}
+
+test "rewrites links that resolve to the renamed note" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const text =
+        \\See [one](../a/one.md#intro) and [again](</a/one.md> "title").
+        \\Not [other](other.md) or [web](https://example.com/a/one.md).
+        \\`[code](../a/one.md)` stays, ![img](../a/one.md) moves.
+        \\```
+        \\[fenced](../a/one.md)
+        \\```
+        \\
+    ;
+    const out = try testRewrite(allocator, text, "b/two.md", "a/one.md", "c/new one.md");
+    try std.testing.expectEqualStrings(
+        \\See [one](../c/new%20one.md#intro) and [again](</c/new one.md> "title").
+        \\Not [other](other.md) or [web](https://example.com/a/one.md).
+        \\`[code](../a/one.md)` stays, ![img](../c/new%20one.md) moves.
+        \\```
+        \\[fenced](../a/one.md)
+        \\```
+        \\
+    , out);
+
+    // The renamed note rebases its own relative links
+    const own = try testRewrite(allocator, "[two](../b/two.md) [self](one.md)", "a/one.md", "a/one.md", "a/deep/one.md");
+    try std.testing.expectEqualStrings("[two](../../b/two.md) [self](one.md)", own);
+
+    const edits = [_]Edit{ .{ .start = 2, .end = 4, .text = "xyz" }, .{ .start = 6, .end = 7, .text = "" } };
+    try std.testing.expectEqual(@as(usize, 1), mapOffset(&edits, 1));
+    try std.testing.expectEqual(@as(usize, 5), mapOffset(&edits, 3));
+    try std.testing.expectEqual(@as(usize, 7), mapOffset(&edits, 6));
+    try std.testing.expectEqual(@as(usize, 8), mapOffset(&edits, 8));
+}
+
+test "renameNote rewrites and moves notes on disk" {
+    var tmp = std.testing.tmpDir(.{ .iterate = true });
+    defer tmp.cleanup();
+
+    try tmp.dir.makePath("a");
+    try tmp.dir.makePath("b");
+    try tmp.dir.writeFile(.{ .sub_path = "a/one.md", .data = "[two](../b/two.md)\n" });
+    try tmp.dir.writeFile(.{ .sub_path = "b/two.md", .data = "[one](../a/one.md) [again](/a/one.md)\n" });
+    try tmp.dir.writeFile(.{ .sub_path = "b/three.md", .data = "no links here\n" });
+    try tmp.dir.writeFile(.{ .sub_path = "b/four.md", .data = "[escaped](../a/%6Fne.md)\n" });
+
+    const result = try renameNote(std.testing.allocator, tmp.dir, "a/one.md", "c/d/uno.md");
+    try std.testing.expectEqual(@as(usize, 3), result.files_changed);
+    try std.testing.expectEqual(@as(usize, 4), result.links_changed);
+    try std.testing.expectEqual(@as(usize, 0), result.failures);
+
+    var buf: [128]u8 = undefined;
+    try std.testing.expectEqualStrings("[one](../c/d/uno.md) [again](/c/d/uno.md)\n", try tmp.dir.readFile("b/two.md", &buf));
+    try std.testing.expectEqualStrings("[two](../../b/two.md)\n", try tmp.dir.readFile("c/d/uno.md", &buf));
+    try std.testing.expectEqualStrings("[escaped](../c/d/uno.md)\n", try tmp.dir.readFile("b/four.md", &buf));
+    try std.testing.expectError(error.FileNotFound, tmp.dir.access("a/one.md", .{}));
+}
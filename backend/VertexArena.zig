@@ -0,0 +1,307 @@
+// VertexArena.zig - Per-paragraph vertex chunks inside one persistent buffer
+//
+// Portable (std only). The arena only hands out vertex ranges; the memory is the
+// caller's (e.g. a shared MTLBuffer). Each frame the caller passes one key per
+// paragraph to `sync`: chunks whose key is unchanged keep their vertices, the
+// rest are marked dirty and rebuilt through `reserve`/`commit`. Freed ranges go
+// to a coalescing free list, and `compact` squeezes out holes when they pile up.
+
+const std = @import("std");
+const Allocator = std.mem.Allocator;
+
+const Self = @This();
+
+// ============================================================================
+// Types
+// ============================================================================
+
+/// Half-open vertex range [offset, offset + len).
+pub const Range = struct {
+    offset: usize,
+    len: usize,
+
+    fn end(self: Range) usize {
+        return self.offset + self.len;
+    }
+};
+
+pub const Chunk = struct {
+    /// Identity of the paragraph content this chunk was built from
+    key: u64,
+    offset: usize,
+    /// Vertices written
+    len: usize,
+    /// Vertices owned (len <= capacity)
+    capacity: usize,
+    dirty: bool,
+
+    pub fn range(self: Chunk) Range {
+        return .{ .offset = self.offset, .len = self.len };
+    }
+};
+
+pub const Error = error{OutOfSpace} || Allocator.Error;
+
+// ============================================================================
+// Struct Fields
+// ============================================================================
+
+/// One chunk per paragraph, in document order (after `sync`)
+chunks: std.ArrayList(Chunk) = .empty,
+/// Free ranges sorted by offset, never adjacent (always coalesced)
+free: std.ArrayList(Range) = .empty,
+/// Total vertices in the backing buffer
+capacity: usize = 0,
+/// Vertices owned by chunks
+live: usize = 0,
+
+pub fn deinit(self: *Self, allocator: Allocator) void {
+    self.chunks.deinit(allocator);
+    self.free.deinit(allocator);
+    self.* = .{};
+}
+
+// ============================================================================
+// Frame Sync
+// ============================================================================
+
+/// Match this frame's paragraph keys against the existing chunks. A chunk whose
+/// key reappears keeps its vertices (wherever the paragraph moved to); new keys
+/// get an empty dirty chunk; chunks whose key vanished are freed.
+pub fn sync(self: *Self, allocator: Allocator, keys: []const u64) Allocator.Error!void {
+    var old = self.chunks;
+
+    // key -> most recent old chunk index, with a chain for duplicate keys
+    var by_key = std.AutoHashMapUnmanaged(u64, usize).empty;
+    defer by_key.deinit(allocator);
+    const next_same = try allocator.alloc(?usize, old.items.len);
+    defer allocator.free(next_same);
+    const used = try allocator.alloc(bool, old.items.len);
+    defer allocator.free(used);
+    @memset(used, false);
+
+    try by_key.ensureTotalCapacity(allocator, @intCast(old.items.len));
+    var i = old.items.len;
+    while (i > 0) {
+        i -= 1;
+        const gop = by_key.getOrPutAssumeCapacity(old.items[i].key);
+        next_same[i] = if (gop.found_existing) gop.value_ptr.* else null;
+        gop.value_ptr.* = i;
+    }
+
+    var chunks = try std.ArrayList(Chunk).initCapacity(allocator, keys.len);
+    errdefer chunks.deinit(allocator);
+    for (keys) |key| {
+        if (by_key.getPtr(key)) |head| {
+            const idx = head.*;
+            if (!used[idx]) {
+                used[idx] = true;
+                if (next_same[idx]) |n| head.* = n else _ = by_key.remove(key);
+                chunks.appendAssumeCapacity(old.items[idx]);
+                continue;
+            }
+        }
+        chunks.appendAssumeCapacity(.{ .key = key, .offset = 0, .len = 0, .capacity = 0, .dirty = true });
+    }
+
+    // Return storage of chunks that no longer exist
+    for (old.items, used) |chunk, was_used| {
+        if (!was_used and chunk.capacity > 0) {
+            try self.release(allocator, .{ .offset = chunk.offset, .len = chunk.capacity });
+        }
+    }
+
+    old.deinit(allocator);
+    self.chunks = chunks;
+}
+
+/// Get space for `max_len` vertices for chunk `index`. Reuses the chunk's own
+/// range if it is big enough. Returns the vertex offset to write at.
+pub fn reserve(self: *Self, allocator: Allocator, index: usize, max_len: usize) Error!usize {
+    const chunk = &self.chunks.items[index];
+    if (chunk.capacity >= max_len) return chunk.offset;
+
+    if (chunk.capacity > 0) {
+        try self.release(allocator, .{ .offset = chunk.offset, .len = chunk.capacity });
+        chunk.capacity = 0;
+        chunk.len = 0;
+    }
+    if (max_len == 0) return 0;
+
+    // First fit
+    for (self.free.items, 0..) |*range, fi| {
+        if (range.len < max_len) continue;
+        chunk.offset = range.offset;
+        chunk.capacity = max_len;
+        range.offset += max_len;
+        range.len -= max_len;
+        if (range.len == 0) _ = self.free.orderedRemove(fi);
+        self.live += max_len;
+        return chunk.offset;
+    }
+    return error.OutOfSpace;
+}
+
+/// Finish rebuilding chunk `index` with `len` vertices; unused tail space is freed.
+pub fn commit(self: *Self, allocator: Allocator, index: usize, len: usize) Allocator.Error!void {
+    const chunk = &self.chunks.items[index];
+    std.debug.assert(len <= chunk.capacity);
+    if (chunk.capacity > len) {
+        try self.release(allocator, .{ .offset = chunk.offset + len, .len = chunk.capacity - len });
+        chunk.capacity = len;
+    }
+    chunk.len = len;
+    chunk.dirty = false;
+}
+
+// ============================================================================
+// Space Management
+// ============================================================================
+
+/// The backing buffer grew to `new_capacity` vertices (old contents kept).
+pub fn grow(self: *Self, allocator: Allocator, new_capacity: usize) Allocator.Error!void {
+    if (new_capacity <= self.capacity) return;
+    const old_capacity = self.capacity;
+    self.capacity = new_capacity;
+    // release() also counts the range against `live`; undo that for new space
+    self.live += new_capacity - old_capacity;
+    try self.release(allocator, .{ .offset = old_capacity, .len = new_capacity - old_capacity });
+}
+
+/// Free vertices not at the end of the buffer, i.e. space lost to holes.
+pub fn holeSpace(self: *const Self) usize {
+    var total: usize = 0;
+    for (self.free.items) |range| {
+        if (range.end() == self.capacity) continue;
+        total += range.len;
+    }
+    return total;
+}
+
+/// Compaction pays off once holes make up a quarter of the buffer.
+pub fn needsCompaction(self: *const Self) bool {
+    return self.capacity > 0 and self.holeSpace() * 4 >= self.capacity;
+}
+
+/// Move all chunks to the front of `storage` (in offset order, so each move is
+/// leftwards and safe with memmove) leaving one free range at the end.
+pub fn compact(self: *Self, allocator: Allocator, comptime Vertex: type, storage: [*]Vertex) Allocator.Error!void {
+    const order = try allocator.alloc(usize, self.chunks.items.len);
+    defer allocator.free(order);
+    for (order, 0..) |*o, i| o.* = i;
+
+    const Ctx = struct {
+        chunks: []const Chunk,
+        fn lessThan(ctx: @This(), a: usize, b: usize) bool {
+            return ctx.chunks[a].offset < ctx.chunks[b].offset;
+        }
+    };
+    std.mem.sort(usize, order, Ctx{ .chunks = self.chunks.items }, Ctx.lessThan);
+
+    var write: usize = 0;
+    for (order) |idx| {
+        const chunk = &self.chunks.items[idx];
+        if (chunk.capacity == 0) continue;
+        if (chunk.offset != write) {
+            std.mem.copyForwards(Vertex, storage[write .. write + chunk.len], storage[chunk.offset .. chunk.offset + chunk.len]);
+            chunk.offset = write;
+        }
+        write += chunk.capacity;
+    }
+
+    self.free.clearRetainingCapacity();
+    if (write < self.capacity) {
+        try self.free.append(allocator, .{ .offset = write, .len = self.capacity - write });
+    }
+    self.live = write;
+}
+
+/// Insert a range into the free list, merging with its neighbours.
+fn release(self: *Self, allocator: Allocator, range: Range) Allocator.Error!void {
+    if (range.len == 0) return;
+    self.live -= range.len;
+
+    // First free range after `range`
+    var pos: usize = 0;
+    while (pos < self.free.items.len and self.free.items[pos].offset < range.offset) : (pos += 1) {}
+
+    const merges_prev = pos > 0 and self.free.items[pos - 1].end() == range.offset;
+    const merges_next = pos < self.free.items.len and range.end() == self.free.items[pos].offset;
+
+    if (merges_prev and merges_next) {
+        self.free.items[pos - 1].len += range.len + self.free.items[pos].len;
+        _ = self.free.orderedRemove(pos);
+    } else if (merges_prev) {
+        self.free.items[pos - 1].len += range.len;
+    } else if (merges_next) {
+        self.free.items[pos].offset = range.offset;
+        self.free.items[pos].len += range.len;
+    } else {
+        try self.free.insert(allocator, pos, range);
+    }
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+test "unchanged paragraphs keep their chunks" {
+    const allocator = std.testing.allocator;
+    var arena = Self{};
+    defer arena.deinit(allocator);
+    try arena.grow(allocator, 100);
+
+    try arena.sync(allocator, &.{ 1, 2, 3 });
+    for (0..3) |i| {
+        try std.testing.expect(arena.chunks.items[i].dirty);
+        _ = try arena.reserve(allocator, i, 20);
+        try arena.commit(allocator, i, 10);
+    }
+    try std.testing.expectEqual(@as(usize, 30), arena.live);
+    const offset_of_3 = arena.chunks.items[2].offset;
+
+    // Paragraph 2 edited, a new paragraph inserted before 3
+    try arena.sync(allocator, &.{ 1, 22, 4, 3 });
+    try std.testing.expect(!arena.chunks.items[0].dirty);
+    try std.testing.expect(arena.chunks.items[1].dirty);
+    try std.testing.expect(arena.chunks.items[2].dirty);
+    try std.testing.expect(!arena.chunks.items[3].dirty);
+    try std.testing.expectEqual(offset_of_3, arena.chunks.items[3].offset);
+    try std.testing.expectEqual(@as(usize, 20), arena.live);
+}
+
+test "out of space, grow and compaction" {
+    const allocator = std.testing.allocator;
+    var arena = Self{};
+    defer arena.deinit(allocator);
+    try arena.grow(allocator, 8);
+
+    var storage: [16]u32 = undefined;
+    try arena.sync(allocator, &.{ 10, 20, 30, 40 });
+    for (0..4) |i| {
+        const off = try arena.reserve(allocator, i, 2);
+        storage[off] = @intCast(i * 10);
+        storage[off + 1] = @intCast(i * 10 + 1);
+        try arena.commit(allocator, i, 2);
+    }
+
+    // Full buffer: a new paragraph does not fit until the buffer grows
+    try arena.sync(allocator, &.{ 10, 20, 30, 40, 50 });
+    try std.testing.expectError(error.OutOfSpace, arena.reserve(allocator, 4, 2));
+    try arena.grow(allocator, 16);
+    try std.testing.expectEqual(@as(usize, 8), try arena.reserve(allocator, 4, 2));
+    try arena.commit(allocator, 4, 2);
+
+    // Dropping paragraphs 20 and 40 leaves two holes
+    try arena.sync(allocator, &.{ 10, 30, 50 });
+    try std.testing.expectEqual(@as(usize, 4), arena.holeSpace());
+    try std.testing.expect(arena.needsCompaction());
+
+    try arena.compact(allocator, u32, &storage);
+    try std.testing.expectEqual(@as(usize, 0), arena.holeSpace());
+    try std.testing.expectEqual(@as(usize, 1), arena.free.items.len);
+    const third = arena.chunks.items[1];
+    try std.testing.expectEqual(@as(usize, 2), third.offset);
+    try std.testing.expectEqual(@as(u32, 20), storage[third.offset]);
+    try std.testing.expectEqual(@as(u32, 21), storage[third.offset + 1]);
+}
@@ -0,0 +1,499 @@
+// bench.zig - Headless micro-benchmarks for the portable backend code
+//
+// Run with `zig build bench`. Only imports modules without CoreText/Metal
+// dependencies (Renderer uses a synthetic glyph atlas) so it builds and runs
+// on Linux.
+
+const std = @import("std");
+const SignedDistanceField = @import("SignedDistanceField.zig");
+const VertexArena = @import("VertexArena.zig");
+const GlyphAtlas = @import("GlyphAtlas.zig");
+const Renderer = @import("Renderer.zig");
+const Dawg = @import("Dawg.zig");
+const Fst = @import("Fst.zig");
+const MdParser = @import("MdParser.zig");
+const HistoryStore = @import("HistoryStore.zig");
+const Fingerprint = @import("Fingerprint.zig");
+const TextStorage = @import("TextStorage.zig");
+const PropertyIndex = @import("PropertyIndex.zig");
+const VaultQuery = @import("VaultQuery.zig");
+
+fn report(name: []const u8, iterations: usize, elapsed_ns: u64, bytes_per_iter: usize) void {
+    const per_iter_ns = elapsed_ns / @max(iterations, 1);
+    const total_bytes: f64 = @floatFromInt(bytes_per_iter * iterations);
+    const seconds: f64 = @as(f64, @floatFromInt(elapsed_ns)) / std.time.ns_per_s;
+    const mb_per_s = if (seconds > 0) total_bytes / seconds / (1024 * 1024) else 0;
+    std.debug.print("{s:<32} {d:>10} ns/iter {d:>10.1} MB/s\n", .{ name, per_iter_ns, mb_per_s });
+}
+
+// ============================================================================
+// Signed Distance Field
+// ============================================================================
+
+fn benchSdf(allocator: std.mem.Allocator) !void {
+    // Roughly the size of a 48pt ASCII atlas with SDF padding
+    const width: usize = 640;
+    const height: usize = 384;
+    const coverage = try allocator.alloc(u8, width * height);
+    defer allocator.free(coverage);
+    const out = try allocator.alloc(u8, width * height);
+    defer allocator.free(out);
+
+    // Synthetic "glyphs": a grid of rings
+    for (0..height) |y| {
+        for (0..width) |x| {
+            const cx: f32 = @floatFromInt(x % 40);
+            const cy: f32 = @floatFromInt(y % 48);
+            const d = @sqrt((cx - 20) * (cx - 20) + (cy - 24) * (cy - 24));
+            coverage[y * width + x] = if (d > 8 and d < 14) 255 else 0;
+        }
+    }
+
+    const iterations: usize = 20;
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |_| {
+        try SignedDistanceField.generate(allocator, coverage, width, height, 6.0, out);
+        std.mem.doNotOptimizeAway(out[width * height / 2]);
+    }
+    report("sdf generate 640x384", iterations, timer.read(), width * height);
+}
+
+// ============================================================================
+// Vertex Arena
+// ============================================================================
+
+fn rebuildDirty(
+    allocator: std.mem.Allocator,
+    arena: *VertexArena,
+    comptime Vertex: type,
+    storage: []Vertex,
+    verts_per_paragraph: usize,
+) !usize {
+    var rebuilt: usize = 0;
+    for (arena.chunks.items, 0..) |chunk, i| {
+        if (!chunk.dirty) continue;
+        const offset = arena.reserve(allocator, i, verts_per_paragraph) catch |err| switch (err) {
+            error.OutOfSpace => {
+                // Picked up again next frame
+                try arena.compact(allocator, Vertex, storage.ptr);
+                continue;
+            },
+            else => return err,
+        };
+        @memset(storage[offset .. offset + verts_per_paragraph], std.mem.zeroes(Vertex));
+        try arena.commit(allocator, i, verts_per_paragraph);
+        rebuilt += 1;
+    }
+    return rebuilt;
+}
+
+/// One keystroke in a large document: every frame re-syncs all paragraph keys,
+/// but only the edited paragraph is rebuilt.
+fn benchVertexArena(allocator: std.mem.Allocator) !void {
+    const Vertex = [4]f32;
+    const paragraphs: usize = 10_000;
+    const verts_per_paragraph: usize = 240;
+
+    var arena = VertexArena{};
+    defer arena.deinit(allocator);
+    const capacity = paragraphs * verts_per_paragraph * 2;
+    const storage = try allocator.alloc(Vertex, capacity);
+    defer allocator.free(storage);
+    try arena.grow(allocator, capacity);
+
+    const keys = try allocator.alloc(u64, paragraphs);
+    defer allocator.free(keys);
+    for (keys, 0..) |*k, i| k.* = i;
+
+    // Initial build of every paragraph is not part of the measurement
+    try arena.sync(allocator, keys);
+    _ = try rebuildDirty(allocator, &arena, Vertex, storage, verts_per_paragraph);
+
+    const iterations: usize = 200;
+    var rebuilt: usize = 0;
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |iter| {
+        keys[(iter * 7919) % paragraphs] +%= paragraphs;
+        try arena.sync(allocator, keys);
+        rebuilt += try rebuildDirty(allocator, &arena, Vertex, storage, verts_per_paragraph);
+    }
+    report("vertex arena 10k paras, 1 edit", iterations, timer.read(), paragraphs * @sizeOf(u64));
+    std.mem.doNotOptimizeAway(rebuilt);
+}
+
+// ============================================================================
+// Layout and Glyph Vertices
+// ============================================================================
+
+/// Markdown-ish prose: words of varying length, paragraphs every few lines.
+fn makeDocument(allocator: std.mem.Allocator, size: usize) ![]u8 {
+    const words = [_][]const u8{ "the", "quick", "brown", "fox", "jumps", "over", "a", "lazy", "dog", "**bold**", "[[link]]", "#tag", "![[embed]]" };
+    const text = try allocator.alloc(u8, size);
+    var prng = std.Random.DefaultPrng.init(42);
+    const random = prng.random();
+
+    var i: usize = 0;
+    var words_in_line: usize = 0;
+    while (i < size) {
+        const word = words[random.uintLessThan(usize, words.len)];
+        const n = @min(word.len, size - i);
+        @memcpy(text[i .. i + n], word[0..n]);
+        i += n;
+        if (i >= size) break;
+        words_in_line += 1;
+        if (words_in_line == 14) {
+            text[i] = '\n';
+            words_in_line = 0;
+        } else {
+            text[i] = ' ';
+        }
+        i += 1;
+    }
+    return text;
+}
+
+fn benchLayout(allocator: std.mem.Allocator) !void {
+    const size: usize = 1 << 20;
+    const text = try makeDocument(allocator, size);
+    defer allocator.free(text);
+
+    var renderer = Renderer.init(GlyphAtlas.synthetic(16));
+    defer renderer.deinit();
+    if (!renderer.ensureLayoutCapacity(size)) return error.OutOfMemory;
+
+    const iterations: usize = 20;
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |_| {
+        renderer.layout_result = renderer.layoutText(text, 900, renderer.layout_buf);
+        std.mem.doNotOptimizeAway(renderer.layout_result.final_baseline_y);
+    }
+    report("layoutText 1 MiB", iterations, timer.read(), size);
+
+    const max_vertices = size * Renderer.VERTICES_PER_CHAR;
+    const vertices = try allocator.alloc(Renderer.GlyphVertex, max_vertices);
+    defer allocator.free(vertices);
+
+    timer.reset();
+    for (0..iterations) |_| {
+        const n = renderer.buildGlyphVertices(text, vertices.ptr, max_vertices);
+        std.mem.doNotOptimizeAway(vertices[n / 2]);
+    }
+    report("buildGlyphVertices 1 MiB", iterations, timer.read(), size);
+}
+
+// ============================================================================
+// Spell Check Dictionary
+// ============================================================================
+
+fn benchDawg(allocator: std.mem.Allocator) !void {
+    // Pseudo-words from a small syllable set: plenty of shared prefixes and
+    // suffixes, like a real word list
+    const syllables = [_][]const u8{ "re", "con", "ing", "tion", "ed", "pre", "al", "er", "ous", "ment", "st", "an" };
+    const word_count: usize = 100_000;
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const scratch = arena.allocator();
+
+    var prng = std.Random.DefaultPrng.init(7);
+    const random = prng.random();
+    const words = try scratch.alloc([]const u8, word_count);
+    for (words) |*word| {
+        var buf: [Dawg.MAX_WORD_LEN]u8 = undefined;
+        var len: usize = 0;
+        const parts = 2 + random.uintLessThan(usize, 4);
+        for (0..parts) |_| {
+            const syllable = syllables[random.uintLessThan(usize, syllables.len)];
+            @memcpy(buf[len .. len + syllable.len], syllable);
+            len += syllable.len;
+        }
+        word.* = try scratch.dupe(u8, buf[0..len]);
+    }
+
+    var timer = try std.time.Timer.start();
+    const bytes = try Dawg.build(allocator, words);
+    defer allocator.free(bytes);
+    report("Dawg.build 100k words", 1, timer.read(), 0);
+    std.debug.print("{s:<32} {d:>10} bytes\n", .{ "  compiled size", bytes.len });
+
+    const automaton = try Dawg.Automaton.init(bytes);
+    timer.reset();
+    var hits: usize = 0;
+    for (words) |word| hits += @intFromBool(automaton.contains(word));
+    std.mem.doNotOptimizeAway(hits);
+    report("Dawg.contains", word_count, timer.read(), 0);
+
+    var suggestions: [8]Dawg.Suggestion = undefined;
+    const iterations: usize = 200;
+    timer.reset();
+    for (0..iterations) |i| {
+        var buf: [Dawg.MAX_WORD_LEN]u8 = undefined;
+        const word = words[i];
+        @memcpy(buf[0..word.len], word);
+        buf[word.len / 2] = 'x';
+        std.mem.doNotOptimizeAway(automaton.suggest(buf[0..word.len], 2, &suggestions));
+    }
+    report("Dawg.suggest distance 2", iterations, timer.read(), 0);
+}
+
+fn benchFst(allocator: std.mem.Allocator) !void {
+    const syllables = [_][]const u8{ "re", "con", "ing", "tion", "ed", "pre", "al", "er", "ous", "ment", "st", "an" };
+    const word_count: usize = 100_000;
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const scratch = arena.allocator();
+
+    var prng = std.Random.DefaultPrng.init(11);
+    const random = prng.random();
+    const entries = try scratch.alloc(Fst.Entry, word_count);
+    for (entries) |*entry| {
+        var buf: [Fst.MAX_WORD_LEN]u8 = undefined;
+        var len: usize = 0;
+        const parts = 2 + random.uintLessThan(usize, 4);
+        for (0..parts) |_| {
+            const syllable = syllables[random.uintLessThan(usize, syllables.len)];
+            @memcpy(buf[len .. len + syllable.len], syllable);
+            len += syllable.len;
+        }
+        // Zipf-like counts, as word frequencies in notes are
+        entry.* = .{ .word = try scratch.dupe(u8, buf[0..len]), .weight = 1 + 10_000 / (1 + random.uintLessThan(u32, 10_000)) };
+    }
+
+    var timer = try std.time.Timer.start();
+    const bytes = try Fst.build(allocator, entries);
+    defer allocator.free(bytes);
+    report("Fst.build 100k words", 1, timer.read(), 0);
+    std.debug.print("{s:<32} {d:>10} bytes\n", .{ "  compiled size", bytes.len });
+
+    const transducer = try Fst.Transducer.init(bytes);
+    var completions: [8]Fst.Completion = undefined;
+    const prefixes = [_][]const u8{ "r", "con", "preal", "stan" };
+    const iterations: usize = 2000;
+    timer.reset();
+    for (0..iterations) |i| {
+        const prefix = prefixes[i % prefixes.len];
+        std.mem.doNotOptimizeAway(try transducer.complete(scratch, prefix, &completions));
+    }
+    report("Fst.complete top 8", iterations, timer.read(), 0);
+}
+
+// ============================================================================
+// Version History
+// ============================================================================
+
+fn benchChunking(allocator: std.mem.Allocator) !void {
+    const size: usize = 1 << 20;
+    const text = try makeDocument(allocator, size);
+    defer allocator.free(text);
+
+    const iterations: usize = 20;
+    var chunks: usize = 0;
+    var timer = try std.time.Timer.start();
+    for (0..iterations) |_| {
+        chunks = 0;
+        var pos: usize = 0;
+        while (pos < text.len) : (chunks += 1) pos += HistoryStore.cutPoint(text[pos..]);
+    }
+    report("cutPoint 1 MiB", iterations, timer.read(), size);
+    std.debug.print("{s:<32} {d:>10} bytes\n", .{ "  average chunk", size / @max(chunks, 1) });
+
+    timer.reset();
+    for (0..iterations) |_| {
+        var pos: usize = 0;
+        while (pos < text.len) {
+            const n = HistoryStore.cutPoint(text[pos..]);
+            std.mem.doNotOptimizeAway(HistoryStore.chunkId(text[pos..][0..n]));
+            pos += n;
+        }
+    }
+    report("cutPoint + chunkId 1 MiB", iterations, timer.read(), size);
+}
+
+fn benchFingerprint(allocator: std.mem.Allocator) !void {
+    const size: usize = 1 << 20;
+    const text = try makeDocument(allocator, size);
+    defer allocator.free(text);
+
+    var timer = try std.time.Timer.start();
+    var tree = try Fingerprint.build(allocator, text);
+    defer tree.deinit();
+    report("Fingerprint.build 1 MiB", 1, timer.read(), size);
+
+    // One keystroke: a byte replaced in place, then the tree updated
+    var prng = std.Random.DefaultPrng.init(5);
+    const random = prng.random();
+    const iterations: usize = 100_000;
+    timer.reset();
+    for (0..iterations) |_| {
+        const offset = random.uintLessThan(usize, text.len);
+        text[offset] = 'a' + random.uintLessThan(u8, 26);
+        try tree.splice(text, offset, offset + 1, offset + 1);
+    }
+    report("Fingerprint.splice keystroke", iterations, timer.read(), 1);
+    std.mem.doNotOptimizeAway(tree.whole());
+}
+
+// ============================================================================
+// Text Storage
+// ============================================================================
+
+const TraceOp = struct {
+    offset: usize,
+    delete: usize,
+    insert: []const u8,
+};
+
+/// A writing session: typing and backspacing in bursts at a cursor that
+/// mostly stays put, with occasional jumps and pastes elsewhere
+fn makeEditTrace(allocator: std.mem.Allocator, start_len: usize, count: usize) ![]TraceOp {
+    const ops = try allocator.alloc(TraceOp, count);
+    var prng = std.Random.DefaultPrng.init(13);
+    const random = prng.random();
+    const paste = "pasted [[link]] and a **bold** word\n";
+
+    var size = start_len;
+    var cursor = size / 2;
+    for (ops) |*op| {
+        if (random.uintLessThan(u32, 100) == 0) cursor = random.uintLessThan(usize, size + 1);
+        const roll = random.uintLessThan(u32, 100);
+        if (roll < 80) {
+            op.* = .{ .offset = cursor, .delete = 0, .insert = "etaoin shrdlu\n"[random.uintLessThan(usize, 14)..][0..1] };
+        } else if (roll < 98) {
+            const n = @min(cursor, 1 + random.uintLessThan(usize, 3));
+            op.* = .{ .offset = cursor - n, .delete = n, .insert = "" };
+        } else {
+            op.* = .{ .offset = cursor, .delete = 0, .insert = paste };
+        }
+        size = size - op.delete + op.insert.len;
+        cursor = op.offset + op.insert.len;
+    }
+    return ops;
+}
+
+/// Replays `trace` against storage `T`; with `contiguous`, also asks for the
+/// whole text after every edit, as a session does to reparse
+fn replayTrace(comptime T: type, allocator: std.mem.Allocator, name: []const u8, text: []const u8, trace: []const TraceOp, contiguous: bool) !void {
+    var storage = try T.create(allocator, text);
+    defer storage.deinit(allocator);
+
+    const latencies = try allocator.alloc(u64, trace.len);
+    defer allocator.free(latencies);
+    var total = try std.time.Timer.start();
+    var timer = try std.time.Timer.start();
+    for (trace, 0..) |op, i| {
+        timer.reset();
+        if (op.delete > 0) try storage.delete_range(op.offset, op.offset + op.delete);
+        if (op.insert.len > 0) try storage.insert(allocator, op.offset, op.insert);
+        if (contiguous) std.mem.doNotOptimizeAway(storage.contents().ptr);
+        latencies[i] = timer.read();
+    }
+    report(name, trace.len, total.read(), 1);
+
+    std.mem.sort(u64, latencies, {}, std.sort.asc(u64));
+    std.debug.print("{s:<32} {d:>10} ns p99 {d:>10} KiB\n", .{
+        "  worst 1%",
+        latencies[latencies.len * 99 / 100],
+        storage.memoryUsed() / 1024,
+    });
+}
+
+fn benchTextStorage(allocator: std.mem.Allocator) !void {
+    const size: usize = 1 << 20;
+    const text = try makeDocument(allocator, size);
+    defer allocator.free(text);
+    const trace = try makeEditTrace(allocator, size, 20_000);
+    defer allocator.free(trace);
+
+    try replayTrace(TextStorage.Editor, allocator, "array storage, edit trace", text, trace, false);
+    try replayTrace(TextStorage.GapBuffer, allocator, "gap storage, edit trace", text, trace, false);
+    try replayTrace(TextStorage.Editor, allocator, "array storage, trace + contents", text, trace, true);
+    try replayTrace(TextStorage.GapBuffer, allocator, "gap storage, trace + contents", text, trace, true);
+}
+
+// ============================================================================
+// Markdown Parser
+// ============================================================================
+
+fn benchParser(allocator: std.mem.Allocator) !void {
+    const size: usize = 1 << 20;
+    const text = try makeDocument(allocator, size);
+    defer allocator.free(text);
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+
+    const iterations: usize = 20;
+    const configs = .{
+        .{ "parse core 1 MiB", MdParser.Core },
+        .{ "parse vault 1 MiB", MdParser.Vault },
+    };
+    inline for (configs) |config| {
+        var timer = try std.time.Timer.start();
+        for (0..iterations) |_| {
+            _ = arena.reset(.retain_capacity);
+            const root = try config[1].parseBlocks(arena.allocator(), text);
+            try config[1].parseInline(arena.allocator(), root);
+        }
+        report(config[0], iterations, timer.read(), size);
+    }
+}
+
+// ============================================================================
+// Vault Query
+// ============================================================================
+
+fn benchQuery(allocator: std.mem.Allocator) !void {
+    const notes: usize = 100_000;
+    const now: i64 = 20_000 * std.time.s_per_day;
+    var index = PropertyIndex.init(allocator);
+    defer index.deinit();
+
+    var prng = std.Random.DefaultPrng.init(7);
+    const random = prng.random();
+    var text = std.ArrayList(u8).empty;
+    defer text.deinit(allocator);
+    var path_buf: [32]u8 = undefined;
+
+    var timer = try std.time.Timer.start();
+    for (0..notes) |i| {
+        text.clearRetainingCapacity();
+        const status = if (random.boolean()) "open" else "done";
+        try text.print(allocator, "---\nstatus: {s}\npriority: {d}\n---\n", .{ status, random.uintLessThan(u8, 5) });
+        if (random.uintLessThan(u8, 10) == 0) try text.appendSlice(allocator, "#project ");
+        for (0..random.uintLessThan(usize, 200)) |_| try text.appendSlice(allocator, "word ");
+        const note_path = try std.fmt.bufPrint(&path_buf, "/vault/{d}.md", .{i});
+        const age: i64 = random.uintLessThan(u16, 365);
+        try index.update(note_path, text.items, now - age * std.time.s_per_day);
+    }
+    report("PropertyIndex.update 100k notes", 1, timer.read(), 0);
+
+    const queries = [_][]const u8{
+        "#project AND modified >= today-7 SORT words DESC LIMIT 20",
+        "status = open priority >= 3 SORT modified DESC LIMIT 50",
+        "NOT status = done OR words < 10",
+    };
+    const iterations: usize = 50;
+    for (queries) |query| {
+        timer.reset();
+        for (0..iterations) |_| {
+            const rows = try VaultQuery.execute(allocator, &index, query, now, 0);
+            allocator.free(rows);
+        }
+        report(query[0..@min(query.len, 32)], iterations, timer.read(), 0);
+    }
+}
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    try benchSdf(allocator);
+    try benchVertexArena(allocator);
+    try benchLayout(allocator);
+    try benchDawg(allocator);
+    try benchFst(allocator);
+    try benchChunking(allocator);
+    try benchFingerprint(allocator);
+    try benchTextStorage(allocator);
+    try benchParser(allocator);
+    try benchQuery(allocator);
+}
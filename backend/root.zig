@@ -1,4 +1,31 @@
 const std = @import("std");
+
+// Portable modules (no CoreText/Metal), testable on any host
+pub const SignedDistanceField = @import("SignedDistanceField.zig");
+pub const FrameScheduler = @import("FrameScheduler.zig");
+pub const Damage = @import("Damage.zig");
+pub const VertexArena = @import("VertexArena.zig");
+pub const GlyphAtlas = @import("GlyphAtlas.zig");
+pub const Renderer = @import("Renderer.zig");
+pub const Dawg = @import("Dawg.zig");
+pub const Fst = @import("Fst.zig");
+pub const SpellCheck = @import("SpellCheck.zig");
+pub const Completion = @import("Completion.zig");
+pub const VaultRename = @import("VaultRename.zig");
+pub const HistoryStore = @import("HistoryStore.zig");
+pub const Transclusion = @import("Transclusion.zig");
+pub const ImageProbe = @import("ImageProbe.zig");
+pub const Frontmatter = @import("Frontmatter.zig");
+pub const PropertyIndex = @import("PropertyIndex.zig");
+pub const VaultQuery = @import("VaultQuery.zig");
+pub const Outline = @import("Outline.zig");
+pub const SequenceCrdt = @import("SequenceCrdt.zig");
+pub const Encoding = @import("Encoding.zig");
+pub const LineEnding = @import("LineEnding.zig");
+pub const Fingerprint = @import("Fingerprint.zig");
+pub const TextStorage = @import("TextStorage.zig");
+pub const QuickAppend = @import("QuickAppend.zig");
+
 test {
     // This runs all tests in imported files
     std.testing.refAllDecls(@This());
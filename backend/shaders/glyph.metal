@@ -32,3 +32,15 @@ fragment float4 glyph_fragment_main(VertexOut in [[stage_in]],
     float alpha = tex.sample(smp, in.texcoord).r;
     return float4(text_color.rgb, alpha);
 }
+
+// Distance-field atlas: 0.5 is the glyph edge. Antialias over one screen pixel
+// using the derivative so edges stay crisp at any scale.
+fragment float4 glyph_sdf_fragment_main(VertexOut in [[stage_in]],
+                                   texture2d<float> tex [[texture(0)]],
+                                   sampler smp [[sampler(0)]],
+                                   constant float4 &text_color [[buffer(1)]]) {
+    float dist = tex.sample(smp, in.texcoord).r;
+    float edge_width = max(fwidth(dist) * 0.5, 1.0 / 255.0);
+    float alpha = smoothstep(0.5 - edge_width, 0.5 + edge_width, dist);
+    return float4(text_color.rgb, alpha);
+}
@@ -26,14 +26,25 @@ fn addMacFrameworkPaths(b: *std.Build, lib: *std.Build.Step.Compile) void {
     lib.addSystemFrameworkPath(.{ .cwd_relative = "/Library/Frameworks" });
 }
 
+/// Buffer behind each edit session (backend/TextStorage.zig)
+const TextStorage = enum { array, gap };
+
 pub fn build(b: *std.Build) void {
     const target = b.standardTargetOptions(.{});
     const optimize = b.standardOptimizeOption(.{});
 
+    const options = b.addOptions();
+    const text_storage = b.option(TextStorage, "text_storage", "Session text buffer: array (default) or gap") orelse .array;
+    options.addOption(TextStorage, "text_storage", text_storage);
+    const options_mod = options.createModule();
+
     // Backend module - this is your Zig code in the backend/ directory
     const backend_mod = b.addModule("backend", .{
         .root_source_file = b.path("backend/root.zig"),
         .target = target,
+        .imports = &.{
+            .{ .name = "build_options", .module = options_mod },
+        },
     });
 
     // Executable that uses the backend
@@ -73,6 +84,9 @@ pub fn build(b: *std.Build) void {
             .root_source_file = b.path("backend/Exports.zig"),
             .target = macos_aarch64_target,
             .optimize = optimize,
+            .imports = &.{
+                .{ .name = "build_options", .module = options_mod },
+            },
         }),
     });
     addMacFrameworkPaths(b, lib_aarch64);
@@ -90,6 +104,9 @@ pub fn build(b: *std.Build) void {
             .root_source_file = b.path("backend/Exports.zig"),
             .target = macos_x86_64_target,
             .optimize = optimize,
+            .imports = &.{
+                .{ .name = "build_options", .module = options_mod },
+            },
         }),
     });
     addMacFrameworkPaths(b, lib_x86_64);
@@ -141,6 +158,22 @@ pub fn build(b: *std.Build) void {
     test_step.dependOn(&run_backend_tests.step);
     test_step.dependOn(&run_exe_tests.step);
 
+    // Benchmarks for portable backend code (always optimized)
+    const bench_exe = b.addExecutable(.{
+        .name = "bench",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("backend/bench.zig"),
+            .target = target,
+            .optimize = .ReleaseFast,
+            .imports = &.{
+                .{ .name = "build_options", .module = options_mod },
+            },
+        }),
+    });
+    const run_bench = b.addRunArtifact(bench_exe);
+    const bench_step = b.step("bench", "Run backend benchmarks");
+    bench_step.dependOn(&run_bench.step);
+
     // Check step for ZLS build-on-save feature
     // This allows ZLS to compile and check for errors on save
     // We check both the backend module and the main executable
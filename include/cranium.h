@@ -14,8 +14,8 @@
 /**
  * Block type tags - must match BlockTypeTag enum in md_parser.zig
  *
- * Block types (0-8): Document structure elements
- * Inline types (9-14): Text formatting elements
+ * Block types (0-8, 16): Document structure elements
+ * Inline types (9-15): Text formatting elements
  */
 typedef enum
 {
@@ -36,6 +36,9 @@ typedef enum
     BlockType_StrongEmph = 12,
     BlockType_Link = 13,
     BlockType_Image = 14,
+    BlockType_Embed = 15, // ![[Note]]; children hold the embedded note's Document
+    // block types added later
+    BlockType_Frontmatter = 16, // leading --- YAML block, delimiters included
 } BlockTypeTag;
 
 /**
@@ -114,6 +117,20 @@ typedef struct CCursorMetrics
     float line_height;
 } CCursorMetrics;
 
+/**
+ * What a session call changed, as bits of CEditSession.changes. Cursor moves
+ * set only Cursor and Metrics; root_block is then the same tree as before.
+ * Text means text_ptr/text_len point at new contents; Tree means root_block
+ * was rebuilt and the previous CBlock pointers must no longer be used.
+ */
+typedef enum
+{
+    SyncChange_Text = 1 << 0,
+    SyncChange_Tree = 1 << 1,
+    SyncChange_Cursor = 1 << 2,
+    SyncChange_Metrics = 1 << 3,
+} SyncChange;
+
 typedef struct CEditSession
 {
     CBlock *root_block;
@@ -124,6 +141,11 @@ typedef struct CEditSession
     size_t text_len;
     void *session_ptr;
     size_t cursor_byte_offset;
+    /** SyncChange bits set since the GUI last cleared them (write 0 once handled) */
+    uint32_t changes;
+    /** Backend bookkeeping; do not touch */
+    uint64_t synced_generation;
+    const void *synced_root;
 } CEditSession;
 
 /**
@@ -203,10 +225,431 @@ void setCursorByteOffset(CEditSession *session, size_t byte_offset);
  */
 void deleteTextRange(CEditSession *session, size_t start_offset, size_t end_offset);
 
+/**
+ * Replace the half-open byte range [start_offset, end_offset) with text, as
+ * one undo step. Same-length replacements (e.g. toggling "[ ]" to "[x]") are
+ * patched in place and only reparse the inline content they touch.
+ *
+ * @param session Pointer to the CEditSession.
+ * @param start_offset Start byte offset (inclusive).
+ * @param end_offset End byte offset (exclusive).
+ * @param text UTF-8 replacement text.
+ * @param text_len Length of text in bytes.
+ */
+void replaceTextRange(CEditSession *session, size_t start_offset, size_t end_offset, const char *text, size_t text_len);
+
+typedef enum
+{
+    FileEncoding_Utf8 = 0,
+    FileEncoding_Utf8Bom = 1,
+    FileEncoding_Utf16LE = 2,
+    FileEncoding_Utf16BE = 3,
+    FileEncoding_Latin1 = 4,
+} FileEncoding;
+
+/**
+ * Encoding the note's file was opened in. The session text is always UTF-8;
+ * saving converts back, except that a Latin-1 note gaining characters
+ * Latin-1 cannot hold is saved as UTF-8 from then on.
+ *
+ * @param session Pointer to the CEditSession.
+ * @return One of FileEncoding, or -1 for an invalid session.
+ */
+int getFileEncoding(CEditSession *session);
+
+/**
+ * Whether the session text differs from what was last opened or saved.
+ * Compares fingerprints kept up to date on every edit, so it costs nothing.
+ *
+ * @param session Pointer to the CEditSession.
+ * @return 1 if there are unsaved changes, 0 if not, -1 for an invalid session.
+ */
+int hasUnsavedChanges(CEditSession *session);
+
+/**
+ * Whether the note's file was changed by something else (a sync tool, another
+ * editor) since it was last opened or saved here. Reads the whole file.
+ *
+ * @param session Pointer to the CEditSession.
+ * @return 1 if the file changed, 0 if not, -1 if it could not be read.
+ */
+int fileChangedOnDisk(CEditSession *session);
+
+/**
+ * Fingerprint of the text in [start_offset, end_offset): a 61-bit hash that is
+ * the same for equal bytes wherever they are, usable as a cache key for a
+ * block or the whole note. Ranges are clamped to the text.
+ *
+ * @param session Pointer to the CEditSession.
+ * @param start_offset Byte offset of the range start.
+ * @param end_offset Byte offset of the range end.
+ * @return The fingerprint, or 0 for an invalid session.
+ */
+uint64_t getTextFingerprint(CEditSession *session, size_t start_offset, size_t end_offset);
+
+// ============================================================================
+// Outline
+// ============================================================================
+
+/**
+ * A block start in the current note. Headings have a level of 1-6 and a
+ * title; every other block has level 0 and an empty title.
+ */
+typedef struct COutlineEntry
+{
+    size_t offset;
+    BlockTypeTag block_type;
+    uint32_t level;
+    const char *title_ptr; // points into the session text; copy before editing
+    size_t title_len;
+} COutlineEntry;
+
+typedef enum
+{
+    OutlineJump_NextHeading = 0,
+    OutlineJump_PrevHeading = 1,
+    OutlineJump_NextBlock = 2,
+    OutlineJump_PrevBlock = 3,
+} OutlineJump;
+
+/**
+ * Copy the outline of the session's note: headings and block starts in
+ * document order. Rebuilt on every parse. Filter on level > 0 for a table
+ * of contents.
+ *
+ * @param session Pointer to the CEditSession.
+ * @param out Array receiving up to max_count entries, or NULL to query the count.
+ * @param max_count Capacity of out.
+ * @return Number of entries written, or the total count when out is NULL.
+ */
+size_t getOutline(CEditSession *session, COutlineEntry *out, size_t max_count);
+
+/**
+ * Move the cursor to the next/previous heading or block start. Also bound to
+ * Option-Up/Down (blocks) and Command-Option-Up/Down (headings) in
+ * handleKeyEvent.
+ *
+ * @param session Pointer to the CEditSession.
+ * @param jump One of OutlineJump.
+ * @return 1 if the cursor moved, 0 if there is nothing in that direction.
+ */
+int jumpCursor(CEditSession *session, OutlineJump jump);
+
+// ============================================================================
+// Vault
+// ============================================================================
+
+/**
+ * Rename or move a note and rewrite every [text](path) link to it in the
+ * vault's .md files. Notes are rewritten in parallel, each atomically (temp
+ * file + rename). Open edit sessions get the same rewrite in their buffer as
+ * a single undoable edit, and a session for the moved note saves to the new
+ * path. Both paths must be inside the vault.
+ *
+ * @param vault_root Absolute path of the vault directory.
+ * @param old_path Absolute path of the note.
+ * @param new_path Absolute path to move it to.
+ * @return 0 on success, -1 on error.
+ */
+int renameNote(const char *vault_root, const char *old_path, const char *new_path);
+
+// ============================================================================
+// Images
+// ============================================================================
+
+/**
+ * Pixel size of an image, read from its file header.
+ */
+typedef struct CImageSize
+{
+    uint32_t width;
+    uint32_t height;
+} CImageSize;
+
+/**
+ * Size of a local PNG, JPEG, GIF or WebP image without decoding it. Images in
+ * open notes are probed in the background when the note is parsed; other
+ * paths are queued on the first call. Results are cached until the file's
+ * mtime changes.
+ *
+ * @param path Absolute path of the image.
+ * @param out Receives the size.
+ * @return 1 if the size is known, 0 if it is still being probed or the file
+ *         is missing or not a supported image.
+ */
+int getImageSize(const char *path, CImageSize *out);
+
+/**
+ * Size of an image a note links to, like getImageSize. The URL is resolved
+ * the way the session resolved it when it queued the probe: file:// URLs and
+ * absolute paths as they are, other local URLs relative to the note's
+ * folder, with percent escapes decoded. Remote URLs return 0.
+ *
+ * @param session The session of the note holding the image.
+ * @param url The image URL as written in the note.
+ * @param out Receives the size.
+ * @return 1 if the size is known, 0 otherwise (see getImageSize).
+ */
+int getNoteImageSize(CEditSession *session, const char *url, CImageSize *out);
+
+// ============================================================================
+// Properties
+// ============================================================================
+
+/**
+ * Build the vault-wide metadata index from every .md file under vault_root:
+ * frontmatter properties, tags, word and link counts and mtimes. Once built,
+ * it is updated on every save, so property filters and queries never have to
+ * open the notes.
+ *
+ * @param vault_root Absolute path of the vault.
+ * @return Number of notes indexed, or -1 on error.
+ */
+ptrdiff_t indexVaultProperties(const char *vault_root);
+
+/**
+ * Notes whose property `key` equals `value`: the same text, a list (such as
+ * tags) containing it, or the same number, boolean or YYYY-MM-DD date.
+ *
+ * @param key Property name.
+ * @param value Value to match, written as it would be in YAML.
+ * @param out Buffer receiving absolute note paths separated by '\n' (not
+ *            null-terminated). Paths that do not fit are left out.
+ * @param out_len Capacity of out in bytes.
+ * @return Bytes written.
+ */
+size_t findNotesWithProperty(const char *key, const char *value, char *out, size_t out_len);
+
+/**
+ * Run a query over the metadata index, e.g.
+ * "#project AND modified >= today-7 SORT words DESC LIMIT 20".
+ *
+ * Terms are #tag or `field op value`, with op one of = != < <= > >=. Terms
+ * combine with AND (or plain juxtaposition), OR, NOT and parentheses. Fields
+ * are frontmatter keys plus modified, words and links. Values are typed like
+ * YAML scalars. `today` and `today-N` are dates. SORT also accepts path.
+ * Dates are local days, and `modified` compares with them at day granularity
+ * (`modified = today` matches anything saved today).
+ *
+ * @param query Query text.
+ * @param utc_offset Seconds the local time zone is ahead of UTC, e.g.
+ *                   TimeZone.current.secondsFromGMT().
+ * @param out Buffer receiving matching note paths in order, separated by
+ *            '\n' (not null-terminated). Paths that do not fit are left out.
+ * @param out_len Capacity of out in bytes.
+ * @return Bytes written, or -1 if the query does not parse.
+ */
+ptrdiff_t queryVault(const char *query, int32_t utc_offset, char *out, size_t out_len);
+
+// ============================================================================
+// Quick Capture
+// ============================================================================
+
+/**
+ * Append text to the end of a note without opening a session, creating the
+ * note if it does not exist. The file is opened with O_APPEND and locked with
+ * flock while writing, and only its first bytes (for the encoding) and last
+ * line are read, so a capture costs the same for any note size. Open
+ * sessions of the note, the property index and cached embeds are updated
+ * from the appended text.
+ *
+ * @param path Absolute path of the note.
+ * @param text UTF-8 text to append, written in the note's encoding and with
+ *             its line breaks in the note's style (LF or CRLF, as its last
+ *             lines use).
+ * @return 0 on success, -1 on error (including text a Latin-1 note cannot
+ *         hold).
+ */
+int quickAppend(const char *path, const char *text);
+
+// ============================================================================
+// Version History
+// ============================================================================
+
+/**
+ * A saved version of a note.
+ */
+typedef struct CNoteVersion
+{
+    uint32_t id;
+    int64_t timestamp; // seconds since the epoch
+    uint64_t size;     // bytes
+} CNoteVersion;
+
+/**
+ * Open (or create) the version history store in a directory. Once open, every
+ * save records a version; unchanged content is stored only once, so a
+ * lightly edited note costs a few KB per version. Opened once per process.
+ *
+ * @param store_path Absolute path of the store directory.
+ * @return 0 on success, -1 on error.
+ */
+int openHistoryStore(const char *store_path);
+
+/**
+ * List the saved versions of a note, newest first.
+ *
+ * @param note_path Absolute path of the note, as passed to createEditSession.
+ * @param out Array receiving up to max_count versions.
+ * @param max_count Capacity of out.
+ * @return Number of versions written, or -1 if no store is open.
+ */
+ptrdiff_t getNoteVersions(const char *note_path, CNoteVersion *out, size_t max_count);
+
+/**
+ * Reconstruct a saved version. Call with out = NULL to get the size first;
+ * the text is only copied when out_len is large enough.
+ *
+ * @param version_id Version id from getNoteVersions.
+ * @param out Buffer receiving the text (not null-terminated).
+ * @param out_len Capacity of out in bytes.
+ * @return Size of the version in bytes, or -1 if there is no such version.
+ */
+ptrdiff_t readNoteVersion(uint32_t version_id, char *out, size_t out_len);
+
+// ============================================================================
+// Sync
+// ============================================================================
+
+/**
+ * Keep a mergeable history of the session's edits so copies of the note
+ * edited on two machines can be merged instead of ending up as conflict
+ * copies. Each machine writes its own log (e.g. <vault>/.sync/<note>.<replica>)
+ * and merges the others'. Enable right after opening the note.
+ *
+ * @param session Pointer to the CEditSession.
+ * @param replica Id of this machine, unique among those syncing; not 0.
+ * @param log_path This machine's log for the note; resumed if it exists.
+ * @return 0 on success, -1 on error.
+ */
+int enableSync(CEditSession *session, uint32_t replica, const char *log_path);
+
+/**
+ * Write this machine's log for the note (atomically).
+ *
+ * @param session Pointer to the CEditSession.
+ * @param log_path Where to write it.
+ * @return 0 on success, -1 on error or if sync is not enabled.
+ */
+int writeSyncLog(CEditSession *session, const char *log_path);
+
+/**
+ * Merge another machine's log into the session's text. Every machine that has
+ * merged the same logs has the same text. Undo history is cleared when the
+ * text changes.
+ *
+ * @param session Pointer to the CEditSession.
+ * @param log_path The other machine's log.
+ * @return 1 if the text changed, 0 if there was nothing new, -1 on error
+ *         (unreadable log, or one that started from a different saved text).
+ */
+int mergeSyncLog(CEditSession *session, const char *log_path);
+
+// ============================================================================
+// Spell Check
+// ============================================================================
+
+/**
+ * A misspelled word: half-open byte range [start, end) in the session text.
+ */
+typedef struct CMisspelling
+{
+    size_t start;
+    size_t end;
+} CMisspelling;
+
+/**
+ * Load the spell check dictionary. The word list (one word per line, hunspell
+ * .dic files work too) is compiled into a compact automaton at cache_path on
+ * first use or when the list is newer, then memory-mapped. Loaded once per
+ * process; later calls are no-ops.
+ *
+ * @param word_list_path Absolute path of the word list.
+ * @param cache_path Absolute path for the compiled dictionary.
+ * @return 0 on success, -1 on error.
+ */
+int loadSpellDictionary(const char *word_list_path, const char *cache_path);
+
+/**
+ * Spell check the blocks overlapping [start_offset, end_offset), usually the
+ * visible range, on a background thread. Unchanged blocks are served from a
+ * cache, so calling this after every edit is cheap.
+ *
+ * @param session Pointer to the CEditSession.
+ * @param start_offset Start byte offset (inclusive).
+ * @param end_offset End byte offset (exclusive).
+ */
+void requestSpellCheck(CEditSession *session, size_t start_offset, size_t end_offset);
+
+/**
+ * Copy the misspellings found for the current text.
+ *
+ * @param session Pointer to the CEditSession.
+ * @param out Array receiving up to max_count ranges.
+ * @param max_count Capacity of out.
+ * @return Number of ranges written, or -1 while the check is still running.
+ */
+ptrdiff_t getMisspellings(CEditSession *session, CMisspelling *out, size_t max_count);
+
+/**
+ * Suggest corrections (up to two edits away), closest first.
+ *
+ * @param word UTF-8 word.
+ * @param word_len Length of word in bytes.
+ * @param out Buffer receiving newline-separated suggestions (not terminated).
+ * @param out_len Capacity of out in bytes.
+ * @return Number of bytes written.
+ */
+size_t getSpellingSuggestions(const char *word, size_t word_len, char *out, size_t out_len);
+
+// ============================================================================
+// Completion
+// ============================================================================
+
+/**
+ * Build the vault's completion index: every word and [[link]] target in its
+ * notes, weighted by how often it occurs, compiled to cache_path and
+ * memory-mapped. Call again to rebuild. Words typed afterwards are counted
+ * in memory and folded into the file on save once enough have accumulated.
+ *
+ * @param vault_root Absolute path of the vault directory.
+ * @param cache_path Absolute path for the compiled index.
+ * @return 0 on success, -1 on error.
+ */
+int loadCompletionIndex(const char *vault_root, const char *cache_path);
+
+/**
+ * Complete the word, or the unclosed [[link, before the cursor. Link
+ * completions include the leading "[[".
+ *
+ * @param session Pointer to the CEditSession.
+ * @param out Buffer receiving newline-separated completions, most frequent
+ *            first (not terminated).
+ * @param out_len Capacity of out in bytes.
+ * @param replace_start Receives the byte offset where the completed prefix
+ *                      starts; a chosen completion replaces it up to the cursor.
+ * @return Number of bytes written.
+ */
+size_t getCompletions(CEditSession *session, char *out, size_t out_len, size_t *replace_start);
+
 // ============================================================================
 // Metal Renderer
 // ============================================================================
 
+/**
+ * When the surface next needs a frame. Lets the MTKView stay paused and draw
+ * on demand; an idle editor only asks for the caret blink phase changes.
+ */
+typedef struct CFrameRequest
+{
+    /** Non-zero if something changed and a frame should be drawn right away */
+    uint8_t immediate;
+    /** Non-zero if delay_seconds holds the time until the next needed frame */
+    uint8_t has_deadline;
+    /** Seconds from now until the next needed frame (valid if has_deadline) */
+    double delay_seconds;
+} CFrameRequest;
+
 /**
  * Initialize the Metal renderer.
  *
@@ -257,6 +700,33 @@ int hit_test(void *renderer, const char *text, int text_len, float view_width, f
  */
 void update_scroll(void *renderer, float delta_y);
 
+/**
+ * Keep drawing every frame for the given time, e.g. while a trackpad scroll
+ * gesture or its momentum is under way.
+ *
+ * @param renderer Opaque renderer handle from surface_init().
+ * @param duration_seconds How long from now to draw continuously.
+ */
+void animate_scroll(void *renderer, double duration_seconds);
+
+/**
+ * Query when the next frame is needed (blink phase change, animation, pending work).
+ * Call after each draw and schedule the next setNeedsDisplay accordingly.
+ *
+ * @param renderer Opaque renderer handle from surface_init().
+ */
+CFrameRequest next_frame_request(void *renderer);
+
+/**
+ * Change the rendered font size (zoom / backing scale change).
+ * The glyph atlas is a distance field, so this only rescales metrics and
+ * never re-rasterizes or re-uploads the atlas texture.
+ *
+ * @param renderer Opaque renderer handle from surface_init().
+ * @param font_size New font size in drawable pixels.
+ */
+void set_font_size(void *renderer, float font_size);
+
 /**
  * Destroy the Metal renderer and release all Metal resources.
  *
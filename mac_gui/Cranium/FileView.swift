@@ -139,7 +139,7 @@ class FileViewModel {
     func sendCursorByteOffset(_ offset: Int) {
         guard let session = editSession else { return }
         setCursorByteOffset(session, clampedOffset(offset))
-        cursorByteOffset = Int(session.pointee.cursor_byte_offset)
+        refreshText()
     }
 
     func beginSelection(at offset: Int) {
@@ -208,6 +208,13 @@ class FileViewModel {
 
     private func refreshText() {
         guard let session = editSession else { return }
+        let changes = session.pointee.changes
+        session.pointee.changes = 0
+        // Cursor moves leave the text alone; skip rebuilding the string
+        guard changes & UInt32(SyncChange_Text.rawValue) != 0 else {
+            cursorByteOffset = Int(session.pointee.cursor_byte_offset)
+            return
+        }
         let length = session.pointee.text_len
         guard let ptr = session.pointee.text_ptr, length > 0 else {
             currentText = ""
@@ -652,6 +659,12 @@ struct FileView: View {
         // Positive scrollingDeltaY = scroll up = decrease scroll offset, so negate
         let scaledDelta = Float(-event.scrollingDeltaY * scale)
         update_scroll(renderer, scaledDelta)
+        // Gesture and momentum events arrive unevenly; draw every frame until
+        // shortly after the last one
+        if event.phase == .began || event.phase == .changed || event.momentumPhase == .began || event.momentumPhase == .changed {
+            animate_scroll(renderer, 0.1)
+        }
+        metalView.needsDisplay = true
     }
 
     private func handleMouseDown(viewModel: FileViewModel, point: NSPoint, in sourceView: NSView) {
@@ -701,6 +714,8 @@ struct BlockTreeView: View {
     let depth: Int
     let activeBlockId: Int
     let editorFont: EditorFont?
+    /// Session of the note, for resolving image links
+    let session: UnsafeMutablePointer<CEditSession>?
     
     /// Block types that handle their own children rendering
     var handlesOwnChildren: Bool {
@@ -731,7 +746,8 @@ struct BlockTreeView: View {
                         block: block.children[index],
                         depth: depth + 1,
                         activeBlockId: activeBlockId,
-                        editorFont: editorFont
+                        editorFont: editorFont,
+                        session: session
                     )
                 }
             }
@@ -784,6 +800,19 @@ struct BlockTreeView: View {
                 Text(stripListMarker(text))
             }
             
+        case BlockType_Frontmatter:
+            // Properties; the raw YAML while the cursor is in it
+            if let text = block.content {
+                let isEditing = block.blockId == activeBlockId
+                Text(isEditing ? text : stripFrontmatterDelimiters(text))
+                    .font(editorFont?.codeFont() ?? .system(.body, design: .monospaced))
+                    .foregroundColor(.secondary)
+                    .padding(8)
+                    .frame(maxWidth: .infinity, alignment: .leading)
+                    .background(Color.gray.opacity(0.1))
+                    .cornerRadius(4)
+            }
+            
         case BlockType_CodeBlock:
             // Code blocks have children that contain the actual code
             VStack(alignment: .leading, spacing: 0) {
@@ -812,7 +841,8 @@ struct BlockTreeView: View {
                             block: block.children[index],
                             depth: depth + 1,
                             activeBlockId: activeBlockId,
-                            editorFont: editorFont
+                            editorFont: editorFont,
+                            session: session
                         )
                     }
                 }
@@ -829,7 +859,8 @@ struct BlockTreeView: View {
                         number: index + 1,
                         depth: depth + 1,
                         activeBlockId: activeBlockId,
-                        editorFont: editorFont
+                        editorFont: editorFont,
+                        session: session
                     )
                 }
             }
@@ -842,7 +873,8 @@ struct BlockTreeView: View {
                         block: block.children[index],
                         depth: depth + 1,
                         activeBlockId: activeBlockId,
-                        editorFont: editorFont
+                        editorFont: editorFont,
+                        session: session
                     )
                 }
             }
@@ -860,7 +892,8 @@ struct BlockTreeView: View {
                             block: block.children[index],
                             depth: depth + 1,
                             activeBlockId: activeBlockId,
-                            editorFont: editorFont
+                            editorFont: editorFont,
+                            session: session
                         )
                     }
                 }
@@ -878,7 +911,8 @@ struct BlockTreeView: View {
                             block: block.children[index],
                             depth: depth + 1,
                             activeBlockId: activeBlockId,
-                            editorFont: editorFont
+                            editorFont: editorFont,
+                            session: session
                         )
                     }
                 }
@@ -911,10 +945,17 @@ struct BlockTreeView: View {
             
         case BlockType_Image:
             if let url = block.urlString {
-                AsyncImage(url: URL(string: url)) { image in
+                let imageURL = URL(string: url)
+                let probedSize = probedImageSize(url)
+                AsyncImage(url: imageURL) { image in
                     image.resizable().aspectRatio(contentMode: .fit)
                 } placeholder: {
-                    ProgressView()
+                    // Reserve the final size so the layout does not jump on load
+                    if let probedSize {
+                        Color.clear.aspectRatio(probedSize, contentMode: .fit)
+                    } else {
+                        ProgressView()
+                    }
                 }
                 .frame(maxHeight: 200)
             }
@@ -926,6 +967,25 @@ struct BlockTreeView: View {
         }
     }
     
+    /// Image size from the backend's header probe (local images only), for
+    /// the path the session resolved the link to
+    func probedImageSize(_ url: String) -> CGSize? {
+        guard let session else { return nil }
+        var size = CImageSize()
+        guard getNoteImageSize(session, url, &size) == 1, size.width > 0, size.height > 0 else { return nil }
+        return CGSize(width: Int(size.width), height: Int(size.height))
+    }
+
+    /// Frontmatter body without its --- lines
+    func stripFrontmatterDelimiters(_ text: String) -> String {
+        var lines = text.components(separatedBy: "\n")
+        if lines.count >= 2 {
+            lines.removeFirst()
+            lines.removeLast()
+        }
+        return lines.joined(separator: "\n")
+    }
+
     /// Strip heading markers (## ) from the beginning of a heading line
     func stripHeadingMarker(_ text: String) -> String {
         var result = text.trimmingCharacters(in: .whitespaces)
@@ -1074,10 +1134,25 @@ struct InlineTextView: View {
         case BlockType_Link:
             // Links in Text need special handling - just show as underlined for now
             return Text(content).underline().foregroundColor(.blue)
+        case BlockType_Embed:
+            // Embedded note: its text, dimmed; unresolved embeds show the target
+            if child.children.isEmpty {
+                return Text("![[\(content)]]").foregroundColor(.secondary)
+            }
+            return Text(embeddedText(child)).foregroundColor(.secondary)
         default:
             return Text(content)
         }
     }
+
+    /// Plain text of an embedded note, one line per block
+    private func embeddedText(_ block: UnsafeMutablePointer<CBlock>) -> String {
+        if block.children.isEmpty {
+            return block.content ?? ""
+        }
+        let separator = block.blockType == BlockType_Paragraph || block.blockType == BlockType_Heading ? "" : "\n"
+        return block.children.map { embeddedText($0) }.joined(separator: separator)
+    }
     
     /// Strip block quote markers (>) from each line in multi-line content
     private func stripBlockQuoteMarkersFromContent(_ text: String) -> String {
@@ -1104,6 +1179,8 @@ struct OrderedListItemView: View {
     let depth: Int
     let activeBlockId: Int
     let editorFont: EditorFont?
+    /// Session of the note, for resolving image links
+    let session: UnsafeMutablePointer<CEditSession>?
     
     var body: some View {
         HStack(alignment: .top, spacing: 4) {
@@ -1116,7 +1193,8 @@ struct OrderedListItemView: View {
                         block: block.children[index],
                         depth: depth + 1,
                         activeBlockId: activeBlockId,
-                        editorFont: editorFont
+                        editorFont: editorFont,
+                        session: session
                     )
                 }
             }
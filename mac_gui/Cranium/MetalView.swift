@@ -15,8 +15,9 @@ struct MetalSurfaceView: NSViewRepresentable {
 
     func makeNSView(context: Context) -> MTKView {
         let view = MTKView()
-        view.enableSetNeedsDisplay = false
-        view.isPaused = false
+        // Draw on demand; the backend reports when the next frame is needed.
+        view.enableSetNeedsDisplay = true
+        view.isPaused = true
         view.preferredFramesPerSecond = 60
 
         // Initialize the Zig Metal renderer, passing the MTKView pointer.
@@ -37,6 +38,7 @@ struct MetalSurfaceView: NSViewRepresentable {
         context.coordinator.cursorByteOffset = cursorByteOffset
         context.coordinator.selectionStartByteOffset = selectionStartByteOffset
         context.coordinator.selectionEndByteOffset = selectionEndByteOffset
+        nsView.needsDisplay = true
     }
 
     class Coordinator: NSObject, MTKViewDelegate {
@@ -45,8 +47,29 @@ struct MetalSurfaceView: NSViewRepresentable {
         var cursorByteOffset: Int = 0
         var selectionStartByteOffset: Int = -1
         var selectionEndByteOffset: Int = -1
+        private var frameTimer: Timer?
 
-        func mtkView(_ view: MTKView, drawableSizeWillChange size: CGSize) {}
+        func mtkView(_ view: MTKView, drawableSizeWillChange size: CGSize) {
+            view.needsDisplay = true
+        }
+
+        /// Ask the backend when the next frame is due and schedule it.
+        func scheduleNextFrame(_ view: MTKView) {
+            guard let renderer = renderer else { return }
+            frameTimer?.invalidate()
+            frameTimer = nil
+
+            let request = next_frame_request(renderer)
+            if request.immediate != 0 {
+                DispatchQueue.main.async { [weak view] in
+                    view?.needsDisplay = true
+                }
+            } else if request.has_deadline != 0 {
+                frameTimer = Timer.scheduledTimer(withTimeInterval: max(request.delay_seconds, 0), repeats: false) { [weak view] _ in
+                    view?.needsDisplay = true
+                }
+            }
+        }
 
         func draw(in view: MTKView) {
             guard let renderer = renderer else { return }
@@ -63,9 +86,11 @@ struct MetalSurfaceView: NSViewRepresentable {
                     Int32(selectionEndByteOffset)
                 )
             }
+            scheduleNextFrame(view)
         }
 
         deinit {
+            frameTimer?.invalidate()
             if let renderer = renderer {
                 surface_deinit(renderer)
             }